@@ -0,0 +1,664 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <vector>
+#include <climits>
+#include <algorithm>
+#include <sstream>
+#include "betree.h"
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/scan_not_initialized_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/end_of_file_exception.h"
+
+namespace badgerdb
+{
+
+static bool keyLess(const BeKey& k1, const BeKey& k2)
+{
+	if(k1.key != k2.key) {
+		return k1.key < k2.key;
+	}
+	if(k1.rid.page_number != k2.rid.page_number) {
+		return k1.rid.page_number < k2.rid.page_number;
+	}
+	return k1.rid.slot_number < k2.rid.slot_number;
+}
+
+static BeKey messageKey(const BeMessage& m)
+{
+	BeKey key;
+	key.set(m.rid, m.key);
+	return key;
+}
+
+static bool messageLess(const BeMessage& m1, const BeMessage& m2)
+{
+	return keyLess(messageKey(m1), messageKey(m2));
+}
+
+static bool messageKeyLess(const BeMessage& m, const BeKey& key)
+{
+	return keyLess(messageKey(m), key);
+}
+
+// apply messages in order to entries sorted by <key,rid>
+static void applyMessages(std::vector<BeKey>& entries, const BeMessage* msgs, const size_t count)
+{
+	for(size_t i = 0; i < count; i++) {
+		BeKey entry = messageKey(msgs[i]);
+		std::vector<BeKey>::iterator it = std::lower_bound(entries.begin(), entries.end(), entry, keyLess);
+		if(msgs[i].type == BEINSERT) {
+			entries.insert(it, entry);
+		} else if(it != entries.end() && !keyLess(entry, *it)) {
+			entries.erase(it);
+		}
+	}
+}
+
+// entries [begin, end) make up leaf, leaves are not linked as scans find the next leaf from the root
+static void fillLeaf(LeafNodeInt* leaf, const std::vector<BeKey>& entries, const int begin, const int end)
+{
+	leaf->rightSibPageNo = 0;
+	leaf->leftSibPageNo = 0;
+	for(int i = 0; i < INTARRAYLEAFSIZE; i++) {
+		if(begin + i < end) {
+			leaf->keyArray[i] = entries[begin+i].key;
+			leaf->ridArray[i] = entries[begin+i].rid;
+		} else {
+			leaf->ridArray[i].page_number = 0;
+		}
+	}
+}
+
+// children [begin, end) of pageNos and the pivots between them make up node
+static void fillNonLeaf(BeNonLeafNodeInt* node, const std::vector<PageId>& pageNos, const std::vector<BeKey>& keys,
+		const int begin, const int end)
+{
+	node->childCount = end - begin;
+	for(int i = begin; i < end; i++) {
+		node->pageNoArray[i-begin] = pageNos[i];
+		if(i > begin) {
+			node->pivotArray[i-begin-1] = keys[i-1];
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::BeTreeIndex -- Constructor
+// -----------------------------------------------------------------------------
+
+BeTreeIndex::BeTreeIndex(const std::string & relationName,
+		std::string & outIndexName,
+		BufMgr *bufMgrIn,
+		const int attrByteOffset,
+		const Datatype attrType)
+{
+	if(attrType != INTEGER) {
+		throw BadIndexInfoException("Bε-tree indexes take INTEGER attributes only");
+	}
+
+	// construct an index name, apart from the B+ tree on the same attribute
+	std::ostringstream idxStr;
+	idxStr << relationName << '.' << attrByteOffset << ".be";
+	std::string indexName = idxStr.str();
+
+	outIndexName = indexName;
+	this->bufMgr = bufMgrIn;
+	this->attrByteOffset = attrByteOffset;
+	this->attributeType = attrType;
+	this->scanExecuting = false;
+
+	if(File::exists(indexName)) {
+		this->file = new BlobFile(indexName, false);
+		this->headerPageNum = file->getFirstPageNo();
+		Page* metaPage;
+		bufMgr->readPage(file, headerPageNum, metaPage);
+		IndexMetaInfo* meta = (IndexMetaInfo*)metaPage;
+		bool match = (meta->attrByteOffset == attrByteOffset && meta->attrType == attrType);
+		rootPageNum = meta->rootPageNo;
+		rootIsLeaf = meta->rootIsLeaf;
+		bufMgr->unPinPage(file, headerPageNum, false);
+		if(!match) {
+			delete file;
+			throw BadIndexInfoException("Index meta page does not match the requested attribute");
+		}
+		return;
+	}
+
+	// else, a new index file is created with an empty leaf as the root
+	this->file = new BlobFile(indexName, true);
+	Page* metaPage;
+	Page* rootPage;
+	bufMgr->allocPage(file, headerPageNum, metaPage);
+	bufMgr->allocPage(file, rootPageNum, rootPage);
+	rootIsLeaf = true;
+
+	IndexMetaInfo* meta = (IndexMetaInfo*)metaPage;
+	strcpy(meta->relationName, relationName.c_str());
+	meta->attrByteOffset = attrByteOffset;
+	meta->attrType = attrType;
+	meta->rootPageNo = rootPageNum;
+	meta->rootIsLeaf = rootIsLeaf;
+	meta->firstFreePageNo = 0;
+	fillLeaf((LeafNodeInt*)rootPage, std::vector<BeKey>(), 0, 0);
+	bufMgr->unPinPage(file, rootPageNum, true);
+	bufMgr->unPinPage(file, headerPageNum, true);
+
+	// entries go in in relation order, which is what the buffers are for
+	FileScan* scan = new FileScan(relationName, bufMgr);
+	try {
+		while(true) {
+			RecordId rid;
+			scan->scanNext(rid);
+			std::string recordString = scan->getRecord();
+			insertEntry(recordString.c_str() + attrByteOffset, rid);
+		}
+	}
+	catch(const EndOfFileException& e) {}
+	delete scan;
+	bufMgr->flushFile(file);
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::~BeTreeIndex -- destructor
+// -----------------------------------------------------------------------------
+
+BeTreeIndex::~BeTreeIndex()
+{
+	scanExecuting = false;
+	bufMgr->flushFile(file);
+	delete file;
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::insertEntry
+// -----------------------------------------------------------------------------
+
+const void BeTreeIndex::insertEntry(const void* key, const RecordId rid)
+{
+	BeMessage msg;
+	msg.key = *(int*)key;
+	msg.rid = rid;
+	msg.type = BEINSERT;
+	addMessage(msg);
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::deleteEntry
+// -----------------------------------------------------------------------------
+
+const void BeTreeIndex::deleteEntry(const void* key, const RecordId rid)
+{
+	BeMessage msg;
+	msg.key = *(int*)key;
+	msg.rid = rid;
+	msg.type = BEDELETE;
+	addMessage(msg);
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::addMessage
+// -----------------------------------------------------------------------------
+
+void BeTreeIndex::addMessage(const BeMessage& msg)
+{
+	std::vector<PageKeyPair<BeKey> > newChildren;
+	if(rootIsLeaf) {
+		// a tree of one leaf has nowhere to buffer
+		applyToLeaf(rootPageNum, std::vector<BeMessage>(1, msg), newChildren);
+		if(!newChildren.empty()) {
+			growRoot(newChildren, 1);
+		}
+		return;
+	}
+
+	Page* page;
+	bufMgr->readPage(file, rootPageNum, page);
+	BeNonLeafNodeInt* root = (BeNonLeafNodeInt*)page;
+	if(root->msgCount == BEBUFFERSIZE) {
+		int level = root->level;
+		bufMgr->unPinPage(file, rootPageNum, false);
+		flushNode(rootPageNum, newChildren, false);
+		if(!newChildren.empty()) {
+			growRoot(newChildren, level + 1);
+		}
+		bufMgr->readPage(file, rootPageNum, page);
+		root = (BeNonLeafNodeInt*)page;
+	}
+
+	// the newest message goes after the others with its key
+	BeMessage* pos = std::upper_bound(root->msgArray, root->msgArray + root->msgCount, msg, messageLess);
+	std::copy_backward(pos, root->msgArray + root->msgCount, root->msgArray + root->msgCount + 1);
+	*pos = msg;
+	root->msgCount++;
+	bufMgr->unPinPage(file, rootPageNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::flushNode
+// -----------------------------------------------------------------------------
+
+void BeTreeIndex::flushNode(const PageId pageNo, std::vector<PageKeyPair<BeKey> >& newChildren, const bool all)
+{
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+	BeNonLeafNodeInt* node = (BeNonLeafNodeInt*)page;
+
+	// messages are sorted, so each child gets a contiguous run of them
+	std::vector<PageId> pageNos;
+	std::vector<BeKey> keys;
+	int first = 0;
+	for(int i = 0; i < node->childCount; i++) {
+		int last = (i == node->childCount - 1) ? node->msgCount
+			: std::lower_bound(node->msgArray + first, node->msgArray + node->msgCount, node->pivotArray[i],
+					messageKeyLess) - node->msgArray;
+		std::vector<BeMessage> msgs(node->msgArray + first, node->msgArray + last);
+		first = last;
+
+		std::vector<PageKeyPair<BeKey> > childNew;
+		if(node->level == 1) {
+			if(!msgs.empty()) {
+				applyToLeaf(node->pageNoArray[i], msgs, childNew);
+			}
+		} else {
+			if(!msgs.empty()) {
+				pushToNonLeaf(node->pageNoArray[i], msgs, childNew);
+			}
+			if(all) {
+				// flush the child and every sibling it split into, their own splits go right after them
+				std::vector<PageKeyPair<BeKey> > group = childNew;
+				childNew.clear();
+				for(int j = 0; j <= (int)group.size(); j++) {
+					PageId memberPageNo = (j == 0) ? node->pageNoArray[i] : group[j-1].pageNo;
+					if(j > 0) {
+						childNew.push_back(group[j-1]);
+					}
+					std::vector<PageKeyPair<BeKey> > memberNew;
+					flushNode(memberPageNo, memberNew, true);
+					childNew.insert(childNew.end(), memberNew.begin(), memberNew.end());
+				}
+			}
+		}
+
+		if(i > 0) {
+			keys.push_back(node->pivotArray[i-1]);
+		}
+		pageNos.push_back(node->pageNoArray[i]);
+		for(size_t j = 0; j < childNew.size(); j++) {
+			keys.push_back(childNew[j].key);
+			pageNos.push_back(childNew[j].pageNo);
+		}
+	}
+	node->msgCount = 0;
+
+	if((int)pageNos.size() <= BEFANOUT) {
+		fillNonLeaf(node, pageNos, keys, 0, pageNos.size());
+	} else {
+		splitNonLeaf(node, pageNos, keys, newChildren);
+	}
+	bufMgr->unPinPage(file, pageNo, true);
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::pushToNonLeaf
+// -----------------------------------------------------------------------------
+
+void BeTreeIndex::pushToNonLeaf(const PageId pageNo, const std::vector<BeMessage>& msgs,
+		std::vector<PageKeyPair<BeKey> >& newChildren)
+{
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+	BeNonLeafNodeInt* node = (BeNonLeafNodeInt*)page;
+	if(node->msgCount + (int)msgs.size() <= BEBUFFERSIZE) {
+		// the child's messages are older, so they stay ahead of the new ones with the same key
+		std::vector<BeMessage> merged(node->msgCount + msgs.size());
+		std::merge(node->msgArray, node->msgArray + node->msgCount, msgs.begin(), msgs.end(), merged.begin(), messageLess);
+		std::copy(merged.begin(), merged.end(), node->msgArray);
+		node->msgCount = merged.size();
+		bufMgr->unPinPage(file, pageNo, true);
+		return;
+	}
+	bufMgr->unPinPage(file, pageNo, false);
+
+	// make room first, the child and the siblings it split into all start out with empty buffers
+	flushNode(pageNo, newChildren, false);
+	size_t first = 0;
+	for(size_t j = 0; j <= newChildren.size(); j++) {
+		size_t last = msgs.size();
+		if(j < newChildren.size()) {
+			last = std::lower_bound(msgs.begin() + first, msgs.end(), newChildren[j].key,
+					messageKeyLess) - msgs.begin();
+		}
+		if(last > first) {
+			PageId memberPageNo = (j == 0) ? pageNo : newChildren[j-1].pageNo;
+			bufMgr->readPage(file, memberPageNo, page);
+			node = (BeNonLeafNodeInt*)page;
+			std::copy(msgs.begin() + first, msgs.begin() + last, node->msgArray);
+			node->msgCount = last - first;
+			bufMgr->unPinPage(file, memberPageNo, true);
+		}
+		first = last;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::applyToLeaf
+// -----------------------------------------------------------------------------
+
+void BeTreeIndex::applyToLeaf(const PageId pageNo, const std::vector<BeMessage>& msgs,
+		std::vector<PageKeyPair<BeKey> >& newChildren)
+{
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+	LeafNodeInt* leaf = (LeafNodeInt*)page;
+	std::vector<BeKey> entries;
+	for(int i = 0; i < INTARRAYLEAFSIZE && leaf->ridArray[i].page_number != 0; i++) {
+		BeKey entry;
+		entry.set(leaf->ridArray[i], leaf->keyArray[i]);
+		entries.push_back(entry);
+	}
+	applyMessages(entries, &msgs[0], msgs.size());
+
+	// an overflowing leaf is cut into leaves about three quarters full
+	int count = entries.size();
+	int pieces = 1;
+	if(count > INTARRAYLEAFSIZE) {
+		pieces = (count + INTARRAYLEAFSIZE * 3 / 4 - 1) / (INTARRAYLEAFSIZE * 3 / 4);
+	}
+	std::vector<int> bounds;
+	for(int j = 0; j <= pieces; j++) {
+		bounds.push_back((int)((long long)count * j / pieces));
+	}
+
+	for(size_t j = 0; j + 1 < bounds.size(); j++) {
+		PageId leafPageNo = pageNo;
+		LeafNodeInt* target = leaf;
+		if(j > 0) {
+			Page* newPage;
+			bufMgr->allocPage(file, leafPageNo, newPage);
+			target = (LeafNodeInt*)newPage;
+			PageKeyPair<BeKey> newChild;
+			newChild.set(leafPageNo, entries[bounds[j]]);
+			newChildren.push_back(newChild);
+		}
+		fillLeaf(target, entries, bounds[j], bounds[j+1]);
+		if(j > 0) {
+			bufMgr->unPinPage(file, leafPageNo, true);
+		}
+	}
+	bufMgr->unPinPage(file, pageNo, true);
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::splitNonLeaf
+// -----------------------------------------------------------------------------
+
+void BeTreeIndex::splitNonLeaf(BeNonLeafNodeInt* node, const std::vector<PageId>& pageNos,
+		const std::vector<BeKey>& keys, std::vector<PageKeyPair<BeKey> >& newChildren)
+{
+	// the pivot between two pieces moves up, the pieces start out with empty buffers
+	int count = pageNos.size();
+	int pieces = (count + BEFANOUT * 3 / 4 - 1) / (BEFANOUT * 3 / 4);
+	for(int j = pieces - 1; j >= 0; j--) {
+		int begin = (int)((long long)count * j / pieces);
+		int end = (int)((long long)count * (j + 1) / pieces);
+		if(j == 0) {
+			fillNonLeaf(node, pageNos, keys, begin, end);
+			break;
+		}
+		PageId newPageNo;
+		Page* newPage;
+		bufMgr->allocPage(file, newPageNo, newPage);
+		BeNonLeafNodeInt* newNode = (BeNonLeafNodeInt*)newPage;
+		newNode->level = node->level;
+		newNode->msgCount = 0;
+		fillNonLeaf(newNode, pageNos, keys, begin, end);
+		bufMgr->unPinPage(file, newPageNo, true);
+		PageKeyPair<BeKey> newChild;
+		newChild.set(newPageNo, keys[begin-1]);
+		newChildren.insert(newChildren.begin(), newChild);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::growRoot
+// -----------------------------------------------------------------------------
+
+void BeTreeIndex::growRoot(std::vector<PageKeyPair<BeKey> >& newChildren, int level)
+{
+	while(!newChildren.empty()) {
+		std::vector<PageId> pageNos(1, rootPageNum);
+		std::vector<BeKey> keys;
+		for(size_t i = 0; i < newChildren.size(); i++) {
+			pageNos.push_back(newChildren[i].pageNo);
+			keys.push_back(newChildren[i].key);
+		}
+		newChildren.clear();
+
+		PageId newRootPageNo;
+		Page* page;
+		bufMgr->allocPage(file, newRootPageNo, page);
+		BeNonLeafNodeInt* root = (BeNonLeafNodeInt*)page;
+		root->level = level;
+		root->msgCount = 0;
+		if((int)pageNos.size() <= BEFANOUT) {
+			fillNonLeaf(root, pageNos, keys, 0, pageNos.size());
+		} else {
+			splitNonLeaf(root, pageNos, keys, newChildren);
+		}
+		bufMgr->unPinPage(file, newRootPageNo, true);
+		setRoot(newRootPageNo, false);
+		level++;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::setRoot
+// -----------------------------------------------------------------------------
+
+void BeTreeIndex::setRoot(const PageId pageNo, const bool isLeaf)
+{
+	rootPageNum = pageNo;
+	rootIsLeaf = isLeaf;
+	Page* metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	((IndexMetaInfo*)metaPage)->rootPageNo = pageNo;
+	((IndexMetaInfo*)metaPage)->rootIsLeaf = isLeaf;
+	bufMgr->unPinPage(file, headerPageNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::flushMessages
+// -----------------------------------------------------------------------------
+
+void BeTreeIndex::flushMessages()
+{
+	if(rootIsLeaf) {
+		return;
+	}
+	Page* page;
+	bufMgr->readPage(file, rootPageNum, page);
+	int level = ((BeNonLeafNodeInt*)page)->level;
+	bufMgr->unPinPage(file, rootPageNum, false);
+
+	std::vector<PageKeyPair<BeKey> > newChildren;
+	flushNode(rootPageNum, newChildren, true);
+	growRoot(newChildren, level + 1);
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::findChildPos
+// -----------------------------------------------------------------------------
+
+int BeTreeIndex::findChildPos(const BeNonLeafNodeInt* node, const BeKey& key) const
+{
+	return std::upper_bound(node->pivotArray, node->pivotArray + node->childCount - 1, key, keyLess) - node->pivotArray;
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::readLeafEntries
+// -----------------------------------------------------------------------------
+
+bool BeTreeIndex::readLeafEntries(const BeKey& key, std::vector<BeKey>& entries, BeKey& nextKey)
+{
+	// collect what is pending for key's child on the way down, narrowing the key range of the leaf
+	std::vector<std::vector<BeMessage> > pending;
+	bool hasLow = false, hasHigh = false;
+	BeKey low = key, high = key;
+	PageId pageNo = rootPageNum;
+	bool isLeaf = rootIsLeaf;
+	while(!isLeaf) {
+		Page* page;
+		bufMgr->readPage(file, pageNo, page);
+		BeNonLeafNodeInt* node = (BeNonLeafNodeInt*)page;
+		int pos = findChildPos(node, key);
+		if(pos > 0 && (!hasLow || keyLess(low, node->pivotArray[pos-1]))) {
+			low = node->pivotArray[pos-1];
+			hasLow = true;
+		}
+		if(pos < node->childCount - 1 && (!hasHigh || keyLess(node->pivotArray[pos], high))) {
+			high = node->pivotArray[pos];
+			hasHigh = true;
+		}
+		pending.push_back(std::vector<BeMessage>(node->msgArray, node->msgArray + node->msgCount));
+		isLeaf = (node->level == 1);
+		PageId childPageNo = node->pageNoArray[pos];
+		bufMgr->unPinPage(file, pageNo, false);
+		pageNo = childPageNo;
+	}
+
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+	LeafNodeInt* leaf = (LeafNodeInt*)page;
+	entries.clear();
+	for(int i = 0; i < INTARRAYLEAFSIZE && leaf->ridArray[i].page_number != 0; i++) {
+		BeKey entry;
+		entry.set(leaf->ridArray[i], leaf->keyArray[i]);
+		entries.push_back(entry);
+	}
+	bufMgr->unPinPage(file, pageNo, false);
+
+	// the deepest messages are the oldest
+	for(size_t level = pending.size(); level > 0; level--) {
+		std::vector<BeMessage>& msgs = pending[level-1];
+		std::vector<BeMessage>::iterator begin = msgs.begin(), end = msgs.end();
+		if(hasLow) {
+			begin = std::lower_bound(msgs.begin(), msgs.end(), low, messageKeyLess);
+		}
+		if(hasHigh) {
+			end = std::lower_bound(begin, msgs.end(), high, messageKeyLess);
+		}
+		if(begin != end) {
+			applyMessages(entries, &*begin, end - begin);
+		}
+	}
+	nextKey = high;
+	return hasHigh;
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::startScan
+// -----------------------------------------------------------------------------
+
+const void BeTreeIndex::startScan(const void* lowValParm,
+				   const Operator lowOpParm,
+				   const void* highValParm,
+				   const Operator highOpParm)
+{
+	lowValInt = *(int *)lowValParm;
+	highValInt = *(int *)highValParm;
+	lowOp = lowOpParm;
+	highOp = highOpParm;
+	if(lowValInt > highValInt) {
+		throw BadScanrangeException();
+	}
+	if(lowOpParm != GTE && lowOpParm != GT) {
+		throw BadOpcodesException();
+	}
+	if(highOpParm != LTE && highOpParm != LT) {
+		throw BadOpcodesException();
+	}
+
+	// skip leaves that end up empty or hold nothing past the low end
+	scanExecuting = true;
+	BeKey key;
+	key.rid.page_number = 0;
+	key.rid.slot_number = 0;
+	key.key = lowValInt;
+	while(true) {
+		lastLeaf = !readLeafEntries(key, scanEntries, nextLeafKey);
+		nextEntry = 0;
+		while(nextEntry < scanEntries.size() && (scanEntries[nextEntry].key < lowValInt
+				|| (lowOp == GT && scanEntries[nextEntry].key == lowValInt))) {
+			nextEntry++;
+		}
+		if(nextEntry < scanEntries.size()) {
+			if(!pastHighVal(scanEntries[nextEntry].key)) {
+				return;
+			}
+			break;
+		}
+		if(lastLeaf || pastHighVal(nextLeafKey.key)) {
+			break;
+		}
+		key = nextLeafKey;
+	}
+	scanExecuting = false;
+	throw NoSuchKeyFoundException();
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::scanNext
+// -----------------------------------------------------------------------------
+
+const void BeTreeIndex::scanNext(RecordId& outRid)
+{
+	if(!scanExecuting) {
+		throw ScanNotInitializedException();
+	}
+	while(nextEntry == scanEntries.size()) {
+		if(lastLeaf || pastHighVal(nextLeafKey.key)) {
+			throw IndexScanCompletedException();
+		}
+		lastLeaf = !readLeafEntries(nextLeafKey, scanEntries, nextLeafKey);
+		nextEntry = 0;
+	}
+	if(pastHighVal(scanEntries[nextEntry].key)) {
+		throw IndexScanCompletedException();
+	}
+	outRid = scanEntries[nextEntry].rid;
+	nextEntry++;
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::pastHighVal
+// -----------------------------------------------------------------------------
+
+bool BeTreeIndex::pastHighVal(const int key) const
+{
+	return (highOp == LT && key >= highValInt) || (highOp == LTE && key > highValInt);
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::endScan
+// -----------------------------------------------------------------------------
+
+const void BeTreeIndex::endScan()
+{
+	if(!scanExecuting) {
+		throw ScanNotInitializedException();
+	}
+	scanExecuting = false;
+	scanEntries.clear();
+}
+
+}
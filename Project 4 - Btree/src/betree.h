@@ -0,0 +1,312 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Maximum number of children of a Bε-tree non-leaf. The rest of the page buffers messages.
+ */
+const  int BEFANOUT = 32;
+
+/**
+ * @brief Kinds of message buffered in Bε-tree non-leaves.
+ */
+enum BeMessageType
+{
+	BEINSERT = 0,
+	BEDELETE = 1
+};
+
+/**
+ * @brief An insert or delete of <key,rid> on its way down to a leaf.
+ */
+struct BeMessage{
+	int key;
+	RecordId rid;
+	int type;
+};
+
+/**
+ * @brief Bε-tree entries, pivots and messages are ordered by <key,rid>, so entries with the same key can be
+ * split across leaves and a delete still finds its leaf.
+ */
+typedef RIDKeyPair<int> BeKey;
+
+/**
+ * @brief Number of messages a Bε-tree non-leaf can buffer.
+ */
+//                                                 level and counts            pivots                              children
+const  int BEBUFFERSIZE = ( Page::SIZE - 3 * sizeof( int ) - ( BEFANOUT - 1 ) * sizeof( BeKey ) - BEFANOUT * sizeof( PageId ) ) / sizeof( BeMessage );
+
+/**
+ * @brief Structure for the non-leaf nodes of a Bε-tree with INTEGER keys.
+ * Child i holds the entries e with pivotArray[i-1] <= e < pivotArray[i]. Buffered messages are sorted by <key,rid>,
+ * messages for the same entry in the order they arrived, and are all older than the messages in the parent.
+*/
+struct BeNonLeafNodeInt{
+  /**
+   * Level of the node in the tree, 1 right above the leaves.
+   */
+	int level;
+
+  /**
+   * Number of children.
+   */
+	int childCount;
+
+  /**
+   * Number of buffered messages.
+   */
+	int msgCount;
+
+  /**
+   * Pivot keys.
+   */
+	BeKey pivotArray[ BEFANOUT - 1 ];
+
+  /**
+   * Page numbers of the children.
+   */
+	PageId pageNoArray[ BEFANOUT ];
+
+  /**
+   * Buffered messages.
+   */
+	BeMessage msgArray[ BEBUFFERSIZE ];
+};
+
+
+/**
+ * @brief Write optimized index on an INTEGER attribute: a Bε-tree.
+ *
+ * Inserts and deletes are added as messages to the buffer of the root. A full buffer is flushed to the
+ * children in one go, so a leaf takes in a whole batch of entries per write instead of one entry per
+ * insertEntry(). Leaves use the LeafNodeInt layout of BTreeIndex. Scans merge the messages still pending
+ * above a leaf into its entries.
+ *
+ * Deletes are blind: a delete of an entry that is not in the index is dropped when it reaches a leaf.
+*/
+class BeTreeIndex {
+
+ private:
+
+  /**
+   * File object for the index file.
+   */
+	File		*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * Page number of root page of the tree inside index file.
+   */
+	PageId	rootPageNum;
+
+  /**
+   * True if the root page is a leaf.
+   */
+	bool		rootIsLeaf;
+
+  /**
+   * Byte offset of attribute in the record.
+   */
+	int			attrByteOffset;
+
+  /**
+   * Datatype of attribute over which index is built.
+   */
+	Datatype	attributeType;
+
+	// MEMBERS SPECIFIC TO SCANNING
+
+  /**
+   * True if an index scan has been started.
+   */
+	bool		scanExecuting;
+
+  /**
+   * Entries of the current leaf with the pending messages applied, in key order.
+   */
+	std::vector<BeKey> scanEntries;
+
+  /**
+   * Index of the next entry of scanEntries to return.
+   */
+	size_t	nextEntry;
+
+  /**
+   * Smallest entry of the leaf after the current one.
+   */
+	BeKey		nextLeafKey;
+
+  /**
+   * True if the current leaf is the last one.
+   */
+	bool		lastLeaf;
+
+  /**
+   * Low INTEGER value for scan.
+   */
+	int			lowValInt;
+
+  /**
+   * High INTEGER value for scan.
+   */
+	int			highValInt;
+
+  /**
+   * Low Operator. Can only be GT(>) or GTE(>=).
+   */
+	Operator	lowOp;
+
+  /**
+   * High Operator. Can only be LT(<) or LTE(<=).
+   */
+	Operator	highOp;
+
+  /**
+	 * Add a message to the root, flushing the root buffer first if it is full.
+	**/
+	void addMessage(const BeMessage& msg);
+
+  /**
+	 * Push every message buffered in non-leaf pageNo down to its children. Children that split add pivots to
+	 * pageNo, which is split in turn if it runs out of room.
+	 * @param newChildren	Receives <first entry, page number> of the new right siblings of pageNo
+	 * @param all	Flush the whole subtree down to the leaves
+	**/
+	void flushNode(const PageId pageNo, std::vector<PageKeyPair<BeKey> >& newChildren, const bool all);
+
+  /**
+	 * Add messages to the buffer of non-leaf pageNo, flushing pageNo first if they do not fit.
+	 * @param newChildren	Receives <first entry, page number> of the new right siblings of pageNo
+	**/
+	void pushToNonLeaf(const PageId pageNo, const std::vector<BeMessage>& msgs,
+			std::vector<PageKeyPair<BeKey> >& newChildren);
+
+  /**
+	 * Apply messages to leaf pageNo, splitting it into as many leaves as its entries need.
+	 * @param newChildren	Receives <first entry, page number> of the new right siblings of pageNo
+	**/
+	void applyToLeaf(const PageId pageNo, const std::vector<BeMessage>& msgs,
+			std::vector<PageKeyPair<BeKey> >& newChildren);
+
+  /**
+	 * Split the children and pivots of a non-leaf that no longer fit into it across new right siblings.
+	 * @param newChildren	Receives <pivot, page number> of the new right siblings
+	**/
+	void splitNonLeaf(BeNonLeafNodeInt* node, const std::vector<PageId>& pageNos, const std::vector<BeKey>& keys,
+			std::vector<PageKeyPair<BeKey> >& newChildren);
+
+  /**
+	 * Put new non-leaves above the root until a single root is left.
+	**/
+	void growRoot(std::vector<PageKeyPair<BeKey> >& newChildren, int level);
+
+  /**
+	 * Update the root in the meta page.
+	**/
+	void setRoot(const PageId pageNo, const bool isLeaf);
+
+  /**
+	 * Find the leaf that holds key and its entries with the messages pending above it applied.
+	 * @param entries	Receives the entries of the leaf in <key,rid> order
+	 * @param nextKey	Set to the smallest entry of the next leaf
+	 * @return true if there is a next leaf
+	**/
+	bool readLeafEntries(const BeKey& key, std::vector<BeKey>& entries, BeKey& nextKey);
+
+  /**
+	 * @return child of node whose range holds key
+	**/
+	int findChildPos(const BeNonLeafNodeInt* node, const BeKey& key) const;
+
+  /**
+	 * @return true if key is beyond the high end of the current scan range
+	**/
+	bool pastHighVal(const int key) const;
+
+ public:
+
+  /**
+	 * Open the index on attrByteOffset of relationName, or create it and insert an entry for every record
+	 * if there is none yet.
+   * @param relationName	Name of file
+   * @param outIndexName	Return the name of index file
+   * @param bufMgrIn			Buffer Manager Instance
+   * @param attrByteOffset	Offset of attribute, over which index is to be built, in the record
+   * @param attrType			Datatype of attribute over which index is built, INTEGER only
+	 * @throws  BadIndexInfoException If an existing index file does not match attrByteOffset and attrType.
+	**/
+	BeTreeIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn, const int attrByteOffset, const Datatype attrType);
+
+  /**
+	 * Destructor. Ends any scan and flushes the index file, buffered messages stay in their nodes.
+	**/
+	~BeTreeIndex();
+
+  /**
+	 * Insert a new entry using the pair <value,rid>.
+   * @param key			Key to insert, pointer to integer
+   * @param rid			Record ID of a record whose entry is getting inserted into the index.
+	**/
+	const void insertEntry(const void* key, const RecordId rid);
+
+  /**
+	 * Delete the entry <key,rid>. The delete is buffered like an insert, see the class description.
+	**/
+	const void deleteEntry(const void* key, const RecordId rid);
+
+  /**
+	 * Push all buffered messages down to the leaves.
+	**/
+	void flushMessages();
+
+  /**
+	 * Begin a filtered scan of the index, like BTreeIndex::startScan().
+	 * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+	 * @throws  BadScanrangeException If lowVal > highval
+	 * @throws  NoSuchKeyFoundException If there is no key in the index that satisfies the scan criteria.
+	**/
+	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+  /**
+	 * Fetch the record id of the next index entry that matches the scan.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	**/
+	const void scanNext(RecordId& outRid);
+
+  /**
+	 * Terminate the current scan.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	const void endScan();
+};
+
+}
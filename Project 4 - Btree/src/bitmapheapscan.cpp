@@ -0,0 +1,122 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <vector>
+#include "bitmapheapscan.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/scan_not_initialized_exception.h"
+
+namespace badgerdb
+{
+
+// -----------------------------------------------------------------------------
+// BitmapHeapScan::BitmapHeapScan -- Constructor
+// -----------------------------------------------------------------------------
+
+BitmapHeapScan::BitmapHeapScan(const std::string & relationName, BufMgr *bufMgrIn)
+{
+	this->relationName = relationName;
+	this->bufMgr = bufMgrIn;
+	this->hasRids = false;
+	this->scan = NULL;
+}
+
+// -----------------------------------------------------------------------------
+// BitmapHeapScan::~BitmapHeapScan -- destructor
+// -----------------------------------------------------------------------------
+
+BitmapHeapScan::~BitmapHeapScan()
+{
+	endFetch();
+}
+
+// -----------------------------------------------------------------------------
+// BitmapHeapScan::addIndexScan
+// -----------------------------------------------------------------------------
+
+void BitmapHeapScan::addIndexScan(BTreeIndex *index, const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp)
+{
+	RoaringBitmap found;
+	try
+	{
+		index->startScan(lowVal, lowOp, highVal, highOp);
+	}
+	catch(const NoSuchKeyFoundException& e)
+	{
+		addBitmap(found);
+		return;
+	}
+
+	RecordId batch[HEAPSCANBATCHSIZE];
+	size_t count;
+	while((count = index->scanNextBatch(batch, HEAPSCANBATCHSIZE)) > 0) {
+		for(size_t i = 0; i < count; i++) {
+			found.add(RoaringBitmap::ridValue(batch[i]));
+		}
+	}
+	index->endScan();
+	addBitmap(found);
+}
+
+// -----------------------------------------------------------------------------
+// BitmapHeapScan::addBitmap
+// -----------------------------------------------------------------------------
+
+void BitmapHeapScan::addBitmap(const RoaringBitmap& bitmap)
+{
+	rids = hasRids ? rids.andWith(bitmap) : bitmap;
+	hasRids = true;
+}
+
+// -----------------------------------------------------------------------------
+// BitmapHeapScan::getRidCount
+// -----------------------------------------------------------------------------
+
+size_t BitmapHeapScan::getRidCount() const
+{
+	return rids.cardinality();
+}
+
+// -----------------------------------------------------------------------------
+// BitmapHeapScan::startFetch
+// -----------------------------------------------------------------------------
+
+void BitmapHeapScan::startFetch()
+{
+	endFetch();
+	std::vector<RecordId> ridList;
+	rids.toRids(ridList);
+	scan = new FileScan(relationName, bufMgr);
+	scan->restrictTo(ridList);
+}
+
+// -----------------------------------------------------------------------------
+// BitmapHeapScan::fetchNext
+// -----------------------------------------------------------------------------
+
+void BitmapHeapScan::fetchNext(RecordId& outRid, std::string& outRecord)
+{
+	if(scan == NULL) {
+		throw ScanNotInitializedException();
+	}
+	scan->scanNext(outRid);
+	outRecord = scan->getRecord();
+}
+
+// -----------------------------------------------------------------------------
+// BitmapHeapScan::endFetch
+// -----------------------------------------------------------------------------
+
+void BitmapHeapScan::endFetch()
+{
+	if(scan != NULL) {
+		delete scan;
+		scan = NULL;
+	}
+}
+
+}
@@ -0,0 +1,115 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "types.h"
+#include "buffer.h"
+#include "btree.h"
+#include "bitmapindex.h"
+#include "filescan.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of record ids taken from an index scan per BTreeIndex::scanNextBatch() call.
+ */
+const  int HEAPSCANBATCHSIZE = 1024;
+
+/**
+ * @brief Fetch of the records found by one or more index scans, in page order.
+ *
+ * The record ids of each index scan are collected into a RoaringBitmap instead of being fetched in key
+ * order, and the bitmaps of several scans are intersected. The fetch then reads each heap page holding a
+ * qualifying record once and takes all of its qualifying slots from it, however the records were ordered
+ * in the indexes.
+*/
+class BitmapHeapScan {
+
+ private:
+
+  /**
+   * Name of the relation the records are fetched from.
+   */
+	std::string	relationName;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Record ids of the records to fetch.
+   */
+	RoaringBitmap	rids;
+
+  /**
+   * False until the first set of record ids is added, every later set is intersected with rids.
+   */
+	bool		hasRids;
+
+  /**
+   * Scan of the relation restricted to rids, NULL until startFetch() is called.
+   */
+	FileScan	*scan;
+
+ public:
+
+  /**
+	 * Start collecting record ids of relationName.
+   * @param relationName	Name of file
+   * @param bufMgrIn			Buffer Manager Instance
+	**/
+	BitmapHeapScan(const std::string & relationName, BufMgr *bufMgrIn);
+
+  /**
+	 * Destructor. Ends the fetch if there is one.
+	**/
+	~BitmapHeapScan();
+
+  /**
+	 * Run a scan of index, given as for BTreeIndex::startScan(), and intersect its record ids with those
+	 * collected so far. A scan without results leaves nothing to fetch.
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   * @throws  BadScanrangeException If lowVal > highval
+	**/
+	void addIndexScan(BTreeIndex *index, const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+  /**
+	 * Intersect the record ids collected so far with bitmap, e.g. one from a BitmapIndex.
+	**/
+	void addBitmap(const RoaringBitmap& bitmap);
+
+  /**
+	 * @return number of records the fetch returns
+	**/
+	size_t getRidCount() const;
+
+  /**
+	 * Start fetching the records of the record ids collected so far, in page order.
+	**/
+	void startFetch();
+
+  /**
+	 * Fetch the next record.
+   * @param outRid			Record id of the record
+   * @param outRecord		Record
+	 * @throws ScanNotInitializedException If startFetch() has not been called.
+	 * @throws EndOfFileException If every record has been fetched.
+	**/
+	void fetchNext(RecordId& outRid, std::string& outRecord);
+
+  /**
+	 * End the fetch, unpinning the page it is on.
+	**/
+	void endFetch();
+};
+
+}
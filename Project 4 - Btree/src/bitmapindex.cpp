@@ -0,0 +1,633 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <sstream>
+#include "bitmapindex.h"
+#include "compositeindex.h"
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/end_of_file_exception.h"
+#include "exceptions/invalid_record_exception.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace badgerdb
+{
+
+enum RoaringOp
+{
+	ROARINGAND,
+	ROARINGOR,
+	ROARINGANDNOT
+};
+
+static bool containerKeyLess(const RoaringContainer& c, const std::uint16_t key)
+{
+	return c.key < key;
+}
+
+static void setBit(std::vector<std::uint64_t>& bits, const std::uint16_t low)
+{
+	bits[low >> 6] |= (std::uint64_t)1 << (low & 63);
+}
+
+static bool testBit(const std::vector<std::uint64_t>& bits, const std::uint16_t low)
+{
+	return (bits[low >> 6] >> (low & 63)) & 1;
+}
+
+// keep the container in the smaller of its two forms
+static void normalize(RoaringContainer& c)
+{
+	if(c.bits.empty() && c.cardinality > ROARINGARRAYMAX) {
+		c.bits.assign(ROARINGBITMAPWORDS, 0);
+		for(size_t i = 0; i < c.array.size(); i++) {
+			setBit(c.bits, c.array[i]);
+		}
+		c.array.clear();
+	} else if(!c.bits.empty() && c.cardinality <= ROARINGARRAYMAX) {
+		c.array.clear();
+		for(int i = 0; i < ROARINGBITMAPWORDS; i++) {
+			for(std::uint64_t word = c.bits[i]; word != 0; word &= word - 1) {
+				c.array.push_back(i * 64 + __builtin_ctzll(word));
+			}
+		}
+		c.bits.clear();
+	}
+}
+
+// combine two bitmap containers word by word
+static int bitmapKernel(const std::uint64_t* a, const std::uint64_t* b, std::uint64_t* out, const int op)
+{
+#ifdef __SSE2__
+	for(int i = 0; i < ROARINGBITMAPWORDS; i += 2) {
+		__m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+		__m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+		__m128i vr;
+		if(op == ROARINGAND) {
+			vr = _mm_and_si128(va, vb);
+		} else if(op == ROARINGOR) {
+			vr = _mm_or_si128(va, vb);
+		} else {
+			vr = _mm_andnot_si128(vb, va);
+		}
+		_mm_storeu_si128((__m128i*)(out + i), vr);
+	}
+#else
+	for(int i = 0; i < ROARINGBITMAPWORDS; i++) {
+		if(op == ROARINGAND) {
+			out[i] = a[i] & b[i];
+		} else if(op == ROARINGOR) {
+			out[i] = a[i] | b[i];
+		} else {
+			out[i] = a[i] & ~b[i];
+		}
+	}
+#endif
+	int cardinality = 0;
+	for(int i = 0; i < ROARINGBITMAPWORDS; i++) {
+		cardinality += __builtin_popcountll(out[i]);
+	}
+	return cardinality;
+}
+
+// combine two containers with the same key
+static RoaringContainer combine(const RoaringContainer& a, const RoaringContainer& b, const int op)
+{
+	RoaringContainer c;
+	c.key = a.key;
+	if(!a.bits.empty() && !b.bits.empty()) {
+		c.bits.resize(ROARINGBITMAPWORDS);
+		c.cardinality = bitmapKernel(&a.bits[0], &b.bits[0], &c.bits[0], op);
+	} else if(a.bits.empty() && b.bits.empty()) {
+		if(op == ROARINGAND) {
+			std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(c.array));
+		} else if(op == ROARINGOR) {
+			std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(c.array));
+		} else {
+			std::set_difference(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(c.array));
+		}
+		c.cardinality = c.array.size();
+	} else if(op == ROARINGOR) {
+		// set the values of the array container in a copy of the bitmap container
+		const RoaringContainer& bitmap = a.bits.empty() ? b : a;
+		const RoaringContainer& array = a.bits.empty() ? a : b;
+		c.bits = bitmap.bits;
+		c.cardinality = bitmap.cardinality;
+		for(size_t i = 0; i < array.array.size(); i++) {
+			if(!testBit(c.bits, array.array[i])) {
+				setBit(c.bits, array.array[i]);
+				c.cardinality++;
+			}
+		}
+	} else if(a.bits.empty()) {
+		// an array container minus or intersected with a bitmap container stays small
+		for(size_t i = 0; i < a.array.size(); i++) {
+			if(testBit(b.bits, a.array[i]) == (op == ROARINGAND)) {
+				c.array.push_back(a.array[i]);
+			}
+		}
+		c.cardinality = c.array.size();
+	} else if(op == ROARINGAND) {
+		for(size_t i = 0; i < b.array.size(); i++) {
+			if(testBit(a.bits, b.array[i])) {
+				c.array.push_back(b.array[i]);
+			}
+		}
+		c.cardinality = c.array.size();
+	} else {
+		c.bits = a.bits;
+		c.cardinality = a.cardinality;
+		for(size_t i = 0; i < b.array.size(); i++) {
+			if(testBit(c.bits, b.array[i])) {
+				c.bits[b.array[i] >> 6] &= ~((std::uint64_t)1 << (b.array[i] & 63));
+				c.cardinality--;
+			}
+		}
+	}
+	normalize(c);
+	return c;
+}
+
+// -----------------------------------------------------------------------------
+// RoaringBitmap::ridValue
+// -----------------------------------------------------------------------------
+
+std::uint32_t RoaringBitmap::ridValue(const RecordId& rid)
+{
+	// a value holds the page number in its high 16 bits, so a larger one would alias a lower page
+	if(rid.page_number > 0xFFFF)
+		throw InvalidRecordException(rid, rid.page_number);
+	return ((std::uint32_t)rid.page_number << 16) | rid.slot_number;
+}
+
+// -----------------------------------------------------------------------------
+// RoaringBitmap::valueRid
+// -----------------------------------------------------------------------------
+
+RecordId RoaringBitmap::valueRid(const std::uint32_t value)
+{
+	RecordId rid;
+	rid.page_number = value >> 16;
+	rid.slot_number = value & 0xFFFF;
+	return rid;
+}
+
+// -----------------------------------------------------------------------------
+// RoaringBitmap::add
+// -----------------------------------------------------------------------------
+
+void RoaringBitmap::add(const std::uint32_t value)
+{
+	std::uint16_t key = value >> 16;
+	std::uint16_t low = value & 0xFFFF;
+	std::vector<RoaringContainer>::iterator it = std::lower_bound(containers.begin(), containers.end(), key, containerKeyLess);
+	if(it == containers.end() || it->key != key) {
+		RoaringContainer c;
+		c.key = key;
+		c.cardinality = 0;
+		it = containers.insert(it, c);
+	}
+	if(!it->bits.empty()) {
+		if(!testBit(it->bits, low)) {
+			setBit(it->bits, low);
+			it->cardinality++;
+		}
+		return;
+	}
+	std::vector<std::uint16_t>::iterator pos = std::lower_bound(it->array.begin(), it->array.end(), low);
+	if(pos == it->array.end() || *pos != low) {
+		it->array.insert(pos, low);
+		it->cardinality++;
+		normalize(*it);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// RoaringBitmap::remove
+// -----------------------------------------------------------------------------
+
+void RoaringBitmap::remove(const std::uint32_t value)
+{
+	std::uint16_t key = value >> 16;
+	std::uint16_t low = value & 0xFFFF;
+	std::vector<RoaringContainer>::iterator it = std::lower_bound(containers.begin(), containers.end(), key, containerKeyLess);
+	if(it == containers.end() || it->key != key) {
+		return;
+	}
+	if(!it->bits.empty()) {
+		if(!testBit(it->bits, low)) {
+			return;
+		}
+		it->bits[low >> 6] &= ~((std::uint64_t)1 << (low & 63));
+	} else {
+		std::vector<std::uint16_t>::iterator pos = std::lower_bound(it->array.begin(), it->array.end(), low);
+		if(pos == it->array.end() || *pos != low) {
+			return;
+		}
+		it->array.erase(pos);
+	}
+	it->cardinality--;
+	if(it->cardinality == 0) {
+		containers.erase(it);
+	} else {
+		normalize(*it);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// RoaringBitmap::contains
+// -----------------------------------------------------------------------------
+
+bool RoaringBitmap::contains(const std::uint32_t value) const
+{
+	std::uint16_t key = value >> 16;
+	std::uint16_t low = value & 0xFFFF;
+	std::vector<RoaringContainer>::const_iterator it = std::lower_bound(containers.begin(), containers.end(), key, containerKeyLess);
+	if(it == containers.end() || it->key != key) {
+		return false;
+	}
+	if(!it->bits.empty()) {
+		return testBit(it->bits, low);
+	}
+	return std::binary_search(it->array.begin(), it->array.end(), low);
+}
+
+// -----------------------------------------------------------------------------
+// RoaringBitmap::cardinality
+// -----------------------------------------------------------------------------
+
+size_t RoaringBitmap::cardinality() const
+{
+	size_t count = 0;
+	for(size_t i = 0; i < containers.size(); i++) {
+		count += containers[i].cardinality;
+	}
+	return count;
+}
+
+// -----------------------------------------------------------------------------
+// RoaringBitmap::andWith
+// -----------------------------------------------------------------------------
+
+RoaringBitmap RoaringBitmap::andWith(const RoaringBitmap& other) const
+{
+	RoaringBitmap result;
+	size_t i = 0, j = 0;
+	while(i < containers.size() && j < other.containers.size()) {
+		if(containers[i].key < other.containers[j].key) {
+			i++;
+		} else if(containers[i].key > other.containers[j].key) {
+			j++;
+		} else {
+			RoaringContainer c = combine(containers[i++], other.containers[j++], ROARINGAND);
+			if(c.cardinality > 0) {
+				result.containers.push_back(c);
+			}
+		}
+	}
+	return result;
+}
+
+// -----------------------------------------------------------------------------
+// RoaringBitmap::orWith
+// -----------------------------------------------------------------------------
+
+RoaringBitmap RoaringBitmap::orWith(const RoaringBitmap& other) const
+{
+	RoaringBitmap result;
+	size_t i = 0, j = 0;
+	while(i < containers.size() || j < other.containers.size()) {
+		if(j == other.containers.size() || (i < containers.size() && containers[i].key < other.containers[j].key)) {
+			result.containers.push_back(containers[i++]);
+		} else if(i == containers.size() || containers[i].key > other.containers[j].key) {
+			result.containers.push_back(other.containers[j++]);
+		} else {
+			result.containers.push_back(combine(containers[i++], other.containers[j++], ROARINGOR));
+		}
+	}
+	return result;
+}
+
+// -----------------------------------------------------------------------------
+// RoaringBitmap::andNotWith
+// -----------------------------------------------------------------------------
+
+RoaringBitmap RoaringBitmap::andNotWith(const RoaringBitmap& other) const
+{
+	RoaringBitmap result;
+	size_t j = 0;
+	for(size_t i = 0; i < containers.size(); i++) {
+		while(j < other.containers.size() && other.containers[j].key < containers[i].key) {
+			j++;
+		}
+		if(j == other.containers.size() || other.containers[j].key != containers[i].key) {
+			result.containers.push_back(containers[i]);
+			continue;
+		}
+		RoaringContainer c = combine(containers[i], other.containers[j], ROARINGANDNOT);
+		if(c.cardinality > 0) {
+			result.containers.push_back(c);
+		}
+	}
+	return result;
+}
+
+// -----------------------------------------------------------------------------
+// RoaringBitmap::toRids
+// -----------------------------------------------------------------------------
+
+void RoaringBitmap::toRids(std::vector<RecordId>& outRids) const
+{
+	for(size_t i = 0; i < containers.size(); i++) {
+		std::uint32_t high = (std::uint32_t)containers[i].key << 16;
+		if(containers[i].bits.empty()) {
+			for(size_t j = 0; j < containers[i].array.size(); j++) {
+				outRids.push_back(valueRid(high | containers[i].array[j]));
+			}
+			continue;
+		}
+		for(int j = 0; j < ROARINGBITMAPWORDS; j++) {
+			for(std::uint64_t word = containers[i].bits[j]; word != 0; word &= word - 1) {
+				outRids.push_back(valueRid(high | (j * 64 + __builtin_ctzll(word))));
+			}
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------
+// RoaringBitmap::serialize
+// -----------------------------------------------------------------------------
+
+void RoaringBitmap::serialize(std::string& out) const
+{
+	// container count, then key, form and cardinality of each container followed by its array or bits
+	std::uint32_t count = containers.size();
+	out.append((const char*)&count, sizeof(count));
+	for(size_t i = 0; i < containers.size(); i++) {
+		const RoaringContainer& c = containers[i];
+		char isBitmap = !c.bits.empty();
+		out.append((const char*)&c.key, sizeof(c.key));
+		out.append(&isBitmap, 1);
+		out.append((const char*)&c.cardinality, sizeof(c.cardinality));
+		if(isBitmap) {
+			out.append((const char*)&c.bits[0], ROARINGBITMAPWORDS * sizeof(std::uint64_t));
+		} else {
+			out.append((const char*)&c.array[0], c.array.size() * sizeof(std::uint16_t));
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------
+// RoaringBitmap::deserialize
+// -----------------------------------------------------------------------------
+
+void RoaringBitmap::deserialize(const std::string& data, size_t& pos)
+{
+	std::uint32_t count;
+	memcpy(&count, data.data() + pos, sizeof(count));
+	pos += sizeof(count);
+	containers.resize(count);
+	for(size_t i = 0; i < count; i++) {
+		RoaringContainer& c = containers[i];
+		memcpy(&c.key, data.data() + pos, sizeof(c.key));
+		pos += sizeof(c.key);
+		bool isBitmap = data[pos++];
+		memcpy(&c.cardinality, data.data() + pos, sizeof(c.cardinality));
+		pos += sizeof(c.cardinality);
+		if(isBitmap) {
+			c.bits.resize(ROARINGBITMAPWORDS);
+			memcpy(&c.bits[0], data.data() + pos, ROARINGBITMAPWORDS * sizeof(std::uint64_t));
+			pos += ROARINGBITMAPWORDS * sizeof(std::uint64_t);
+		} else {
+			c.array.resize(c.cardinality);
+			memcpy(&c.array[0], data.data() + pos, c.cardinality * sizeof(std::uint16_t));
+			pos += c.cardinality * sizeof(std::uint16_t);
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BitmapIndex::BitmapIndex -- Constructor
+// -----------------------------------------------------------------------------
+
+BitmapIndex::BitmapIndex(const std::string & relationName,
+		std::string & outIndexName,
+		BufMgr *bufMgrIn,
+		const int attrByteOffset,
+		const Datatype attrType)
+{
+	std::ostringstream idxStr;
+	idxStr << relationName << '.' << attrByteOffset << ".bitmap";
+	std::string indexName = idxStr.str();
+
+	outIndexName = indexName;
+	this->bufMgr = bufMgrIn;
+	this->attrByteOffset = attrByteOffset;
+	this->attributeType = attrType;
+	this->dirty = false;
+
+	if(File::exists(indexName)) {
+		this->file = new BlobFile(indexName, false);
+		this->headerPageNum = file->getFirstPageNo();
+		Page* metaPage;
+		bufMgr->readPage(file, headerPageNum, metaPage);
+		BitmapIndexMetaInfo meta = *(BitmapIndexMetaInfo*)metaPage;
+		bufMgr->unPinPage(file, headerPageNum, false);
+		if(meta.attrByteOffset != attrByteOffset || meta.attrType != attrType) {
+			delete file;
+			throw BadIndexInfoException("Index meta page does not match the requested attribute");
+		}
+
+		// read the serialized bitmaps back, each is preceded by the length and bytes of its value
+		std::string data;
+		for(int i = 0; i < meta.dataPageCount; i++) {
+			Page* page;
+			bufMgr->readPage(file, meta.firstDataPageNo + i, page);
+			data.append((const char*)page, std::min((int)Page::SIZE, meta.byteCount - i * (int)Page::SIZE));
+			bufMgr->unPinPage(file, meta.firstDataPageNo + i, false);
+		}
+		size_t pos = 0;
+		while(pos < data.size()) {
+			std::uint32_t length;
+			memcpy(&length, data.data() + pos, sizeof(length));
+			pos += sizeof(length);
+			RoaringBitmap& bitmap = bitmaps[data.substr(pos, length)];
+			pos += length;
+			bitmap.deserialize(data, pos);
+		}
+
+		// union the bitmaps pairwise, folding them into allRecords one by one would copy it once per value
+		std::vector<RoaringBitmap> unions;
+		for(std::map<std::string, RoaringBitmap>::const_iterator it = bitmaps.begin(); it != bitmaps.end(); ++it) {
+			unions.push_back(it->second);
+		}
+		while(unions.size() > 1) {
+			for(size_t i = 0; i + 1 < unions.size(); i += 2) {
+				unions[i/2] = unions[i].orWith(unions[i+1]);
+			}
+			if(unions.size() % 2 == 1) {
+				unions[unions.size()/2] = unions.back();
+			}
+			unions.resize((unions.size() + 1) / 2);
+		}
+		if(!unions.empty()) {
+			allRecords = unions[0];
+		}
+		return;
+	}
+
+	this->file = new BlobFile(indexName, true);
+	Page* metaPage;
+	bufMgr->allocPage(file, headerPageNum, metaPage);
+	BitmapIndexMetaInfo* meta = (BitmapIndexMetaInfo*)metaPage;
+	strcpy(meta->relationName, relationName.c_str());
+	meta->attrByteOffset = attrByteOffset;
+	meta->attrType = attrType;
+	meta->byteCount = 0;
+	meta->firstDataPageNo = 0;
+	meta->dataPageCount = 0;
+	bufMgr->unPinPage(file, headerPageNum, true);
+
+	FileScan* scan = new FileScan(relationName, bufMgr);
+	try {
+		while(true) {
+			RecordId rid;
+			scan->scanNext(rid);
+			std::string recordString = scan->getRecord();
+			insertEntry(recordString.c_str() + attrByteOffset, rid);
+		}
+	}
+	catch(const EndOfFileException& e) {}
+	delete scan;
+	writeBitmaps();
+	bufMgr->flushFile(file);
+}
+
+// -----------------------------------------------------------------------------
+// BitmapIndex::~BitmapIndex -- destructor
+// -----------------------------------------------------------------------------
+
+BitmapIndex::~BitmapIndex()
+{
+	if(dirty) {
+		writeBitmaps();
+	}
+	bufMgr->flushFile(file);
+	delete file;
+}
+
+// -----------------------------------------------------------------------------
+// BitmapIndex::writeBitmaps
+// -----------------------------------------------------------------------------
+
+void BitmapIndex::writeBitmaps()
+{
+	std::string data;
+	for(std::map<std::string, RoaringBitmap>::const_iterator it = bitmaps.begin(); it != bitmaps.end(); ++it) {
+		std::uint32_t length = it->first.size();
+		data.append((const char*)&length, sizeof(length));
+		data.append(it->first);
+		it->second.serialize(data);
+	}
+
+	Page* metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	BitmapIndexMetaInfo* meta = (BitmapIndexMetaInfo*)metaPage;
+
+	// pages are reused from the last write and the file grows by whole pages, so they stay consecutive
+	int pageCount = (data.size() + Page::SIZE - 1) / Page::SIZE;
+	for(int i = 0; i < pageCount; i++) {
+		Page* page;
+		PageId pageNo;
+		if(i < meta->dataPageCount) {
+			pageNo = meta->firstDataPageNo + i;
+			bufMgr->readPage(file, pageNo, page);
+		} else {
+			bufMgr->allocPage(file, pageNo, page);
+			if(meta->dataPageCount++ == 0) {
+				meta->firstDataPageNo = pageNo;
+			}
+		}
+		size_t count = std::min((size_t)Page::SIZE, data.size() - i * Page::SIZE);
+		memcpy(page, data.data() + i * Page::SIZE, count);
+		bufMgr->unPinPage(file, pageNo, true);
+	}
+	meta->byteCount = data.size();
+	bufMgr->unPinPage(file, headerPageNum, true);
+	dirty = false;
+}
+
+// -----------------------------------------------------------------------------
+// BitmapIndex::insertEntry
+// -----------------------------------------------------------------------------
+
+const void BitmapIndex::insertEntry(const void* key, const RecordId rid)
+{
+	std::uint32_t value = RoaringBitmap::ridValue(rid);
+	bitmaps[encodeKeyPart(key, attributeType)].add(value);
+	allRecords.add(value);
+	dirty = true;
+}
+
+// -----------------------------------------------------------------------------
+// BitmapIndex::deleteEntry
+// -----------------------------------------------------------------------------
+
+const void BitmapIndex::deleteEntry(const void* key, const RecordId rid)
+{
+	std::uint32_t value = RoaringBitmap::ridValue(rid);
+	std::map<std::string, RoaringBitmap>::iterator it = bitmaps.find(encodeKeyPart(key, attributeType));
+	if(it == bitmaps.end() || !it->second.contains(value)) {
+		throw NoSuchKeyFoundException();
+	}
+	it->second.remove(value);
+	if(it->second.cardinality() == 0) {
+		bitmaps.erase(it);
+	}
+	allRecords.remove(value);
+	dirty = true;
+}
+
+// -----------------------------------------------------------------------------
+// BitmapIndex::getBitmap
+// -----------------------------------------------------------------------------
+
+RoaringBitmap BitmapIndex::getBitmap(const void* key) const
+{
+	std::map<std::string, RoaringBitmap>::const_iterator it = bitmaps.find(encodeKeyPart(key, attributeType));
+	if(it == bitmaps.end()) {
+		return RoaringBitmap();
+	}
+	return it->second;
+}
+
+// -----------------------------------------------------------------------------
+// BitmapIndex::complement
+// -----------------------------------------------------------------------------
+
+RoaringBitmap BitmapIndex::complement(const RoaringBitmap& bitmap) const
+{
+	return allRecords.andNotWith(bitmap);
+}
+
+// -----------------------------------------------------------------------------
+// BitmapIndex::getValueCount
+// -----------------------------------------------------------------------------
+
+int BitmapIndex::getValueCount() const
+{
+	return bitmaps.size();
+}
+
+}
@@ -0,0 +1,285 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Most values an array container of a Roaring bitmap holds before it becomes a bitmap container.
+ */
+const  int ROARINGARRAYMAX = 4096;
+
+/**
+ * @brief Number of 64 bit words of a bitmap container, one bit for each of the 2^16 low values.
+ */
+const  int ROARINGBITMAPWORDS = 1024;
+
+/**
+ * @brief The values of a Roaring bitmap that share their high 16 bits. Up to ROARINGARRAYMAX low halves are
+ * kept as a sorted array, more as a bitmap of ROARINGBITMAPWORDS words.
+ */
+struct RoaringContainer{
+  /**
+   * High 16 bits shared by the values.
+   */
+	std::uint16_t key;
+
+  /**
+   * Number of values.
+   */
+	int cardinality;
+
+  /**
+   * Sorted low halves, if the container is an array container.
+   */
+	std::vector<std::uint16_t> array;
+
+  /**
+   * Bits of the low halves, if the container is a bitmap container.
+   */
+	std::vector<std::uint64_t> bits;
+};
+
+/**
+ * @brief Compressed set of 32 bit values, used for sets of record ids.
+ *
+ * A record id is the value page_number * 2^16 + slot_number, so each container holds the slots of one heap
+ * page, containers are in page order and relations of up to 2^16 pages can be represented.
+ * Bitmap containers are combined 128 bits at a time with SSE2 where the compiler targets it.
+*/
+class RoaringBitmap {
+
+ private:
+
+  /**
+   * Containers in key order, none of them empty.
+   */
+	std::vector<RoaringContainer> containers;
+
+ public:
+
+  /**
+	 * @return value of rid in a bitmap
+	 * @throws InvalidRecordException If the page number of rid does not fit in the high 16 bits.
+	**/
+	static std::uint32_t ridValue(const RecordId& rid);
+
+  /**
+	 * @return record id of value in a bitmap
+	**/
+	static RecordId valueRid(const std::uint32_t value);
+
+  /**
+	 * Add value, nothing changes if it is in the set already.
+	**/
+	void add(const std::uint32_t value);
+
+  /**
+	 * Remove value, nothing changes if it is not in the set.
+	**/
+	void remove(const std::uint32_t value);
+
+  /**
+	 * @return true if value is in the set
+	**/
+	bool contains(const std::uint32_t value) const;
+
+  /**
+	 * @return number of values in the set
+	**/
+	size_t cardinality() const;
+
+  /**
+	 * @return intersection of this set and other
+	**/
+	RoaringBitmap andWith(const RoaringBitmap& other) const;
+
+  /**
+	 * @return union of this set and other
+	**/
+	RoaringBitmap orWith(const RoaringBitmap& other) const;
+
+  /**
+	 * @return the values of this set that are not in other
+	**/
+	RoaringBitmap andNotWith(const RoaringBitmap& other) const;
+
+  /**
+	 * Append the values as record ids in page order, the order in which FileScan::restrictTo() takes them.
+	**/
+	void toRids(std::vector<RecordId>& outRids) const;
+
+  /**
+	 * Append a byte encoding of the set to out.
+	**/
+	void serialize(std::string& out) const;
+
+  /**
+	 * Read a set encoded by serialize() from data, starting at pos.
+	 * @param pos	Set to the first byte after the set
+	**/
+	void deserialize(const std::string& data, size_t& pos);
+};
+
+/**
+ * @brief The meta page of a bitmap index, which is always the first page of the index file.
+ */
+struct BitmapIndexMetaInfo{
+  /**
+   * Name of base relation.
+   */
+	char relationName[20];
+
+  /**
+   * Offset of attribute, over which index is built, inside the record stored in pages.
+   */
+	int attrByteOffset;
+
+  /**
+   * Type of the attribute over which index is built.
+   */
+	Datatype attrType;
+
+  /**
+   * Number of bytes of the serialized bitmaps.
+   */
+	int byteCount;
+
+  /**
+   * Page number of the first page of serialized bitmaps, the others follow it.
+   */
+	PageId firstDataPageNo;
+
+  /**
+   * Number of pages of serialized bitmaps.
+   */
+	int dataPageCount;
+};
+
+
+/**
+ * @brief Bitmap index on an attribute of few distinct values.
+ *
+ * One RoaringBitmap of record ids per distinct value, so that predicates such as IsHoliday = 'TRUE' are
+ * answered by combining bitmaps and the qualifying records are read page by page through
+ * FileScan::restrictTo(). Values are kept as encodeKeyPart() encodings, so INTEGER, DOUBLE and STRING
+ * attributes work alike. The bitmaps are held in memory and written to the index file when the index is
+ * closed.
+*/
+class BitmapIndex {
+
+ private:
+
+  /**
+   * File object for the index file.
+   */
+	File		*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * Byte offset of attribute in the record.
+   */
+	int			attrByteOffset;
+
+  /**
+   * Datatype of attribute over which index is built.
+   */
+	Datatype	attributeType;
+
+  /**
+   * Bitmap of each distinct value, by encoded value.
+   */
+	std::map<std::string, RoaringBitmap> bitmaps;
+
+  /**
+   * Every record id in the index, what NOT is taken against.
+   */
+	RoaringBitmap allRecords;
+
+  /**
+   * True if the bitmaps changed since they were read from or written to the index file.
+   */
+	bool		dirty;
+
+  /**
+	 * Write the bitmaps to the pages after the meta page.
+	**/
+	void writeBitmaps();
+
+ public:
+
+  /**
+	 * Open the bitmap index on attrByteOffset of relationName, or create it from the records of the relation
+	 * if there is none yet.
+   * @param relationName	Name of file
+   * @param outIndexName	Return the name of index file
+   * @param bufMgrIn			Buffer Manager Instance
+   * @param attrByteOffset	Offset of attribute, over which index is to be built, in the record
+   * @param attrType			Datatype of attribute over which index is built
+	 * @throws  BadIndexInfoException If an existing index file does not match attrByteOffset and attrType.
+	 * @throws  InvalidRecordException If a record of the relation lies on a page past 0xFFFF.
+	**/
+	BitmapIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn, const int attrByteOffset, const Datatype attrType);
+
+  /**
+	 * Destructor. Writes the bitmaps out if they changed and flushes the index file.
+	**/
+	~BitmapIndex();
+
+  /**
+	 * Add rid to the bitmap of key.
+   * @param key			Attribute value, laid out as in a record
+	 * @throws InvalidRecordException If rid lies on a page past 0xFFFF.
+	**/
+	const void insertEntry(const void* key, const RecordId rid);
+
+  /**
+	 * Remove rid from the bitmap of key.
+	 * @throws NoSuchKeyFoundException If the entry is not in the index.
+	**/
+	const void deleteEntry(const void* key, const RecordId rid);
+
+  /**
+	 * @return the records with attribute value key, an empty set if there are none
+	**/
+	RoaringBitmap getBitmap(const void* key) const;
+
+  /**
+	 * @return the records of the index that are not in bitmap
+	**/
+	RoaringBitmap complement(const RoaringBitmap& bitmap) const;
+
+  /**
+	 * @return number of distinct values
+	**/
+	int getValueCount() const;
+};
+
+}
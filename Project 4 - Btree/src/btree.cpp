@@ -5,6 +5,9 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <vector>
+#include <climits>
+#include <algorithm>
 #include "btree.h"
 #include "filescan.h"
 #include "exceptions/bad_index_info_exception.h"
@@ -22,6 +25,17 @@
 namespace badgerdb
 {
 
+// record ids in a posting list are kept sorted and delta coded by this value
+static unsigned long long ridValue(const RecordId& rid)
+{
+	return ((unsigned long long)rid.page_number << 16) | rid.slot_number;
+}
+
+static bool ridLess(const RecordId& r1, const RecordId& r2)
+{
+	return ridValue(r1) < ridValue(r2);
+}
+
 // -----------------------------------------------------------------------------
 // BTreeIndex::BTreeIndex -- Constructor
 // -----------------------------------------------------------------------------
@@ -43,6 +57,10 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
     this->attrByteOffset = attrByteOffset;
     this->attributeType = attrType;
     this->scanExecuting = false;
+    this->scanDescending = false;
+    this->probePageNum = 0;
+    this->inPostingList = false;
+    this->pinnedNodesStale = false;
     this->leafOccupancy = INTARRAYLEAFSIZE;
     this->nodeOccupancy = INTARRAYNONLEAFSIZE;
 
@@ -60,11 +78,12 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
         if(this->attrByteOffset == metaInfo->attrByteOffset && this->attributeType == metaInfo->attrType) {
             this->rootPageNum = metaInfo->rootPageNo;
         } else {
-            throw BadIndexInfoException;
+            throw BadIndexInfoException("Index meta page does not match the requested attribute");
         }
         
 	rootPageNum = metaInfo->rootPageNo;
-        rootIsLeaf = (metaInfo->rootPageNo == 2);
+        rootIsLeaf = metaInfo->rootIsLeaf;
+        freeListPageNum = metaInfo->firstFreePageNo;
         this->bufMgr->unPinPage(file, headerPageNum, false);
         
         
@@ -78,6 +97,7 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
 	this->attrByteOffset = attrByteOffset;
 	this->attributeType = attrType;
 	rootIsLeaf = true; // root node is initially a LeafNode
+	freeListPageNum = 0;
 
 	// allocate metaInfo page, allocate root page
 	this->bufMgr->allocPage(this->file, this->headerPageNum, metaPage);
@@ -88,18 +108,23 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
 	meta->attrByteOffset = this->attrByteOffset;
 	meta->attrType = this->attributeType;
 	meta->rootPageNo = this->rootPageNum;
+	meta->rootIsLeaf = rootIsLeaf;
+	meta->firstFreePageNo = freeListPageNum;
 	strcpy(meta->relationName, relationName.c_str());
 
 	// Cast rootPage to LeafNode (root is a leaf for a new Btree)
         LeafNodeInt* root = (LeafNodeInt*)rootPage;
 	root->rightSibPageNo = 0;
+	root->leftSibPageNo = 0;
 
 
 	this->bufMgr->unPinPage(this->file, this->rootPageNum, true);
 	this->bufMgr->unPinPage(this->file, this->headerPageNum, true);
 
-	// Scan the relation file
+	// Scan the relation file, loading the entries in sorted batches
 	FileScan* scan = new FileScan(relationName, this->bufMgr);
+	std::vector<int> keys;
+	std::vector<RecordId> rids;
 	try {
 		while (true) {
 			std::string recordString;
@@ -108,16 +133,28 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
 			// Iterate the records in relation file
 			scan->scanNext(rid);
 			recordString = scan->getRecord();
-			void* key = (void*)(recordString.c_str()+attrByteOffset);
-			insertEntry(key, rid);
+			keys.push_back(*(int*)(recordString.c_str()+attrByteOffset));
+			rids.push_back(rid);
+			if((int)keys.size() == BULKLOADBATCHSIZE) {
+				insertBatch(&keys[0], &rids[0], keys.size());
+				keys.clear();
+				rids.clear();
+			}
 		}
 		
 	}
 	catch (EndOfFileException e) {}
+	if(!keys.empty()) {
+		insertBatch(&keys[0], &rids[0], keys.size());
+	}
 
+	releasePinnedNodes();
 	this->bufMgr->flushFile(this->file);
 	delete scan;
     }
+
+    // hold on to the top levels for the descents to come
+    refreshPinnedNodes();
 }
 
 
@@ -131,7 +168,8 @@ BTreeIndex::~BTreeIndex()
     try {
         endScan();
     } catch (ScanNotInitializedException e){}
-    this->bufMgr->unPinPage(this->file, this->rootPageNum, true);
+    endProbes();
+    releasePinnedNodes();
     this->bufMgr->flushFile(this->file);
     delete file;
 }
@@ -142,931 +180,2078 @@ BTreeIndex::~BTreeIndex()
 
 const void BTreeIndex::insertEntry(const void *key, const RecordId rid) 
 {
-    // create new RIDKeyPair
+	// a split may move the keys after the leaf kept by probeSorted()
+	endProbes();
+
+	// create new RIDKeyPair
 	RIDKeyPair<int> entry;
 	entry.set(rid, *(int *)key);
 
-	// load root page and declare target node (leaf node that entry shoule be inserted into)
-	Page* rootPage;
-	PageId rootPageNo = rootPageNum;
-	bufMgr->readPage(file, rootPageNo, rootPage);
-	Page* targetPage;
-	PageId targetPageNo;
-	LeafNodeInt* targetNode;
+	// insert from the root down, a split that reaches the root grows the tree by one level
+	PageKeyPair<int> newChild;
+	int newEntries;
+	if(insertIntoNode(rootPageNum, rootIsLeaf, entry, newChild, newEntries)) {
+		growRoot(newChild, newEntries);
+	}
+	if(pinnedNodesStale) {
+		refreshPinnedNodes();
+	}
+}
 
-	if(rootIsLeaf) {
-		LeafNodeInt * rootNode = (LeafNodeInt *)rootPage;
-
-		if(rootNode->ridArray[leafOccupancy-1].page_number != 0) {
-                    // split if root node is full
-                    PageId newLeafPageNo;
-                    Page * newLeafPage;
-                    bufMgr->allocPage(file, newLeafPageNo, newLeafPage);
-                    LeafNodeInt * newLeafNode = (LeafNodeInt *)newLeafPage;
-
-                    // initialize new leaf node
-                    int mid = leafOccupancy/2; // middle index
-                    for(int i = 0; i < mid; i++) {
-                        newLeafNode->keyArray[i] = rootNode ->keyArray[mid+i];
-                        newLeafNode->ridArray[i] = rootNode ->ridArray[mid+i];
-                        rootNode->ridArray[mid+i].page_number = 0;
-                    }
-                    newLeafNode->rightSibPageNo = rootNode ->rightSibPageNo;
-                    rootNode ->rightSibPageNo = newLeafPageNo;
-
-                    if(rootIsLeaf) {
-                        // create new root node if leaf node is root node
-                        PageId newRootPageNo;
-                        Page * newRootPage;
-                        bufMgr->allocPage(file, newRootPageNo, newRootPage);
-                        NonLeafNodeInt * newRootNode = (NonLeafNodeInt *)newRootPage;
-
-                        // initialize new root node
-                        newRootNode->level = 1;
-                        newRootNode->keyArray[0] = newLeafNode->keyArray[0];
-                        newRootNode->pageNoArray[0] = rootPageNo;
-                        newRootNode->pageNoArray[1] = newLeafPageNo;
-
-                        // update meta page
-                        Page * metaPage;
-                        bufMgr->readPage(file, headerPageNum, metaPage);
-                        IndexMetaInfo * metaInfo = (IndexMetaInfo *)metaPage;
-                        metaInfo->rootPageNo = newRootPageNo;
-
-                        rootPageNum = newRootPageNo;
-                        rootIsLeaf = false;
-                        bufMgr->unPinPage(file, newRootPageNo, true);
-                        bufMgr->unPinPage(file, headerPageNum, true);
-
-                    } else {
-                        // create new PageKeyPair
-                        PageKeyPair<int> entry;
-                        entry.set(newLeafPageNo, newLeafNode->keyArray[0]);
-
-                        // push up the middle key
-                        Page * parentPage;
-                        bufMgr->readPage(file, rootPageNo, parentPage);
-                        NonLeafNodeInt * parentNode = (NonLeafNodeInt *)parentPage;
-                        // insert non leaf node
-                        int pos = nodeOccupancy;
-
-                        // find appropriate position to insert entry
-                        while((pos >= 0) && (parentNode->pageNoArray[pos] == 0)) {
-                            pos--;
-                        }
-                        while((pos > 0) && (parentNode->keyArray[pos-1] > entry.key)) {
-                            parentNode->keyArray[pos] = parentNode->keyArray[pos-1];
-                            parentNode->pageNoArray[pos+1] = parentNode->pageNoArray[pos];
-                            pos--;
-                        }
-                        // insert entry into position
-                        parentNode->keyArray[pos] = entry.key;
-                        parentNode->pageNoArray[pos+1] = entry.pageNo;
-                        bufMgr->unPinPage(file, rootPageNo, true);
-                    }
-
-                    bufMgr->unPinPage(file, newLeafPageNo, true);
-
-                    bufMgr->unPinPage(file, rootPageNo, true);
-		    // traverse through nodes
-                    // initialize start/parent node and current node
-                    Page * parentPage;
-                    PageId parentPageNo = rootPageNum;
-                    bufMgr->readPage(file, parentPageNo, parentPage);
-                    NonLeafNodeInt * parentNode = (NonLeafNodeInt *)parentPage;
-                    Page * currentPage;
-                    PageId currentPageNo = parentPageNo;
-                    NonLeafNodeInt * currentNode = parentNode;
-
-                    int pos = nodeOccupancy; // position in array
-                    while(currentNode->level != 1) {
-                        // find appropriate position to insert entry
-                        while((pos >= 0) && (currentNode->pageNoArray[pos] == 0)) {
-                            pos--;
-                        }
-                        while((pos > 0) && (currentNode->keyArray[pos-1] >= entry.key)) {
-                            pos--;
-                        }
-
-                        // load current node to be the next node
-                        currentPageNo = currentNode->pageNoArray[pos+1];
-                        bufMgr->readPage(file, currentPageNo, currentPage);
-                        currentNode = (NonLeafNodeInt *)currentPage;
-
-                        if(currentNode->pageNoArray[nodeOccupancy] != 0) {
-                            // if current node is full, split and set current node back to its parent
-                            // create new non-leaf node
-                            PageId newNonLeafPageNo;
-                            Page * newNonLeafPage;
-                            bufMgr->allocPage(file, newNonLeafPageNo, newNonLeafPage);
-                            NonLeafNodeInt * newNonLeafNode = (NonLeafNodeInt *)newNonLeafPage;
-
-                            // initialize new non-leaf node
-                            int mid = nodeOccupancy/2; // middle index
-                            for(int i = 0; i < mid; i++) {
-                                newNonLeafNode->keyArray[i] = currentNode->keyArray[mid+i];
-                                newNonLeafNode->pageNoArray[i] = currentNode->pageNoArray[(mid+1)+i];
-                                currentNode->pageNoArray[(mid+1)+i] = 0;
-                            }
-                            newNonLeafNode->level = currentNode->level;
-
-                            if(currentPageNo == rootPageNum) {
-                                // create new root node
-                                PageId newRootPageNo;
-                                Page * newRootPage;
-                                bufMgr->allocPage(file, newRootPageNo, newRootPage);
-                                NonLeafNodeInt * newRootNode = (NonLeafNodeInt *)newRootPage;
-
-                                // initialize new root node
-                                newRootNode->level = 0;
-                                newRootNode->keyArray[0] = newNonLeafNode->keyArray[0];
-                                newRootNode->pageNoArray[0] = currentPageNo;
-                                newRootNode->pageNoArray[1] = newNonLeafPageNo;
-
-                                // update meta page
-                                Page* metaPage;
-                                bufMgr->readPage(file, headerPageNum, metaPage);
-                                IndexMetaInfo* metaInfo = (IndexMetaInfo*)metaPage;
-                                metaInfo->rootPageNo = newRootPageNo;
-
-                                rootPageNum = newRootPageNo;
-                                bufMgr->unPinPage(file, newRootPageNo, true);
-                                bufMgr->unPinPage(file, headerPageNum, true);
-
-                            } else {
-                                // create new PageKeyPair
-                                PageKeyPair<int> entry;
-                                entry.set(newNonLeafPageNo, newNonLeafNode->keyArray[0]);
-
-                                // push up the middle key
-                                Page* parentPage;
-                                bufMgr->readPage(file, parentPageNo, parentPage);
-                                NonLeafNodeInt* parentNode = (NonLeafNodeInt*)parentPage;
-                                // insert non leaf
-                                int pos = nodeOccupancy;
-                                // find appropriate position to insert entry
-                                while((pos >= 0) && (parentNode->pageNoArray[pos] == 0)) {
-                                    pos--;
-                                }
-                                while((pos > 0) && (parentNode->keyArray[pos-1] > entry.key)) {
-                                    parentNode->keyArray[pos] = parentNode->keyArray[pos-1];
-                                    parentNode->pageNoArray[pos+1] = parentNode->pageNoArray[pos];
-                                    pos--;
-                                }
-                                // insert entry into position
-                                parentNode->keyArray[pos] = entry.key;
-                                parentNode->pageNoArray[pos+1] = entry.pageNo;
-                                bufMgr->unPinPage(file, parentPageNo, true);
-                            }
-                            bufMgr->unPinPage(file, newNonLeafPageNo, true);
-
-                            bufMgr->unPinPage(file, currentPageNo, true);
-                            currentPageNo = parentPageNo;
-                            currentNode = parentNode;
-
-                        } else if(currentNode->level != 1){
-                            // update parent node
-                            bufMgr->unPinPage(file, parentPageNo, false);
-                            parentPageNo = currentPageNo;
-                            parentNode = currentNode;
-
-                        } else {
-                            bufMgr->unPinPage(file, parentPageNo, false);
-                        }
-                    }
-
-                    // find appropriate position to insert entry
-                    pos = nodeOccupancy;
-                    while((pos >= 0) && (currentNode->pageNoArray[pos] == 0)) {
-                        pos--;
-                    }
-                    while((pos > 0) && (currentNode->keyArray[pos-1] >= entry.key)) {
-                        pos--;
-                    }
-
-                    // load target node
-                    Page * targetPage;
-                    PageId targetPageNo = currentNode->pageNoArray[pos];
-                    bufMgr->readPage(file, targetPageNo, targetPage);
-                    LeafNodeInt * targetNode = (LeafNodeInt *)targetPage;
-                    bufMgr->unPinPage(file, currentPageNo, false);
-
-                    if(targetNode->ridArray[leafOccupancy-1].page_number != 0) {
-                        // split if the leaf node is full
-                        // create new leaf node
-                        PageId newLeafPageNo;
-                        Page * newLeafPage;
-                        bufMgr->allocPage(file, newLeafPageNo, newLeafPage);
-                        LeafNodeInt * newLeafNode = (LeafNodeInt *)newLeafPage;
-
-                        // initialize new leaf node
-                        int mid = leafOccupancy/2; // middle index
-                        for(int i = 0; i < mid; i++) {
-                            newLeafNode->keyArray[i] = targetNode->keyArray[mid+i];
-                            newLeafNode->ridArray[i] = targetNode->ridArray[mid+i];
-                            targetNode->ridArray[mid+i].page_number = 0;
-                        }
-                        newLeafNode->rightSibPageNo = targetNode->rightSibPageNo;
-                        targetNode->rightSibPageNo = newLeafPageNo;
-
-                        if(rootIsLeaf) {
-                            // create new root node if leaf node is root node
-                            PageId newRootPageNo;
-                            Page * newRootPage;
-                            bufMgr->allocPage(file, newRootPageNo, newRootPage);
-                            NonLeafNodeInt * newRootNode = (NonLeafNodeInt *)newRootPage;
-
-                            // initialize new root node
-                            newRootNode->level = 1;
-                            newRootNode->keyArray[0] = newLeafNode->keyArray[0];
-                            newRootNode->pageNoArray[0] = targetPageNo;
-                            newRootNode->pageNoArray[1] = newLeafPageNo;
-
-                            // update meta page
-                            Page * metaPage;
-                            bufMgr->readPage(file, headerPageNum, metaPage);
-                            IndexMetaInfo * metaInfo = (IndexMetaInfo *)metaPage;
-                            metaInfo->rootPageNo = newRootPageNo;
-                            rootPageNum = newRootPageNo;
-                            rootIsLeaf = false;
-                            bufMgr->unPinPage(file, newRootPageNo, true);
-                            bufMgr->unPinPage(file, headerPageNum, true);
-
-                        } else {
-                            // create new PageKeyPair
-                            PageKeyPair<int> entry;
-                            entry.set(newLeafPageNo, newLeafNode->keyArray[0]);
-                            // push up the middle key
-                            Page * parentPage;
-                            bufMgr->readPage(file, currentPageNo, parentPage);
-                            NonLeafNodeInt * parentNode = (NonLeafNodeInt *)parentPage;
-                            // insert non leaf
-                            int pos = nodeOccupancy;
-                            // find appropriate position to insert entry
-                            while((pos >= 0) && (parentNode->pageNoArray[pos] == 0)) {
-                                pos--;
-                            }
-                            while((pos > 0) && (parentNode->keyArray[pos-1] > entry.key)) {
-                                parentNode->keyArray[pos] = parentNode->keyArray[pos-1];
-                                parentNode->pageNoArray[pos+1] = parentNode->pageNoArray[pos];
-                                pos--;
-                            }
-                            // insert entry into position
-                            parentNode->keyArray[pos] = entry.key;
-                            parentNode->pageNoArray[pos+1] = entry.pageNo;
-                            bufMgr->unPinPage(file, currentPageNo, true);
-                        }
-
-                        bufMgr->unPinPage(file, newLeafPageNo, true);
-                        bufMgr->unPinPage(file, targetPageNo, true);
-
-                        // find new target node
-                        bufMgr->readPage(file, currentPageNo, currentPage);
-                        currentNode = (NonLeafNodeInt *)currentPage;
-                        pos = nodeOccupancy;
-                        while((pos >= 0) && (currentNode->pageNoArray[pos] == 0)) {
-                            pos--;
-                        }
-                        while((pos > 0) && (currentNode->keyArray[pos-1] >= entry.key)) {
-                            pos--;
-                        }
-
-                        targetPageNo = currentNode->pageNoArray[pos];
-                        bufMgr->unPinPage(file, currentPageNo, false);
-
-                    } else {
-                        targetPageNo = targetPageNo;
-                        bufMgr->unPinPage(file, targetPageNo, false);
-                    }
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertIntoNode
+// -----------------------------------------------------------------------------
 
-		} else {
-			// set target node to be root node
-			targetPageNo = rootPageNo;
-			bufMgr->unPinPage(file, rootPageNo, false);
+bool BTreeIndex::insertIntoNode(const PageId pageNo, const bool isLeaf,
+		const RIDKeyPair<int>& entry, PageKeyPair<int>& newChild, int& newEntries)
+{
+	if(isLeaf) {
+		Page* page;
+		bufMgr->readPage(file, pageNo, page);
+		LeafNodeInt* node = (LeafNodeInt*)page;
+		int count = getLeafCount(node);
+		if(addToPostingList(node, count, entry)) {
+			bufMgr->unPinPage(file, pageNo, false);
+			return false;
+		}
+		if(count < leafOccupancy) {
+			insertIntoLeaf(node, count, entry);
+			packDuplicates(node, entry.key);
+			bufMgr->unPinPage(file, pageNo, true);
+			return false;
+		}
+		splitLeaf(node, pageNo, entry, newChild, newEntries, false);
+		bufMgr->unPinPage(file, pageNo, true);
+		return true;
+	}
+
+	// duplicates of a separator may sit on both sides of it, new ones go right
+	NonLeafNodeInt* node = readNonLeaf(pageNo);
+	int childCount = getChildCount(node);
+	int pos = childCount - 1;
+	while((pos > 0) && (node->keyArray[pos-1] > entry.key)) {
+		pos--;
+	}
+	PageId childPageNo = node->pageNoArray[pos];
+	bool childIsLeaf = (node->level == 1);
+
+	// the node is kept on the way down, its entry count for the child changes either way
+	node->countArray[pos]++;
+	PageKeyPair<int> childSplit;
+	int childSplitEntries;
+	if(!insertIntoNode(childPageNo, childIsLeaf, entry, childSplit, childSplitEntries)) {
+		releaseNonLeaf(pageNo, true);
+		return false;
+	}
+
+	// the child split, add the new sibling right after it
+	if(childCount <= nodeOccupancy) {
+		insertIntoNonLeaf(node, childCount, pos, childSplit, childSplitEntries);
+		releaseNonLeaf(pageNo, true);
+		return false;
+	}
+	splitNonLeaf(node, pos, childSplit, childSplitEntries, newChild, newEntries, false);
+	releaseNonLeaf(pageNo, true);
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertIntoLeaf
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::insertIntoLeaf(LeafNodeInt* node, const int count, const RIDKeyPair<int>& entry)
+{
+	// shift larger keys one slot to the right, equal keys keep insertion order
+	int pos = count - 1;
+	while((pos >= 0) && (node->keyArray[pos] > entry.key)) {
+		node->keyArray[pos+1] = node->keyArray[pos];
+		node->ridArray[pos+1] = node->ridArray[pos];
+		pos--;
+	}
+	node->keyArray[pos+1] = entry.key;
+	node->ridArray[pos+1] = entry.rid;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::addToPostingList
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::addToPostingList(LeafNodeInt* node, const int count, const RIDKeyPair<int>& entry)
+{
+	for(int i = findLeafPos(node, count, entry.key, false); i < count && node->keyArray[i] == entry.key; i++) {
+		if(node->ridArray[i].slot_number == POSTINGLISTSLOT) {
+			insertIntoPostingList(node->ridArray[i].page_number, entry.rid);
+			return true;
+		}
+	}
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::packDuplicates
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::packDuplicates(LeafNodeInt* node, const int key)
+{
+	int count = getLeafCount(node);
+	int first = findLeafPos(node, count, key, false);
+	int last = findLeafPos(node, count, key, true);
+	std::vector<RecordId> rids;
+	for(int i = first; i < last; i++) {
+		if(node->ridArray[i].slot_number == POSTINGLISTSLOT) {
+			return;
+		}
+		if(node->ridArray[i].slot_number != Page::INVALID_SLOT) {
+			rids.push_back(node->ridArray[i]);
 		}
+	}
+	if((int)rids.size() < POSTINGLISTMIN) {
+		return;
+	}
+
+	// the whole run, lazily deleted entries included, collapses into one entry
+	std::sort(rids.begin(), rids.end(), ridLess);
+	node->ridArray[first].page_number = createPostingList(rids);
+	node->ridArray[first].slot_number = POSTINGLISTSLOT;
+	int removed = last - first - 1;
+	for(int i = first + 1; i < count - removed; i++) {
+		node->keyArray[i] = node->keyArray[i+removed];
+		node->ridArray[i] = node->ridArray[i+removed];
+	}
+	for(int i = count - removed; i < count; i++) {
+		node->ridArray[i].page_number = 0;
+		node->ridArray[i].slot_number = 0;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertIntoNonLeaf
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::insertIntoNonLeaf(NonLeafNodeInt* node, const int childCount, const int pos,
+		const PageKeyPair<int>& child, const int childEntries)
+{
+	// child goes to pos+1 with its key as separator between pos and pos+1
+	for(int i = childCount - 1; i > pos; i--) {
+		node->keyArray[i] = node->keyArray[i-1];
+		node->pageNoArray[i+1] = node->pageNoArray[i];
+		node->countArray[i+1] = node->countArray[i];
+	}
+	node->keyArray[pos] = child.key;
+	node->pageNoArray[pos+1] = child.pageNo;
+
+	// its entries were split off the child at pos
+	node->countArray[pos+1] = childEntries;
+	node->countArray[pos] -= childEntries;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::splitLeaf
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::splitLeaf(LeafNodeInt* node, const PageId pageNo, const RIDKeyPair<int>& entry,
+		PageKeyPair<int>& newChild, int& newEntries, const bool rightEdge)
+{
+	PageId newLeafPageNo;
+	Page* newLeafPage;
+	allocIndexPage(newLeafPageNo, newLeafPage);
+	LeafNodeInt* newLeafNode = (LeafNodeInt*)newLeafPage;
+
+	// move the upper half over to the new right sibling, or nothing at all
+	// when appending past the last key so the full leaf stays full
+	int mid = rightEdge ? leafOccupancy : leafOccupancy/2;
+	for(int i = mid; i < leafOccupancy; i++) {
+		newLeafNode->keyArray[i-mid] = node->keyArray[i];
+		newLeafNode->ridArray[i-mid] = node->ridArray[i];
+		node->ridArray[i].page_number = 0;
+	}
+	newLeafNode->rightSibPageNo = node->rightSibPageNo;
+	newLeafNode->leftSibPageNo = pageNo;
+	node->rightSibPageNo = newLeafPageNo;
+	if(newLeafNode->rightSibPageNo != 0) {
+		setLeftSibling(newLeafNode->rightSibPageNo, newLeafPageNo);
+	}
 
+	if(!rightEdge && entry.key < newLeafNode->keyArray[0]) {
+		insertIntoLeaf(node, mid, entry);
 	} else {
-		NonLeafNodeInt * rootNode = (NonLeafNodeInt *)rootPage;
-
-		if(rootNode->pageNoArray[nodeOccupancy] != 0) {
-			// split if root node is full
-                    // create new non-leaf node
-                    PageId newNonLeafPageNo;
-                    Page * newNonLeafPage;
-                    bufMgr->allocPage(file, newNonLeafPageNo, newNonLeafPage);
-                    NonLeafNodeInt * newNonLeafNode = (NonLeafNodeInt *)newNonLeafPage;
-
-                    // initialize new non-leaf node
-                    int mid = nodeOccupancy/2; // middle index
-                    for(int i = 0; i < mid; i++) {
-                        newNonLeafNode->keyArray[i] = rootNode->keyArray[mid+i];
-                        newNonLeafNode->pageNoArray[i] = rootNode->pageNoArray[(mid+1)+i];
-                        rootNode->pageNoArray[(mid+1)+i] = 0;
-                    }
-                    newNonLeafNode->level = rootNode->level;
-
-                    if(rootPageNo == rootPageNum) {
-                        // create new root node
-                        PageId newRootPageNo;
-                        Page * newRootPage;
-                        bufMgr->allocPage(file, newRootPageNo, newRootPage);
-                        NonLeafNodeInt * newRootNode = (NonLeafNodeInt *)newRootPage;
-
-                        // initialize new root node
-                        newRootNode->level = 0;
-                        newRootNode->keyArray[0] = newNonLeafNode->keyArray[0];
-                        newRootNode->pageNoArray[0] = rootPageNo;
-                        newRootNode->pageNoArray[1] = newNonLeafPageNo;
-
-                        // update meta page
-                        Page* metaPage;
-                        bufMgr->readPage(file, headerPageNum, metaPage);
-                        IndexMetaInfo* metaInfo = (IndexMetaInfo*)metaPage;
-                        metaInfo->rootPageNo = newRootPageNo;
-
-                        rootPageNum = newRootPageNo;
-                        bufMgr->unPinPage(file, newRootPageNo, true);
-                        bufMgr->unPinPage(file, headerPageNum, true);
-
-                    } else {
-                        // create new PageKeyPair
-                        PageKeyPair<int> entry;
-                        entry.set(newNonLeafPageNo, newNonLeafNode->keyArray[0]);
-
-                        // push up the middle key
-                        Page* parentPage;
-                        bufMgr->readPage(file, rootPageNo, parentPage);
-                        NonLeafNodeInt* parentNode = (NonLeafNodeInt*)parentPage;
-                        int pos = nodeOccupancy;
-                        // find appropriate position to insert entry
-                        while((pos >= 0) && (parentNode->pageNoArray[pos] == 0)) {
-                            pos--;
-                        }
-                        while((pos > 0) && (parentNode->keyArray[pos-1] > entry.key)) {
-                            parentNode->keyArray[pos] = parentNode->keyArray[pos-1];
-                            parentNode->pageNoArray[pos+1] = parentNode->pageNoArray[pos];
-                            pos--;
-                        }
-
-                        // insert entry into position
-                        parentNode->keyArray[pos] = entry.key;
-                        parentNode->pageNoArray[pos+1] = entry.pageNo;
-                        bufMgr->unPinPage(file, rootPageNo, true);
-                    }
-
-                    bufMgr->unPinPage(file, newNonLeafPageNo, true);
-                    bufMgr->unPinPage(file, rootPageNo, true);
+		insertIntoLeaf(newLeafNode, leafOccupancy - mid, entry);
+	}
+
+	// first key of the right leaf is copied up as separator
+	newChild.set(newLeafPageNo, newLeafNode->keyArray[0]);
+	newEntries = getLiveCount(newLeafNode);
+	bufMgr->unPinPage(file, newLeafPageNo, true);
+}
 
+// -----------------------------------------------------------------------------
+// BTreeIndex::splitNonLeaf
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::splitNonLeaf(NonLeafNodeInt* node, const int pos, const PageKeyPair<int>& child,
+		const int childEntries, PageKeyPair<int>& newChild, int& newEntries, const bool rightEdge)
+{
+	// lay out all keys and children including the new one, then cut in the middle
+	int keys[INTARRAYNONLEAFSIZE + 1];
+	PageId pageNos[INTARRAYNONLEAFSIZE + 2];
+	int counts[INTARRAYNONLEAFSIZE + 2];
+	int total = nodeOccupancy + 2; // number of children
+	for(int i = 0, j = 0; i < total; i++) {
+		if(i == pos + 1) {
+			pageNos[i] = child.pageNo;
+			counts[i] = childEntries;
 		} else {
-			bufMgr->unPinPage(file, rootPageNo, false);
-		}
-                // traverse through nodes
-                // initialize start/parent node and current node
-                Page * parentPage;
-                PageId parentPageNo = rootPageNum;
-                bufMgr->readPage(file, parentPageNo, parentPage);
-                NonLeafNodeInt * parentNode = (NonLeafNodeInt *)parentPage;
-                Page * currentPage;
-                PageId currentPageNo = parentPageNo;
-                NonLeafNodeInt * currentNode = parentNode;
-
-                int pos = nodeOccupancy; // position in array
-                while(currentNode->level != 1) {
-                    // find appropriate position to insert entry
-                    while((pos >= 0) && (currentNode->pageNoArray[pos] == 0)) {
-			pos--;
-                    }
-                    while((pos > 0) && (currentNode->keyArray[pos-1] >= entry.key)) {
-			pos--;
-                    }
-
-                    // load current node to be the next node
-                    currentPageNo = currentNode->pageNoArray[pos+1];
-                    bufMgr->readPage(file, currentPageNo, currentPage);
-                    currentNode = (NonLeafNodeInt *)currentPage;
-
-                    if(currentNode->pageNoArray[nodeOccupancy] != 0) {
-                        // if current node is full, split and set current node back to its parent
-			// create new non-leaf node
-                        PageId newNonLeafPageNo;
-                        Page * newNonLeafPage;
-                        bufMgr->allocPage(file, newNonLeafPageNo, newNonLeafPage);
-                        NonLeafNodeInt * newNonLeafNode = (NonLeafNodeInt *)newNonLeafPage;
-
-                        // initialize new non-leaf node
-                        int mid = nodeOccupancy/2; // middle index
-                        for(int i = 0; i < mid; i++) {
-                            newNonLeafNode->keyArray[i] = currentNode->keyArray[mid+i];
-                            newNonLeafNode->pageNoArray[i] = currentNode->pageNoArray[(mid+1)+i];
-                            currentNode->pageNoArray[(mid+1)+i] = 0;
-                        }
-                        newNonLeafNode->level = currentNode->level;
-
-                        if(currentPageNo == rootPageNum) {
-                            // create new root node
-                            PageId newRootPageNo;
-                            Page * newRootPage;
-                            bufMgr->allocPage(file, newRootPageNo, newRootPage);
-                            NonLeafNodeInt * newRootNode = (NonLeafNodeInt *)newRootPage;
-
-                            // initialize new root node
-                            newRootNode->level = 0;
-                            newRootNode->keyArray[0] = newNonLeafNode->keyArray[0];
-                            newRootNode->pageNoArray[0] = currentPageNo;
-                            newRootNode->pageNoArray[1] = newNonLeafPageNo;
-
-                            // update meta page
-                            Page* metaPage;
-                            bufMgr->readPage(file, headerPageNum, metaPage);
-                            IndexMetaInfo* metaInfo = (IndexMetaInfo*)metaPage;
-                            metaInfo->rootPageNo = newRootPageNo;
-
-                            rootPageNum = newRootPageNo;
-                            bufMgr->unPinPage(file, newRootPageNo, true);
-                            bufMgr->unPinPage(file, headerPageNum, true);
-
-                        } else {
-                            // create new PageKeyPair
-                            PageKeyPair<int> entry;
-                            entry.set(newNonLeafPageNo, newNonLeafNode->keyArray[0]);
-
-                            // push up the middle key
-                            Page* parentPage;
-                            bufMgr->readPage(file, parentPageNo, parentPage);
-                            NonLeafNodeInt* parentNode = (NonLeafNodeInt*)parentPage;
-                            // insert non leaf
-                            int pos = nodeOccupancy;
-                            // find appropriate position to insert entry
-                            while((pos >= 0) && (parentNode->pageNoArray[pos] == 0)) {
-                                pos--;
-                            }
-                            while((pos > 0) && (parentNode->keyArray[pos-1] > entry.key)) {
-                                parentNode->keyArray[pos] = parentNode->keyArray[pos-1];
-                                parentNode->pageNoArray[pos+1] = parentNode->pageNoArray[pos];
-                                pos--;
-                            }
-                            // insert entry into position
-                            parentNode->keyArray[pos] = entry.key;
-                            parentNode->pageNoArray[pos+1] = entry.pageNo;
-                            bufMgr->unPinPage(file, parentPageNo, true);
-                        }
-                        bufMgr->unPinPage(file, newNonLeafPageNo, true);
-
-			bufMgr->unPinPage(file, currentPageNo, true);
-			currentPageNo = parentPageNo;
-			currentNode = parentNode;
-
-                    } else if(currentNode->level != 1){
-                        // update parent node
-			bufMgr->unPinPage(file, parentPageNo, false);
-			parentPageNo = currentPageNo;
-			parentNode = currentNode;
-
-                    } else {
-                            bufMgr->unPinPage(file, parentPageNo, false);
-                    }
-                }
-
-                // find appropriate position to insert entry
-                pos = nodeOccupancy;
-                while((pos >= 0) && (currentNode->pageNoArray[pos] == 0)) {
-                    pos--;
-                }
-                while((pos > 0) && (currentNode->keyArray[pos-1] >= entry.key)) {
-                    pos--;
-                }
-
-                // load target node
-                Page * targetPage;
-                PageId targetPageNo = currentNode->pageNoArray[pos];
-                bufMgr->readPage(file, targetPageNo, targetPage);
-                LeafNodeInt * targetNode = (LeafNodeInt *)targetPage;
-                bufMgr->unPinPage(file, currentPageNo, false);
-
-                if(targetNode->ridArray[leafOccupancy-1].page_number != 0) {
-                    // split if the leaf node is full
-                    // create new leaf node
-                    PageId newLeafPageNo;
-                    Page * newLeafPage;
-                    bufMgr->allocPage(file, newLeafPageNo, newLeafPage);
-                    LeafNodeInt * newLeafNode = (LeafNodeInt *)newLeafPage;
-
-                    // initialize new leaf node
-                    int mid = leafOccupancy/2; // middle index
-                    for(int i = 0; i < mid; i++) {
-                        newLeafNode->keyArray[i] = targetNode->keyArray[mid+i];
-                        newLeafNode->ridArray[i] = targetNode->ridArray[mid+i];
-                        targetNode->ridArray[mid+i].page_number = 0;
-                    }
-                    newLeafNode->rightSibPageNo = targetNode->rightSibPageNo;
-                    targetNode->rightSibPageNo = newLeafPageNo;
-
-                    if(rootIsLeaf) {
-                        // create new root node if leaf node is root node
-                        PageId newRootPageNo;
-                        Page * newRootPage;
-                        bufMgr->allocPage(file, newRootPageNo, newRootPage);
-                        NonLeafNodeInt * newRootNode = (NonLeafNodeInt *)newRootPage;
-
-                        // initialize new root node
-                        newRootNode->level = 1;
-                        newRootNode->keyArray[0] = newLeafNode->keyArray[0];
-                        newRootNode->pageNoArray[0] = targetPageNo;
-                        newRootNode->pageNoArray[1] = newLeafPageNo;
-
-                        // update meta page
-                        Page * metaPage;
-                        bufMgr->readPage(file, headerPageNum, metaPage);
-                	IndexMetaInfo * metaInfo = (IndexMetaInfo *)metaPage;
-                        metaInfo->rootPageNo = newRootPageNo;
-                        rootPageNum = newRootPageNo;
-                        rootIsLeaf = false;
-                        bufMgr->unPinPage(file, newRootPageNo, true);
-                        bufMgr->unPinPage(file, headerPageNum, true);
-
-                    } else {
-                        // create new PageKeyPair
-                        PageKeyPair<int> entry;
-                        entry.set(newLeafPageNo, newLeafNode->keyArray[0]);
-                        // push up the middle key
-                        Page * parentPage;
-                        bufMgr->readPage(file, currentPageNo, parentPage);
-                        NonLeafNodeInt * parentNode = (NonLeafNodeInt *)parentPage;
-                        // insert non leaf
-                        int pos = nodeOccupancy;
-                        // find appropriate position to insert entry
-                        while((pos >= 0) && (parentNode->pageNoArray[pos] == 0)) {
-                            pos--;
-                        }
-                        while((pos > 0) && (parentNode->keyArray[pos-1] > entry.key)) {
-                            parentNode->keyArray[pos] = parentNode->keyArray[pos-1];
-                            parentNode->pageNoArray[pos+1] = parentNode->pageNoArray[pos];
-                            pos--;
-                        }
-                        // insert entry into position
-                        parentNode->keyArray[pos] = entry.key;
-                        parentNode->pageNoArray[pos+1] = entry.pageNo;
-                        bufMgr->unPinPage(file, currentPageNo, true);
-                    }
-
-                    bufMgr->unPinPage(file, newLeafPageNo, true);
-                    bufMgr->unPinPage(file, targetPageNo, true);
-
-                    // find new target node
-                    bufMgr->readPage(file, currentPageNo, currentPage);
-                    currentNode = (NonLeafNodeInt *)currentPage;
-                    pos = nodeOccupancy;
-                    while((pos >= 0) && (currentNode->pageNoArray[pos] == 0)) {
-			pos--;
-                    }
-                    while((pos > 0) && (currentNode->keyArray[pos-1] >= entry.key)) {
-			pos--;
-                    }
-
-                    targetPageNo = currentNode->pageNoArray[pos];
-                    bufMgr->unPinPage(file, currentPageNo, false);
-
-                } else {
-                    targetPageNo = targetPageNo;
-                    bufMgr->unPinPage(file, targetPageNo, false);
-                }
-	}
-
-	// insert entry into target node
-	bufMgr->readPage(file, targetPageNo, targetPage);
-	targetNode = (LeafNodeInt *)targetPage;
-	if(targetNode->ridArray[0].page_number == 0) {
-		// insert entry at index 0 if array is empty
-		targetNode->keyArray[0] = entry.key;
-		targetNode->ridArray[0] = entry.rid;
+			pageNos[i] = node->pageNoArray[j];
+			counts[i] = node->countArray[j];
+			j++;
+		}
+	}
+	counts[pos] -= childEntries;
+	for(int i = 0, j = 0; i < total - 1; i++) {
+		if(i == pos) {
+			keys[i] = child.key;
+		} else {
+			keys[i] = node->keyArray[j++];
+		}
+	}
+
+	PageId newNonLeafPageNo;
+	Page* newNonLeafPage;
+	allocIndexPage(newNonLeafPageNo, newNonLeafPage);
+	NonLeafNodeInt* newNonLeafNode = (NonLeafNodeInt*)newNonLeafPage;
+	newNonLeafNode->level = node->level;
+
+	// a right edge split leaves only the new child in the new node
+	int leftCount = rightEdge ? total - 1 : (total + 1)/2;
+	for(int i = 0; i < leftCount; i++) {
+		node->pageNoArray[i] = pageNos[i];
+		node->countArray[i] = counts[i];
+	}
+	for(int i = 0; i < leftCount - 1; i++) {
+		node->keyArray[i] = keys[i];
+	}
+	for(int i = leftCount; i <= nodeOccupancy; i++) {
+		node->pageNoArray[i] = 0;
+	}
+	newEntries = 0;
+	for(int i = leftCount; i < total; i++) {
+		newNonLeafNode->pageNoArray[i-leftCount] = pageNos[i];
+		newNonLeafNode->countArray[i-leftCount] = counts[i];
+		newEntries += counts[i];
+	}
+	for(int i = leftCount; i < total - 1; i++) {
+		newNonLeafNode->keyArray[i-leftCount] = keys[i];
+	}
+
+	// middle key is pushed up, it is not kept in either half
+	newChild.set(newNonLeafPageNo, keys[leftCount-1]);
+	pinnedNodesStale = true;
+	bufMgr->unPinPage(file, newNonLeafPageNo, true);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertBatch
+// -----------------------------------------------------------------------------
+
+const void BTreeIndex::insertBatch(const void* keys, const RecordId* rids, const size_t n)
+{
+	endProbes();
+	std::vector<RIDKeyPair<int> > entries(n);
+	for(size_t i = 0; i < n; i++) {
+		entries[i].set(rids[i], ((const int*)keys)[i]);
+	}
+	if(!std::is_sorted(entries.begin(), entries.end())) {
+		std::sort(entries.begin(), entries.end());
+	}
 
+	// the root-to-leaf path stays pinned from one entry to the next, fences[i]
+	// is the exclusive upper bound of keys below path[i] (LLONG_MAX if none)
+	std::vector<PathLevelInt> path;
+	std::vector<long long> fences;
+	PageId leafPageNo = 0;
+	LeafNodeInt* leaf = NULL;
+	long long leafFence = LLONG_MAX;
+	bool leafDirty = false;
+
+	for(size_t e = 0; e < n; e++) {
+		const RIDKeyPair<int>& entry = entries[e];
+
+		if(leaf != NULL && entry.key >= leafFence) {
+			// past this leaf, climb only as far as needed to find the next one
+			bufMgr->unPinPage(file, leafPageNo, leafDirty);
+			leaf = NULL;
+			while(path.size() > 1 && entry.key >= fences.back()) {
+				releaseNonLeaf(path.back().pageNo, path.back().dirty);
+				path.pop_back();
+				fences.pop_back();
+			}
+		}
+		if(leaf == NULL) {
+			pinPathDown(entry.key, path, fences, leafPageNo, leaf, leafFence);
+			leafDirty = false;
+		}
+
+		// the entry ends up below every level of the path, split or not
+		for(size_t i = 0; i < path.size(); i++) {
+			path[i].node->countArray[path[i].pos]++;
+			path[i].dirty = true;
+		}
+
+		int count = getLeafCount(leaf);
+		if(addToPostingList(leaf, count, entry)) {
+			continue;
+		}
+		if(count < leafOccupancy) {
+			insertIntoLeaf(leaf, count, entry);
+			packDuplicates(leaf, entry.key);
+			leafDirty = true;
+			continue;
+		}
+
+		// leaf is full, appending past its last key keeps it that way
+		PageKeyPair<int> newChild;
+		int newEntries;
+		splitLeaf(leaf, leafPageNo, entry, newChild, newEntries, entry.key >= leaf->keyArray[count-1]);
+		leafDirty = true;
+
+		if(!path.empty() && getChildCount(path.back().node) <= nodeOccupancy) {
+			// parent has room: link the new leaf in and carry on from whichever leaf got the entry
+			PathLevelInt& parent = path.back();
+			int childCount = getChildCount(parent.node);
+			insertIntoNonLeaf(parent.node, childCount, parent.pos, newChild, newEntries);
+			parent.dirty = true;
+			if(entry.key >= newChild.key) {
+				bufMgr->unPinPage(file, leafPageNo, true);
+				parent.pos++;
+				leafPageNo = newChild.pageNo;
+				Page* page;
+				bufMgr->readPage(file, leafPageNo, page);
+				leaf = (LeafNodeInt*)page;
+				leafDirty = false;
+			} else {
+				leafFence = newChild.key;
+			}
+			continue;
+		}
+
+		// the split climbs further, let the path go and push it up level by level
+		bufMgr->unPinPage(file, leafPageNo, true);
+		leaf = NULL;
+		while(!path.empty()) {
+			PathLevelInt& level = path.back();
+			int childCount = getChildCount(level.node);
+			if(childCount <= nodeOccupancy) {
+				insertIntoNonLeaf(level.node, childCount, level.pos, newChild, newEntries);
+				releaseNonLeaf(level.pageNo, true);
+				path.pop_back();
+				break;
+			}
+			PageKeyPair<int> upChild;
+			int upEntries;
+			splitNonLeaf(level.node, level.pos, newChild, newEntries, upChild, upEntries, level.pos == childCount - 1);
+			releaseNonLeaf(level.pageNo, true);
+			path.pop_back();
+			newChild = upChild;
+			newEntries = upEntries;
+			if(path.empty()) {
+				growRoot(newChild, newEntries);
+			}
+		}
+		if(path.empty() && rootIsLeaf) {
+			growRoot(newChild, newEntries);
+		}
+		releasePath(path);
+		fences.clear();
+	}
+
+	if(leaf != NULL) {
+		bufMgr->unPinPage(file, leafPageNo, leafDirty);
+	}
+	releasePath(path);
+	if(pinnedNodesStale) {
+		refreshPinnedNodes();
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::pinPathDown
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::pinPathDown(const int key, std::vector<PathLevelInt>& path, std::vector<long long>& fences,
+		PageId& leafPageNo, LeafNodeInt*& leaf, long long& leafFence)
+{
+	// start below the deepest level still pinned, or at the root
+	PageId pageNo;
+	bool isLeaf;
+	long long fence;
+	if(path.empty()) {
+		pageNo = rootPageNum;
+		isLeaf = rootIsLeaf;
+		fence = LLONG_MAX;
 	} else {
-		int pos = leafOccupancy-1;
+		PathLevelInt& level = path.back();
+		int childCount = getChildCount(level.node);
+		while((level.pos < childCount - 1) && (level.node->keyArray[level.pos] <= key)) {
+			level.pos++;
+		}
+		pageNo = level.node->pageNoArray[level.pos];
+		isLeaf = (level.node->level == 1);
+		fence = (level.pos < childCount - 1) ? level.node->keyArray[level.pos] : fences.back();
+	}
 
-		// find appropriate position to insert entry
-		while((pos >= 0) && (targetNode->ridArray[pos].page_number == 0)) {
-			pos--;
+	while(!isLeaf) {
+		PathLevelInt level;
+		level.pageNo = pageNo;
+		level.node = readNonLeaf(pageNo);
+		level.dirty = false;
+		int childCount = getChildCount(level.node);
+		level.pos = childCount - 1;
+		while((level.pos > 0) && (level.node->keyArray[level.pos-1] > key)) {
+			level.pos--;
 		}
-		while((pos >= 0) && (targetNode->keyArray[pos] > entry.key)) {
-			targetNode->keyArray[pos+1] = targetNode->keyArray[pos];
-			targetNode->ridArray[pos+1] = targetNode->ridArray[pos];
-			pos--;
+		path.push_back(level);
+		fences.push_back(fence);
+
+		pageNo = level.node->pageNoArray[level.pos];
+		isLeaf = (level.node->level == 1);
+		if(level.pos < childCount - 1) {
+			fence = level.node->keyArray[level.pos];
 		}
+	}
 
-		// insert entry into position
-		targetNode->keyArray[pos+1] = entry.key;
-		targetNode->ridArray[pos+1] = entry.rid;
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+	leafPageNo = pageNo;
+	leaf = (LeafNodeInt*)page;
+	leafFence = fence;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::releasePath
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::releasePath(std::vector<PathLevelInt>& path)
+{
+	for(size_t i = 0; i < path.size(); i++) {
+		releaseNonLeaf(path[i].pageNo, path[i].dirty);
 	}
-	bufMgr->unPinPage(file, targetPageNo, true);
+	path.clear();
 }
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::startScan
+// BTreeIndex::growRoot
 // -----------------------------------------------------------------------------
 
-const void BTreeIndex::startScan(const void* lowValParm,
-				   const Operator lowOpParm,
-				   const void* highValParm,
-				   const Operator highOpParm) {
-        // set fields
-	lowValInt = *(int *)lowValParm;
-	highValInt = *(int *)highValParm;
-	lowOp = lowOpParm;
-	highOp = highOpParm;
+void BTreeIndex::growRoot(const PageKeyPair<int>& newChild, const int newEntries)
+{
+	// what is left in the old root after its split
+	Page* oldRootPage;
+	bufMgr->readPage(file, rootPageNum, oldRootPage);
+	int oldEntries = rootIsLeaf ? getLiveCount((LeafNodeInt*)oldRootPage) : getSubtreeCount((NonLeafNodeInt*)oldRootPage);
+	bufMgr->unPinPage(file, rootPageNum, false);
+
+	PageId newRootPageNo;
+	Page* newRootPage;
+	allocIndexPage(newRootPageNo, newRootPage);
+	NonLeafNodeInt* newRootNode = (NonLeafNodeInt*)newRootPage;
+
+	// initialize new root node
+	newRootNode->level = rootIsLeaf ? 1 : 0;
+	newRootNode->keyArray[0] = newChild.key;
+	newRootNode->pageNoArray[0] = rootPageNum;
+	newRootNode->pageNoArray[1] = newChild.pageNo;
+	newRootNode->countArray[0] = oldEntries;
+	newRootNode->countArray[1] = newEntries;
+	bufMgr->unPinPage(file, newRootPageNo, true);
+
+	setRoot(newRootPageNo, false);
+}
 
-        // check range
-	if (lowValInt > highValInt) {
-		throw BadScanrangeException();
+// -----------------------------------------------------------------------------
+// BTreeIndex::setRoot
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::setRoot(const PageId pageNo, const bool isLeaf)
+{
+	rootPageNum = pageNo;
+	rootIsLeaf = isLeaf;
+	pinnedNodesStale = true;
+
+	// update meta page
+	Page* metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	IndexMetaInfo* metaInfo = (IndexMetaInfo*)metaPage;
+	metaInfo->rootPageNo = rootPageNum;
+	metaInfo->rootIsLeaf = rootIsLeaf;
+	bufMgr->unPinPage(file, headerPageNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::deleteEntry
+// -----------------------------------------------------------------------------
+
+const void BTreeIndex::deleteEntry(const void* key, const RecordId rid)
+{
+	// merges may free the leaf a scan is sitting on
+	if(scanExecuting) {
+		endScan();
 	}
-	if (lowOpParm != GTE && lowOpParm != GT) {
-		throw BadOpcodesException();
+	endProbes();
+
+	// the two reserved slot numbers never belong to a record
+	RIDKeyPair<int> entry;
+	entry.set(rid, *(int *)key);
+	if(rid.slot_number == Page::INVALID_SLOT || rid.slot_number == POSTINGLISTSLOT || !removeEntry(entry)) {
+		throw NoSuchKeyFoundException();
 	}
-	if (highOpParm != LTE && highOpParm != LT) {
-		throw BadOpcodesException();
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::deleteEntryLazy
+// -----------------------------------------------------------------------------
+
+const void BTreeIndex::deleteEntryLazy(const void* key, const RecordId rid)
+{
+	RIDKeyPair<int> entry;
+	entry.set(rid, *(int *)key);
+	if(rid.slot_number == Page::INVALID_SLOT || rid.slot_number == POSTINGLISTSLOT
+			|| !markDeadInNode(rootPageNum, rootIsLeaf, entry)) {
+		throw NoSuchKeyFoundException();
 	}
+}
 
-	if(scanExecuting){
+// -----------------------------------------------------------------------------
+// BTreeIndex::markDeadInNode
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::markDeadInNode(const PageId pageNo, const bool isLeaf, const RIDKeyPair<int>& entry)
+{
+	if(isLeaf) {
+		Page* page;
+		bufMgr->readPage(file, pageNo, page);
+		LeafNodeInt* node = (LeafNodeInt*)page;
+		int count = getLeafCount(node);
+		for(int i = findLeafPos(node, count, entry.key, false); i < count && node->keyArray[i] == entry.key; i++) {
+			if(node->ridArray[i] == entry.rid) {
+				// keep the slot occupied, scans skip it until reclaimDeadEntries runs
+				node->ridArray[i].slot_number = Page::INVALID_SLOT;
+				bufMgr->unPinPage(file, pageNo, true);
+				return true;
+			}
+
+			// a packed record id leaves its list right away, an emptied list waits for reclaimDeadEntries
+			if(node->ridArray[i].slot_number == POSTINGLISTSLOT
+					&& removeFromPostingList(node->ridArray[i].page_number, entry.rid)) {
+				bufMgr->unPinPage(file, pageNo, false);
+				return true;
+			}
+		}
+		bufMgr->unPinPage(file, pageNo, false);
+		return false;
+	}
+
+	// same candidate children as removeFromNode, the entry leaves the count of the one it is found in
+	NonLeafNodeInt* node = readNonLeaf(pageNo);
+	int childCount = getChildCount(node);
+	bool childIsLeaf = (node->level == 1);
+	int pos = 0;
+	while((pos < childCount - 1) && (node->keyArray[pos] < entry.key)) {
+		pos++;
+	}
+	for(int i = pos; i < childCount; i++) {
+		if((i > pos) && (node->keyArray[i-1] > entry.key)) {
+			break;
+		}
+		if(markDeadInNode(node->pageNoArray[i], childIsLeaf, entry)) {
+			node->countArray[i]--;
+			releaseNonLeaf(pageNo, true);
+			return true;
+		}
+	}
+	releaseNonLeaf(pageNo, false);
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::reclaimDeadEntries
+// -----------------------------------------------------------------------------
+
+const int BTreeIndex::reclaimDeadEntries()
+{
+	if(scanExecuting) {
 		endScan();
 	}
-	scanExecuting = true;
+	endProbes();
+
+	// collect the dead entries along the leaf chain first, removing them
+	// while walking could free the leaf we are standing on
+	std::vector<RIDKeyPair<int> > dead;
+	PageId pageNo = findLeafPageNo(INT_MIN, false);
+	while(pageNo != 0) {
+		Page* page;
+		bufMgr->readPage(file, pageNo, page);
+		LeafNodeInt* node = (LeafNodeInt*)page;
+		for(int i = 0; i < leafOccupancy && node->ridArray[i].page_number != 0; i++) {
+			if(getEntryCount(node, i) == 0) {
+				RIDKeyPair<int> entry;
+				entry.set(node->ridArray[i], node->keyArray[i]);
+				dead.push_back(entry);
+			}
+		}
+		PageId nextPageNo = node->rightSibPageNo;
+		bufMgr->unPinPage(file, pageNo, false);
+		pageNo = nextPageNo;
+	}
 
-	LeafNodeInt * currentNode;
-	if(rootIsLeaf) {
-		currentPageNum = rootPageNum;
-		bufMgr->readPage(file, currentPageNum, currentPageData);
+	for(size_t i = 0; i < dead.size(); i++) {
+		removeEntry(dead[i]);
+	}
+	return (int)dead.size();
+}
 
-	} else {
-		RIDKeyPair<int> entry;
-		RecordId rid;
-		entry.set(rid, lowValInt);
-		Page * parentPage;
-                PageId parentPageNo = rootPageNum;
-                bufMgr->readPage(file, parentPageNo, parentPage);
-                NonLeafNodeInt * parentNode = (NonLeafNodeInt *)parentPage;
-                Page * currentPage;
-                PageId currentPageNo = parentPageNo;
-                NonLeafNodeInt * currentNode = parentNode;
-
-                int pos = nodeOccupancy; // position in array
-                while(currentNode->level != 1) {
-                    // find appropriate position to insert entry
-                    while((pos >= 0) && (currentNode->pageNoArray[pos] == 0)) {
-			pos--;
-                    }
-                    while((pos > 0) && (currentNode->keyArray[pos-1] >= entry.key)) {
-			pos--;
-                    }
-
-                    // load current node to be the next node
-                    currentPageNo = currentNode->pageNoArray[pos+1];
-                    bufMgr->readPage(file, currentPageNo, currentPage);
-                    currentNode = (NonLeafNodeInt *)currentPage;
-
-                    if(currentNode->pageNoArray[nodeOccupancy] != 0) {
-                        // if current node is full, split and set current node back to its parent
-			// create new non-leaf node
-                        PageId newNonLeafPageNo;
-                        Page * newNonLeafPage;
-                        bufMgr->allocPage(file, newNonLeafPageNo, newNonLeafPage);
-                        NonLeafNodeInt * newNonLeafNode = (NonLeafNodeInt *)newNonLeafPage;
-
-                        // initialize new non-leaf node
-                        int mid = nodeOccupancy/2; // middle index
-                        for(int i = 0; i < mid; i++) {
-                            newNonLeafNode->keyArray[i] = currentNode->keyArray[mid+i];
-                            newNonLeafNode->pageNoArray[i] = currentNode->pageNoArray[(mid+1)+i];
-                            currentNode->pageNoArray[(mid+1)+i] = 0;
-                        }
-                        newNonLeafNode->level = currentNode->level;
-
-                        if(currentPageNo == rootPageNum) {
-                            // create new root node
-                            PageId newRootPageNo;
-                            Page * newRootPage;
-                            bufMgr->allocPage(file, newRootPageNo, newRootPage);
-                            NonLeafNodeInt * newRootNode = (NonLeafNodeInt *)newRootPage;
-
-                            // initialize new root node
-                            newRootNode->level = 0;
-                            newRootNode->keyArray[0] = newNonLeafNode->keyArray[0];
-                            newRootNode->pageNoArray[0] = currentPageNo;
-                            newRootNode->pageNoArray[1] = newNonLeafPageNo;
-
-                            // update meta page
-                            Page* metaPage;
-                            bufMgr->readPage(file, headerPageNum, metaPage);
-                            IndexMetaInfo* metaInfo = (IndexMetaInfo*)metaPage;
-                            metaInfo->rootPageNo = newRootPageNo;
-
-                            rootPageNum = newRootPageNo;
-                            bufMgr->unPinPage(file, newRootPageNo, true);
-                            bufMgr->unPinPage(file, headerPageNum, true);
-
-                        } else {
-                            // create new PageKeyPair
-                            PageKeyPair<int> entry;
-                            entry.set(newNonLeafPageNo, newNonLeafNode->keyArray[0]);
-
-                            // push up the middle key
-                            Page* parentPage;
-                            bufMgr->readPage(file, parentPageNo, parentPage);
-                            NonLeafNodeInt* parentNode = (NonLeafNodeInt*)parentPage;
-                            int pos = nodeOccupancy;
-                            // find appropriate position to insert entry
-                            while((pos >= 0) && (parentNode->pageNoArray[pos] == 0)) {
-                                pos--;
-                            }
-                            while((pos > 0) && (parentNode->keyArray[pos-1] > entry.key)) {
-                                parentNode->keyArray[pos] = parentNode->keyArray[pos-1];
-                                parentNode->pageNoArray[pos+1] = parentNode->pageNoArray[pos];
-                                pos--;
-                            }
-
-                            // insert entry into position
-                            parentNode->keyArray[pos] = entry.key;
-                            parentNode->pageNoArray[pos+1] = entry.pageNo;
-                            bufMgr->unPinPage(file, parentPageNo, true);
-                        }
-
-                        bufMgr->unPinPage(file, newNonLeafPageNo, true);
-			bufMgr->unPinPage(file, currentPageNo, true);
-			currentPageNo = parentPageNo;
-			currentNode = parentNode;
-
-                    } else if(currentNode->level != 1){
-                        // update parent node
-			bufMgr->unPinPage(file, parentPageNo, false);
-			parentPageNo = currentPageNo;
-			parentNode = currentNode;
-
-                    } else {
-			bufMgr->unPinPage(file, parentPageNo, false);
-                    }
-                }
-
-                // find appropriate position to insert entry
-                pos = nodeOccupancy;
-                while((pos >= 0) && (currentNode->pageNoArray[pos] == 0)) {
-                    pos--;
-                }
-                while((pos > 0) && (currentNode->keyArray[pos-1] >= entry.key)) {
-                    pos--;
-                }
-
-                // load target node
-                Page * targetPage;
-                PageId targetPageNo = currentNode->pageNoArray[pos];
-                bufMgr->readPage(file, targetPageNo, targetPage);
-                LeafNodeInt * targetNode = (LeafNodeInt *)targetPage;
-                bufMgr->unPinPage(file, currentPageNo, false);
-
-                if(targetNode->ridArray[leafOccupancy-1].page_number != 0) {
-                    // split if the leaf node is full
-                    // create new leaf node
-                    PageId newLeafPageNo;
-                    Page * newLeafPage;
-                    bufMgr->allocPage(file, newLeafPageNo, newLeafPage);
-                    LeafNodeInt * newLeafNode = (LeafNodeInt *)newLeafPage;
-                    // initialize new leaf node
-                    int mid = leafOccupancy/2; // middle index
-                    for(int i = 0; i < mid; i++) {
-                        newLeafNode->keyArray[i] = targetNode->keyArray[mid+i];
-                        newLeafNode->ridArray[i] = targetNode->ridArray[mid+i];
-                        targetNode->ridArray[mid+i].page_number = 0;
-                    }
-                    newLeafNode->rightSibPageNo = targetNode->rightSibPageNo;
-                    targetNode->rightSibPageNo = newLeafPageNo;
-
-                    if(rootIsLeaf) {
-                        // create new root node if leaf node is root node
-                        PageId newRootPageNo;
-                        Page * newRootPage;
-                        bufMgr->allocPage(file, newRootPageNo, newRootPage);
-                        NonLeafNodeInt * newRootNode = (NonLeafNodeInt *)newRootPage;
-
-                        // initialize new root node
-                        newRootNode->level = 1;
-                        newRootNode->keyArray[0] = newLeafNode->keyArray[0];
-                        newRootNode->pageNoArray[0] = targetPageNo;
-                        newRootNode->pageNoArray[1] = newLeafPageNo;
-
-                        // update meta page
-                        Page * metaPage;
-                        bufMgr->readPage(file, headerPageNum, metaPage);
-                        IndexMetaInfo * metaInfo = (IndexMetaInfo *)metaPage;
-                        metaInfo->rootPageNo = newRootPageNo;
-                        rootPageNum = newRootPageNo;
-                        rootIsLeaf = false;
-                        bufMgr->unPinPage(file, newRootPageNo, true);
-                        bufMgr->unPinPage(file, headerPageNum, true);
-                    } else {
-                        // create new PageKeyPair
-                        PageKeyPair<int> entry;
-                        entry.set(newLeafPageNo, newLeafNode->keyArray[0]);
-                        // push up the middle key
-                        Page * parentPage;
-                        bufMgr->readPage(file, currentPageNo, parentPage);
-                        NonLeafNodeInt * parentNode = (NonLeafNodeInt *)parentPage;
-                        int pos = nodeOccupancy;
-                        // find appropriate position to insert entry
-                        while((pos >= 0) && (parentNode->pageNoArray[pos] == 0)) {
-                            pos--;
-                        }
-                        while((pos > 0) && (parentNode->keyArray[pos-1] > entry.key)) {
-                            parentNode->keyArray[pos] = parentNode->keyArray[pos-1];
-                            parentNode->pageNoArray[pos+1] = parentNode->pageNoArray[pos];
-                            pos--;
-                        }
-
-                        // insert entry into position
-                        parentNode->keyArray[pos] = entry.key;
-                        parentNode->pageNoArray[pos+1] = entry.pageNo;
-                        bufMgr->unPinPage(file, currentPageNo, true);
-                    }
-
-                    bufMgr->unPinPage(file, newLeafPageNo, true);
-                    bufMgr->unPinPage(file, targetPageNo, true);
-
-                    // find new target node
-                    bufMgr->readPage(file, currentPageNo, currentPage);
-                    currentNode = (NonLeafNodeInt *)currentPage;
-                    pos = nodeOccupancy;
-                    while((pos >= 0) && (currentNode->pageNoArray[pos] == 0)) {
-			pos--;
-                    }
-                    while((pos > 0) && (currentNode->keyArray[pos-1] >= entry.key)) {
-			pos--;
-                    }
-
-                    currentPageNum = currentNode->pageNoArray[pos];
-                    bufMgr->unPinPage(file, currentPageNo, false);
-
-                } else {
-                    currentPageNum = targetPageNo;
-                    bufMgr->unPinPage(file, targetPageNo, false);
-                }
-		bufMgr->readPage(file, currentPageNum, currentPageData);
+// -----------------------------------------------------------------------------
+// BTreeIndex::removeEntry
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::removeEntry(const RIDKeyPair<int>& entry)
+{
+	bool underflow;
+	if(!removeFromNode(rootPageNum, rootIsLeaf, entry, underflow)) {
+		return false;
+	}
+
+	// a non-leaf root left with a single child is replaced by that child
+	if(!rootIsLeaf) {
+		NonLeafNodeInt* rootNode = readNonLeaf(rootPageNum);
+		if(rootNode->pageNoArray[1] == 0) {
+			PageId oldRootPageNo = rootPageNum;
+			PageId childPageNo = rootNode->pageNoArray[0];
+			bool childIsLeaf = (rootNode->level == 1);
+			releaseNonLeaf(oldRootPageNo, false);
+			setRoot(childPageNo, childIsLeaf);
+			freeIndexPage(oldRootPageNo);
+		} else {
+			releaseNonLeaf(rootPageNum, false);
+		}
+	}
+	if(pinnedNodesStale) {
+		refreshPinnedNodes();
 	}
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::removeFromNode
+// -----------------------------------------------------------------------------
 
-        // find next entry
-	currentNode = (LeafNodeInt *)currentPageData;
-	for(int i = 0; i < INTARRAYLEAFSIZE; i++) {
-		if(lowOpParm == GT) {
-			if(currentNode->keyArray[i] > lowValInt) {
-				nextEntry = i;
+bool BTreeIndex::removeFromNode(const PageId pageNo, const bool isLeaf,
+		const RIDKeyPair<int>& entry, bool& underflow)
+{
+	if(isLeaf) {
+		Page* page;
+		bufMgr->readPage(file, pageNo, page);
+		LeafNodeInt* node = (LeafNodeInt*)page;
+		int count = getLeafCount(node);
+		int pos = findLeafPos(node, count, entry.key, false);
+		for(; (pos < count) && (node->keyArray[pos] == entry.key); pos++) {
+			if(node->ridArray[pos] == entry.rid) {
 				break;
-			} else {
-				nextEntry = highValInt+1;
 			}
 
-		} else if(lowOpParm == GTE){
-			if(currentNode->keyArray[i] >= lowValInt) {
-				nextEntry = i;
+			// record ids packed into a posting list are taken out of the list,
+			// the leaf only changes once the list is empty
+			if(node->ridArray[pos].slot_number == POSTINGLISTSLOT && entry.rid.slot_number != Page::INVALID_SLOT
+					&& removeFromPostingList(node->ridArray[pos].page_number, entry.rid)) {
+				if(getPostingCount(node->ridArray[pos].page_number) > 0) {
+					underflow = false;
+					bufMgr->unPinPage(file, pageNo, false);
+					return true;
+				}
 				break;
-			} else {
-				nextEntry = highValInt+1;
 			}
+		}
+		if((pos == count) || (node->keyArray[pos] != entry.key)) {
+			bufMgr->unPinPage(file, pageNo, false);
+			return false;
+		}
+		if(node->ridArray[pos].slot_number == POSTINGLISTSLOT) {
+			freePostingList(node->ridArray[pos].page_number);
+		}
 
-		} else {
-			nextEntry = highValInt+1;
+		// close the gap
+		for(int i = pos; i < count - 1; i++) {
+			node->keyArray[i] = node->keyArray[i+1];
+			node->ridArray[i] = node->ridArray[i+1];
 		}
+		node->ridArray[count-1].page_number = 0;
+		node->ridArray[count-1].slot_number = 0;
+		underflow = (count - 1 < leafOccupancy/2);
+		bufMgr->unPinPage(file, pageNo, true);
+		return true;
 	}
-}
 
+	// the entry can be in any child whose range touches the key, try them left to right
+	NonLeafNodeInt* node = readNonLeaf(pageNo);
+	int childCount = getChildCount(node);
+	bool childIsLeaf = (node->level == 1);
+	int pos = 0;
+	while((pos < childCount - 1) && (node->keyArray[pos] < entry.key)) {
+		pos++;
+	}
+	for(int i = pos; i < childCount; i++) {
+		if((i > pos) && (node->keyArray[i-1] > entry.key)) {
+			break;
+		}
+		bool childUnderflow = false;
+		if(removeFromNode(node->pageNoArray[i], childIsLeaf, entry, childUnderflow)) {
+			// lazily deleted entries came off the counts when they were marked,
+			// and a posting list entry is only removed once it holds nothing
+			bool dirty = false;
+			if(entry.rid.slot_number != Page::INVALID_SLOT && entry.rid.slot_number != POSTINGLISTSLOT) {
+				node->countArray[i]--;
+				dirty = true;
+			}
+			if(childUnderflow && childCount > 1) {
+				fixUnderflow(node, childCount, i, childIsLeaf);
+				childCount = getChildCount(node);
+				dirty = true;
+			}
+			underflow = (childCount < (nodeOccupancy + 1)/2);
+			releaseNonLeaf(pageNo, dirty);
+			return true;
+		}
+	}
+	releaseNonLeaf(pageNo, false);
+	return false;
+}
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::scanNext
+// BTreeIndex::fixUnderflow
 // -----------------------------------------------------------------------------
 
-const void BTreeIndex::scanNext(RecordId& outRid) 
+void BTreeIndex::fixUnderflow(NonLeafNodeInt* parent, const int childCount, const int pos,
+		const bool childIsLeaf)
 {
-    if (scanExecuting == false) {
-        throw ScanNotInitializedException();
-    }
-    if (this->currentPageNum == 0) {
-        throw IndexScanCompletedException();
-    }
-    LeafNodeInt * cur = (LeafNodeInt *) this->currentPageData;
-
-    // terminate scan if exceeds limits
-    if ((highOp == LT) && (cur->keyArray[nextEntry] >= highValInt)) {
-	throw IndexScanCompletedException();
-    } else if((highOp == LTE) && (cur->keyArray[nextEntry] > highValInt)) {
-	throw IndexScanCompletedException();
-    }
-    outRid = cur->ridArray[nextEntry];	
-    nextEntry++;		
-    if( nextEntry == leafOccupancy ||  cur->ridArray[nextEntry].page_number == 0 ){
-	this->currentPageNum =  cur->rightSibPageNo;
-	if(cur->rightSibPageNo == 0) return;
-	this->bufMgr->readPage(this->file, this->currentPageNum, this->currentPageData);
-	this->bufMgr->unPinPage(this->file, this->currentPageNum, false);
-	nextEntry = 0;
-    }
+	// pair the child up with its left sibling, or the right one for the first child
+	int leftPos = (pos > 0) ? pos - 1 : pos;
+	PageId leftPageNo = parent->pageNoArray[leftPos];
+	PageId rightPageNo = parent->pageNoArray[leftPos+1];
+	Page* leftPage;
+	Page* rightPage;
+	bufMgr->readPage(file, leftPageNo, leftPage);
+	bufMgr->readPage(file, rightPageNo, rightPage);
+
+	bool merged;
+	if(childIsLeaf) {
+		merged = balanceLeaves((LeafNodeInt*)leftPage, (LeafNodeInt*)rightPage, parent->keyArray[leftPos]);
+		parent->countArray[leftPos] = getLiveCount((LeafNodeInt*)leftPage);
+		parent->countArray[leftPos+1] = getLiveCount((LeafNodeInt*)rightPage);
+	} else {
+		merged = balanceNonLeaves((NonLeafNodeInt*)leftPage, (NonLeafNodeInt*)rightPage, parent->keyArray[leftPos]);
+		parent->countArray[leftPos] = getSubtreeCount((NonLeafNodeInt*)leftPage);
+		parent->countArray[leftPos+1] = getSubtreeCount((NonLeafNodeInt*)rightPage);
+	}
+	if(merged && childIsLeaf && ((LeafNodeInt*)leftPage)->rightSibPageNo != 0) {
+		setLeftSibling(((LeafNodeInt*)leftPage)->rightSibPageNo, leftPageNo);
+	}
+	bufMgr->unPinPage(file, leftPageNo, true);
+	bufMgr->unPinPage(file, rightPageNo, true);
+
+	if(merged) {
+		// drop the separator and the emptied right node from the parent
+		for(int i = leftPos; i < childCount - 2; i++) {
+			parent->keyArray[i] = parent->keyArray[i+1];
+			parent->pageNoArray[i+1] = parent->pageNoArray[i+2];
+			parent->countArray[i+1] = parent->countArray[i+2];
+		}
+		parent->pageNoArray[childCount-1] = 0;
+		freeIndexPage(rightPageNo);
+		pinnedNodesStale = pinnedNodesStale || !childIsLeaf;
+	}
 }
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::endScan
+// BTreeIndex::balanceLeaves
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::balanceLeaves(LeafNodeInt* left, LeafNodeInt* right, int& separator)
+{
+	int leftCount = getLeafCount(left);
+	int rightCount = getLeafCount(right);
+	int total = leftCount + rightCount;
+
+	if(total <= leafOccupancy) {
+		// merge right into left
+		for(int i = 0; i < rightCount; i++) {
+			left->keyArray[leftCount+i] = right->keyArray[i];
+			left->ridArray[leftCount+i] = right->ridArray[i];
+		}
+		left->rightSibPageNo = right->rightSibPageNo;
+		return true;
+	}
+
+	// borrow from the fuller sibling so both end up half full
+	int newLeftCount = total/2;
+	if(newLeftCount > leftCount) {
+		int moved = newLeftCount - leftCount;
+		for(int i = 0; i < moved; i++) {
+			left->keyArray[leftCount+i] = right->keyArray[i];
+			left->ridArray[leftCount+i] = right->ridArray[i];
+		}
+		for(int i = 0; i < rightCount - moved; i++) {
+			right->keyArray[i] = right->keyArray[i+moved];
+			right->ridArray[i] = right->ridArray[i+moved];
+		}
+		for(int i = rightCount - moved; i < rightCount; i++) {
+			right->ridArray[i].page_number = 0;
+		}
+	} else {
+		int moved = leftCount - newLeftCount;
+		for(int i = rightCount - 1; i >= 0; i--) {
+			right->keyArray[i+moved] = right->keyArray[i];
+			right->ridArray[i+moved] = right->ridArray[i];
+		}
+		for(int i = 0; i < moved; i++) {
+			right->keyArray[i] = left->keyArray[newLeftCount+i];
+			right->ridArray[i] = left->ridArray[newLeftCount+i];
+			left->ridArray[newLeftCount+i].page_number = 0;
+		}
+	}
+	separator = right->keyArray[0];
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::balanceNonLeaves
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::balanceNonLeaves(NonLeafNodeInt* left, NonLeafNodeInt* right, int& separator)
+{
+	int leftCount = getChildCount(left);
+	int rightCount = getChildCount(right);
+	int total = leftCount + rightCount;
+
+	if(total <= nodeOccupancy + 1) {
+		// merge right into left, the separator comes down between the two halves
+		left->keyArray[leftCount-1] = separator;
+		for(int i = 0; i < rightCount; i++) {
+			left->pageNoArray[leftCount+i] = right->pageNoArray[i];
+			left->countArray[leftCount+i] = right->countArray[i];
+		}
+		for(int i = 0; i < rightCount - 1; i++) {
+			left->keyArray[leftCount+i] = right->keyArray[i];
+		}
+		return true;
+	}
+
+	// rotate children through the parent until both sides hold half
+	int keys[2 * (INTARRAYNONLEAFSIZE + 1)];
+	PageId pageNos[2 * (INTARRAYNONLEAFSIZE + 1)];
+	int counts[2 * (INTARRAYNONLEAFSIZE + 1)];
+	for(int i = 0; i < leftCount; i++) {
+		pageNos[i] = left->pageNoArray[i];
+		counts[i] = left->countArray[i];
+	}
+	for(int i = 0; i < rightCount; i++) {
+		pageNos[leftCount+i] = right->pageNoArray[i];
+		counts[leftCount+i] = right->countArray[i];
+	}
+	for(int i = 0; i < leftCount - 1; i++) {
+		keys[i] = left->keyArray[i];
+	}
+	keys[leftCount-1] = separator;
+	for(int i = 0; i < rightCount - 1; i++) {
+		keys[leftCount+i] = right->keyArray[i];
+	}
+
+	int newLeftCount = total/2;
+	for(int i = 0; i <= nodeOccupancy; i++) {
+		left->pageNoArray[i] = (i < newLeftCount) ? pageNos[i] : 0;
+		right->pageNoArray[i] = (i < total - newLeftCount) ? pageNos[newLeftCount+i] : 0;
+		left->countArray[i] = (i < newLeftCount) ? counts[i] : 0;
+		right->countArray[i] = (i < total - newLeftCount) ? counts[newLeftCount+i] : 0;
+	}
+	for(int i = 0; i < newLeftCount - 1; i++) {
+		left->keyArray[i] = keys[i];
+	}
+	for(int i = 0; i < total - newLeftCount - 1; i++) {
+		right->keyArray[i] = keys[newLeftCount+i];
+	}
+	separator = keys[newLeftCount-1];
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::setLeftSibling
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::setLeftSibling(const PageId pageNo, const PageId leftPageNo)
+{
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+	((LeafNodeInt*)page)->leftSibPageNo = leftPageNo;
+	bufMgr->unPinPage(file, pageNo, true);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::allocIndexPage
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::allocIndexPage(PageId& pageNo, Page*& page)
+{
+	if(freeListPageNum == 0) {
+		bufMgr->allocPage(file, pageNo, page);
+		return;
+	}
+
+	// reuse the first page of the free list
+	pageNo = freeListPageNum;
+	bufMgr->readPage(file, pageNo, page);
+	freeListPageNum = ((FreeIndexPage*)page)->nextFreePageNo;
+	*page = Page();
+
+	Page* metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	((IndexMetaInfo*)metaPage)->firstFreePageNo = freeListPageNum;
+	bufMgr->unPinPage(file, headerPageNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::freeIndexPage
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::freeIndexPage(const PageId pageNo)
+{
+	// BlobFile pages cannot be deleted, chain the page into the free list instead
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+	((FreeIndexPage*)page)->nextFreePageNo = freeListPageNum;
+	bufMgr->unPinPage(file, pageNo, true);
+	freeListPageNum = pageNo;
+
+	Page* metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	((IndexMetaInfo*)metaPage)->firstFreePageNo = freeListPageNum;
+	bufMgr->unPinPage(file, headerPageNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::createPostingList
+// -----------------------------------------------------------------------------
+
+PageId BTreeIndex::createPostingList(const std::vector<RecordId>& rids)
+{
+	// fill each page before chaining the next one
+	PageId headPageNo = 0;
+	PageId prevPageNo = 0;
+	PostingPageInt* prev = NULL;
+	size_t done = 0;
+	do {
+		PageId pageNo;
+		Page* page;
+		allocIndexPage(pageNo, page);
+		PostingPageInt* posting = (PostingPageInt*)page;
+		posting->nextPageNo = 0;
+		posting->totalCount = (prev == NULL) ? (int)rids.size() : 0;
+		done += encodePostingPage(posting, rids, done);
+		if(prev == NULL) {
+			headPageNo = pageNo;
+		} else {
+			prev->nextPageNo = pageNo;
+			bufMgr->unPinPage(file, prevPageNo, true);
+		}
+		prev = posting;
+		prevPageNo = pageNo;
+	} while(done < rids.size());
+	bufMgr->unPinPage(file, prevPageNo, true);
+	return headPageNo;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertIntoPostingList
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::insertIntoPostingList(const PageId headPageNo, const RecordId& rid)
+{
+	Page* page;
+	bufMgr->readPage(file, headPageNo, page);
+	PostingPageInt* head = (PostingPageInt*)page;
+
+	// the rid goes to the first page that does not end below it, or the last one
+	PageId pageNo = headPageNo;
+	PostingPageInt* posting = head;
+	std::vector<RecordId> rids;
+	while(true) {
+		rids.clear();
+		decodePostingPage(posting, rids);
+		if(posting->nextPageNo == 0 || (!rids.empty() && !ridLess(rids.back(), rid))) {
+			break;
+		}
+		PageId nextPageNo = posting->nextPageNo;
+		if(pageNo != headPageNo) {
+			bufMgr->unPinPage(file, pageNo, false);
+		}
+		pageNo = nextPageNo;
+		bufMgr->readPage(file, pageNo, page);
+		posting = (PostingPageInt*)page;
+	}
+	rids.insert(std::upper_bound(rids.begin(), rids.end(), rid, ridLess), rid);
+
+	// whatever no longer fits spills into new pages right after this one
+	size_t done = encodePostingPage(posting, rids, 0);
+	PageId lastPageNo = pageNo;
+	PostingPageInt* last = posting;
+	while(done < rids.size()) {
+		PageId newPageNo;
+		Page* newPage;
+		allocIndexPage(newPageNo, newPage);
+		PostingPageInt* spill = (PostingPageInt*)newPage;
+		spill->nextPageNo = last->nextPageNo;
+		spill->totalCount = 0;
+		done += encodePostingPage(spill, rids, done);
+		last->nextPageNo = newPageNo;
+		if(lastPageNo != pageNo) {
+			bufMgr->unPinPage(file, lastPageNo, true);
+		}
+		lastPageNo = newPageNo;
+		last = spill;
+	}
+	if(lastPageNo != pageNo) {
+		bufMgr->unPinPage(file, lastPageNo, true);
+	}
+	if(pageNo != headPageNo) {
+		bufMgr->unPinPage(file, pageNo, true);
+	}
+	head->totalCount++;
+	bufMgr->unPinPage(file, headPageNo, true);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::removeFromPostingList
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::removeFromPostingList(const PageId headPageNo, const RecordId& rid)
+{
+	Page* page;
+	bufMgr->readPage(file, headPageNo, page);
+	PostingPageInt* head = (PostingPageInt*)page;
+
+	// find the page holding rid, remembering the one before it
+	PageId prevPageNo = 0;
+	PageId pageNo = headPageNo;
+	PostingPageInt* posting = head;
+	std::vector<RecordId> rids;
+	while(true) {
+		rids.clear();
+		decodePostingPage(posting, rids);
+		std::vector<RecordId>::iterator it = std::lower_bound(rids.begin(), rids.end(), rid, ridLess);
+		if(it != rids.end() && *it == rid) {
+			rids.erase(it);
+			break;
+		}
+		PageId nextPageNo = posting->nextPageNo;
+		if(pageNo != headPageNo) {
+			bufMgr->unPinPage(file, pageNo, false);
+		}
+		if(it != rids.end() || nextPageNo == 0) {
+			bufMgr->unPinPage(file, headPageNo, false);
+			return false;
+		}
+		prevPageNo = pageNo;
+		pageNo = nextPageNo;
+		bufMgr->readPage(file, pageNo, page);
+		posting = (PostingPageInt*)page;
+	}
+
+	if(!rids.empty() || (posting->nextPageNo == 0 && pageNo == headPageNo)) {
+		encodePostingPage(posting, rids, 0);
+		if(pageNo != headPageNo) {
+			bufMgr->unPinPage(file, pageNo, true);
+		}
+	} else if(pageNo == headPageNo) {
+		// the head page emptied out, the next page moves into it
+		PageId nextPageNo = head->nextPageNo;
+		bufMgr->readPage(file, nextPageNo, page);
+		PostingPageInt* next = (PostingPageInt*)page;
+		head->nextPageNo = next->nextPageNo;
+		head->ridCount = next->ridCount;
+		head->byteCount = next->byteCount;
+		memcpy(head->data, next->data, next->byteCount);
+		bufMgr->unPinPage(file, nextPageNo, false);
+		freeIndexPage(nextPageNo);
+	} else {
+		// unlink the emptied page
+		PageId nextPageNo = posting->nextPageNo;
+		bufMgr->unPinPage(file, pageNo, false);
+		freeIndexPage(pageNo);
+		bufMgr->readPage(file, prevPageNo, page);
+		((PostingPageInt*)page)->nextPageNo = nextPageNo;
+		bufMgr->unPinPage(file, prevPageNo, true);
+	}
+	head->totalCount--;
+	bufMgr->unPinPage(file, headPageNo, true);
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::freePostingList
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::freePostingList(const PageId headPageNo)
+{
+	PageId pageNo = headPageNo;
+	while(pageNo != 0) {
+		Page* page;
+		bufMgr->readPage(file, pageNo, page);
+		PageId nextPageNo = ((PostingPageInt*)page)->nextPageNo;
+		bufMgr->unPinPage(file, pageNo, false);
+		freeIndexPage(pageNo);
+		pageNo = nextPageNo;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::readPostingList
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::readPostingList(const PageId headPageNo, std::vector<RecordId>& rids)
+{
+	PageId pageNo = headPageNo;
+	while(pageNo != 0) {
+		Page* page;
+		bufMgr->readPage(file, pageNo, page);
+		decodePostingPage((PostingPageInt*)page, rids);
+		PageId nextPageNo = ((PostingPageInt*)page)->nextPageNo;
+		bufMgr->unPinPage(file, pageNo, false);
+		pageNo = nextPageNo;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::getPostingCount
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::getPostingCount(const PageId headPageNo)
+{
+	Page* page;
+	bufMgr->readPage(file, headPageNo, page);
+	int total = ((PostingPageInt*)page)->totalCount;
+	bufMgr->unPinPage(file, headPageNo, false);
+	return total;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::encodePostingPage
+// -----------------------------------------------------------------------------
+
+size_t BTreeIndex::encodePostingPage(PostingPageInt* posting, const std::vector<RecordId>& rids, const size_t from) const
+{
+	// each page starts from 0 so it decodes on its own, then varint deltas
+	// of 7 bits per byte, low bits first
+	unsigned long long prev = 0;
+	int bytes = 0;
+	size_t i = from;
+	for(; i < rids.size(); i++) {
+		unsigned char buf[10];
+		int len = 0;
+		unsigned long long delta = ridValue(rids[i]) - prev;
+		do {
+			buf[len] = delta & 0x7f;
+			delta >>= 7;
+			if(delta != 0) {
+				buf[len] |= 0x80;
+			}
+			len++;
+		} while(delta != 0);
+		if(bytes + len > POSTINGPAGESIZE) {
+			break;
+		}
+		memcpy(posting->data + bytes, buf, len);
+		bytes += len;
+		prev = ridValue(rids[i]);
+	}
+	posting->ridCount = (int)(i - from);
+	posting->byteCount = bytes;
+	return i - from;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::decodePostingPage
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::decodePostingPage(const PostingPageInt* posting, std::vector<RecordId>& rids) const
+{
+	unsigned long long value = 0;
+	int bytes = 0;
+	for(int i = 0; i < posting->ridCount; i++) {
+		unsigned long long delta = 0;
+		int shift = 0;
+		unsigned char byte;
+		do {
+			byte = posting->data[bytes++];
+			delta |= (unsigned long long)(byte & 0x7f) << shift;
+			shift += 7;
+		} while(byte & 0x80);
+		value += delta;
+		RecordId rid;
+		rid.page_number = (PageId)(value >> 16);
+		rid.slot_number = (SlotId)(value & 0xffff);
+		rids.push_back(rid);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::readNonLeaf
+// -----------------------------------------------------------------------------
+
+NonLeafNodeInt* BTreeIndex::readNonLeaf(const PageId pageNo)
+{
+	// the top levels are held pinned, only the rest goes through the buffer manager
+	std::map<PageId, PinnedNodeInt>::iterator it = pinnedNodes.find(pageNo);
+	if(it != pinnedNodes.end()) {
+		return it->second.node;
+	}
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+	return (NonLeafNodeInt*)page;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::releaseNonLeaf
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::releaseNonLeaf(const PageId pageNo, const bool dirty)
+{
+	// a held node is only marked dirty, it reaches the buffer manager when it is let go
+	std::map<PageId, PinnedNodeInt>::iterator it = pinnedNodes.find(pageNo);
+	if(it != pinnedNodes.end()) {
+		it->second.dirty = it->second.dirty || dirty;
+		return;
+	}
+	bufMgr->unPinPage(file, pageNo, dirty);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::refreshPinnedNodes
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::refreshPinnedNodes()
+{
+	releasePinnedNodes();
+	pinnedNodesStale = false;
+	if(rootIsLeaf) {
+		return;
+	}
+
+	// pin level by level from the root, as long as the whole level fits
+	std::vector<PageId> level(1, rootPageNum);
+	while(!level.empty() && pinnedNodes.size() + level.size() <= (size_t)PINNEDNODELIMIT) {
+		std::vector<PageId> nextLevel;
+		for(size_t i = 0; i < level.size(); i++) {
+			Page* page;
+			bufMgr->readPage(file, level[i], page);
+			PinnedNodeInt pinned;
+			pinned.node = (NonLeafNodeInt*)page;
+			pinned.dirty = false;
+			pinnedNodes[level[i]] = pinned;
+			if(pinned.node->level == 0) {
+				int childCount = getChildCount(pinned.node);
+				for(int j = 0; j < childCount; j++) {
+					nextLevel.push_back(pinned.node->pageNoArray[j]);
+				}
+			}
+		}
+		level.swap(nextLevel);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::releasePinnedNodes
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::releasePinnedNodes()
+{
+	for(std::map<PageId, PinnedNodeInt>::iterator it = pinnedNodes.begin(); it != pinnedNodes.end(); ++it) {
+		bufMgr->unPinPage(file, it->first, it->second.dirty);
+	}
+	pinnedNodes.clear();
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::findLeafPageNo
+// -----------------------------------------------------------------------------
+
+PageId BTreeIndex::findLeafPageNo(const int key, const bool afterKey)
+{
+	// go down the leftmost (or rightmost) path that may hold key, only one page is pinned at a time
+	PageId pageNo = rootPageNum;
+	bool isLeaf = rootIsLeaf;
+	while(!isLeaf) {
+		NonLeafNodeInt* node = readNonLeaf(pageNo);
+		int childCount = getChildCount(node);
+		int pos = 0;
+		while((pos < childCount - 1) && (node->keyArray[pos] < key || (afterKey && node->keyArray[pos] == key))) {
+			pos++;
+		}
+		PageId childPageNo = node->pageNoArray[pos];
+		isLeaf = (node->level == 1);
+		releaseNonLeaf(pageNo, false);
+		pageNo = childPageNo;
+	}
+	return pageNo;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::findLeafPos
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::findLeafPos(const LeafNodeInt* node, const int count, const int key, const bool afterKey) const
+{
+	// binary search for the first key >= key, or > key if afterKey
+	int low = 0;
+	int high = count;
+	while(low < high) {
+		int mid = (low + high)/2;
+		if(node->keyArray[mid] < key || (afterKey && node->keyArray[mid] == key)) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::getLeafCount
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::getLeafCount(const LeafNodeInt* node) const
+{
+	// entries are packed to the left, binary search for the first empty slot
+	int low = 0;
+	int high = leafOccupancy;
+	while(low < high) {
+		int mid = (low + high)/2;
+		if(node->ridArray[mid].page_number != 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::getChildCount
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::getChildCount(const NonLeafNodeInt* node) const
+{
+	int low = 0;
+	int high = nodeOccupancy + 1;
+	while(low < high) {
+		int mid = (low + high)/2;
+		if(node->pageNoArray[mid] != 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::getLiveCount
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::getLiveCount(const LeafNodeInt* node)
+{
+	int live = 0;
+	for(int i = 0; i < leafOccupancy && node->ridArray[i].page_number != 0; i++) {
+		live += getEntryCount(node, i);
+	}
+	return live;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::getEntryCount
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::getEntryCount(const LeafNodeInt* node, const int pos)
+{
+	if(node->ridArray[pos].slot_number == Page::INVALID_SLOT) {
+		return 0;
+	}
+	if(node->ridArray[pos].slot_number == POSTINGLISTSLOT) {
+		return getPostingCount(node->ridArray[pos].page_number);
+	}
+	return 1;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::getSubtreeCount
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::getSubtreeCount(const NonLeafNodeInt* node) const
+{
+	int total = 0;
+	int childCount = getChildCount(node);
+	for(int i = 0; i < childCount; i++) {
+		total += node->countArray[i];
+	}
+	return total;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::countBelow
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::countBelow(const int key, const bool inclusive)
+{
+	// add up the children left of the path down to key, then the leaf entries before it
+	int below = 0;
+	PageId pageNo = rootPageNum;
+	bool isLeaf = rootIsLeaf;
+	while(!isLeaf) {
+		NonLeafNodeInt* node = readNonLeaf(pageNo);
+		int childCount = getChildCount(node);
+		int pos = 0;
+		while((pos < childCount - 1) && (node->keyArray[pos] < key || (inclusive && node->keyArray[pos] == key))) {
+			below += node->countArray[pos];
+			pos++;
+		}
+		PageId childPageNo = node->pageNoArray[pos];
+		isLeaf = (node->level == 1);
+		releaseNonLeaf(pageNo, false);
+		pageNo = childPageNo;
+	}
+
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+	LeafNodeInt* node = (LeafNodeInt*)page;
+	int end = findLeafPos(node, getLeafCount(node), key, inclusive);
+	for(int i = 0; i < end; i++) {
+		below += getEntryCount(node, i);
+	}
+	bufMgr->unPinPage(file, pageNo, false);
+	return below;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::countRange
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::countRange(const void* lowValParm, const Operator lowOpParm,
+		const void* highValParm, const Operator highOpParm)
+{
+	int lowVal = *(int *)lowValParm;
+	int highVal = *(int *)highValParm;
+	if (lowVal > highVal) {
+		throw BadScanrangeException();
+	}
+	if (lowOpParm != GTE && lowOpParm != GT) {
+		throw BadOpcodesException();
+	}
+	if (highOpParm != LTE && highOpParm != LT) {
+		throw BadOpcodesException();
+	}
+
+	// an empty range such as (x,x) would come out negative
+	int count = countBelow(highVal, highOpParm == LTE) - countBelow(lowVal, lowOpParm == GT);
+	return std::max(count, 0);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::getLeafPages
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::getLeafPages(const void* lowValParm, const Operator lowOpParm,
+		const void* highValParm, const Operator highOpParm, std::vector<PageId>& leafPageNos)
+{
+	int lowVal = *(int *)lowValParm;
+	int highVal = *(int *)highValParm;
+	if (lowVal > highVal) {
+		throw BadScanrangeException();
+	}
+	if (lowOpParm != GTE && lowOpParm != GT) {
+		throw BadOpcodesException();
+	}
+	if (highOpParm != LTE && highOpParm != LT) {
+		throw BadOpcodesException();
+	}
+
+	if(rootIsLeaf) {
+		leafPageNos.push_back(rootPageNum);
+		return;
+	}
+	collectLeafPages(rootPageNum, lowVal, highVal, leafPageNos);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::collectLeafPages
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::collectLeafPages(const PageId pageNo, const int lowVal, const int highVal, std::vector<PageId>& leafPageNos)
+{
+	// keys equal to a separator may be on either side of it, so both children are taken
+	NonLeafNodeInt* node = readNonLeaf(pageNo);
+	int childCount = getChildCount(node);
+	for(int i = 0; i < childCount; i++) {
+		if(i > 0 && node->keyArray[i - 1] > highVal) {
+			break;
+		}
+		if(i < childCount - 1 && node->keyArray[i] < lowVal) {
+			continue;
+		}
+		if(node->level == 1) {
+			leafPageNos.push_back(node->pageNoArray[i]);
+		} else {
+			collectLeafPages(node->pageNoArray[i], lowVal, highVal, leafPageNos);
+		}
+	}
+	releaseNonLeaf(pageNo, false);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::readLeafRange
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::readLeafRange(const PageId leafPageNo, const void* lowValParm, const Operator lowOpParm,
+		const void* highValParm, const Operator highOpParm, std::vector<RecordId>& rids)
+{
+	int lowVal = *(int *)lowValParm;
+	int highVal = *(int *)highValParm;
+	Page* page;
+	bufMgr->readPage(file, leafPageNo, page);
+	LeafNodeInt* node = (LeafNodeInt*)page;
+	int count = getLeafCount(node);
+	for(int i = findLeafPos(node, count, lowVal, lowOpParm == GT); i < count; i++) {
+		int key = node->keyArray[i];
+		if((highOpParm == LT && key >= highVal) || (highOpParm == LTE && key > highVal)) {
+			break;
+		}
+		if(node->ridArray[i].slot_number == POSTINGLISTSLOT) {
+			readPostingList(node->ridArray[i].page_number, rids);
+		} else if(node->ridArray[i].slot_number != Page::INVALID_SLOT) {
+			rids.push_back(node->ridArray[i]);
+		}
+	}
+	bufMgr->unPinPage(file, leafPageNo, false);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::rank
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::rank(const void* key)
+{
+	return countBelow(*(int *)key, false);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::select
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::select(const int rank, void* outKey, RecordId& outRid)
+{
+	if(rank < 0) {
+		return false;
+	}
+
+	// skip whole children until the one holding the entry
+	int remaining = rank;
+	PageId pageNo = rootPageNum;
+	bool isLeaf = rootIsLeaf;
+	while(!isLeaf) {
+		NonLeafNodeInt* node = readNonLeaf(pageNo);
+		int childCount = getChildCount(node);
+		int pos = 0;
+		while((pos < childCount) && (remaining >= node->countArray[pos])) {
+			remaining -= node->countArray[pos];
+			pos++;
+		}
+		if(pos == childCount) {
+			releaseNonLeaf(pageNo, false);
+			return false;
+		}
+		PageId childPageNo = node->pageNoArray[pos];
+		isLeaf = (node->level == 1);
+		releaseNonLeaf(pageNo, false);
+		pageNo = childPageNo;
+	}
+
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+	LeafNodeInt* node = (LeafNodeInt*)page;
+	int count = getLeafCount(node);
+	for(int i = 0; i < count; i++) {
+		int entries = getEntryCount(node, i);
+		if(remaining < entries) {
+			*(int *)outKey = node->keyArray[i];
+			if(node->ridArray[i].slot_number == POSTINGLISTSLOT) {
+				std::vector<RecordId> rids;
+				readPostingList(node->ridArray[i].page_number, rids);
+				outRid = rids[remaining];
+			} else {
+				outRid = node->ridArray[i];
+			}
+			bufMgr->unPinPage(file, pageNo, false);
+			return true;
+		}
+		remaining -= entries;
+	}
+	bufMgr->unPinPage(file, pageNo, false);
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::lookup
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::lookup(const void* key, RecordId& outRid)
+{
+	int keyVal = *(int *)key;
+	PageId pageNo = findLeafPageNo(keyVal, false);
+
+	// the first live entry with the key wins, it may be a few leaves over
+	// when the key is duplicated or entries were deleted lazily
+	while(pageNo != 0) {
+		Page* page;
+		bufMgr->readPage(file, pageNo, page);
+		LeafNodeInt* node = (LeafNodeInt*)page;
+		int count = getLeafCount(node);
+		for(int i = findLeafPos(node, count, keyVal, false); i < count; i++) {
+			if(node->keyArray[i] != keyVal) {
+				bufMgr->unPinPage(file, pageNo, false);
+				return false;
+			}
+			if(node->ridArray[i].slot_number == POSTINGLISTSLOT && getPostingCount(node->ridArray[i].page_number) > 0) {
+				// only a list's first page is needed for its first record id
+				Page* postingPage;
+				std::vector<RecordId> rids;
+				bufMgr->readPage(file, node->ridArray[i].page_number, postingPage);
+				decodePostingPage((PostingPageInt*)postingPage, rids);
+				bufMgr->unPinPage(file, node->ridArray[i].page_number, false);
+				outRid = rids[0];
+				bufMgr->unPinPage(file, pageNo, false);
+				return true;
+			}
+			if(node->ridArray[i].slot_number != Page::INVALID_SLOT && node->ridArray[i].slot_number != POSTINGLISTSLOT) {
+				outRid = node->ridArray[i];
+				bufMgr->unPinPage(file, pageNo, false);
+				return true;
+			}
+		}
+		PageId nextPageNo = node->rightSibPageNo;
+		bufMgr->unPinPage(file, pageNo, false);
+		pageNo = nextPageNo;
+	}
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::lookupAll
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::lookupAll(const void* key, const std::function<void (const RecordId&)>& callback)
+{
+	int keyVal = *(int *)key;
+	PageId pageNo = findLeafPageNo(keyVal, false);
+	int found = 0;
+
+	while(pageNo != 0) {
+		Page* page;
+		bufMgr->readPage(file, pageNo, page);
+		LeafNodeInt* node = (LeafNodeInt*)page;
+		int count = getLeafCount(node);
+		int i = findLeafPos(node, count, keyVal, false);
+		for(; i < count && node->keyArray[i] == keyVal; i++) {
+			if(node->ridArray[i].slot_number == POSTINGLISTSLOT) {
+				std::vector<RecordId> rids;
+				readPostingList(node->ridArray[i].page_number, rids);
+				for(size_t j = 0; j < rids.size(); j++) {
+					callback(rids[j]);
+				}
+				found += (int)rids.size();
+			} else if(node->ridArray[i].slot_number != Page::INVALID_SLOT) {
+				callback(node->ridArray[i]);
+				found++;
+			}
+		}
+
+		// only a run that reaches the end of the leaf can go on in the next one
+		PageId nextPageNo = (i == count) ? node->rightSibPageNo : 0;
+		bufMgr->unPinPage(file, pageNo, false);
+		pageNo = nextPageNo;
+	}
+	return found;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::probeSorted
+// -----------------------------------------------------------------------------
+
+int BTreeIndex::probeSorted(const void* key, const std::function<void (const RecordId&)>& callback)
+{
+	int keyVal = *(int *)key;
+	if(probePageNum != 0 && keyVal <= probeFloor) {
+		endProbes();
+	}
+
+	// entries with keyVal start in the pinned leaf unless they are past its last key,
+	// then they start in its right sibling unless they are past that one's too
+	if(probePageNum != 0) {
+		LeafNodeInt* node = (LeafNodeInt*)probePageData;
+		int count = getLeafCount(node);
+		if(count == 0 || node->keyArray[count - 1] < keyVal) {
+			PageId siblingPageNo = node->rightSibPageNo;
+			endProbes();
+			if(count > 0 && siblingPageNo != 0) {
+				probePageNum = siblingPageNo;
+				bufMgr->readPage(file, probePageNum, probePageData);
+				node = (LeafNodeInt*)probePageData;
+				count = getLeafCount(node);
+				if(count == 0 || node->keyArray[count - 1] < keyVal) {
+					endProbes();
+				}
+			}
+		}
+	}
+	if(probePageNum == 0) {
+		probePageNum = findLeafPageNo(keyVal, false);
+		bufMgr->readPage(file, probePageNum, probePageData);
+	}
+
+	int found = 0;
+	while(true) {
+		LeafNodeInt* node = (LeafNodeInt*)probePageData;
+		int count = getLeafCount(node);
+		int i = findLeafPos(node, count, keyVal, false);
+		for(; i < count && node->keyArray[i] == keyVal; i++) {
+			if(node->ridArray[i].slot_number == POSTINGLISTSLOT) {
+				std::vector<RecordId> rids;
+				readPostingList(node->ridArray[i].page_number, rids);
+				for(size_t j = 0; j < rids.size(); j++) {
+					callback(rids[j]);
+				}
+				found += (int)rids.size();
+			} else if(node->ridArray[i].slot_number != Page::INVALID_SLOT) {
+				callback(node->ridArray[i]);
+				found++;
+			}
+		}
+		if(i < count || node->rightSibPageNo == 0) {
+			break;
+		}
+
+		// the run reaches the end of the leaf and may go on in the next one
+		PageId nextPageNo = node->rightSibPageNo;
+		bufMgr->unPinPage(file, probePageNum, false);
+		probePageNum = nextPageNo;
+		bufMgr->readPage(file, probePageNum, probePageData);
+	}
+
+	// the entries after keyVal start where its run ended
+	probeFloor = keyVal;
+	return found;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::endProbes
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::endProbes()
+{
+	if(probePageNum != 0) {
+		bufMgr->unPinPage(file, probePageNum, false);
+		probePageNum = 0;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::startScan
+// -----------------------------------------------------------------------------
+
+const void BTreeIndex::startScan(const void* lowValParm,
+				   const Operator lowOpParm,
+				   const void* highValParm,
+				   const Operator highOpParm,
+				   const bool descending) {
+        // set fields
+	lowValInt = *(int *)lowValParm;
+	highValInt = *(int *)highValParm;
+	lowOp = lowOpParm;
+	highOp = highOpParm;
+
+        // check range
+	if (lowValInt > highValInt) {
+		throw BadScanrangeException();
+	}
+	if (lowOpParm != GTE && lowOpParm != GT) {
+		throw BadOpcodesException();
+	}
+	if (highOpParm != LTE && highOpParm != LT) {
+		throw BadOpcodesException();
+	}
+
+	if(scanExecuting){
+		endScan();
+	}
+
+	scanExecuting = true;
+	scanDescending = descending;
+	inPostingList = false;
+
+	if(!descending) {
+		// pin the first leaf that may hold lowVal
+		currentPageNum = findLeafPageNo(lowValInt, false);
+		bufMgr->readPage(file, currentPageNum, currentPageData);
+
+		// skip entries below the low bound, they may run on into the right siblings
+		while(currentPageNum != 0) {
+			LeafNodeInt * cur = (LeafNodeInt *)currentPageData;
+			int count = getLeafCount(cur);
+			nextEntry = findLeafPos(cur, count, lowValInt, lowOp == GT);
+			if(nextEntry < count) {
+				break;
+			}
+			moveToRightSibling();
+		}
+	} else {
+		// pin the last leaf that may hold highVal and work back from there
+		currentPageNum = findLeafPageNo(highValInt, highOp == LTE);
+		bufMgr->readPage(file, currentPageNum, currentPageData);
+
+		while(currentPageNum != 0) {
+			LeafNodeInt * cur = (LeafNodeInt *)currentPageData;
+			nextEntry = findLeafPos(cur, getLeafCount(cur), highValInt, highOp == LTE) - 1;
+			if(nextEntry >= 0) {
+				break;
+			}
+			moveToLeftSibling();
+		}
+	}
+	skipDeadEntries();
+
+	// nothing on the near side of the range stays within its far end
+	if(currentPageNum == 0 || pastScanEnd(((LeafNodeInt *)currentPageData)->keyArray[nextEntry])) {
+		endScan();
+		throw NoSuchKeyFoundException();
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::scanNext
+// -----------------------------------------------------------------------------
+
+const void BTreeIndex::scanNext(RecordId& outRid) 
+{
+    if (scanExecuting == false) {
+        throw ScanNotInitializedException();
+    }
+    skipDeadEntries();
+    if (this->currentPageNum == 0) {
+        throw IndexScanCompletedException();
+    }
+    LeafNodeInt * cur = (LeafNodeInt *) this->currentPageData;
+
+    // terminate scan if exceeds limits
+    if (pastScanEnd(cur->keyArray[nextEntry])) {
+	throw IndexScanCompletedException();
+    }
+    if (inPostingList) {
+	outRid = postingRids[postingNext++];
+	if (postingNext == postingRids.size()) {
+	    inPostingList = false;
+	    advanceScanEntry();
+	}
+	return;
+    }
+    outRid = cur->ridArray[nextEntry];
+    advanceScanEntry();
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::scanNextBatch
+// -----------------------------------------------------------------------------
+
+size_t BTreeIndex::scanNextBatch(RecordId* outRids, const size_t max)
+{
+    if (scanExecuting == false) {
+        throw ScanNotInitializedException();
+    }
+
+    size_t count = 0;
+    int step = scanDescending ? -1 : 1;
+    while (count < max) {
+	skipDeadEntries();
+	if (this->currentPageNum == 0) {
+	    break;
+	}
+	LeafNodeInt * cur = (LeafNodeInt *) this->currentPageData;
+
+	// keys are sorted, so the first key past the far end of the range ends the whole scan
+	if (pastScanEnd(cur->keyArray[nextEntry])) {
+	    // nothing left in range, release the leaf now
+	    this->bufMgr->unPinPage(this->file, this->currentPageNum, false);
+	    this->currentPageNum = 0;
+	    break;
+	}
+
+	// a posting list is copied out as far as the buffer allows
+	if (inPostingList) {
+	    size_t n = std::min(max - count, postingRids.size() - postingNext);
+	    std::copy(postingRids.begin() + postingNext, postingRids.begin() + postingNext + n, outRids + count);
+	    count += n;
+	    postingNext += n;
+	    if (postingNext == postingRids.size()) {
+		inPostingList = false;
+		advanceScanEntry();
+	    }
+	    continue;
+	}
+
+	// copy the run of plain entries in range out in one go, leaving out lazily deleted entries
+	int leafCount = getLeafCount(cur);
+	while (count < max && nextEntry >= 0 && nextEntry < leafCount
+		&& cur->ridArray[nextEntry].slot_number != POSTINGLISTSLOT
+		&& !pastScanEnd(cur->keyArray[nextEntry])) {
+	    if (cur->ridArray[nextEntry].slot_number != Page::INVALID_SLOT) {
+		outRids[count++] = cur->ridArray[nextEntry];
+	    }
+	    nextEntry += step;
+	}
+    }
+    return count;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::moveToRightSibling
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::moveToRightSibling()
+{
+    // done with this leaf, move the pin over to its right sibling
+    LeafNodeInt * cur = (LeafNodeInt *) this->currentPageData;
+    PageId nextPageNum = cur->rightSibPageNo;
+    this->bufMgr->unPinPage(this->file, this->currentPageNum, false);
+    this->currentPageNum = nextPageNum;
+    if (nextPageNum == 0) return;
+    this->bufMgr->readPage(this->file, this->currentPageNum, this->currentPageData);
+    nextEntry = 0;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::moveToLeftSibling
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::moveToLeftSibling()
+{
+    // descending scans leave a leaf through its left end
+    LeafNodeInt * cur = (LeafNodeInt *) this->currentPageData;
+    PageId nextPageNum = cur->leftSibPageNo;
+    this->bufMgr->unPinPage(this->file, this->currentPageNum, false);
+    this->currentPageNum = nextPageNum;
+    if (nextPageNum == 0) return;
+    this->bufMgr->readPage(this->file, this->currentPageNum, this->currentPageData);
+    nextEntry = getLeafCount((LeafNodeInt *) this->currentPageData) - 1;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::advanceScanEntry
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::advanceScanEntry()
+{
+    LeafNodeInt * cur = (LeafNodeInt *) this->currentPageData;
+    if (scanDescending) {
+	nextEntry--;
+	if (nextEntry < 0) {
+	    moveToLeftSibling();
+	}
+	return;
+    }
+    nextEntry++;
+    if (nextEntry == leafOccupancy || cur->ridArray[nextEntry].page_number == 0) {
+	moveToRightSibling();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::skipDeadEntries
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::skipDeadEntries()
+{
+    while (!inPostingList && this->currentPageNum != 0) {
+	LeafNodeInt * cur = (LeafNodeInt *) this->currentPageData;
+	if (nextEntry < 0 || nextEntry >= leafOccupancy || cur->ridArray[nextEntry].page_number == 0) {
+	    if (scanDescending) {
+		moveToLeftSibling();
+	    } else {
+		moveToRightSibling();
+	    }
+	    continue;
+	}
+
+	// posting lists are only read once the scan is known to reach them
+	RecordId rid = cur->ridArray[nextEntry];
+	if (rid.slot_number == POSTINGLISTSLOT && !pastScanEnd(cur->keyArray[nextEntry])) {
+	    loadPostingList(rid.page_number);
+	    if (!postingRids.empty()) {
+		inPostingList = true;
+		return;
+	    }
+	} else if (rid.slot_number != Page::INVALID_SLOT) {
+	    return;
+	}
+	nextEntry += scanDescending ? -1 : 1;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::loadPostingList
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::loadPostingList(const PageId headPageNo)
+{
+    postingRids.clear();
+    readPostingList(headPageNo, postingRids);
+    if (scanDescending) {
+	std::reverse(postingRids.begin(), postingRids.end());
+    }
+    postingNext = 0;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::pastHighVal
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::pastHighVal(const int key) const
+{
+    return (highOp == LT && key >= highValInt) || (highOp == LTE && key > highValInt);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::pastLowVal
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::pastLowVal(const int key) const
+{
+    return (lowOp == GT && key <= lowValInt) || (lowOp == GTE && key < lowValInt);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::pastScanEnd
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::pastScanEnd(const int key) const
+{
+    return scanDescending ? pastLowVal(key) : pastHighVal(key);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::endScan
 // -----------------------------------------------------------------------------
 //
 const void BTreeIndex::endScan() 
@@ -1079,11 +2264,13 @@ const void BTreeIndex::endScan()
     } else {
         scanExecuting = false;
     }
+    inPostingList = false;
+    postingRids.clear();
     
     //unpin all the pages that have been pinned for the scan
-    try {
+    if (this->currentPageNum != 0) {
         bufMgr->unPinPage(this->file, this->currentPageNum, false);
-    } catch (PageNotPinnedException e) {}
+    }
     
 }
 
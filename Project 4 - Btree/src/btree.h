@@ -11,6 +11,9 @@
 #include <string>
 #include "string.h"
 #include <sstream>
+#include <vector>
+#include <map>
+#include <functional>
 
 #include "types.h"
 #include "page.h"
@@ -45,19 +48,40 @@ enum Operator
 /**
  * @brief Number of key slots in B+Tree leaf for INTEGER key.
  */
-//                                                  sibling ptr             key               rid
-const  int INTARRAYLEAFSIZE = ( Page::SIZE - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( RecordId ) );
+//                                                  sibling ptrs                key               rid
+const  int INTARRAYLEAFSIZE = ( Page::SIZE - 2 * sizeof( PageId ) ) / ( sizeof( int ) + sizeof( RecordId ) );
 
 /**
  * @brief Number of key slots in B+Tree non-leaf for INTEGER key.
  */
-//                                                     level     extra pageNo                  key       pageNo
-const  int INTARRAYNONLEAFSIZE = ( Page::SIZE - sizeof( int ) - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( PageId ) );
+//                                                     level     extra pageNo     extra count          key       pageNo          count
+const  int INTARRAYNONLEAFSIZE = ( Page::SIZE - sizeof( int ) - sizeof( PageId ) - sizeof( int ) ) / ( sizeof( int ) + sizeof( PageId ) + sizeof( int ) );
 
 /**
- * @return true if root is leaf
+ * @brief Slot number of a leaf entry whose page number is the first page of a posting list rather than a record id.
  */
-bool rootIsLeaf; 
+const SlotId POSTINGLISTSLOT = 0xFFFF;
+
+/**
+ * @brief Number of live entries with one key in a leaf at which they are packed into a posting list.
+ */
+const  int POSTINGLISTMIN = INTARRAYLEAFSIZE / 2;
+
+/**
+ * @brief Number of bytes of packed record ids a posting list page holds.
+ */
+//                                                  next page      rid, total and byte count
+const  int POSTINGPAGESIZE = Page::SIZE - sizeof( PageId ) - 3 * sizeof( int );
+
+/**
+ * @brief Number of entries the constructor collects from the base relation before loading them with insertBatch.
+ */
+const  int BULKLOADBATCHSIZE = 1 << 20;
+
+/**
+ * @brief Maximum number of non-leaf pages an index keeps pinned in the buffer pool for its descents.
+ */
+const  int PINNEDNODELIMIT = 16;
 
 /**
  * @brief Structure to store a key-rid pair. It is used to pass the pair to functions that 
@@ -133,6 +157,16 @@ struct IndexMetaInfo{
    * Page number of root page of the B+ Tree inside the file index file.
    */
 	PageId rootPageNo;
+
+  /**
+   * True if the root page is a leaf. Deletes can shrink the tree back down to a single leaf on any page.
+   */
+	bool rootIsLeaf;
+
+  /**
+   * First page of the chain of index pages freed by deletes, 0 if there are none.
+   */
+	PageId firstFreePageNo;
 };
 
 /*
@@ -160,6 +194,11 @@ struct NonLeafNodeInt{
    * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
    */
 	PageId pageNoArray[ INTARRAYNONLEAFSIZE + 1 ];
+
+  /**
+   * Number of live (not lazily deleted) entries in the subtree below each child, for counting and rank queries.
+   */
+	int countArray[ INTARRAYNONLEAFSIZE + 1 ];
 };
 
 
@@ -182,6 +221,100 @@ struct LeafNodeInt{
 	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
    */
 	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side, used by descending index scans.
+   */
+	PageId leftSibPageNo;
+};
+
+
+/**
+ * @brief Structure for the pages of a posting list, which holds the record ids of one key.
+ * Record ids are sorted by page and slot number and stored as varint coded deltas, starting over on every page
+ * so each page decodes on its own. The list spills into further pages as it grows.
+*/
+struct PostingPageInt{
+  /**
+   * Page number of the next page of the list, 0 on the last page.
+   */
+	PageId nextPageNo;
+
+  /**
+   * Number of record ids on this page.
+   */
+	int ridCount;
+
+  /**
+   * Number of record ids in the whole list, kept on the first page only.
+   */
+	int totalCount;
+
+  /**
+   * Number of bytes of data in use.
+   */
+	int byteCount;
+
+  /**
+   * Packed record id deltas.
+   */
+	unsigned char data[ POSTINGPAGESIZE ];
+};
+
+
+/**
+ * @brief Structure of an index page freed by a merge. BlobFile pages cannot be deleted, so free pages are chained
+ * from the meta page and handed out again before the file is grown.
+*/
+struct FreeIndexPage{
+  /**
+   * Page number of the next free page, 0 for the last one.
+   */
+	PageId nextFreePageNo;
+};
+
+
+/**
+ * @brief One pinned non-leaf on a root-to-leaf path. insertBatch keeps the whole path pinned between entries
+ * and only climbs as far up as the next leaf requires.
+*/
+struct PathLevelInt{
+  /**
+   * Page number of the non-leaf.
+   */
+	PageId pageNo;
+
+  /**
+   * The pinned non-leaf itself.
+   */
+	NonLeafNodeInt* node;
+
+  /**
+   * Index of the child the path continues through.
+   */
+	int pos;
+
+  /**
+   * True if the node has been changed while pinned.
+   */
+	bool dirty;
+};
+
+
+/**
+ * @brief A non-leaf of the top levels of the tree, which the index keeps pinned between calls
+ * so that descents do not have to go through the buffer manager for it.
+*/
+struct PinnedNodeInt{
+  /**
+   * The pinned non-leaf.
+   */
+	NonLeafNodeInt* node;
+
+  /**
+   * True if the node has been changed since it was pinned.
+   */
+	bool dirty;
 };
 
 
@@ -213,6 +346,16 @@ class BTreeIndex {
    */
 	PageId	rootPageNum;
 
+  /**
+   * True if root is leaf, i.e. the tree has only a single level.
+   */
+	bool		rootIsLeaf;
+
+  /**
+   * Head of the free page chain, cached from the meta page.
+   */
+	PageId	freeListPageNum;
+
   /**
    * Datatype of attribute over which index is built.
    */
@@ -233,6 +376,17 @@ class BTreeIndex {
    */
 	int			nodeOccupancy;
 
+  /**
+   * Non-leaves of the top levels of the tree, pinned for as long as they stay there. See refreshPinnedNodes().
+   */
+	std::map<PageId, PinnedNodeInt>	pinnedNodes;
+
+  /**
+   * True once the top levels may have changed, i.e. the root moved or a non-leaf was split or merged.
+   * pinnedNodes stays usable but is rebuilt when the operation that changed them completes.
+   */
+	bool		pinnedNodesStale;
+
 
 	// MEMBERS SPECIFIC TO SCANNING
 
@@ -296,6 +450,326 @@ class BTreeIndex {
    */
 	Operator	highOp;
 
+  /**
+   * True if the current scan returns entries from the high end of the range down.
+   */
+	bool		scanDescending;
+
+  /**
+   * True while the scan is returning the record ids of a posting list entry.
+   */
+	bool		inPostingList;
+
+  /**
+   * Record ids of the posting list being scanned, in scan order.
+   */
+	std::vector<RecordId> postingRids;
+
+  /**
+   * Index of the next record id to return from postingRids.
+   */
+	size_t	postingNext;
+
+	// MEMBERS SPECIFIC TO SORTED PROBES
+
+  /**
+   * Leaf the last probeSorted() ended on, kept pinned for the next one, 0 if none.
+   */
+	PageId	probePageNum;
+	Page		*probePageData;
+
+  /**
+   * Every entry with a key above probeFloor is in the pinned leaf or to its right.
+   */
+	int			probeFloor;
+
+  /**
+	 * Unpin the leaf currently being scanned and pin its right sibling, if any, as the new current page.
+	 * currentPageNum is set to 0 once the last leaf has been passed.
+	**/
+	void moveToRightSibling();
+
+  /**
+	 * Like moveToRightSibling() for descending scans, positioning the scan on the last entry of the left sibling.
+	**/
+	void moveToLeftSibling();
+
+  /**
+	 * Step the scan to the next entry in scan order, moving on to a sibling at the end of the leaf.
+	**/
+	void advanceScanEntry();
+
+  /**
+	 * Advance the scan past entries that have been deleted lazily and empty posting lists, moving on to siblings
+	 * if needed. When the scan stops on a posting list entry within range, its record ids are loaded.
+	**/
+	void skipDeadEntries();
+
+  /**
+	 * Decode the posting list starting at headPageNo into postingRids, in scan order.
+	 * The whole list is read up front, so deletes during the scan do not affect the pages being scanned.
+	**/
+	void loadPostingList(const PageId headPageNo);
+
+  /**
+	 * @return true if key is beyond the high end of the current scan range
+	**/
+	bool pastHighVal(const int key) const;
+
+  /**
+	 * @return true if key is beyond the low end of the current scan range
+	**/
+	bool pastLowVal(const int key) const;
+
+  /**
+	 * @return true if key is beyond the end the current scan is moving towards
+	**/
+	bool pastScanEnd(const int key) const;
+
+  /**
+	 * Recursively insert entry into the subtree rooted at pageNo.
+   * @param pageNo		Page of the subtree root
+   * @param isLeaf		True if pageNo is a leaf
+   * @param entry			Key/rid pair to insert
+   * @param newChild	Set to the new right sibling and its separator key if the node split
+   * @param newEntries	Set to the number of entries below newChild if the node split
+	 * @return true if the node split and newChild has to be added to its parent
+	**/
+	bool insertIntoNode(const PageId pageNo, const bool isLeaf, const RIDKeyPair<int>& entry, PageKeyPair<int>& newChild,
+			int& newEntries);
+
+  /**
+	 * Insert entry into a leaf that has room for it, keeping the keys sorted.
+	**/
+	void insertIntoLeaf(LeafNodeInt* node, const int count, const RIDKeyPair<int>& entry);
+
+  /**
+	 * Insert child right after the child at pos in a non-leaf that has room for it.
+	 * child was split off the child at pos, so childEntries moves over from its count.
+	**/
+	void insertIntoNonLeaf(NonLeafNodeInt* node, const int childCount, const int pos, const PageKeyPair<int>& child,
+			const int childEntries);
+
+  /**
+	 * Split a full leaf in half and insert entry into the proper half. The new right leaf and its first key are returned in newChild.
+	 * With rightEdge set, entry must not be smaller than any key in the leaf; the leaf is left full and entry alone starts the new leaf.
+	 * newEntries is set to the number of live entries in the new leaf.
+	**/
+	void splitLeaf(LeafNodeInt* node, const PageId pageNo, const RIDKeyPair<int>& entry, PageKeyPair<int>& newChild,
+			int& newEntries, const bool rightEdge);
+
+  /**
+	 * Split a full non-leaf while inserting child after pos. The middle key moves up and is returned in newChild with the new right node.
+	 * With rightEdge set (child goes after the last one) the node is left full and the new node only holds child.
+	 * Entry counts go along with their children as in insertIntoNonLeaf(); newEntries is set to the total of the new node.
+	**/
+	void splitNonLeaf(NonLeafNodeInt* node, const int pos, const PageKeyPair<int>& child, const int childEntries,
+			PageKeyPair<int>& newChild, int& newEntries, const bool rightEdge);
+
+  /**
+	 * Pin the path from the deepest level in path (or the root if path is empty) down to the leaf for key.
+   * @param fences		Exclusive upper key bound of each level in path, kept in step with path
+   * @param leafFence	Set to the exclusive upper key bound of the leaf
+	**/
+	void pinPathDown(const int key, std::vector<PathLevelInt>& path, std::vector<long long>& fences,
+			PageId& leafPageNo, LeafNodeInt*& leaf, long long& leafFence);
+
+  /**
+	 * Unpin every level of path and clear it.
+	**/
+	void releasePath(std::vector<PathLevelInt>& path);
+
+  /**
+	 * Put a new root above the old root and newChild, holding newEntries entries, after the old root has split.
+	**/
+	void growRoot(const PageKeyPair<int>& newChild, const int newEntries);
+
+  /**
+	 * Make pageNo the root of the tree and record it in the meta page.
+	**/
+	void setRoot(const PageId pageNo, const bool isLeaf);
+
+  /**
+	 * Remove entry from the tree, merging or rebalancing nodes that fall below half occupancy.
+	 * @return false if the entry is not in the tree
+	**/
+	bool removeEntry(const RIDKeyPair<int>& entry);
+
+  /**
+	 * Recursively remove entry from the subtree rooted at pageNo.
+   * @param underflow	Set to true if the node ends up below half occupancy
+	 * @return false if the entry is not in the subtree
+	**/
+	bool removeFromNode(const PageId pageNo, const bool isLeaf, const RIDKeyPair<int>& entry, bool& underflow);
+
+  /**
+	 * Recursively find entry in the subtree rooted at pageNo and mark it dead, see deleteEntryLazy().
+	 * @return false if the entry is not in the subtree
+	**/
+	bool markDeadInNode(const PageId pageNo, const bool isLeaf, const RIDKeyPair<int>& entry);
+
+  /**
+	 * Fix the underflowing child at pos of parent by borrowing from or merging with a sibling.
+	**/
+	void fixUnderflow(NonLeafNodeInt* parent, const int childCount, const int pos, const bool childIsLeaf);
+
+  /**
+	 * Merge right into left if they fit in one leaf, otherwise even them out.
+   * @param separator	Parent key between the two leaves, updated when entries move
+	 * @return true if right was merged into left and can be freed
+	**/
+	bool balanceLeaves(LeafNodeInt* left, LeafNodeInt* right, int& separator);
+
+  /**
+	 * Merge right into left if they fit in one node, otherwise even them out through the parent key.
+   * @param separator	Parent key between the two nodes, updated when children move
+	 * @return true if right was merged into left and can be freed
+	**/
+	bool balanceNonLeaves(NonLeafNodeInt* left, NonLeafNodeInt* right, int& separator);
+
+  /**
+	 * Point the left sibling pointer of leaf pageNo at leftPageNo.
+	**/
+	void setLeftSibling(const PageId pageNo, const PageId leftPageNo);
+
+  /**
+	 * Allocate a page for a new node, reusing a freed page if there is one. The page is returned pinned.
+	**/
+	void allocIndexPage(PageId& pageNo, Page*& page);
+
+  /**
+	 * Return an unpinned node page to the free page chain.
+	**/
+	void freeIndexPage(const PageId pageNo);
+
+  /**
+	 * Write sorted rids into a new posting list, filling each page before chaining the next one.
+	 * @return page number of the first page of the list
+	**/
+	PageId createPostingList(const std::vector<RecordId>& rids);
+
+  /**
+	 * Add rid to the posting list at headPageNo, keeping it sorted. A page that overflows spills into a new page
+	 * linked in after it.
+	**/
+	void insertIntoPostingList(const PageId headPageNo, const RecordId& rid);
+
+  /**
+	 * Remove rid from the posting list at headPageNo. Pages that empty out are freed, except the first page.
+	 * @return true if rid was found
+	**/
+	bool removeFromPostingList(const PageId headPageNo, const RecordId& rid);
+
+  /**
+	 * Free every page of the posting list at headPageNo.
+	**/
+	void freePostingList(const PageId headPageNo);
+
+  /**
+	 * Append the record ids of the posting list at headPageNo to rids, in sorted order.
+	**/
+	void readPostingList(const PageId headPageNo, std::vector<RecordId>& rids);
+
+  /**
+	 * @return number of record ids in the posting list at headPageNo
+	**/
+	int getPostingCount(const PageId headPageNo);
+
+  /**
+	 * Pack rids from index from on into a posting list page, as many as fit.
+	 * @return number of record ids written
+	**/
+	size_t encodePostingPage(PostingPageInt* posting, const std::vector<RecordId>& rids, const size_t from) const;
+
+  /**
+	 * Append the record ids packed in a posting list page to rids.
+	**/
+	void decodePostingPage(const PostingPageInt* posting, std::vector<RecordId>& rids) const;
+
+  /**
+	 * If the leaf already holds a posting list for the key of entry, add the rid of entry to it.
+	 * @return true if the entry went into a posting list, the leaf itself is left unchanged
+	**/
+	bool addToPostingList(LeafNodeInt* node, const int count, const RIDKeyPair<int>& entry);
+
+  /**
+	 * Replace the entries with key in a leaf by a single posting list entry once POSTINGLISTMIN of them are live.
+	 * Lazily deleted entries in the run are dropped.
+	**/
+	void packDuplicates(LeafNodeInt* node, const int key);
+
+  /**
+	 * Get non-leaf pageNo for reading or changing it, straight from pinnedNodes if it is held there
+	 * and from the buffer manager otherwise. Every call is paired with releaseNonLeaf().
+	**/
+	NonLeafNodeInt* readNonLeaf(const PageId pageNo);
+
+  /**
+	 * Done with a non-leaf from readNonLeaf(). Pages that are not held in pinnedNodes are unpinned.
+	**/
+	void releaseNonLeaf(const PageId pageNo, const bool dirty);
+
+  /**
+	 * Pin the top levels of the tree into pinnedNodes again, from the root down as long as the whole next level
+	 * fits within PINNEDNODELIMIT. Must not be called while a node from readNonLeaf() is in use.
+	**/
+	void refreshPinnedNodes();
+
+  /**
+	 * Unpin every node in pinnedNodes, e.g. before the index file is flushed.
+	**/
+	void releasePinnedNodes();
+
+  /**
+	 * Descend from the root to the leftmost leaf that may contain key, pinning one page at a time.
+	 * With afterKey set, descend to the rightmost leaf that may contain key instead.
+	 * @return page number of the leaf
+	**/
+	PageId findLeafPageNo(const int key, const bool afterKey);
+
+  /**
+	 * Binary search a leaf for the first entry with a key >= key, or > key if afterKey is set.
+	 * @return index of the entry, count if there is none
+	**/
+	int findLeafPos(const LeafNodeInt* node, const int count, const int key, const bool afterKey) const;
+
+  /**
+	 * @return number of entries in a leaf
+	**/
+	int getLeafCount(const LeafNodeInt* node) const;
+
+  /**
+	 * @return number of children of a non-leaf
+	**/
+	int getChildCount(const NonLeafNodeInt* node) const;
+
+  /**
+	 * @return number of record ids in a leaf that are not lazily deleted, posting lists included
+	**/
+	int getLiveCount(const LeafNodeInt* node);
+
+  /**
+	 * @return number of live record ids leaf entry pos stands for: 0 if it is lazily deleted,
+	 * the length of its list for a posting list entry and 1 otherwise
+	**/
+	int getEntryCount(const LeafNodeInt* node, const int pos);
+
+  /**
+	 * @return number of live entries below a non-leaf, from its entry counts
+	**/
+	int getSubtreeCount(const NonLeafNodeInt* node) const;
+
+  /**
+	 * Count the live entries with a key below key, or up to and including key if inclusive is set.
+	 * The entry counts of the children left of the path are summed up, so only one root-to-leaf path is read.
+	**/
+	int countBelow(const int key, const bool inclusive);
+
+  /**
+	 * Append the leaves below non-leaf pageNo that may hold keys from lowVal to highVal to leafPageNos, left to right.
+	**/
+	void collectLeafPages(const PageId pageNo, const int lowVal, const int highVal, std::vector<PageId>& leafPageNos);
+
 	
  public:
 
@@ -336,6 +810,116 @@ class BTreeIndex {
 	const void insertEntry(const void* key, const RecordId rid);
 
 
+  /**
+	 * Insert n entries <keys[i],rids[i]> in one go, e.g. for bulk loads.
+	 * The batch is sorted first unless it already is. The root-to-leaf path stays pinned from one entry to the next, so
+	 * consecutive keys fill a leaf without descending from the root again, and moving on to the next leaf only climbs as
+	 * far as their common parent. A full leaf that is appended to past its last key is not halved: it stays full and the
+	 * new entry starts a new right sibling, so sorted appends leave leaves (and non-leaves) almost completely full.
+   * @param keys		Array of n keys, pointer to integers
+   * @param rids		Array of n Record IDs matching keys
+   * @param n				Number of entries
+	**/
+	const void insertBatch(const void* keys, const RecordId* rids, const size_t n);
+
+
+  /**
+	 * Exact match lookup of key, for point queries such as primary key access.
+	 * Only one page is pinned at a time on the way down, the leaf is binary searched and nothing is left pinned
+	 * afterwards. It does not touch the scan state, so it can be used while a scan is executing.
+   * @param key			Key to look up, pointer to integer
+   * @param outRid	Record ID of the first entry with the key, set only if one is found
+	 * @return true if the key is in the index
+	**/
+	bool lookup(const void* key, RecordId& outRid);
+
+
+  /**
+	 * Exact match lookup of all entries with key, like lookup().
+	 * callback is invoked once per matching Record ID in index order, while the leaf holding it is pinned;
+	 * it must not modify the index.
+   * @param key			Key to look up, pointer to integer
+   * @param callback	Called for each matching Record ID
+	 * @return number of entries found
+	**/
+	int lookupAll(const void* key, const std::function<void (const RecordId&)>& callback);
+
+
+  /**
+	 * Exact match lookup of all entries with key, like lookupAll(), for keys that come in ascending order such as
+	 * the sorted outer keys of an index nested loop join. The leaf a probe ends on stays pinned and the next probe
+	 * starts there, or at its right sibling, instead of descending from the root again. A key that is not above
+	 * the previous one is looked up from the root. The index must not be changed between probes.
+   * @param key			Key to look up, pointer to integer
+   * @param callback	Called for each matching Record ID
+	 * @return number of entries found
+	**/
+	int probeSorted(const void* key, const std::function<void (const RecordId&)>& callback);
+
+
+  /**
+	 * Unpin the leaf kept by probeSorted(). Inserting or deleting entries, other than lazily, does it as well.
+	**/
+	void endProbes();
+
+
+  /**
+	 * Count the entries in a range without scanning it. The range is given as for startScan().
+	 * Non-leaves keep the number of entries below each child, so this reads two root-to-leaf paths
+	 * however many entries are in the range. Lazily deleted entries are not counted.
+   * @param lowVal	Low value of range, pointer to integer
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer
+   * @param highOp	High operator (LT/LTE)
+	 * @return number of entries in the range
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values 
+   * @throws  BadScanrangeException If lowVal > highval
+	**/
+	int countRange(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+
+  /**
+	 * Find the leaves that may hold entries in a range, left to right, reading only the non-leaves above them.
+	 * The range is given as for startScan(). Together with readLeafRange() this splits a range scan into pieces
+	 * that can be read in any order, e.g. by several threads.
+   * @param leafPageNos	Receives the page numbers of the leaves
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values 
+   * @throws  BadScanrangeException If lowVal > highval
+	**/
+	void getLeafPages(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+			std::vector<PageId>& leafPageNos);
+
+
+  /**
+	 * Append the record ids of the live entries of one leaf found by getLeafPages() that are in the range to rids,
+	 * in key order. It keeps no state in the index and only pins pages through the buffer manager, so several
+	 * threads may read leaves at once, as long as the index is not changed meanwhile.
+   * @param leafPageNo	Page number of the leaf
+   * @param rids			Receives the record ids
+	**/
+	void readLeafRange(const PageId leafPageNo, const void* lowVal, const Operator lowOp, const void* highVal,
+			const Operator highOp, std::vector<RecordId>& rids);
+
+
+  /**
+	 * Rank of a key, i.e. the number of entries with a smaller key. Reads one root-to-leaf path.
+   * @param key			Key to rank, pointer to integer
+	 * @return number of entries below key
+	**/
+	int rank(const void* key);
+
+
+  /**
+	 * Find the entry at position rank in key order (0 is the smallest), e.g. for medians and percentiles.
+	 * Reads one root-to-leaf path, skipping children by their entry counts.
+   * @param rank		Position of the entry
+   * @param outKey	Key of the entry, pointer to integer
+   * @param outRid	Record ID of the entry
+	 * @return false if rank is negative or not smaller than the number of entries
+	**/
+	bool select(const int rank, void* outKey, RecordId& outRid);
+
+
   /**
 	 * Begin a filtered scan of the index.  For instance, if the method is called 
 	 * using ("a",GT,"d",LTE) then we should seek all entries with a value 
@@ -343,15 +927,19 @@ class BTreeIndex {
 	 * If another scan is already executing, that needs to be ended here.
 	 * Set up all the variables for scan. Start from root to find out the leaf page that contains the first RecordID
 	 * that satisfies the scan parameters. Keep that page pinned in the buffer pool.
+	 * A descending scan starts at the high end of the range and follows the left sibling pointers, so queries
+	 * like "largest key below x" or top-N descending only read the few leaves they return entries from.
    * @param lowVal	Low value of range, pointer to integer / double / char string
    * @param lowOp		Low operator (GT/GTE)
    * @param highVal	High value of range, pointer to integer / double / char string
    * @param highOp	High operator (LT/LTE)
+   * @param descending	Return entries in descending key order
    * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values 
    * @throws  BadScanrangeException If lowVal > highval
 	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
 	**/
-	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+			const bool descending = false);
 
 
   /**
@@ -364,11 +952,63 @@ class BTreeIndex {
 	const void scanNext(RecordId& outRid);  // returned record id
 
 
+  /**
+	 * Fetch up to max record ids that match the scan in a single call.
+	 * Runs of qualifying entries are copied out of a leaf in one pass and posting lists are copied out whole,
+	 * so a range scan costs about one call per max entries rather than one per entry. The buffer is filled
+	 * across leaves, entries beyond max are returned by the next call.
+	 * The end of the scan is reported through the return value instead of IndexScanCompletedException.
+   * @param outRids	Array of at least max RecordIds that receives the matching record ids
+   * @param max			Capacity of outRids
+	 * @return Number of record ids copied into outRids, 0 once the scan is completed
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	size_t scanNextBatch(RecordId* outRids, const size_t max);
+
+
+  /**
+	 * Delete the entry <key,rid> from the index.
+	 * Leaves and non-leaves that fall below half occupancy borrow entries from a sibling, or are merged into it
+	 * when both fit in one node. Merged away pages are kept on a free list and reused by later splits.
+	 * If the root is left with a single child, that child becomes the new root.
+	 * Any executing scan is ended, since its leaf may be merged away.
+   * @param key			Key to delete, pointer to integer
+   * @param rid			Record ID stored with the key
+	 * @throws NoSuchKeyFoundException If the entry is not in the index.
+	**/
+	const void deleteEntry(const void* key, const RecordId rid);
+
+
+  /**
+	 * Mark the entry <key,rid> dead without restructuring the tree.
+	 * The entry keeps its slot but scans skip it; its space is given back by reclaimDeadEntries().
+	 * This is safe to call while a scan is executing.
+   * @param key			Key to delete, pointer to integer
+   * @param rid			Record ID stored with the key
+	 * @throws NoSuchKeyFoundException If the entry is not in the index.
+	**/
+	const void deleteEntryLazy(const void* key, const RecordId rid);
+
+
+  /**
+	 * Physically remove all entries marked dead by deleteEntryLazy(), merging and freeing nodes like deleteEntry().
+	 * Meant to be run periodically, e.g. when the index is idle. Any executing scan is ended.
+	 * @return number of entries removed
+	**/
+	const int reclaimDeadEntries();
+
+
   /**
 	 * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
 	 * @throws ScanNotInitializedException If no scan has been initialized.
 	**/
 	const void endScan();
+
+
+  /**
+	 * @return offset of the indexed attribute inside records
+	**/
+	int getAttrByteOffset() const { return attrByteOffset; }
 	
 };
 
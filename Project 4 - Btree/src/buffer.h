@@ -10,6 +10,7 @@
 #include "file.h"
 #include "bufHashTbl.h"
 #include <iostream>
+#include <mutex>
 
 namespace badgerdb {
 
@@ -157,6 +158,8 @@ struct BufStats
 
 /**
 * @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+* The methods that pin, unpin, allocate, flush or dispose pages hold a lock on the pool, so threads may share a
+* BufMgr. A page stays put while it is pinned, so its contents can be read without the lock.
 */
 class BufMgr 
 {
@@ -187,6 +190,11 @@ class BufMgr
   BufStats bufStats;
 
 	/**
+   * Held while the frames, the hash table and the statistics are looked at or changed
+	 */
+  std::mutex poolLock;
+
+	/**
 	 * Allocate a free frame.  
 	 *
 	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
@@ -276,10 +284,11 @@ class BufMgr
   void  printSelf();
 
 	/**
-   * Get buffer pool usage statistics
+   * Get buffer pool usage statistics, a copy taken under the pool lock since other threads may be updating them
 	 */
-  BufStats & getBufStats()
+  BufStats getBufStats()
   {
+		std::lock_guard<std::mutex> guard(poolLock);
 		return bufStats;
   }
 
@@ -288,6 +297,7 @@ class BufMgr
 	 */
   void clearBufStats() 
   {
+		std::lock_guard<std::mutex> guard(poolLock);
 		bufStats.clear();
   }
 };
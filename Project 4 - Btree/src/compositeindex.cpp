@@ -0,0 +1,486 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+#include "compositeindex.h"
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/scan_not_initialized_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/end_of_file_exception.h"
+
+namespace badgerdb
+{
+
+static bool entryLess(const RIDKeyPair<std::string>& e1, const RIDKeyPair<std::string>& e2)
+{
+	return e1.key < e2.key;
+}
+
+// -----------------------------------------------------------------------------
+// encodeKeyPart
+// -----------------------------------------------------------------------------
+
+std::string encodeKeyPart(const void* value, const Datatype type)
+{
+	std::string out;
+	if(type == STRING) {
+		const char* str = (const char*)value;
+		out.assign(str, getStringKeyLength(str));
+		out.push_back('\0');
+		return out;
+	}
+
+	unsigned long long bits;
+	int bytes;
+	if(type == INTEGER) {
+		bits = (unsigned int)*(const int*)value ^ 0x80000000u;
+		bytes = sizeof(int);
+	} else {
+		memcpy(&bits, value, sizeof(double));
+		bits = (bits >> 63) ? ~bits : bits ^ (1ULL << 63);
+		bytes = sizeof(double);
+	}
+	for(int i = bytes - 1; i >= 0; i--) {
+		out.push_back((char)((bits >> (8 * i)) & 0xff));
+	}
+	return out;
+}
+
+// -----------------------------------------------------------------------------
+// encodeCompositeKey
+// -----------------------------------------------------------------------------
+
+std::string encodeCompositeKey(const char* record, const std::vector<KeyPart>& parts)
+{
+	std::string key;
+	for(size_t i = 0; i < parts.size(); i++) {
+		key += encodeKeyPart(record + parts[i].attrByteOffset, parts[i].attrType);
+	}
+	return key;
+}
+
+// -----------------------------------------------------------------------------
+// prefixUpperBound
+// -----------------------------------------------------------------------------
+
+std::string prefixUpperBound(const std::string& prefix)
+{
+	// bump the last byte that can be bumped, everything after it no longer matters
+	std::string bound = prefix;
+	while(!bound.empty() && (unsigned char)bound[bound.size()-1] == 0xff) {
+		bound.erase(bound.size() - 1);
+	}
+	if(!bound.empty()) {
+		bound[bound.size()-1]++;
+	}
+	return bound;
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::CompositeIndex -- Constructor
+// -----------------------------------------------------------------------------
+
+CompositeIndex::CompositeIndex(const std::string & relationName,
+		std::string & outIndexName,
+		BufMgr *bufMgrIn,
+		const std::vector<KeyPart>& parts)
+{
+	if(parts.empty() || (int)parts.size() > MAXKEYPARTS) {
+		throw BadIndexInfoException("Composite keys take 1 to 4 attributes");
+	}
+	int maxKeySize = 0;
+	for(size_t i = 0; i < parts.size(); i++) {
+		maxKeySize += (parts[i].attrType == STRING) ? STRINGSIZE + 1 : (parts[i].attrType == DOUBLE) ? 8 : 4;
+	}
+	if(maxKeySize > MAXSTRINGKEYSIZE) {
+		throw BadIndexInfoException("Composite key is too long");
+	}
+
+	// construct an index name
+	std::ostringstream idxStr;
+	idxStr << relationName << ".k";
+	for(size_t i = 0; i < parts.size(); i++) {
+		idxStr << '.' << parts[i].attrByteOffset;
+	}
+	std::string indexName = idxStr.str();
+
+	outIndexName = indexName;
+	this->bufMgr = bufMgrIn;
+	this->keyParts = parts;
+	this->scanExecuting = false;
+
+	if(File::exists(indexName)) {
+		// open the index file and check it was built over the same attributes
+		this->file = new BlobFile(indexName, false);
+		this->headerPageNum = file->getFirstPageNo();
+		Page* metaPage;
+		bufMgr->readPage(file, headerPageNum, metaPage);
+		CompositeIndexMetaInfo* meta = (CompositeIndexMetaInfo*)metaPage;
+		bool match = (meta->partCount == (int)parts.size());
+		for(int i = 0; match && i < meta->partCount; i++) {
+			match = (meta->parts[i].attrByteOffset == parts[i].attrByteOffset && meta->parts[i].attrType == parts[i].attrType);
+		}
+		rootPageNum = meta->rootPageNo;
+		rootIsLeaf = meta->rootIsLeaf;
+		bufMgr->unPinPage(file, headerPageNum, false);
+		if(!match) {
+			delete file;
+			throw BadIndexInfoException("Index meta page does not match the requested attributes");
+		}
+		return;
+	}
+
+	// else, a new index file is created with an empty leaf as the root
+	this->file = new BlobFile(indexName, true);
+	Page* metaPage;
+	Page* rootPage;
+	bufMgr->allocPage(file, headerPageNum, metaPage);
+	bufMgr->allocPage(file, rootPageNum, rootPage);
+	rootIsLeaf = true;
+
+	CompositeIndexMetaInfo* meta = (CompositeIndexMetaInfo*)metaPage;
+	strcpy(meta->relationName, relationName.c_str());
+	meta->partCount = parts.size();
+	for(size_t i = 0; i < parts.size(); i++) {
+		meta->parts[i] = parts[i];
+	}
+	meta->rootPageNo = rootPageNum;
+	meta->rootIsLeaf = rootIsLeaf;
+	initStringLeaf((LeafNodeString*)rootPage);
+	bufMgr->unPinPage(file, rootPageNum, true);
+	bufMgr->unPinPage(file, headerPageNum, true);
+
+	// load the relation in key order, so every entry goes past the last key on the right edge of the tree
+	// and the nodes it splits stay full
+	FileScan* scan = new FileScan(relationName, bufMgr);
+	std::vector<RIDKeyPair<std::string> > entries;
+	try {
+		while(true) {
+			RecordId rid;
+			scan->scanNext(rid);
+			RIDKeyPair<std::string> entry;
+			entry.set(rid, encodeKey(scan->getRecord().c_str()));
+			entries.push_back(entry);
+		}
+	}
+	catch(const EndOfFileException& e) {}
+	delete scan;
+
+	std::stable_sort(entries.begin(), entries.end(), entryLess);
+	for(size_t i = 0; i < entries.size(); i++) {
+		insertEntry(entries[i].key, entries[i].rid);
+	}
+	bufMgr->flushFile(file);
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::~CompositeIndex -- destructor
+// -----------------------------------------------------------------------------
+
+CompositeIndex::~CompositeIndex()
+{
+	if(scanExecuting) {
+		endScan();
+	}
+	bufMgr->flushFile(file);
+	delete file;
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::encodeKey
+// -----------------------------------------------------------------------------
+
+std::string CompositeIndex::encodeKey(const char* record) const
+{
+	return encodeCompositeKey(record, keyParts);
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::insertEntry
+// -----------------------------------------------------------------------------
+
+const void CompositeIndex::insertEntry(const std::string& key, const RecordId rid)
+{
+	RIDKeyPair<std::string> entry;
+	entry.set(rid, key);
+	std::string sep;
+	PageId newPageNo;
+	if(insertIntoNode(rootPageNum, rootIsLeaf, true, entry, sep, newPageNo)) {
+		growRoot(sep, newPageNo);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::insertIntoNode
+// -----------------------------------------------------------------------------
+
+bool CompositeIndex::insertIntoNode(const PageId pageNo, const bool isLeaf, const bool rightmost,
+		const RIDKeyPair<std::string>& entry, std::string& newSep, PageId& newPageNo)
+{
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+
+	if(isLeaf) {
+		LeafNodeString* leaf = (LeafNodeString*)page;
+		if(insertIntoStringLeaf(leaf, entry)) {
+			bufMgr->unPinPage(file, pageNo, true);
+			return false;
+		}
+
+		// split, linking the new leaf in to the right of this one
+		Page* newPage;
+		bufMgr->allocPage(file, newPageNo, newPage);
+		LeafNodeString* newLeaf = (LeafNodeString*)newPage;
+		newLeaf->rightSibPageNo = leaf->rightSibPageNo;
+		newLeaf->leftSibPageNo = pageNo;
+		if(leaf->rightSibPageNo != 0) {
+			Page* rightPage;
+			bufMgr->readPage(file, leaf->rightSibPageNo, rightPage);
+			((LeafNodeString*)rightPage)->leftSibPageNo = newPageNo;
+			bufMgr->unPinPage(file, leaf->rightSibPageNo, true);
+		}
+		leaf->rightSibPageNo = newPageNo;
+		bool rightEdge = rightmost && entry.key >= getStringLeafKey(leaf, leaf->keyCount - 1);
+		newSep = splitStringLeaf(leaf, newLeaf, entry, rightEdge);
+		bufMgr->unPinPage(file, newPageNo, true);
+		bufMgr->unPinPage(file, pageNo, true);
+		return true;
+	}
+
+	// equal keys go right, after the entries already there
+	NonLeafNodeString* node = (NonLeafNodeString*)page;
+	int pos = findStringChildPos(node, entry.key, true);
+	std::string childSep;
+	PageId childPageNo;
+	if(!insertIntoNode(getStringChild(node, pos), node->level == 1, rightmost && pos == node->keyCount, entry,
+			childSep, childPageNo)) {
+		bufMgr->unPinPage(file, pageNo, false);
+		return false;
+	}
+	if(insertIntoStringNonLeaf(node, pos, childSep, childPageNo)) {
+		bufMgr->unPinPage(file, pageNo, true);
+		return false;
+	}
+
+	Page* newPage;
+	bufMgr->allocPage(file, newPageNo, newPage);
+	NonLeafNodeString* newNode = (NonLeafNodeString*)newPage;
+	newSep = splitStringNonLeaf(node, newNode, pos, childSep, childPageNo, rightmost && pos == node->keyCount);
+	bufMgr->unPinPage(file, newPageNo, true);
+	bufMgr->unPinPage(file, pageNo, true);
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::growRoot
+// -----------------------------------------------------------------------------
+
+void CompositeIndex::growRoot(const std::string& sep, const PageId newPageNo)
+{
+	int level = 1;
+	if(!rootIsLeaf) {
+		Page* oldRoot;
+		bufMgr->readPage(file, rootPageNum, oldRoot);
+		level = ((NonLeafNodeString*)oldRoot)->level + 1;
+		bufMgr->unPinPage(file, rootPageNum, false);
+	}
+
+	PageId newRootPageNo;
+	Page* newRoot;
+	bufMgr->allocPage(file, newRootPageNo, newRoot);
+	initStringNonLeaf((NonLeafNodeString*)newRoot, level, rootPageNum);
+	insertIntoStringNonLeaf((NonLeafNodeString*)newRoot, 0, sep, newPageNo);
+	bufMgr->unPinPage(file, newRootPageNo, true);
+	rootPageNum = newRootPageNo;
+	rootIsLeaf = false;
+
+	Page* metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	((CompositeIndexMetaInfo*)metaPage)->rootPageNo = rootPageNum;
+	((CompositeIndexMetaInfo*)metaPage)->rootIsLeaf = false;
+	bufMgr->unPinPage(file, headerPageNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::findLeafPageNo
+// -----------------------------------------------------------------------------
+
+PageId CompositeIndex::findLeafPageNo(const std::string& key)
+{
+	PageId pageNo = rootPageNum;
+	bool isLeaf = rootIsLeaf;
+	while(!isLeaf) {
+		Page* page;
+		bufMgr->readPage(file, pageNo, page);
+		NonLeafNodeString* node = (NonLeafNodeString*)page;
+		PageId childPageNo = getStringChild(node, findStringChildPos(node, key, false));
+		isLeaf = (node->level == 1);
+		bufMgr->unPinPage(file, pageNo, false);
+		pageNo = childPageNo;
+	}
+	return pageNo;
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::deleteEntry
+// -----------------------------------------------------------------------------
+
+const void CompositeIndex::deleteEntry(const std::string& key, const RecordId rid)
+{
+	// equal keys may run on into the right siblings
+	PageId pageNo = findLeafPageNo(key);
+	while(pageNo != 0) {
+		Page* page;
+		bufMgr->readPage(file, pageNo, page);
+		LeafNodeString* leaf = (LeafNodeString*)page;
+		int pos = findStringLeafPos(leaf, key, false);
+		int end = findStringLeafPos(leaf, key, true);
+		for(; pos < end; pos++) {
+			if(((StringLeafSlot*)leaf->data)[pos].rid == rid) {
+				removeFromStringLeaf(leaf, pos);
+				bufMgr->unPinPage(file, pageNo, true);
+				return;
+			}
+		}
+		PageId nextPageNo = leaf->rightSibPageNo;
+		bool more = (end == leaf->keyCount);
+		bufMgr->unPinPage(file, pageNo, false);
+		pageNo = more ? nextPageNo : 0;
+	}
+	throw NoSuchKeyFoundException();
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::startScan
+// -----------------------------------------------------------------------------
+
+const void CompositeIndex::startScan(const std::string& lowKeyParm, const Operator lowOpParm,
+		const std::string& highKeyParm, const Operator highOpParm)
+{
+	if(lowOpParm != GTE && lowOpParm != GT) {
+		throw BadOpcodesException();
+	}
+	if(highOpParm != LTE && highOpParm != LT) {
+		throw BadOpcodesException();
+	}
+	if(lowKeyParm > highKeyParm) {
+		throw BadScanrangeException();
+	}
+	if(scanExecuting) {
+		endScan();
+	}
+
+	lowKey = lowKeyParm;
+	highKey = highKeyParm;
+	lowOp = lowOpParm;
+	highOp = highOpParm;
+	scanExecuting = true;
+
+	currentPageNum = findLeafPageNo(lowKey);
+	bufMgr->readPage(file, currentPageNum, currentPageData);
+	nextEntry = findStringLeafPos((LeafNodeString*)currentPageData, lowKey, lowOp == GT);
+	if(nextEntry == ((LeafNodeString*)currentPageData)->keyCount) {
+		moveToRightSibling();
+	}
+
+	// nothing at or after the low end stays within the high end
+	if(currentPageNum == 0 || pastHighKey(getStringLeafKey((LeafNodeString*)currentPageData, nextEntry))) {
+		endScan();
+		throw NoSuchKeyFoundException();
+	}
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::startPrefixScan
+// -----------------------------------------------------------------------------
+
+const void CompositeIndex::startPrefixScan(const std::string& prefix)
+{
+	// without an upper bound the prefix is all 0xff bytes, and no key is greater than that many of them
+	std::string bound = prefixUpperBound(prefix);
+	if(bound.empty()) {
+		startScan(prefix, GTE, std::string(MAXSTRINGKEYSIZE, '\xff'), LTE);
+	} else {
+		startScan(prefix, GTE, bound, LT);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::scanNext
+// -----------------------------------------------------------------------------
+
+const void CompositeIndex::scanNext(RecordId& outRid)
+{
+	if(!scanExecuting) {
+		throw ScanNotInitializedException();
+	}
+	if(currentPageNum == 0) {
+		throw IndexScanCompletedException();
+	}
+	LeafNodeString* leaf = (LeafNodeString*)currentPageData;
+	if(pastHighKey(getStringLeafKey(leaf, nextEntry))) {
+		throw IndexScanCompletedException();
+	}
+	outRid = ((StringLeafSlot*)leaf->data)[nextEntry].rid;
+	nextEntry++;
+	if(nextEntry == leaf->keyCount) {
+		moveToRightSibling();
+	}
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::moveToRightSibling
+// -----------------------------------------------------------------------------
+
+void CompositeIndex::moveToRightSibling()
+{
+	// leaves emptied by deletes are stepped over
+	do {
+		PageId nextPageNum = ((LeafNodeString*)currentPageData)->rightSibPageNo;
+		bufMgr->unPinPage(file, currentPageNum, false);
+		currentPageNum = nextPageNum;
+		if(currentPageNum == 0) {
+			return;
+		}
+		bufMgr->readPage(file, currentPageNum, currentPageData);
+		nextEntry = 0;
+	} while(((LeafNodeString*)currentPageData)->keyCount == 0);
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::pastHighKey
+// -----------------------------------------------------------------------------
+
+bool CompositeIndex::pastHighKey(const std::string& key) const
+{
+	return (highOp == LT && key >= highKey) || (highOp == LTE && key > highKey);
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::endScan
+// -----------------------------------------------------------------------------
+
+const void CompositeIndex::endScan()
+{
+	if(!scanExecuting) {
+		throw ScanNotInitializedException();
+	}
+	scanExecuting = false;
+	if(currentPageNum != 0) {
+		bufMgr->unPinPage(file, currentPageNum, false);
+	}
+}
+
+}
@@ -0,0 +1,279 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+#include "stringnode.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Maximum number of attributes in a composite key.
+ */
+const  int MAXKEYPARTS = 4;
+
+/**
+ * @brief One attribute of a composite key.
+ */
+struct KeyPart{
+  /**
+   * Offset of the attribute inside the record.
+   */
+	int attrByteOffset;
+
+  /**
+   * Type of the attribute. STRING attributes are STRINGSIZE bytes wide.
+   */
+	Datatype attrType;
+};
+
+/**
+ * @brief The meta page of a composite index, which is always the first page of the index file.
+ */
+struct CompositeIndexMetaInfo{
+  /**
+   * Name of base relation.
+   */
+	char relationName[20];
+
+  /**
+   * Number of attributes the key is made of.
+   */
+	int partCount;
+
+  /**
+   * The attributes of the key, most significant first.
+   */
+	KeyPart parts[ MAXKEYPARTS ];
+
+  /**
+   * Page number of the root page.
+   */
+	PageId rootPageNo;
+
+  /**
+   * True if the root page is a leaf.
+   */
+	bool rootIsLeaf;
+};
+
+
+/**
+ * Encode one attribute value so that comparing encodings with memcmp orders them like the values.
+ * INTEGER and DOUBLE values become big endian with the sign bit flipped, negative DOUBLE values have all
+ * bits flipped. STRING values keep their bytes up to the first NUL and are ended by a 0 byte, so a shorter
+ * string sorts before the strings it is a prefix of and the next attribute starts after it.
+ * @param value	Pointer to the value, laid out as in a record
+ * @param type	Type of the value
+ * @return the encoded value
+**/
+std::string encodeKeyPart(const void* value, const Datatype type);
+
+/**
+ * Concatenate the encodings of the key attributes of a record, most significant first.
+ * @return the composite key of record
+**/
+std::string encodeCompositeKey(const char* record, const std::vector<KeyPart>& parts);
+
+/**
+ * @return the smallest key that is greater than every key starting with prefix, empty if there is none
+**/
+std::string prefixUpperBound(const std::string& prefix);
+
+/**
+ * @brief B+ Tree index over several attributes of a relation.
+ *
+ * Keys are the concatenated encodings from encodeCompositeKey(), so a range on the leading attributes is
+ * a range of keys: e.g. (Store = s, Date in [a, b]) is the scan from encodeKeyPart(s) + encodeKeyPart(a)
+ * to below prefixUpperBound(encodeKeyPart(s) + encodeKeyPart(b)). Nodes use the prefix truncated layouts
+ * of LeafNodeString and NonLeafNodeString.
+*/
+class CompositeIndex {
+
+ private:
+
+  /**
+   * File object for the index file.
+   */
+	File		*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * Page number of root page of B+ tree inside index file.
+   */
+	PageId	rootPageNum;
+
+  /**
+   * True if the root page is a leaf.
+   */
+	bool		rootIsLeaf;
+
+  /**
+   * Attributes of the key.
+   */
+	std::vector<KeyPart> keyParts;
+
+	// MEMBERS SPECIFIC TO SCANNING
+
+  /**
+   * True if an index scan has been started.
+   */
+	bool		scanExecuting;
+
+  /**
+   * Index of next entry to be scanned in current leaf being scanned.
+   */
+	int			nextEntry;
+
+  /**
+   * Page number of current page being scanned.
+   */
+	PageId	currentPageNum;
+
+  /**
+   * Current Page being scanned.
+   */
+	Page		*currentPageData;
+
+  /**
+   * Low key of the scan.
+   */
+	std::string lowKey;
+
+  /**
+   * High key of the scan.
+   */
+	std::string highKey;
+
+  /**
+   * Low Operator. Can only be GT(>) or GTE(>=).
+   */
+	Operator	lowOp;
+
+  /**
+   * High Operator. Can only be LT(<) or LTE(<=).
+   */
+	Operator	highOp;
+
+  /**
+	 * Insert entry into the subtree rooted at pageNo.
+	 * @param rightmost	True if pageNo is the last node of its level, where a split for an entry past the last
+	 *					key leaves the node full, so that loading keys in order fills every node
+	 * @param newSep	Set to the separator for the new sibling if pageNo was split
+	 * @param newPageNo	Set to the page number of the new sibling if pageNo was split
+	 * @return true if pageNo was split
+	**/
+	bool insertIntoNode(const PageId pageNo, const bool isLeaf, const bool rightmost,
+			const RIDKeyPair<std::string>& entry, std::string& newSep, PageId& newPageNo);
+
+  /**
+	 * Make a new root above the old one after the old root was split.
+	**/
+	void growRoot(const std::string& sep, const PageId newPageNo);
+
+  /**
+	 * Descend from the root to the leftmost leaf that may contain key.
+	 * @return page number of the leaf
+	**/
+	PageId findLeafPageNo(const std::string& key);
+
+  /**
+	 * @return true if key is beyond the high end of the current scan range
+	**/
+	bool pastHighKey(const std::string& key) const;
+
+  /**
+	 * Move the scan on to the right sibling of the current leaf, and further past empty leaves.
+	**/
+	void moveToRightSibling();
+
+ public:
+
+  /**
+	 * Open the composite index on the given attributes of relationName, or create and load it if there
+	 * is none yet. The index file is named after the relation and the attribute offsets.
+   * @param relationName	Name of file
+   * @param outIndexName	Return the name of index file
+   * @param bufMgrIn			Buffer Manager Instance
+   * @param parts					Attributes of the key, most significant first
+	 * @throws  BadIndexInfoException If the key has no or too many attributes, or if an existing index file
+	 * was built over other attributes
+	**/
+	CompositeIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn, const std::vector<KeyPart>& parts);
+
+  /**
+	 * Destructor. Ends any scan and flushes the index file.
+	**/
+	~CompositeIndex();
+
+  /**
+	 * @return the key of a record of the relation for this index
+	**/
+	std::string encodeKey(const char* record) const;
+
+  /**
+	 * Insert a new entry. Entries with equal keys are kept in insertion order.
+   * @param key			Key from encodeKey()
+   * @param rid			Record ID of a record whose entry is getting inserted into the index.
+	**/
+	const void insertEntry(const std::string& key, const RecordId rid);
+
+  /**
+	 * Delete the entry <key,rid>. Leaves are not merged, a leaf that empties out stays in the tree.
+	 * @throws  NoSuchKeyFoundException If the entry is not in the index.
+	**/
+	const void deleteEntry(const std::string& key, const RecordId rid);
+
+  /**
+	 * Begin a filtered scan of the index on encoded keys.
+	 * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+	 * @throws  BadScanrangeException If lowKey > highKey
+	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
+	**/
+	const void startScan(const std::string& lowKey, const Operator lowOp, const std::string& highKey,
+			const Operator highOp);
+
+  /**
+	 * Begin a scan of all entries whose key starts with prefix, e.g. the encodings of the leading attributes.
+	 * @throws  NoSuchKeyFoundException If no key starts with prefix.
+	**/
+	const void startPrefixScan(const std::string& prefix);
+
+  /**
+	 * Fetch the record id of the next index entry that matches the scan.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	**/
+	const void scanNext(RecordId& outRid);
+
+  /**
+	 * Terminate the current scan.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	const void endScan();
+};
+
+}
@@ -0,0 +1,22 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "no_such_column_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+NoSuchColumnException::NoSuchColumnException(const std::string& name)
+    : BadgerDbException(""), column_(name) {
+  std::stringstream ss;
+  ss << "No such column: " << column_;
+  message_.assign(ss.str());
+}
+
+}
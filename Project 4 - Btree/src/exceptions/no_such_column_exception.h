@@ -0,0 +1,41 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a column is looked up by a name
+ *        that is not in the schema.
+ */
+class NoSuchColumnException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a no such column exception for the given column name.
+   *
+   * @param name  Name of the column that doesn't exist.
+   */
+  explicit NoSuchColumnException(const std::string& name);
+
+  /**
+   * Returns the name of the column that caused this exception.
+   */
+  virtual const std::string& column() const { return column_; }
+
+ protected:
+  /**
+   * Name of the column that caused this exception.
+   */
+  const std::string column_;
+};
+
+}
@@ -0,0 +1,22 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "no_such_relation_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+NoSuchRelationException::NoSuchRelationException(const std::string& name)
+    : BadgerDbException(""), relation_(name) {
+  std::stringstream ss;
+  ss << "No such relation: " << relation_;
+  message_.assign(ss.str());
+}
+
+}
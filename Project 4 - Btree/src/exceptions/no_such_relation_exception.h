@@ -0,0 +1,41 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a query names a relation that is
+ *        not in the catalog of the query planner.
+ */
+class NoSuchRelationException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a no such relation exception for the given relation name.
+   *
+   * @param name  Name of the relation that doesn't exist.
+   */
+  explicit NoSuchRelationException(const std::string& name);
+
+  /**
+   * Returns the name of the relation that caused this exception.
+   */
+  virtual const std::string& relation() const { return relation_; }
+
+ protected:
+  /**
+   * Name of the relation that caused this exception.
+   */
+  const std::string relation_;
+};
+
+}
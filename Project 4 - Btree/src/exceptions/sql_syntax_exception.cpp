@@ -0,0 +1,22 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "sql_syntax_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+SqlSyntaxException::SqlSyntaxException(const std::string& problem, const size_t position)
+    : BadgerDbException(""), position_(position) {
+  std::stringstream ss;
+  ss << "SQL syntax error at position " << position_ << ": " << problem;
+  message_.assign(ss.str());
+}
+
+}
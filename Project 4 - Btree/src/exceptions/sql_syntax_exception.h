@@ -0,0 +1,41 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a SQL statement cannot be parsed.
+ */
+class SqlSyntaxException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a SQL syntax exception for the given problem.
+   *
+   * @param problem   What was expected or found.
+   * @param position  Offset of the offending token in the text of the statements.
+   */
+  SqlSyntaxException(const std::string& problem, const size_t position);
+
+  /**
+   * Returns the offset of the token that caused this exception.
+   */
+  virtual size_t position() const { return position_; }
+
+ protected:
+  /**
+   * Offset of the token that caused this exception.
+   */
+  const size_t position_;
+};
+
+}
@@ -0,0 +1,22 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "unsupported_aggregate_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+UnsupportedAggregateException::UnsupportedAggregateException(const std::string& name)
+    : BadgerDbException(""), aggregate_(name) {
+  std::stringstream ss;
+  ss << "Aggregate not supported by this operator: " << aggregate_;
+  message_.assign(ss.str());
+}
+
+}
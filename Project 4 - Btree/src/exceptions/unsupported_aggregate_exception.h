@@ -0,0 +1,41 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when an operator is given an aggregate
+ *        function it cannot compute.
+ */
+class UnsupportedAggregateException : public BadgerDbException {
+ public:
+  /**
+   * Constructs an unsupported aggregate exception for the given aggregate.
+   *
+   * @param name  Name of the result column of the aggregate.
+   */
+  explicit UnsupportedAggregateException(const std::string& name);
+
+  /**
+   * Returns the name of the aggregate that caused this exception.
+   */
+  virtual const std::string& aggregate() const { return aggregate_; }
+
+ protected:
+  /**
+   * Name of the aggregate that caused this exception.
+   */
+  const std::string aggregate_;
+};
+
+}
@@ -0,0 +1,22 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "unsupported_query_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+UnsupportedQueryException::UnsupportedQueryException(const std::string& feature)
+    : BadgerDbException(""), feature_(feature) {
+  std::stringstream ss;
+  ss << "Query not supported: " << feature_;
+  message_.assign(ss.str());
+}
+
+}
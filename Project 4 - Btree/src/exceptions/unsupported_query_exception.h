@@ -0,0 +1,41 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a SQL statement is valid but uses
+ *        something the query planner cannot compile into operators.
+ */
+class UnsupportedQueryException : public BadgerDbException {
+ public:
+  /**
+   * Constructs an unsupported query exception for the given feature.
+   *
+   * @param feature  What the statement uses that is not supported.
+   */
+  explicit UnsupportedQueryException(const std::string& feature);
+
+  /**
+   * Returns the feature that caused this exception.
+   */
+  virtual const std::string& feature() const { return feature_; }
+
+ protected:
+  /**
+   * Feature that caused this exception.
+   */
+  const std::string feature_;
+};
+
+}
@@ -0,0 +1,288 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "externalsort.h"
+
+namespace badgerdb
+{
+
+// -----------------------------------------------------------------------------
+// ExternalSortOperator::ExternalSortOperator -- Constructor
+// -----------------------------------------------------------------------------
+
+ExternalSortOperator::ExternalSortOperator(QueryOperator *child, const std::vector<SortKey>& keys, BufMgr *bufMgrIn, const int frames)
+{
+	this->child = child;
+	this->keys = keys;
+	this->bufMgr = bufMgrIn;
+	this->frames = std::max(frames, 3);
+	this->schema = child->getSchema();
+	for(size_t i = 0; i < keys.size(); i++) {
+		keyColumns.push_back(schema.find(keys[i].column));
+	}
+	this->inMemory = false;
+	this->nextTuple = 0;
+	this->returned = -1;
+	this->runCount = 0;
+}
+
+ExternalSortOperator::~ExternalSortOperator()
+{
+	close();
+	delete child;
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSortOperator::compareKeys
+// -----------------------------------------------------------------------------
+
+int ExternalSortOperator::compareKeys(const char* a, const char* b) const
+{
+	for(size_t i = 0; i < keyColumns.size(); i++) {
+		const Column& column = schema.columns[keyColumns[i]];
+		int result = compareValues(a, column, b, column);
+		if(result != 0) {
+			return keys[i].descending ? -result : result;
+		}
+	}
+	return 0;
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSortOperator::open
+// -----------------------------------------------------------------------------
+
+void ExternalSortOperator::open()
+{
+	close();
+	runCount = 0;
+	int tupleLength = schema.tupleLength;
+	size_t capacity = std::max((size_t)1, (size_t)frames * Page::SIZE / std::max(tupleLength, 1));
+	workspace.resize(capacity * tupleLength);
+
+	// the heap is ordered by run, then key, then arrival; std heaps keep the largest on top
+	auto after = [this, tupleLength](const HeapEntry& a, const HeapEntry& b) {
+		if(a.run != b.run) {
+			return a.run > b.run;
+		}
+		int result = compareKeys(&workspace[a.slot * tupleLength], &workspace[b.slot * tupleLength]);
+		return result != 0 ? result > 0 : a.seq > b.seq;
+	};
+
+	child->open();
+	TupleRef tuple;
+	bool more = true;
+	size_t seq = 0;
+	while(heap.size() < capacity && (more = child->next(tuple))) {
+		memcpy(&workspace[heap.size() * tupleLength], tuple.data, tupleLength);
+		HeapEntry entry = {0, seq++, heap.size()};
+		heap.push_back(entry);
+	}
+	if(!more) {
+		// everything fits: sort the workspace and return it from there
+		child->close();
+		std::sort(heap.begin(), heap.end(), [&after](const HeapEntry& a, const HeapEntry& b) { return after(b, a); });
+		inMemory = true;
+		nextTuple = 0;
+		return;
+	}
+
+	// replacement selection: a tuple read after the last one written joins the current run if it does not sort
+	// before it, and waits for the next run otherwise
+	std::make_heap(heap.begin(), heap.end(), after);
+	int current = -1;
+	SpillFile* run = NULL;
+	while(!heap.empty()) {
+		std::pop_heap(heap.begin(), heap.end(), after);
+		HeapEntry entry = heap.back();
+		heap.pop_back();
+		char* slot = &workspace[entry.slot * tupleLength];
+		if(entry.run != current) {
+			if(run != NULL) {
+				run->finishWrite();
+			}
+			run = new SpillFile(bufMgr, tupleLength);
+			runs.push_back(run);
+			current = entry.run;
+		}
+		run->append(slot);
+
+		if(more && (more = child->next(tuple))) {
+			entry.run = compareKeys(tuple.data, slot) < 0 ? current + 1 : current;
+			entry.seq = seq++;
+			memcpy(slot, tuple.data, tupleLength);
+			heap.push_back(entry);
+			std::push_heap(heap.begin(), heap.end(), after);
+		}
+	}
+	run->finishWrite();
+	child->close();
+	std::vector<char>().swap(workspace);
+	runCount = runs.size();
+
+	size_t fanIn = std::max(2, (frames - 1) / 2);
+	mergePasses(fanIn);
+	startMerge(runs.size());
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSortOperator::headBefore
+// -----------------------------------------------------------------------------
+
+bool ExternalSortOperator::headBefore(const int a, const int b) const
+{
+	if(heads[a] == NULL || heads[b] == NULL) {
+		return heads[b] == NULL && heads[a] != NULL;
+	}
+	int result = compareKeys(heads[a], heads[b]);
+	return result != 0 ? result < 0 : a < b;
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSortOperator::playTree
+// -----------------------------------------------------------------------------
+
+int ExternalSortOperator::playTree(const int node)
+{
+	// leaves are nodes heads.size() to 2 * heads.size() - 1
+	int count = heads.size();
+	if(node >= count) {
+		return node - count;
+	}
+	int left = playTree(2 * node);
+	int right = playTree(2 * node + 1);
+	if(headBefore(left, right)) {
+		losers[node] = right;
+		return left;
+	}
+	losers[node] = left;
+	return right;
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSortOperator::startMerge
+// -----------------------------------------------------------------------------
+
+void ExternalSortOperator::startMerge(const size_t count)
+{
+	heads.assign(count, NULL);
+	losers.assign(count, -1);
+	for(size_t i = 0; i < count; i++) {
+		runs[i]->startRead(true);
+		heads[i] = runs[i]->readNext();
+	}
+	if(count > 0) {
+		losers[0] = playTree(1);
+	}
+	returned = -1;
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSortOperator::advanceRun
+// -----------------------------------------------------------------------------
+
+void ExternalSortOperator::advanceRun(const int run)
+{
+	heads[run] = runs[run]->readNext();
+	int winner = run;
+	for(int node = (run + heads.size()) / 2; node > 0; node /= 2) {
+		if(headBefore(losers[node], winner)) {
+			std::swap(losers[node], winner);
+		}
+	}
+	losers[0] = winner;
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSortOperator::mergePasses
+// -----------------------------------------------------------------------------
+
+void ExternalSortOperator::mergePasses(const size_t fanIn)
+{
+	while(runs.size() > fanIn) {
+		std::vector<SpillFile*> merged;
+		std::vector<SpillFile*> waiting(runs);
+		runs.clear();
+		for(size_t first = 0; first < waiting.size(); first += fanIn) {
+			size_t count = std::min(fanIn, waiting.size() - first);
+			runs.assign(waiting.begin() + first, waiting.begin() + first + count);
+			SpillFile* out = new SpillFile(bufMgr, schema.tupleLength);
+			startMerge(count);
+			while(heads[losers[0]] != NULL) {
+				out->append(heads[losers[0]]);
+				advanceRun(losers[0]);
+			}
+			out->finishWrite();
+			clearRuns();
+			merged.push_back(out);
+		}
+		runs = merged;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSortOperator::next
+// -----------------------------------------------------------------------------
+
+bool ExternalSortOperator::next(TupleRef& outTuple)
+{
+	outTuple.rid.page_number = Page::INVALID_NUMBER;
+	outTuple.rid.slot_number = Page::INVALID_SLOT;
+	if(inMemory) {
+		if(nextTuple == heap.size()) {
+			return false;
+		}
+		outTuple.data = &workspace[heap[nextTuple++].slot * schema.tupleLength];
+		return true;
+	}
+
+	if(heads.empty()) {
+		return false;
+	}
+	if(returned >= 0) {
+		advanceRun(returned);
+	}
+	returned = losers[0];
+	if(heads[returned] == NULL) {
+		returned = -1;
+		return false;
+	}
+	outTuple.data = heads[returned];
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSortOperator::clearRuns
+// -----------------------------------------------------------------------------
+
+void ExternalSortOperator::clearRuns()
+{
+	for(size_t i = 0; i < runs.size(); i++) {
+		delete runs[i];
+	}
+	runs.clear();
+	heads.clear();
+	losers.clear();
+	returned = -1;
+}
+
+// -----------------------------------------------------------------------------
+// ExternalSortOperator::close
+// -----------------------------------------------------------------------------
+
+void ExternalSortOperator::close()
+{
+	clearRuns();
+	std::vector<char>().swap(workspace);
+	heap.clear();
+	inMemory = false;
+	nextTuple = 0;
+}
+
+}
@@ -0,0 +1,131 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "operators.h"
+#include "spillfile.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief ORDER BY for inputs larger than memory, with the results of SortOperator.
+ *
+ * The operator is given a number of frames. Runs are generated by replacement selection in a workspace of
+ * frames * Page::SIZE bytes, which yields runs about twice the workspace on random input and a single run on
+ * sorted input, and written to SpillFiles. The workspace is allocated on the heap, not pinned in the buffer
+ * pool, so the pool does not account for it. The runs are then merged with a loser tree, at most (frames - 1) / 2 at a
+ * time as each run being merged reads one page ahead, in as many passes as needed; the last merge streams into
+ * next(). An input that fits in the workspace is sorted in memory without spilling. Equal tuples keep the order
+ * of the child.
+*/
+class ExternalSortOperator : public QueryOperator {
+
+ private:
+
+  /**
+   * A tuple of the workspace and the run it goes to. seq orders equal tuples as the child returned them.
+   */
+	struct HeapEntry{
+		int run;
+		size_t seq;
+		size_t slot;
+	};
+
+	QueryOperator	*child;
+	std::vector<SortKey>	keys;
+	BufMgr	*bufMgr;
+	int			frames;
+
+  /**
+   * Positions of the key columns in the schema.
+   */
+	std::vector<int>	keyColumns;
+
+  /**
+   * Tuples read from the child, and the order to return them in when they all fit. Heap memory of frames pages,
+   * outside the buffer pool.
+   */
+	std::vector<char>	workspace;
+	std::vector<HeapEntry>	heap;
+	bool		inMemory;
+	size_t	nextTuple;
+
+  /**
+   * Runs left to merge, in the order of the child.
+   */
+	std::vector<SpillFile*>	runs;
+
+  /**
+   * Current tuple of each run being merged, NULL once it is exhausted, and the loser tree over them:
+   * losers[0] is the run with the smallest tuple and losers[n] the run that lost the match at node n.
+   */
+	std::vector<const char*>	heads;
+	std::vector<int>	losers;
+
+  /**
+   * Run whose tuple next() returned last, advanced on the next call, -1 if none.
+   */
+	int			returned;
+
+	int			runCount;
+
+  /**
+	 * @return negative, zero or positive as tuple a sorts before, with or after tuple b
+	**/
+	int compareKeys(const char* a, const char* b) const;
+
+  /**
+	 * @return true if the current tuple of run a comes before that of run b, exhausted runs coming last
+	**/
+	bool headBefore(const int a, const int b) const;
+
+  /**
+	 * @return the run winning the subtree at node of the loser tree, recording the losers below it
+	**/
+	int playTree(const int node);
+
+  /**
+	 * Start merging the first count runs.
+	**/
+	void startMerge(const size_t count);
+
+  /**
+	 * Move run to its next tuple and replay its matches up to the root.
+	**/
+	void advanceRun(const int run);
+
+  /**
+	 * Merge the runs in groups of fanIn until at most fanIn are left.
+	**/
+	void mergePasses(const size_t fanIn);
+
+	void clearRuns();
+
+ public:
+
+  /**
+   * @param frames			Pages of memory the sort may use for its workspace and for the runs it merges, 3 at least
+	**/
+	ExternalSortOperator(QueryOperator *child, const std::vector<SortKey>& keys, BufMgr *bufMgrIn, const int frames);
+	~ExternalSortOperator();
+	void open();
+	bool next(TupleRef& outTuple);
+	void close();
+
+  /**
+	 * @return number of runs written since the sort was opened, 0 if the input was sorted in memory
+	**/
+	int getRunCount() const { return runCount; }
+};
+
+}
@@ -64,6 +64,11 @@ PageId File::getFirstPageNo() {
   return header.first_used_page;
 }
 
+PageId File::getNumPages() {
+  const FileHeader& header = readHeader();
+  return header.num_pages;
+}
+
 File::File(const std::string& name, const bool create_new) : filename_(name) {
   openIfNeeded(create_new);
 
@@ -164,6 +164,13 @@ class File {
    */
 	PageId getFirstPageNo();
 
+ 	/**
+   * Returns the number of pages allocated in the file, counting the header.
+   *
+   * @return  One more than the largest page number in the file.
+   */
+	PageId getNumPages();
+
  protected:
   /**
    * Returns the position of the page with the given number in the file (as an
@@ -17,12 +17,19 @@ FileScan::FileScan(const std::string &name, BufMgr *bufferMgr)
 	curDirtyFlag = false;
   curPage = NULL;
 	filePageIter = file->begin();
+	restricted = false;
+	nextRid = 0;
 }
 
 FileScan::~FileScan()
 {
   // generally must unpin last page of the scan
-  if (curPage != NULL)
+  if (restricted && curPage != NULL)
+  {
+    bufMgr->unPinPage(file, curPageNo, curDirtyFlag);
+    curPage = NULL;
+  }
+  else if (curPage != NULL)
   {
     bufMgr->unPinPage(file, (*filePageIter).page_number(), curDirtyFlag);
     curPage = NULL;
@@ -35,7 +42,29 @@ FileScan::~FileScan()
 
 void FileScan::scanNext(RecordId& outRid)
 {
-  std::string rec;
+  if (restricted)
+  {
+    if (nextRid == restrictRids.size())
+    {
+      throw EndOfFileException();
+    }
+    curRid = restrictRids[nextRid++];
+
+    // only read a page when the scan moves on to it
+    if (curPage == NULL || curRid.page_number != curPageNo)
+    {
+      if (curPage != NULL)
+      {
+        bufMgr->unPinPage(file, curPageNo, curDirtyFlag);
+        curPage = NULL;
+        curDirtyFlag = false;
+      }
+      curPageNo = curRid.page_number;
+      bufMgr->readPage(file, curPageNo, curPage);
+    }
+    outRid = curRid;
+    return;
+  }
 
   if (filePageIter == file->end())
 	{
@@ -61,9 +90,6 @@ void FileScan::scanNext(RecordId& outRid)
 
 		if(pageRecordIter != curPage->end()) 
 		{
-		  // get pointer to record
-		  rec = *pageRecordIter;
-
 			outRid = pageRecordIter.getCurrentRecord();
 			return;
 		}
@@ -95,9 +121,6 @@ void FileScan::scanNext(RecordId& outRid)
   }
 
   // curRec points at a valid record
-  // see if the record satisfies the scan's predicate 
-  // get a pointer to the record
-  rec = *pageRecordIter;
 
 	// return rid of the record
 	outRid = pageRecordIter.getCurrentRecord();
@@ -108,13 +131,42 @@ void FileScan::scanNext(RecordId& outRid)
 // and the scan logic is required to unpin the page 
 std::string FileScan::getRecord()
 {
+  if (restricted)
+  {
+    return curPage->getRecord(curRid);
+  }
   return *pageRecordIter;
 }
 
+// returns the current record without copying it out of the pinned page
+const char* FileScan::getRecordData(std::size_t& length)
+{
+  if (restricted)
+  {
+    return curPage->getRecordData(curRid, &length);
+  }
+  return curPage->getRecordData(pageRecordIter.getCurrentRecord(), &length);
+}
+
 // mark current page of scan dirty
 void FileScan::markDirty()
 {
   curDirtyFlag = true;
 }
 
+// restrict the scan to rids, e.g. those of a bitmap index, so that pages
+// without a qualifying record are not read
+void FileScan::restrictTo(const std::vector<RecordId>& rids)
+{
+  if (curPage != NULL)
+  {
+    bufMgr->unPinPage(file, restricted ? curPageNo : (*filePageIter).page_number(), curDirtyFlag);
+    curPage = NULL;
+    curDirtyFlag = false;
+  }
+  restricted = true;
+  restrictRids = rids;
+  nextRid = 0;
+}
+
 }
@@ -9,6 +9,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "types.h"
 #include "page.h"
 #include "buffer.h"
@@ -34,9 +35,15 @@ class FileScan
   //read current record, returning pointer and length
   std::string getRecord();
 
+  //pointer to the current record in its pinned page, valid until the scan moves to another page
+  const char* getRecordData(std::size_t& length);
+
   //marks current page of scan dirty
   void markDirty();
 
+  //restrict the scan to rids, which must be in page order; each page is read once
+  void restrictTo(const std::vector<RecordId>& rids);
+
  private:
   /**
    * File which is being scanned.
@@ -60,6 +67,27 @@ class FileScan
    * True if page has been updated
    */
   bool  	      curDirtyFlag;
+
+  /**
+   * True if the scan returns only the records of restrictRids.
+   */
+  bool          restricted;
+
+  /**
+   * Records of a restricted scan, in page order.
+   */
+  std::vector<RecordId> restrictRids;
+
+  /**
+   * Position of the next record in restrictRids.
+   */
+  size_t        nextRid;
+
+  /**
+   * Current record and page number of a restricted scan.
+   */
+  RecordId      curRid;
+  PageId        curPageNo;
 };
 
 }
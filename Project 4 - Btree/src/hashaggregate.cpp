@@ -0,0 +1,412 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "hashaggregate.h"
+#include "exceptions/unsupported_aggregate_exception.h"
+
+namespace badgerdb
+{
+
+const std::uint32_t AggregateHashTable::NOGROUP;
+
+// -----------------------------------------------------------------------------
+// AggregateHashTable::AggregateHashTable -- Constructor
+// -----------------------------------------------------------------------------
+
+AggregateHashTable::AggregateHashTable()
+{
+	keyLength = 0;
+	stateOffset = 0;
+	rowLength = 0;
+	mask = 0;
+}
+
+// -----------------------------------------------------------------------------
+// AggregateHashTable::init
+// -----------------------------------------------------------------------------
+
+void AggregateHashTable::init(const int keyLength, const std::vector<AggregateFunction>& functions)
+{
+	this->keyLength = keyLength;
+	this->functions = functions;
+
+	// the states are doubles, so they start on a multiple of 8
+	stateOffset = (keyLength + 7) & ~7;
+	rowLength = stateOffset + 2 * sizeof(double) * functions.size();
+	clear();
+}
+
+// -----------------------------------------------------------------------------
+// AggregateHashTable::clear
+// -----------------------------------------------------------------------------
+
+void AggregateHashTable::clear()
+{
+	std::vector<char>().swap(rows);
+	std::vector<std::uint64_t>().swap(hashes);
+	slots.assign(16, NOGROUP);
+	mask = slots.size() - 1;
+}
+
+// -----------------------------------------------------------------------------
+// AggregateHashTable::hashKey
+// -----------------------------------------------------------------------------
+
+std::uint64_t AggregateHashTable::hashKey(const char* key, const int length)
+{
+	std::uint64_t hash = 14695981039346656037ULL;
+	for(int i = 0; i < length; i++) {
+		hash = (hash ^ (unsigned char)key[i]) * 1099511628211ULL;
+	}
+
+	// murmur3 finalizer, so that both the low bits and the high bits depend on the whole key
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+// -----------------------------------------------------------------------------
+// AggregateHashTable::grow
+// -----------------------------------------------------------------------------
+
+void AggregateHashTable::grow()
+{
+	slots.assign(2 * slots.size(), NOGROUP);
+	mask = slots.size() - 1;
+	for(size_t i = 0; i < hashes.size(); i++) {
+		std::uint64_t slot = hashes[i] & mask;
+		while(slots[slot] != NOGROUP) {
+			slot = (slot + 1) & mask;
+		}
+		slots[slot] = i;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// AggregateHashTable::find
+// -----------------------------------------------------------------------------
+
+char* AggregateHashTable::find(const char* key, const std::uint64_t hash, const bool insert)
+{
+	std::uint64_t slot = hash & mask;
+	while(slots[slot] != NOGROUP) {
+		std::uint32_t groupNo = slots[slot];
+		if(hashes[groupNo] == hash && memcmp(&rows[(size_t)groupNo * rowLength], key, keyLength) == 0) {
+			return &rows[(size_t)groupNo * rowLength];
+		}
+		slot = (slot + 1) & mask;
+	}
+	if(!insert) {
+		return NULL;
+	}
+
+	size_t groupNo = hashes.size();
+	slots[slot] = groupNo;
+	hashes.push_back(hash);
+	rows.resize(rows.size() + rowLength, 0);
+	char* row = &rows[groupNo * rowLength];
+	memcpy(row, key, keyLength);
+	if(2 * hashes.size() > slots.size()) {
+		grow();
+	}
+	return row;
+}
+
+// -----------------------------------------------------------------------------
+// AggregateHashTable::update
+// -----------------------------------------------------------------------------
+
+void AggregateHashTable::update(char* row, const int aggregate, const double value) const
+{
+	// each aggregate keeps a value and the number of values it has seen
+	double* state = (double*)(row + stateOffset) + 2 * aggregate;
+	if(functions[aggregate] == AGGSUM || functions[aggregate] == AGGAVG) {
+		state[0] += value;
+	} else if(functions[aggregate] == AGGMIN) {
+		state[0] = state[1] == 0 ? value : std::min(state[0], value);
+	} else if(functions[aggregate] == AGGMAX) {
+		state[0] = state[1] == 0 ? value : std::max(state[0], value);
+	}
+	state[1]++;
+}
+
+// -----------------------------------------------------------------------------
+// AggregateHashTable::combine
+// -----------------------------------------------------------------------------
+
+void AggregateHashTable::combine(char* row, const char* other) const
+{
+	double* state = (double*)(row + stateOffset);
+	for(size_t i = 0; i < functions.size(); i++, state += 2) {
+		// other may come straight from a spill page, which does not align doubles
+		double otherState[2];
+		memcpy(otherState, other + stateOffset + 2 * sizeof(double) * i, sizeof(otherState));
+		if(otherState[1] == 0) {
+			continue;
+		}
+		if(functions[i] == AGGSUM || functions[i] == AGGAVG) {
+			state[0] += otherState[0];
+		} else if(functions[i] == AGGMIN) {
+			state[0] = state[1] == 0 ? otherState[0] : std::min(state[0], otherState[0]);
+		} else if(functions[i] == AGGMAX) {
+			state[0] = state[1] == 0 ? otherState[0] : std::max(state[0], otherState[0]);
+		}
+		state[1] += otherState[1];
+	}
+}
+
+// -----------------------------------------------------------------------------
+// AggregateHashTable::mergeFrom
+// -----------------------------------------------------------------------------
+
+void AggregateHashTable::mergeFrom(const AggregateHashTable& other)
+{
+	for(size_t i = 0; i < other.getGroupCount(); i++) {
+		combine(find(other.getRow(i), other.getHash(i), true), other.getRow(i));
+	}
+}
+
+// -----------------------------------------------------------------------------
+// AggregateHashTable::finish
+// -----------------------------------------------------------------------------
+
+void AggregateHashTable::finish(const char* row, const int aggregate, char* out) const
+{
+	const double* state = (const double*)(row + stateOffset) + 2 * aggregate;
+	if(functions[aggregate] == AGGCOUNT) {
+		int count = state[1];
+		memcpy(out, &count, sizeof(int));
+	} else {
+		double value = state[0];
+		if(functions[aggregate] == AGGAVG) {
+			value = state[1] == 0 ? 0 : value / state[1];
+		}
+		memcpy(out, &value, sizeof(double));
+	}
+}
+
+// -----------------------------------------------------------------------------
+// AggregateHashTable::footprint
+// -----------------------------------------------------------------------------
+
+size_t AggregateHashTable::footprint() const
+{
+	return rows.size() + hashes.size() * sizeof(std::uint64_t) + slots.size() * sizeof(std::uint32_t);
+}
+
+// -----------------------------------------------------------------------------
+// HashAggregateOperator::HashAggregateOperator -- Constructor
+// -----------------------------------------------------------------------------
+
+HashAggregateOperator::HashAggregateOperator(QueryOperator *child, const std::vector<std::string>& groupColumnNames,
+		const std::vector<AggregateSpec>& aggregates, BufMgr *bufMgrIn, const size_t memoryBudget)
+{
+	this->child = child;
+	this->aggregates = aggregates;
+	this->bufMgr = bufMgrIn;
+	this->memoryBudget = memoryBudget;
+	const Schema& childSchema = child->getSchema();
+	for(size_t i = 0; i < groupColumnNames.size(); i++) {
+		int column = childSchema.find(groupColumnNames[i]);
+		groupColumns.push_back(column);
+		schema.addColumn(childSchema.columns[column].name, childSchema.columns[column].type, childSchema.columns[column].length);
+	}
+	keyLength = schema.tupleLength;
+	std::vector<AggregateFunction> functions;
+	for(size_t i = 0; i < aggregates.size(); i++) {
+		// distinct counts do not fit in fixed width states
+		if(aggregates[i].function == AGGCOUNTDISTINCT || aggregates[i].function == AGGAPPROXCOUNTDISTINCT) {
+			delete child;
+			throw UnsupportedAggregateException(aggregates[i].name);
+		}
+		aggregateColumns.push_back(aggregates[i].column.empty() ? -1 : childSchema.find(aggregates[i].column));
+		schema.addColumn(aggregates[i].name, aggregates[i].function == AGGCOUNT ? INTEGER : DOUBLE);
+		functions.push_back(aggregates[i].function);
+	}
+	table.init(keyLength, functions);
+	this->nextGroup = 0;
+	this->spillCount = 0;
+}
+
+HashAggregateOperator::~HashAggregateOperator()
+{
+	close();
+	delete child;
+}
+
+// -----------------------------------------------------------------------------
+// HashAggregateOperator::partitionOf
+// -----------------------------------------------------------------------------
+
+int HashAggregateOperator::partitionOf(const std::uint64_t hash, const int depth)
+{
+	return (hash >> (60 - 4 * depth)) % HASHAGGPARTITIONS;
+}
+
+// -----------------------------------------------------------------------------
+// HashAggregateOperator::addPartitions
+// -----------------------------------------------------------------------------
+
+void HashAggregateOperator::addPartitions(std::vector<SpillFile*>& partitions)
+{
+	for(int p = 0; p < HASHAGGPARTITIONS; p++) {
+		partitions.push_back(new SpillFile(bufMgr, table.getRowLength()));
+	}
+	spillCount += HASHAGGPARTITIONS;
+}
+
+// -----------------------------------------------------------------------------
+// HashAggregateOperator::queuePartitions
+// -----------------------------------------------------------------------------
+
+void HashAggregateOperator::queuePartitions(std::vector<SpillFile*>& partitions, const int depth)
+{
+	for(size_t p = 0; p < partitions.size(); p++) {
+		partitions[p]->finishWrite();
+		Partition partition = {partitions[p], depth};
+		pending.push_back(partition);
+	}
+	partitions.clear();
+}
+
+// -----------------------------------------------------------------------------
+// HashAggregateOperator::open
+// -----------------------------------------------------------------------------
+
+void HashAggregateOperator::open()
+{
+	close();
+	spillCount = 0;
+	buffer.assign(schema.tupleLength, 0);
+	std::vector<char> key(keyLength, 0);
+	std::vector<char> row(table.getRowLength(), 0);
+	if(groupColumns.empty()) {
+		table.find(&key[0], AggregateHashTable::hashKey(&key[0], keyLength), true);
+	}
+
+	// no partitions until the table is full, then the groups not in it go to them
+	const Schema& childSchema = child->getSchema();
+	std::vector<SpillFile*> partitions;
+	child->open();
+	TupleRef tuple;
+	while(child->next(tuple)) {
+		for(size_t i = 0; i < groupColumns.size(); i++) {
+			const Column& column = childSchema.columns[groupColumns[i]];
+			memcpy(&key[schema.columns[i].offset], tuple.data + column.offset, column.length);
+		}
+		std::uint64_t hash = AggregateHashTable::hashKey(&key[0], keyLength);
+		char* state = table.find(&key[0], hash, partitions.empty());
+		if(state == NULL) {
+			std::fill(row.begin(), row.end(), 0);
+			memcpy(&row[0], &key[0], keyLength);
+			state = &row[0];
+		}
+		for(size_t i = 0; i < aggregates.size(); i++) {
+			table.update(state, i, aggregateColumns[i] < 0 ? 0 : childSchema.getNumber(tuple.data, aggregateColumns[i]));
+		}
+		if(state == &row[0]) {
+			partitions[partitionOf(hash, 0)]->append(state);
+		} else if(partitions.empty() && table.footprint() > memoryBudget) {
+			addPartitions(partitions);
+		}
+	}
+	child->close();
+	queuePartitions(partitions, 0);
+	nextGroup = 0;
+}
+
+// -----------------------------------------------------------------------------
+// HashAggregateOperator::loadPartition
+// -----------------------------------------------------------------------------
+
+bool HashAggregateOperator::loadPartition()
+{
+	while(!pending.empty()) {
+		Partition partition = pending.back();
+		pending.pop_back();
+		if(partition.file->getTupleCount() == 0) {
+			delete partition.file;
+			continue;
+		}
+
+		// the states are combined like the tuples of the child were aggregated, partitions of the
+		// last depth taking every group
+		table.clear();
+		std::vector<SpillFile*> partitions;
+		const char* row;
+		partition.file->startRead();
+		while((row = partition.file->readNext()) != NULL) {
+			std::uint64_t hash = AggregateHashTable::hashKey(row, keyLength);
+			char* state = table.find(row, hash, partitions.empty());
+			if(state == NULL) {
+				partitions[partitionOf(hash, partition.depth + 1)]->append(row);
+				continue;
+			}
+			table.combine(state, row);
+			if(partitions.empty() && table.footprint() > memoryBudget && partition.depth + 1 < HASHAGGMAXDEPTH) {
+				addPartitions(partitions);
+			}
+		}
+		delete partition.file;
+		queuePartitions(partitions, partition.depth + 1);
+		nextGroup = 0;
+		return true;
+	}
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// HashAggregateOperator::next
+// -----------------------------------------------------------------------------
+
+bool HashAggregateOperator::next(TupleRef& outTuple)
+{
+	while(nextGroup == table.getGroupCount()) {
+		if(!loadPartition()) {
+			return false;
+		}
+	}
+	const char* row = table.getRow(nextGroup++);
+	memcpy(&buffer[0], row, keyLength);
+	for(size_t i = 0; i < aggregates.size(); i++) {
+		table.finish(row, i, &buffer[schema.columns[groupColumns.size() + i].offset]);
+	}
+	outTuple.data = &buffer[0];
+	outTuple.rid.page_number = Page::INVALID_NUMBER;
+	outTuple.rid.slot_number = Page::INVALID_SLOT;
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// HashAggregateOperator::clearPending
+// -----------------------------------------------------------------------------
+
+void HashAggregateOperator::clearPending()
+{
+	for(size_t i = 0; i < pending.size(); i++) {
+		delete pending[i].file;
+	}
+	pending.clear();
+}
+
+// -----------------------------------------------------------------------------
+// HashAggregateOperator::close
+// -----------------------------------------------------------------------------
+
+void HashAggregateOperator::close()
+{
+	clearPending();
+	table.clear();
+	nextGroup = 0;
+}
+
+}
@@ -0,0 +1,235 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "buffer.h"
+#include "operators.h"
+#include "spillfile.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of partitions the groups are split into when they do not fit in memory.
+ */
+const  int HASHAGGPARTITIONS = 16;
+
+/**
+ * @brief Most times a partition is split again. Partitions at this depth are aggregated in memory whatever
+ * their size.
+ */
+const  int HASHAGGMAXDEPTH = 4;
+
+/**
+ * @brief Open addressing hash table of groups. Each group is a fixed width row: the group key, then a value and
+ * a count for each aggregate, both doubles. Rows are stored one after another and the slots, probed linearly,
+ * only hold row numbers, so a lookup touches one slot and one row in the common case.
+ *
+ * Rows are partial states: two rows of the same group combine into one, which lets several tables aggregate
+ * parts of an input on their own and be merged at the end with mergeFrom().
+*/
+class AggregateHashTable {
+
+ private:
+
+  /**
+   * Bytes of the group key, offset of the first state in a row and bytes of a row.
+   */
+	int			keyLength;
+	int			stateOffset;
+	int			rowLength;
+	std::vector<AggregateFunction>	functions;
+
+  /**
+   * Rows of the groups one after another, and the hash of each group key.
+   */
+	std::vector<char>	rows;
+	std::vector<std::uint64_t>	hashes;
+
+  /**
+   * Row number of each slot, NOGROUP if it is free. The number of slots is a power of two at least twice the
+   * number of groups.
+   */
+	std::vector<std::uint32_t>	slots;
+	std::uint64_t	mask;
+
+  /**
+	 * Double the number of slots and put the groups back into them.
+	**/
+	void grow();
+
+ public:
+
+  /**
+   * A free slot.
+   */
+	static const std::uint32_t NOGROUP = 0xFFFFFFFF;
+
+	AggregateHashTable();
+
+  /**
+	 * Empty the table, for group keys of keyLength bytes and the aggregate functions.
+	**/
+	void init(const int keyLength, const std::vector<AggregateFunction>& functions);
+
+  /**
+	 * Remove every group, keeping the layout of the rows.
+	**/
+	void clear();
+
+  /**
+	 * @return hash of a group key of length bytes
+	**/
+	static std::uint64_t hashKey(const char* key, const int length);
+
+  /**
+	 * Find the row of group key, whose hash is hash, adding it with empty states if it is not there and insert is set.
+	 * The row stays valid until the next group is added.
+	 * @return the row, NULL if the group is not there and insert is not set
+	**/
+	char* find(const char* key, const std::uint64_t hash, const bool insert);
+
+  /**
+	 * Add value to aggregate number aggregate of row.
+	**/
+	void update(char* row, const int aggregate, const double value) const;
+
+  /**
+	 * Add the states of other, a row of the same group, to row.
+	**/
+	void combine(char* row, const char* other) const;
+
+  /**
+	 * Combine every group of other, a table with the same layout, into this one.
+	**/
+	void mergeFrom(const AggregateHashTable& other);
+
+  /**
+	 * Write the result of aggregate number aggregate of row to out, an int for AGGCOUNT and a double otherwise.
+	**/
+	void finish(const char* row, const int aggregate, char* out) const;
+
+	size_t getGroupCount() const { return hashes.size(); }
+	char* getRow(const size_t groupNo) { return &rows[groupNo * rowLength]; }
+	const char* getRow(const size_t groupNo) const { return &rows[groupNo * rowLength]; }
+	std::uint64_t getHash(const size_t groupNo) const { return hashes[groupNo]; }
+	int getRowLength() const { return rowLength; }
+
+  /**
+	 * @return bytes the table takes
+	**/
+	size_t footprint() const;
+};
+
+/**
+ * @brief GROUP BY with the results of AggregateOperator, over a hash table of fixed width states.
+ *
+ * While the groups fit in memoryBudget bytes the child is aggregated in an AggregateHashTable. Once the budget
+ * is reached the table stops taking new groups: tuples of groups already in it are still aggregated there, the
+ * others are written as single tuple states to HASHAGGPARTITIONS SpillFiles by the hash of their group. The
+ * groups in memory are returned first, then each partition is aggregated the same way, combining its states
+ * and being split again by other hash bits when its groups do not fit either.
+*/
+class HashAggregateOperator : public QueryOperator {
+
+ private:
+
+  /**
+   * A partition of states waiting to be aggregated.
+   */
+	struct Partition{
+		SpillFile* file;
+		int depth;
+	};
+
+	QueryOperator	*child;
+	BufMgr	*bufMgr;
+	size_t	memoryBudget;
+
+  /**
+   * Positions of the group columns in the schema of the child.
+   */
+	std::vector<int>	groupColumns;
+
+	std::vector<AggregateSpec>	aggregates;
+
+  /**
+   * Positions of the aggregated columns in the schema of the child, -1 for COUNT(*).
+   */
+	std::vector<int>	aggregateColumns;
+
+  /**
+   * Bytes of the group columns at the start of a result tuple.
+   */
+	int			keyLength;
+
+	AggregateHashTable	table;
+
+  /**
+   * Partitions left to aggregate.
+   */
+	std::vector<Partition>	pending;
+
+  /**
+   * Next group of the table to return.
+   */
+	size_t	nextGroup;
+
+	int			spillCount;
+
+  /**
+   * The tuple last returned.
+   */
+	std::vector<char>	buffer;
+
+  /**
+	 * @return partition of hash at depth, taken from the high bits so that the table uses other bits
+	**/
+	static int partitionOf(const std::uint64_t hash, const int depth);
+
+  /**
+	 * Add HASHAGGPARTITIONS new partitions to partitions.
+	**/
+	void addPartitions(std::vector<SpillFile*>& partitions);
+
+  /**
+	 * Queue the partitions of depth, ending their writing.
+	**/
+	void queuePartitions(std::vector<SpillFile*>& partitions, const int depth);
+
+  /**
+	 * Aggregate the states of the next pending partition that has any into the table.
+	 * @return false if there is none
+	**/
+	bool loadPartition();
+
+	void clearPending();
+
+ public:
+
+  /**
+   * @param memoryBudget		Bytes the hash table may take before the aggregation spills
+	**/
+	HashAggregateOperator(QueryOperator *child, const std::vector<std::string>& groupColumnNames,
+						const std::vector<AggregateSpec>& aggregates, BufMgr *bufMgrIn, const size_t memoryBudget);
+	~HashAggregateOperator();
+	void open();
+	bool next(TupleRef& outTuple);
+	void close();
+
+  /**
+	 * @return number of partitions written since the operator was opened, 0 if the groups fit in memory
+	**/
+	int getSpillCount() const { return spillCount; }
+};
+
+}
@@ -0,0 +1,510 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <vector>
+#include <cstring>
+#include <sstream>
+#include "hashindex.h"
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/end_of_file_exception.h"
+
+namespace badgerdb
+{
+
+// -----------------------------------------------------------------------------
+// HashIndex::HashIndex -- Constructor
+// -----------------------------------------------------------------------------
+
+HashIndex::HashIndex(const std::string & relationName,
+		std::string & outIndexName,
+		BufMgr *bufMgrIn,
+		const int attrByteOffset,
+		const Datatype attrType)
+{
+	if(attrType != INTEGER) {
+		throw BadIndexInfoException("Hash indexes take INTEGER attributes only");
+	}
+
+	std::ostringstream idxStr;
+	idxStr << relationName << '.' << attrByteOffset << ".hash";
+	std::string indexName = idxStr.str();
+
+	outIndexName = indexName;
+	this->bufMgr = bufMgrIn;
+	this->attrByteOffset = attrByteOffset;
+
+	if(File::exists(indexName)) {
+		this->file = new BlobFile(indexName, false);
+		this->headerPageNum = file->getFirstPageNo();
+		Page* metaPage;
+		bufMgr->readPage(file, headerPageNum, metaPage);
+		HashIndexMetaInfo* meta = (HashIndexMetaInfo*)metaPage;
+		if(meta->attrByteOffset != attrByteOffset || meta->attrType != attrType) {
+			bufMgr->unPinPage(file, headerPageNum, false);
+			delete file;
+			throw BadIndexInfoException("Index meta page does not match the requested attribute");
+		}
+		globalDepth = meta->globalDepth;
+		dirPageNos.assign(meta->dirPageNoArray, meta->dirPageNoArray + meta->dirPageCount);
+		freeListPageNum = meta->firstFreePageNo;
+		bufMgr->unPinPage(file, headerPageNum, false);
+		return;
+	}
+
+	// else, start with a directory of one entry pointing to an empty bucket
+	this->file = new BlobFile(indexName, true);
+	Page* metaPage;
+	bufMgr->allocPage(file, headerPageNum, metaPage);
+	HashIndexMetaInfo* meta = (HashIndexMetaInfo*)metaPage;
+	strcpy(meta->relationName, relationName.c_str());
+	meta->attrByteOffset = attrByteOffset;
+	meta->attrType = attrType;
+	bufMgr->unPinPage(file, headerPageNum, true);
+
+	globalDepth = 0;
+	freeListPageNum = 0;
+	PageId dirPageNo, bucketPageNo;
+	Page* page;
+	bufMgr->allocPage(file, bucketPageNo, page);
+	HashBucketInt* bucket = (HashBucketInt*)page;
+	bucket->localDepth = 0;
+	bucket->count = 0;
+	bucket->overflowPageNo = 0;
+	bufMgr->unPinPage(file, bucketPageNo, true);
+	bufMgr->allocPage(file, dirPageNo, page);
+	((PageId*)page)[0] = bucketPageNo;
+	bufMgr->unPinPage(file, dirPageNo, true);
+	dirPageNos.push_back(dirPageNo);
+	writeMeta();
+
+	FileScan* scan = new FileScan(relationName, bufMgr);
+	try {
+		while(true) {
+			RecordId rid;
+			scan->scanNext(rid);
+			std::string recordString = scan->getRecord();
+			insertEntry(recordString.c_str() + attrByteOffset, rid);
+		}
+	}
+	catch(const EndOfFileException& e) {}
+	delete scan;
+	bufMgr->flushFile(file);
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::~HashIndex -- destructor
+// -----------------------------------------------------------------------------
+
+HashIndex::~HashIndex()
+{
+	bufMgr->flushFile(file);
+	delete file;
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::hashKey
+// -----------------------------------------------------------------------------
+
+unsigned int HashIndex::hashKey(const int key)
+{
+	// mix every bit of the key into the low bits the directory uses
+	unsigned int h = (unsigned int)key;
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+	return h;
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::getGlobalDepth
+// -----------------------------------------------------------------------------
+
+int HashIndex::getGlobalDepth() const
+{
+	return globalDepth;
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::getBucketPageNo
+// -----------------------------------------------------------------------------
+
+PageId HashIndex::getBucketPageNo(const unsigned int dirIndex)
+{
+	PageId dirPageNo = dirPageNos[dirIndex / HASHDIRPAGESIZE];
+	Page* page;
+	bufMgr->readPage(file, dirPageNo, page);
+	PageId pageNo = ((PageId*)page)[dirIndex % HASHDIRPAGESIZE];
+	bufMgr->unPinPage(file, dirPageNo, false);
+	return pageNo;
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::setBucketPageNo
+// -----------------------------------------------------------------------------
+
+void HashIndex::setBucketPageNo(const unsigned int dirIndex, const PageId pageNo)
+{
+	PageId dirPageNo = dirPageNos[dirIndex / HASHDIRPAGESIZE];
+	Page* page;
+	bufMgr->readPage(file, dirPageNo, page);
+	((PageId*)page)[dirIndex % HASHDIRPAGESIZE] = pageNo;
+	bufMgr->unPinPage(file, dirPageNo, true);
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::doubleDirectory
+// -----------------------------------------------------------------------------
+
+void HashIndex::doubleDirectory()
+{
+	unsigned int size = 1u << globalDepth;
+	Page* page;
+	if(2 * size <= (unsigned int)HASHDIRPAGESIZE) {
+		bufMgr->readPage(file, dirPageNos[0], page);
+		PageId* entries = (PageId*)page;
+		std::copy(entries, entries + size, entries + size);
+		bufMgr->unPinPage(file, dirPageNos[0], true);
+	} else {
+		// the directory fills whole pages, the new half is a copy of every page
+		size_t pageCount = dirPageNos.size();
+		for(size_t i = 0; i < pageCount; i++) {
+			PageId newPageNo;
+			Page* newPage;
+			allocIndexPage(newPageNo, newPage);
+			bufMgr->readPage(file, dirPageNos[i], page);
+			*newPage = *page;
+			bufMgr->unPinPage(file, dirPageNos[i], false);
+			bufMgr->unPinPage(file, newPageNo, true);
+			dirPageNos.push_back(newPageNo);
+		}
+	}
+	globalDepth++;
+	writeMeta();
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::splitBucket
+// -----------------------------------------------------------------------------
+
+bool HashIndex::splitBucket(const PageId pageNo, const unsigned int dirIndex)
+{
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+	int depth = ((HashBucketInt*)page)->localDepth;
+	if(depth == HASHMAXDEPTH) {
+		bufMgr->unPinPage(file, pageNo, false);
+		return false;
+	}
+	((HashBucketInt*)page)->localDepth = depth + 1;
+	bufMgr->unPinPage(file, pageNo, true);
+	if(depth == globalDepth) {
+		doubleDirectory();
+	}
+
+	// entries with hash bit depth set move to the new bucket
+	std::vector<RIDKeyPair<int> > entries, stay, move;
+	readChain(pageNo, entries);
+	for(size_t i = 0; i < entries.size(); i++) {
+		if(hashKey(entries[i].key) & (1u << depth)) {
+			move.push_back(entries[i]);
+		} else {
+			stay.push_back(entries[i]);
+		}
+	}
+	PageId newPageNo;
+	allocIndexPage(newPageNo, page);
+	HashBucketInt* bucket = (HashBucketInt*)page;
+	bucket->localDepth = depth + 1;
+	bucket->count = 0;
+	bucket->overflowPageNo = 0;
+	bufMgr->unPinPage(file, newPageNo, true);
+	writeChain(pageNo, stay);
+	writeChain(newPageNo, move);
+
+	// every directory entry of the old bucket with the bit set points to the new one
+	unsigned int low = dirIndex & ((1u << depth) - 1);
+	for(unsigned int i = low | (1u << depth); i < (1u << globalDepth); i += (1u << (depth + 1))) {
+		setBucketPageNo(i, newPageNo);
+	}
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::readChain
+// -----------------------------------------------------------------------------
+
+void HashIndex::readChain(const PageId pageNo, std::vector<RIDKeyPair<int> >& entries)
+{
+	PageId curPageNo = pageNo;
+	while(curPageNo != 0) {
+		Page* page;
+		bufMgr->readPage(file, curPageNo, page);
+		HashBucketInt* bucket = (HashBucketInt*)page;
+		for(int i = 0; i < bucket->count; i++) {
+			RIDKeyPair<int> entry;
+			entry.set(bucket->ridArray[i], bucket->keyArray[i]);
+			entries.push_back(entry);
+		}
+		PageId nextPageNo = bucket->overflowPageNo;
+		bufMgr->unPinPage(file, curPageNo, false);
+		curPageNo = nextPageNo;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::writeChain
+// -----------------------------------------------------------------------------
+
+void HashIndex::writeChain(const PageId pageNo, const std::vector<RIDKeyPair<int> >& entries)
+{
+	PageId curPageNo = pageNo;
+	size_t next = 0;
+	while(true) {
+		Page* page;
+		bufMgr->readPage(file, curPageNo, page);
+		HashBucketInt* bucket = (HashBucketInt*)page;
+		bucket->count = 0;
+		for(; next < entries.size() && bucket->count < HASHBUCKETSIZE; next++) {
+			bucket->keyArray[bucket->count] = entries[next].key;
+			bucket->ridArray[bucket->count] = entries[next].rid;
+			bucket->count++;
+		}
+		if(next < entries.size()) {
+			if(bucket->overflowPageNo == 0) {
+				Page* newPage;
+				allocIndexPage(bucket->overflowPageNo, newPage);
+				((HashBucketInt*)newPage)->overflowPageNo = 0;
+				bufMgr->unPinPage(file, bucket->overflowPageNo, true);
+			}
+			PageId nextPageNo = bucket->overflowPageNo;
+			bufMgr->unPinPage(file, curPageNo, true);
+			curPageNo = nextPageNo;
+			continue;
+		}
+
+		// free the rest of the chain
+		PageId freePageNo = bucket->overflowPageNo;
+		bucket->overflowPageNo = 0;
+		bufMgr->unPinPage(file, curPageNo, true);
+		while(freePageNo != 0) {
+			bufMgr->readPage(file, freePageNo, page);
+			PageId nextPageNo = ((HashBucketInt*)page)->overflowPageNo;
+			bufMgr->unPinPage(file, freePageNo, false);
+			freeIndexPage(freePageNo);
+			freePageNo = nextPageNo;
+		}
+		return;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::insertEntry
+// -----------------------------------------------------------------------------
+
+const void HashIndex::insertEntry(const void* key, const RecordId rid)
+{
+	int keyVal = *(int *)key;
+	unsigned int hash = hashKey(keyVal);
+	while(true) {
+		unsigned int dirIndex = hash & ((1u << globalDepth) - 1);
+		PageId pageNo = getBucketPageNo(dirIndex);
+		Page* page;
+		bufMgr->readPage(file, pageNo, page);
+		HashBucketInt* bucket = (HashBucketInt*)page;
+		if(bucket->count < HASHBUCKETSIZE) {
+			bucket->keyArray[bucket->count] = keyVal;
+			bucket->ridArray[bucket->count] = rid;
+			bucket->count++;
+			bufMgr->unPinPage(file, pageNo, true);
+			return;
+		}
+
+		// splitting only helps if the bucket holds another hash than that of key
+		bool split = false;
+		for(int i = 0; i < bucket->count && !split; i++) {
+			split = (hashKey(bucket->keyArray[i]) != hash);
+		}
+		bufMgr->unPinPage(file, pageNo, false);
+		if(split && splitBucket(pageNo, dirIndex)) {
+			continue;
+		}
+
+		// else, append to the first overflow page with room
+		PageId curPageNo = pageNo;
+		while(true) {
+			bufMgr->readPage(file, curPageNo, page);
+			bucket = (HashBucketInt*)page;
+			if(bucket->count < HASHBUCKETSIZE) {
+				bucket->keyArray[bucket->count] = keyVal;
+				bucket->ridArray[bucket->count] = rid;
+				bucket->count++;
+				bufMgr->unPinPage(file, curPageNo, true);
+				return;
+			}
+			if(bucket->overflowPageNo == 0) {
+				Page* newPage;
+				allocIndexPage(bucket->overflowPageNo, newPage);
+				((HashBucketInt*)newPage)->count = 0;
+				((HashBucketInt*)newPage)->overflowPageNo = 0;
+				bufMgr->unPinPage(file, bucket->overflowPageNo, true);
+			}
+			PageId nextPageNo = bucket->overflowPageNo;
+			bufMgr->unPinPage(file, curPageNo, true);
+			curPageNo = nextPageNo;
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::deleteEntry
+// -----------------------------------------------------------------------------
+
+const void HashIndex::deleteEntry(const void* key, const RecordId rid)
+{
+	int keyVal = *(int *)key;
+	PageId pageNo = getBucketPageNo(hashKey(keyVal) & ((1u << globalDepth) - 1));
+	PageId prevPageNo = 0;
+	PageId curPageNo = pageNo;
+	while(curPageNo != 0) {
+		Page* page;
+		bufMgr->readPage(file, curPageNo, page);
+		HashBucketInt* bucket = (HashBucketInt*)page;
+		for(int i = 0; i < bucket->count; i++) {
+			if(bucket->keyArray[i] != keyVal || bucket->ridArray[i] != rid) {
+				continue;
+			}
+
+			// the last entry fills the hole, an overflow page that empties out leaves the chain
+			bucket->count--;
+			bucket->keyArray[i] = bucket->keyArray[bucket->count];
+			bucket->ridArray[i] = bucket->ridArray[bucket->count];
+			PageId nextPageNo = bucket->overflowPageNo;
+			bool empty = (bucket->count == 0 && curPageNo != pageNo);
+			bufMgr->unPinPage(file, curPageNo, true);
+			if(empty) {
+				bufMgr->readPage(file, prevPageNo, page);
+				((HashBucketInt*)page)->overflowPageNo = nextPageNo;
+				bufMgr->unPinPage(file, prevPageNo, true);
+				freeIndexPage(curPageNo);
+			}
+			return;
+		}
+		PageId nextPageNo = bucket->overflowPageNo;
+		bufMgr->unPinPage(file, curPageNo, false);
+		prevPageNo = curPageNo;
+		curPageNo = nextPageNo;
+	}
+	throw NoSuchKeyFoundException();
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::lookup
+// -----------------------------------------------------------------------------
+
+bool HashIndex::lookup(const void* key, RecordId& outRid)
+{
+	int keyVal = *(int *)key;
+	PageId curPageNo = getBucketPageNo(hashKey(keyVal) & ((1u << globalDepth) - 1));
+	while(curPageNo != 0) {
+		Page* page;
+		bufMgr->readPage(file, curPageNo, page);
+		HashBucketInt* bucket = (HashBucketInt*)page;
+		for(int i = 0; i < bucket->count; i++) {
+			if(bucket->keyArray[i] == keyVal) {
+				outRid = bucket->ridArray[i];
+				bufMgr->unPinPage(file, curPageNo, false);
+				return true;
+			}
+		}
+		PageId nextPageNo = bucket->overflowPageNo;
+		bufMgr->unPinPage(file, curPageNo, false);
+		curPageNo = nextPageNo;
+	}
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::lookupAll
+// -----------------------------------------------------------------------------
+
+int HashIndex::lookupAll(const void* key, const std::function<void (const RecordId&)>& callback)
+{
+	int keyVal = *(int *)key;
+	PageId curPageNo = getBucketPageNo(hashKey(keyVal) & ((1u << globalDepth) - 1));
+	int found = 0;
+	while(curPageNo != 0) {
+		Page* page;
+		bufMgr->readPage(file, curPageNo, page);
+		HashBucketInt* bucket = (HashBucketInt*)page;
+		for(int i = 0; i < bucket->count; i++) {
+			if(bucket->keyArray[i] == keyVal) {
+				callback(bucket->ridArray[i]);
+				found++;
+			}
+		}
+		PageId nextPageNo = bucket->overflowPageNo;
+		bufMgr->unPinPage(file, curPageNo, false);
+		curPageNo = nextPageNo;
+	}
+	return found;
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::allocIndexPage
+// -----------------------------------------------------------------------------
+
+void HashIndex::allocIndexPage(PageId& pageNo, Page*& page)
+{
+	if(freeListPageNum == 0) {
+		bufMgr->allocPage(file, pageNo, page);
+		return;
+	}
+
+	// reuse the first page of the free list
+	pageNo = freeListPageNum;
+	bufMgr->readPage(file, pageNo, page);
+	freeListPageNum = ((FreeIndexPage*)page)->nextFreePageNo;
+	*page = Page();
+	writeMeta();
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::freeIndexPage
+// -----------------------------------------------------------------------------
+
+void HashIndex::freeIndexPage(const PageId pageNo)
+{
+	// BlobFile pages cannot be deleted, chain the page into the free list instead
+	Page* page;
+	bufMgr->readPage(file, pageNo, page);
+	((FreeIndexPage*)page)->nextFreePageNo = freeListPageNum;
+	bufMgr->unPinPage(file, pageNo, true);
+	freeListPageNum = pageNo;
+	writeMeta();
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::writeMeta
+// -----------------------------------------------------------------------------
+
+void HashIndex::writeMeta()
+{
+	Page* metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	HashIndexMetaInfo* meta = (HashIndexMetaInfo*)metaPage;
+	meta->globalDepth = globalDepth;
+	meta->dirPageCount = dirPageNos.size();
+	std::copy(dirPageNos.begin(), dirPageNos.end(), meta->dirPageNoArray);
+	meta->firstFreePageNo = freeListPageNum;
+	bufMgr->unPinPage(file, headerPageNum, true);
+}
+
+}
@@ -0,0 +1,270 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of bucket page numbers in a directory page.
+ */
+const  int HASHDIRPAGESIZE = Page::SIZE / sizeof( PageId );
+
+/**
+ * @brief Most directory pages a hash index can have, which bounds the global depth.
+ */
+const  int HASHMAXDIRPAGES = 512;
+
+/**
+ * @brief Largest global depth, 2^HASHMAXDEPTH directory entries fill HASHMAXDIRPAGES pages.
+ */
+const  int HASHMAXDEPTH = 20;
+
+/**
+ * @brief Number of entries in a bucket page.
+ */
+//                                                   depth and count     overflow ptr
+const  int HASHBUCKETSIZE = ( Page::SIZE - 2 * sizeof( int ) - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( RecordId ) );
+
+/**
+ * @brief The meta page of a hash index, which is always the first page of the index file.
+ */
+struct HashIndexMetaInfo{
+  /**
+   * Name of base relation.
+   */
+	char relationName[20];
+
+  /**
+   * Offset of attribute, over which index is built, inside the record stored in pages.
+   */
+	int attrByteOffset;
+
+  /**
+   * Type of the attribute over which index is built.
+   */
+	Datatype attrType;
+
+  /**
+   * Number of hash bits the directory is indexed by.
+   */
+	int globalDepth;
+
+  /**
+   * Number of directory pages in use, enough for 2^globalDepth entries.
+   */
+	int dirPageCount;
+
+  /**
+   * Page number of the first page of the free list, 0 if it is empty.
+   */
+	PageId firstFreePageNo;
+
+  /**
+   * Page numbers of the directory pages.
+   */
+	PageId dirPageNoArray[ HASHMAXDIRPAGES ];
+};
+
+/**
+ * @brief A bucket of a hash index, or a page of the overflow chain of a bucket.
+ * All entries of a bucket agree on the low localDepth bits of the hash of their key. A bucket only gets an
+ * overflow chain when it cannot be split any further, i.e. when its entries share one key or the directory
+ * is at HASHMAXDEPTH.
+*/
+struct HashBucketInt{
+  /**
+   * Number of hash bits the entries agree on, unused in overflow pages.
+   */
+	int localDepth;
+
+  /**
+   * Number of entries.
+   */
+	int count;
+
+  /**
+   * Next page of the overflow chain, 0 if there is none.
+   */
+	PageId overflowPageNo;
+
+  /**
+   * Keys of the entries.
+   */
+	int keyArray[ HASHBUCKETSIZE ];
+
+  /**
+   * Record ids of the entries.
+   */
+	RecordId ridArray[ HASHBUCKETSIZE ];
+};
+
+
+/**
+ * @brief Extendible hash index on an INTEGER attribute, for equality lookups.
+ *
+ * A directory of 2^globalDepth entries, indexed by the low bits of the hash of a key, points to the buckets.
+ * A probe reads one directory page and one bucket page, however many entries the index holds. A full bucket
+ * is split in two by one more hash bit, doubling the directory when the bucket already uses every bit of it.
+ * Buckets are not merged when entries are deleted.
+*/
+class HashIndex {
+
+ private:
+
+  /**
+   * File object for the index file.
+   */
+	File		*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * Byte offset of attribute in the record.
+   */
+	int			attrByteOffset;
+
+  /**
+   * Number of hash bits the directory is indexed by.
+   */
+	int			globalDepth;
+
+  /**
+   * Page numbers of the directory pages.
+   */
+	std::vector<PageId> dirPageNos;
+
+  /**
+   * Page number of the first page of the free list, 0 if it is empty.
+   */
+	PageId	freeListPageNum;
+
+  /**
+	 * @return page number of the bucket of directory entry dirIndex
+	**/
+	PageId getBucketPageNo(const unsigned int dirIndex);
+
+  /**
+	 * Point directory entry dirIndex to bucket pageNo.
+	**/
+	void setBucketPageNo(const unsigned int dirIndex, const PageId pageNo);
+
+  /**
+	 * Double the directory, the new upper half points to the same buckets as the lower half.
+	**/
+	void doubleDirectory();
+
+  /**
+	 * Split bucket pageNo, the bucket of directory entry dirIndex, into itself and a new bucket by the next hash bit.
+	 * @return false if the bucket cannot be split and has to grow an overflow chain instead
+	**/
+	bool splitBucket(const PageId pageNo, const unsigned int dirIndex);
+
+  /**
+	 * Write entries into bucket pageNo and its overflow chain, which is extended or shortened to fit them.
+	**/
+	void writeChain(const PageId pageNo, const std::vector<RIDKeyPair<int> >& entries);
+
+  /**
+	 * Read the entries of bucket pageNo and its overflow chain.
+	**/
+	void readChain(const PageId pageNo, std::vector<RIDKeyPair<int> >& entries);
+
+  /**
+	 * Allocate a page, taking it off the free list if there is one.
+	**/
+	void allocIndexPage(PageId& pageNo, Page*& page);
+
+  /**
+	 * Put pageNo on the free list, the page must not be pinned.
+	**/
+	void freeIndexPage(const PageId pageNo);
+
+  /**
+	 * Write the global depth, directory pages and free list to the meta page.
+	**/
+	void writeMeta();
+
+ public:
+
+  /**
+	 * Open the hash index on attrByteOffset of relationName, or create it and insert an entry for every record
+	 * if there is none yet.
+   * @param relationName	Name of file
+   * @param outIndexName	Return the name of index file
+   * @param bufMgrIn			Buffer Manager Instance
+   * @param attrByteOffset	Offset of attribute, over which index is to be built, in the record
+   * @param attrType			Datatype of attribute over which index is built, INTEGER only
+	 * @throws  BadIndexInfoException If an existing index file does not match attrByteOffset and attrType.
+	**/
+	HashIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn, const int attrByteOffset, const Datatype attrType);
+
+  /**
+	 * Destructor. Flushes the index file.
+	**/
+	~HashIndex();
+
+  /**
+	 * @return hash of key, the directory is indexed by its low bits
+	**/
+	static unsigned int hashKey(const int key);
+
+  /**
+	 * Insert a new entry using the pair <value,rid>.
+   * @param key			Key to insert, pointer to integer
+   * @param rid			Record ID of a record whose entry is getting inserted into the index.
+	**/
+	const void insertEntry(const void* key, const RecordId rid);
+
+  /**
+	 * Delete the entry <key,rid>. Overflow pages that empty out are freed.
+	 * @throws NoSuchKeyFoundException If the entry is not in the index.
+	**/
+	const void deleteEntry(const void* key, const RecordId rid);
+
+  /**
+	 * Exact match lookup of key, like BTreeIndex::lookup().
+   * @param key			Key to look up, pointer to integer
+   * @param outRid	Record ID of an entry with the key, set only if one is found
+	 * @return true if the key is in the index
+	**/
+	bool lookup(const void* key, RecordId& outRid);
+
+  /**
+	 * Exact match lookup of all entries with key, like BTreeIndex::lookupAll().
+	 * callback must not modify the index.
+	 * @return number of entries found
+	**/
+	int lookupAll(const void* key, const std::function<void (const RecordId&)>& callback);
+
+  /**
+	 * @return number of hash bits the directory is indexed by
+	**/
+	int getGlobalDepth() const;
+};
+
+}
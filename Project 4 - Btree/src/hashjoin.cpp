@@ -0,0 +1,374 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cstring>
+#include "hashjoin.h"
+
+namespace badgerdb
+{
+
+const std::uint32_t JoinHashTable::NOTUPLE;
+
+// -----------------------------------------------------------------------------
+// JoinHashTable::JoinHashTable -- Constructor
+// -----------------------------------------------------------------------------
+
+JoinHashTable::JoinHashTable()
+{
+	tupleLength = 0;
+	mask = 0;
+}
+
+// -----------------------------------------------------------------------------
+// JoinHashTable::clear
+// -----------------------------------------------------------------------------
+
+void JoinHashTable::clear(const int tupleLength)
+{
+	this->tupleLength = tupleLength;
+	std::vector<char>().swap(tuples);
+	std::vector<std::uint64_t>().swap(hashes);
+	std::vector<std::uint32_t>().swap(heads);
+	std::vector<std::uint32_t>().swap(nexts);
+	mask = 0;
+}
+
+// -----------------------------------------------------------------------------
+// JoinHashTable::add
+// -----------------------------------------------------------------------------
+
+void JoinHashTable::add(const char* tuple, const std::uint64_t hash)
+{
+	tuples.insert(tuples.end(), tuple, tuple + tupleLength);
+	hashes.push_back(hash);
+}
+
+// -----------------------------------------------------------------------------
+// JoinHashTable::build
+// -----------------------------------------------------------------------------
+
+void JoinHashTable::build()
+{
+	size_t buckets = 1;
+	while(buckets < hashes.size()) {
+		buckets <<= 1;
+	}
+	mask = buckets - 1;
+	heads.assign(buckets, NOTUPLE);
+	nexts.resize(hashes.size());
+	for(size_t i = 0; i < hashes.size(); i++) {
+		std::uint64_t bucket = hashes[i] & mask;
+		nexts[i] = heads[bucket];
+		heads[bucket] = i;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// JoinHashTable::first
+// -----------------------------------------------------------------------------
+
+std::uint32_t JoinHashTable::first(const std::uint64_t hash) const
+{
+	return heads.empty() ? NOTUPLE : heads[hash & mask];
+}
+
+// -----------------------------------------------------------------------------
+// JoinHashTable::footprint
+// -----------------------------------------------------------------------------
+
+size_t JoinHashTable::footprint(const size_t count, const int tupleLength)
+{
+	// tuple, hash, chain link and about one bucket head per tuple
+	return count * (tupleLength + sizeof(std::uint64_t) + 2 * sizeof(std::uint32_t));
+}
+
+// -----------------------------------------------------------------------------
+// HashJoinOperator::HashJoinOperator -- Constructor
+// -----------------------------------------------------------------------------
+
+HashJoinOperator::HashJoinOperator(QueryOperator *left, QueryOperator *right, const std::string& leftColumn, const std::string& rightColumn,
+		BufMgr *bufMgrIn, const size_t memoryBudget)
+{
+	this->left = left;
+	this->right = right;
+	this->bufMgr = bufMgrIn;
+	this->memoryBudget = memoryBudget;
+	this->leftKey = left->getSchema().columns[left->getSchema().find(leftColumn)];
+	this->rightKey = right->getSchema().columns[right->getSchema().find(rightColumn)];
+	this->schema = left->getSchema();
+	this->schema.append(right->getSchema());
+	this->probeFile = NULL;
+	this->probingChild = false;
+	this->nextMatch = JoinHashTable::NOTUPLE;
+	this->spillCount = 0;
+}
+
+HashJoinOperator::~HashJoinOperator()
+{
+	close();
+	delete left;
+	delete right;
+}
+
+// -----------------------------------------------------------------------------
+// HashJoinOperator::hashKey
+// -----------------------------------------------------------------------------
+
+std::uint64_t HashJoinOperator::hashKey(const char* tuple, const Column& key)
+{
+	std::uint64_t hash;
+	if(key.type == STRING) {
+		hash = 14695981039346656037ULL;
+		for(int i = 0; i < key.length && tuple[key.offset + i] != '\0'; i++) {
+			hash = (hash ^ (unsigned char)tuple[key.offset + i]) * 1099511628211ULL;
+		}
+	} else {
+		// numbers hash by their value as a double, so that an INTEGER key meets an equal DOUBLE key
+		double value;
+		if(key.type == INTEGER) {
+			int number;
+			memcpy(&number, tuple + key.offset, sizeof(int));
+			value = number;
+		} else {
+			memcpy(&value, tuple + key.offset, sizeof(double));
+		}
+		if(value == 0) {
+			value = 0;
+		}
+		memcpy(&hash, &value, sizeof(hash));
+	}
+
+	// murmur3 finalizer, so that every bit depends on the whole key
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+// -----------------------------------------------------------------------------
+// HashJoinOperator::partitionOf
+// -----------------------------------------------------------------------------
+
+int HashJoinOperator::partitionOf(const std::uint64_t hash, const int depth)
+{
+	return (hash >> (60 - 4 * depth)) % HASHJOINPARTITIONS;
+}
+
+// -----------------------------------------------------------------------------
+// HashJoinOperator::open
+// -----------------------------------------------------------------------------
+
+void HashJoinOperator::open()
+{
+	close();
+	spillCount = 0;
+	buffer.assign(schema.tupleLength, 0);
+	int leftLength = left->getSchema().tupleLength;
+	int rightLength = right->getSchema().tupleLength;
+
+	table.clear(rightLength);
+	right->open();
+	TupleRef tuple;
+	bool fits = true;
+	while(right->next(tuple)) {
+		table.add(tuple.data, hashKey(tuple.data, rightKey));
+		if(JoinHashTable::footprint(table.getTupleCount(), rightLength) > memoryBudget) {
+			fits = false;
+			break;
+		}
+	}
+	if(fits) {
+		right->close();
+		table.build();
+		left->open();
+		probingChild = true;
+		return;
+	}
+
+	// the build side is too big: partition what was read, the rest of the right child and the left child
+	std::vector<SpillFile*> builds(HASHJOINPARTITIONS), probes(HASHJOINPARTITIONS);
+	for(int p = 0; p < HASHJOINPARTITIONS; p++) {
+		builds[p] = new SpillFile(bufMgr, rightLength);
+		probes[p] = new SpillFile(bufMgr, leftLength);
+	}
+	for(size_t i = 0; i < table.getTupleCount(); i++) {
+		builds[partitionOf(table.getHash(i), 0)]->append(table.getTuple(i));
+	}
+	table.clear(rightLength);
+	while(right->next(tuple)) {
+		builds[partitionOf(hashKey(tuple.data, rightKey), 0)]->append(tuple.data);
+	}
+	right->close();
+	for(int p = 0; p < HASHJOINPARTITIONS; p++) {
+		builds[p]->finishWrite();
+	}
+
+	left->open();
+	while(left->next(tuple)) {
+		probes[partitionOf(hashKey(tuple.data, leftKey), 0)]->append(tuple.data);
+	}
+	left->close();
+	for(int p = 0; p < HASHJOINPARTITIONS; p++) {
+		probes[p]->finishWrite();
+		PartitionPair pair = {builds[p], probes[p], 0};
+		pending.push_back(pair);
+	}
+	spillCount += HASHJOINPARTITIONS;
+}
+
+// -----------------------------------------------------------------------------
+// HashJoinOperator::splitPartition
+// -----------------------------------------------------------------------------
+
+void HashJoinOperator::splitPartition(SpillFile* build, SpillFile* probe, const int depth)
+{
+	std::vector<SpillFile*> builds(HASHJOINPARTITIONS), probes(HASHJOINPARTITIONS);
+	for(int p = 0; p < HASHJOINPARTITIONS; p++) {
+		builds[p] = new SpillFile(bufMgr, right->getSchema().tupleLength);
+		probes[p] = new SpillFile(bufMgr, left->getSchema().tupleLength);
+	}
+	const char* tuple;
+	build->startRead();
+	while((tuple = build->readNext()) != NULL) {
+		builds[partitionOf(hashKey(tuple, rightKey), depth + 1)]->append(tuple);
+	}
+	delete build;
+	for(int p = 0; p < HASHJOINPARTITIONS; p++) {
+		builds[p]->finishWrite();
+	}
+	probe->startRead();
+	while((tuple = probe->readNext()) != NULL) {
+		probes[partitionOf(hashKey(tuple, leftKey), depth + 1)]->append(tuple);
+	}
+	delete probe;
+	for(int p = 0; p < HASHJOINPARTITIONS; p++) {
+		probes[p]->finishWrite();
+		PartitionPair pair = {builds[p], probes[p], depth + 1};
+		pending.push_back(pair);
+	}
+	spillCount += HASHJOINPARTITIONS;
+}
+
+// -----------------------------------------------------------------------------
+// HashJoinOperator::loadPartition
+// -----------------------------------------------------------------------------
+
+bool HashJoinOperator::loadPartition()
+{
+	int rightLength = right->getSchema().tupleLength;
+	while(!pending.empty()) {
+		PartitionPair pair = pending.back();
+		pending.pop_back();
+		if(pair.build->getTupleCount() == 0 || pair.probe->getTupleCount() == 0) {
+			delete pair.build;
+			delete pair.probe;
+			continue;
+		}
+		if(JoinHashTable::footprint(pair.build->getTupleCount(), rightLength) > memoryBudget && pair.depth + 1 < HASHJOINMAXDEPTH) {
+			splitPartition(pair.build, pair.probe, pair.depth);
+			continue;
+		}
+
+		table.clear(rightLength);
+		const char* tuple;
+		pair.build->startRead();
+		while((tuple = pair.build->readNext()) != NULL) {
+			table.add(tuple, hashKey(tuple, rightKey));
+		}
+		delete pair.build;
+		table.build();
+		probeFile = pair.probe;
+		probeFile->startRead();
+		return true;
+	}
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// HashJoinOperator::next
+// -----------------------------------------------------------------------------
+
+bool HashJoinOperator::next(TupleRef& outTuple)
+{
+	int leftLength = left->getSchema().tupleLength;
+	int rightLength = right->getSchema().tupleLength;
+	while(true) {
+		while(nextMatch != JoinHashTable::NOTUPLE) {
+			std::uint32_t match = nextMatch;
+			nextMatch = table.next(match);
+			if(table.getHash(match) == probeHash && compareValues(&buffer[0], leftKey, table.getTuple(match), rightKey) == 0) {
+				memcpy(&buffer[leftLength], table.getTuple(match), rightLength);
+				outTuple.data = &buffer[0];
+				outTuple.rid = probeRid;
+				return true;
+			}
+		}
+
+		// move on to the next left tuple, from the child or from the partition being joined
+		const char* probe;
+		if(probingChild) {
+			TupleRef tuple;
+			if(!left->next(tuple)) {
+				left->close();
+				probingChild = false;
+				return false;
+			}
+			probe = tuple.data;
+			probeRid = tuple.rid;
+		} else {
+			if(probeFile == NULL || (probe = probeFile->readNext()) == NULL) {
+				delete probeFile;
+				probeFile = NULL;
+				if(!loadPartition()) {
+					return false;
+				}
+				continue;
+			}
+			probeRid.page_number = Page::INVALID_NUMBER;
+			probeRid.slot_number = Page::INVALID_SLOT;
+		}
+		memcpy(&buffer[0], probe, leftLength);
+		probeHash = hashKey(probe, leftKey);
+		nextMatch = table.first(probeHash);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// HashJoinOperator::clearPending
+// -----------------------------------------------------------------------------
+
+void HashJoinOperator::clearPending()
+{
+	for(size_t i = 0; i < pending.size(); i++) {
+		delete pending[i].build;
+		delete pending[i].probe;
+	}
+	pending.clear();
+}
+
+// -----------------------------------------------------------------------------
+// HashJoinOperator::close
+// -----------------------------------------------------------------------------
+
+void HashJoinOperator::close()
+{
+	if(probingChild) {
+		left->close();
+		probingChild = false;
+	}
+	if(probeFile != NULL) {
+		delete probeFile;
+		probeFile = NULL;
+	}
+	clearPending();
+	table.clear(right->getSchema().tupleLength);
+	nextMatch = JoinHashTable::NOTUPLE;
+}
+
+}
@@ -0,0 +1,204 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "buffer.h"
+#include "operators.h"
+#include "spillfile.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of partitions an input is split into when the build side does not fit in memory.
+ */
+const  int HASHJOINPARTITIONS = 16;
+
+/**
+ * @brief Most times a partition is split again. Partitions at this depth are joined in memory whatever their
+ * size, as they are made of a few keys with many duplicates.
+ */
+const  int HASHJOINMAXDEPTH = 4;
+
+/**
+ * @brief A hash table of tuples held in flat arrays: the tuples one after another, their hashes, and a
+ * chain of tuple numbers per bucket. Building takes one pass over the tuples and a probe touches the bucket
+ * heads, then only the hashes of its chain until one matches.
+*/
+class JoinHashTable {
+
+ private:
+
+	int			tupleLength;
+	std::vector<char>	tuples;
+	std::vector<std::uint64_t>	hashes;
+
+  /**
+   * First tuple of each bucket and next tuple of each tuple, NOTUPLE at the end of a chain.
+   */
+	std::vector<std::uint32_t>	heads;
+	std::vector<std::uint32_t>	nexts;
+
+	std::uint64_t	mask;
+
+ public:
+
+  /**
+   * End of a chain.
+   */
+	static const std::uint32_t NOTUPLE = 0xFFFFFFFF;
+
+	JoinHashTable();
+
+  /**
+	 * Empty the table, for tuples of tupleLength bytes.
+	**/
+	void clear(const int tupleLength);
+
+  /**
+	 * Add a copy of tuple, whose key hashes to hash. Call build() once every tuple is added.
+	**/
+	void add(const char* tuple, const std::uint64_t hash);
+
+  /**
+	 * Link the tuples into their buckets.
+	**/
+	void build();
+
+  /**
+	 * @return first tuple in the bucket of hash, NOTUPLE if there is none
+	**/
+	std::uint32_t first(const std::uint64_t hash) const;
+
+  /**
+	 * @return tuple after tupleNo in its bucket, NOTUPLE if there is none
+	**/
+	std::uint32_t next(const std::uint32_t tupleNo) const { return nexts[tupleNo]; }
+
+	std::uint64_t getHash(const std::uint32_t tupleNo) const { return hashes[tupleNo]; }
+	const char* getTuple(const std::uint32_t tupleNo) const { return &tuples[(size_t)tupleNo * tupleLength]; }
+	size_t getTupleCount() const { return hashes.size(); }
+
+  /**
+	 * @return bytes a table of count tuples of tupleLength bytes takes
+	**/
+	static size_t footprint(const size_t count, const int tupleLength);
+};
+
+/**
+ * @brief Equi-join of its left and right children, with the result tuples of JoinOperator.
+ *
+ * The right child is the build side. If it fits in memoryBudget bytes, it is loaded into a JoinHashTable and
+ * the left child is streamed past it (the common case of a small dimension table such as Holidays). Otherwise
+ * both inputs are split by the hash of their key into HASHJOINPARTITIONS SpillFiles through the buffer pool,
+ * Grace style, and each pair of partitions is joined the same way, being split again by other hash bits while
+ * its build side is still too big. Result tuples of spilled partitions carry no record id.
+*/
+class HashJoinOperator : public QueryOperator {
+
+ private:
+
+  /**
+   * A pair of partitions waiting to be joined.
+   */
+	struct PartitionPair{
+		SpillFile* build;
+		SpillFile* probe;
+		int depth;
+	};
+
+	QueryOperator	*left;
+	QueryOperator	*right;
+	BufMgr	*bufMgr;
+	size_t	memoryBudget;
+
+  /**
+   * Key columns of the left and right tuples.
+   */
+	Column	leftKey;
+	Column	rightKey;
+
+	JoinHashTable	table;
+
+  /**
+   * Partitions left to join, and the probe partition being joined, NULL while probing with the left child.
+   */
+	std::vector<PartitionPair>	pending;
+	SpillFile	*probeFile;
+
+  /**
+   * True while the left child is open and probed with.
+   */
+	bool		probingChild;
+
+  /**
+   * Hash of the current left tuple and the next build tuple of its bucket to try.
+   */
+	std::uint64_t	probeHash;
+	std::uint32_t	nextMatch;
+
+  /**
+   * Record id of the current left tuple.
+   */
+	RecordId	probeRid;
+
+  /**
+   * Current left tuple followed by the right tuple last returned.
+   */
+	std::vector<char>	buffer;
+
+	int			spillCount;
+
+  /**
+	 * @return hash of the key of tuple, equal for keys compareValues() finds equal
+	**/
+	static std::uint64_t hashKey(const char* tuple, const Column& key);
+
+  /**
+	 * @return partition of hash at depth, taken from the high bits so that the table uses other bits
+	**/
+	static int partitionOf(const std::uint64_t hash, const int depth);
+
+  /**
+	 * Split partitions build and probe of depth into the next depth and queue them, deleting both.
+	**/
+	void splitPartition(SpillFile* build, SpillFile* probe, const int depth);
+
+  /**
+	 * Load the build side of the next pair of pending partitions that has tuples on both sides.
+	 * @return false if there is none
+	**/
+	bool loadPartition();
+
+	void clearPending();
+
+ public:
+
+  /**
+   * @param leftColumn			Key column of left
+   * @param rightColumn			Key column of right, the build side
+   * @param memoryBudget		Bytes the hash table may take before the join spills
+	**/
+	HashJoinOperator(QueryOperator *left, QueryOperator *right, const std::string& leftColumn, const std::string& rightColumn,
+						BufMgr *bufMgrIn, const size_t memoryBudget);
+	~HashJoinOperator();
+	void open();
+	bool next(TupleRef& outTuple);
+	void close();
+
+  /**
+	 * @return number of partitions written since the join was opened, 0 if the build side fit in memory
+	**/
+	int getSpillCount() const { return spillCount; }
+};
+
+}
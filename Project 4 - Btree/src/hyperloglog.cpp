@@ -0,0 +1,216 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "hyperloglog.h"
+
+namespace badgerdb
+{
+
+/**
+ * Cardinality below which linear counting beats the raw estimate, for precisions 4 to 18 (from HyperLogLog++).
+ */
+static const double linearCountingThreshold[] = {10, 20, 40, 80, 220, 400, 900, 1800, 3100, 6500, 11500, 20000,
+		50000, 120000, 350000};
+
+/**
+ * Number of entries tempList collects before it is sorted into sparseList.
+ */
+static const size_t tempListLimit = 1024;
+
+// -----------------------------------------------------------------------------
+// HyperLogLog::HyperLogLog -- Constructor
+// -----------------------------------------------------------------------------
+
+HyperLogLog::HyperLogLog(const int precision)
+{
+	this->precision = std::min(std::max(precision, 4), 18);
+	this->sparse = true;
+}
+
+// -----------------------------------------------------------------------------
+// HyperLogLog::hashValue
+// -----------------------------------------------------------------------------
+
+std::uint64_t HyperLogLog::hashValue(const char* data, const int length)
+{
+	std::uint64_t hash = 14695981039346656037ULL;
+	for(int i = 0; i < length; i++) {
+		hash = (hash ^ (unsigned char)data[i]) * 1099511628211ULL;
+	}
+
+	// murmur3 finalizer, the estimate relies on every bit being random
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+// -----------------------------------------------------------------------------
+// HyperLogLog::add
+// -----------------------------------------------------------------------------
+
+void HyperLogLog::add(const std::uint64_t hash)
+{
+	if(sparse) {
+		// the register value is the position of the first 1 bit after the index bits
+		std::uint64_t rest = hash << HLLSPARSEPRECISION;
+		std::uint32_t value = rest == 0 ? 64 - HLLSPARSEPRECISION + 1 : __builtin_clzll(rest) + 1;
+		tempList.push_back((std::uint32_t)(hash >> (64 - HLLSPARSEPRECISION)) << 6 | value);
+		if(tempList.size() == tempListLimit) {
+			compact();
+		}
+		return;
+	}
+	std::uint64_t rest = hash << precision;
+	std::uint8_t value = rest == 0 ? 64 - precision + 1 : __builtin_clzll(rest) + 1;
+	std::uint8_t& reg = registers[hash >> (64 - precision)];
+	reg = std::max(reg, value);
+}
+
+// -----------------------------------------------------------------------------
+// HyperLogLog::compact
+// -----------------------------------------------------------------------------
+
+void HyperLogLog::compact()
+{
+	if(tempList.empty()) {
+		return;
+	}
+	sparseList.insert(sparseList.end(), tempList.begin(), tempList.end());
+	tempList.clear();
+	std::sort(sparseList.begin(), sparseList.end());
+
+	// entries of an index sort by value, so the last one of each index is kept
+	size_t kept = 0;
+	for(size_t i = 0; i < sparseList.size(); i++) {
+		if(i + 1 < sparseList.size() && (sparseList[i] >> 6) == (sparseList[i + 1] >> 6)) {
+			continue;
+		}
+		sparseList[kept++] = sparseList[i];
+	}
+	sparseList.resize(kept);
+
+	if(sparseList.size() * sizeof(std::uint32_t) > ((size_t)1 << precision)) {
+		toDense();
+	}
+}
+
+// -----------------------------------------------------------------------------
+// HyperLogLog::addSparseEntry
+// -----------------------------------------------------------------------------
+
+void HyperLogLog::addSparseEntry(const std::uint32_t entry)
+{
+	// the sparse index holds the dense index and the first extra bits of the hash; the dense value counts
+	// the zeros among those extra bits before the sparse value takes over
+	int extraBits = HLLSPARSEPRECISION - precision;
+	std::uint32_t sparseIndex = entry >> 6;
+	std::uint32_t extra = sparseIndex & ((1u << extraBits) - 1);
+	std::uint8_t value;
+	if(extra != 0) {
+		value = extraBits - (32 - __builtin_clz(extra)) + 1;
+	} else {
+		value = extraBits + (entry & 63);
+	}
+	std::uint8_t& reg = registers[sparseIndex >> extraBits];
+	reg = std::max(reg, value);
+}
+
+// -----------------------------------------------------------------------------
+// HyperLogLog::toDense
+// -----------------------------------------------------------------------------
+
+void HyperLogLog::toDense()
+{
+	registers.assign((size_t)1 << precision, 0);
+	sparse = false;
+	for(size_t i = 0; i < sparseList.size(); i++) {
+		addSparseEntry(sparseList[i]);
+	}
+	for(size_t i = 0; i < tempList.size(); i++) {
+		addSparseEntry(tempList[i]);
+	}
+	std::vector<std::uint32_t>().swap(sparseList);
+	std::vector<std::uint32_t>().swap(tempList);
+}
+
+// -----------------------------------------------------------------------------
+// HyperLogLog::merge
+// -----------------------------------------------------------------------------
+
+void HyperLogLog::merge(const HyperLogLog& other)
+{
+	if(sparse && other.sparse) {
+		tempList.insert(tempList.end(), other.sparseList.begin(), other.sparseList.end());
+		tempList.insert(tempList.end(), other.tempList.begin(), other.tempList.end());
+		compact();
+		return;
+	}
+	if(sparse) {
+		toDense();
+	}
+	if(other.sparse) {
+		for(size_t i = 0; i < other.sparseList.size(); i++) {
+			addSparseEntry(other.sparseList[i]);
+		}
+		for(size_t i = 0; i < other.tempList.size(); i++) {
+			addSparseEntry(other.tempList[i]);
+		}
+	} else {
+		for(size_t i = 0; i < registers.size(); i++) {
+			registers[i] = std::max(registers[i], other.registers[i]);
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------
+// HyperLogLog::estimate
+// -----------------------------------------------------------------------------
+
+double HyperLogLog::estimate()
+{
+	if(sparse) {
+		compact();
+	}
+	if(sparse) {
+		// linear counting over the 2^25 sparse registers
+		double m = (double)((std::uint64_t)1 << HLLSPARSEPRECISION);
+		return m * std::log(m / (m - sparseList.size()));
+	}
+
+	double m = (double)registers.size();
+	double sum = 0;
+	int zeros = 0;
+	for(size_t i = 0; i < registers.size(); i++) {
+		sum += std::ldexp(1.0, -registers[i]);
+		zeros += registers[i] == 0;
+	}
+	double alpha = m == 16 ? 0.673 : m == 32 ? 0.697 : m == 64 ? 0.709 : 0.7213 / (1 + 1.079 / m);
+	double raw = alpha * m * m / sum;
+	if(zeros > 0) {
+		double linear = m * std::log(m / zeros);
+		if(linear <= linearCountingThreshold[precision - 4]) {
+			return linear;
+		}
+	}
+	return raw;
+}
+
+// -----------------------------------------------------------------------------
+// HyperLogLog::footprint
+// -----------------------------------------------------------------------------
+
+size_t HyperLogLog::footprint() const
+{
+	return (sparseList.size() + tempList.size()) * sizeof(std::uint32_t) + registers.size();
+}
+
+}
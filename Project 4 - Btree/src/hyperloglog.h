@@ -0,0 +1,104 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace badgerdb
+{
+
+/**
+ * @brief Default precision of a HyperLogLog: 2^14 registers, a standard error of about 0.8%.
+ */
+const  int HLLPRECISION = 14;
+
+/**
+ * @brief Precision of the sparse representation.
+ */
+const  int HLLSPARSEPRECISION = 25;
+
+/**
+ * @brief HyperLogLog++ sketch estimating the number of distinct values added to it, from their 64 bit hashes.
+ *
+ * A sketch starts sparse: a sorted list of the registers set so far, at precision HLLSPARSEPRECISION, which
+ * takes a few bytes per distinct value and gives near exact counts for small sets. Once the list would take more
+ * than the 2^precision one byte registers, the sketch turns dense. Dense estimates below the threshold of the
+ * precision use linear counting, as HyperLogLog++ does; its empirical bias correction is not applied.
+ * Two sketches of the same precision merge into the sketch of the union, so partial results combine.
+*/
+class HyperLogLog {
+
+ private:
+
+	int			precision;
+	bool		sparse;
+
+  /**
+   * Sparse registers, index << 6 | value, sorted with one entry per index, and the entries added since the
+   * list was last sorted.
+   */
+	std::vector<std::uint32_t>	sparseList;
+	std::vector<std::uint32_t>	tempList;
+
+  /**
+   * Dense registers, empty while the sketch is sparse.
+   */
+	std::vector<std::uint8_t>	registers;
+
+  /**
+	 * Sort tempList into sparseList, keeping the largest value of each index, and turn dense if it got too big.
+	**/
+	void compact();
+
+  /**
+	 * Move the sparse registers into dense ones.
+	**/
+	void toDense();
+
+  /**
+	 * Set the dense register a sparse entry falls into.
+	**/
+	void addSparseEntry(const std::uint32_t entry);
+
+ public:
+
+  /**
+   * @param precision		Number of index bits, 4 to 18
+	**/
+	HyperLogLog(const int precision = HLLPRECISION);
+
+  /**
+	 * @return 64 bit hash of length bytes of data, for add()
+	**/
+	static std::uint64_t hashValue(const char* data, const int length);
+
+  /**
+	 * Add a value by its hash.
+	**/
+	void add(const std::uint64_t hash);
+
+  /**
+	 * Add the values of other, a sketch of the same precision.
+	**/
+	void merge(const HyperLogLog& other);
+
+  /**
+	 * @return estimated number of distinct values added
+	**/
+	double estimate();
+
+	bool isSparse() const { return sparse; }
+
+  /**
+	 * @return bytes the registers take
+	**/
+	size_t footprint() const;
+};
+
+}
@@ -0,0 +1,627 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <vector>
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include <sstream>
+#include "lsmindex.h"
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/scan_not_initialized_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/end_of_file_exception.h"
+
+namespace badgerdb
+{
+
+static bool entryLess(const LsmEntry& e1, const LsmEntry& e2)
+{
+	if(e1.key != e2.key) {
+		return e1.key < e2.key;
+	}
+	if(e1.rid.page_number != e2.rid.page_number) {
+		return e1.rid.page_number < e2.rid.page_number;
+	}
+	return e1.rid.slot_number < e2.rid.slot_number;
+}
+
+// bit i of the Bloom filter for key, by double hashing a mixed key
+static int bloomBit(const int key, const int i, const int bitCount)
+{
+	unsigned int h = (unsigned int)key;
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+	unsigned int step = (h >> 17) | (h << 15) | 1;
+	return (h + i * step) % bitCount;
+}
+
+static bool bloomContains(const LsmRun* run, const int key)
+{
+	int bitCount = run->bloom.size() * 8;
+	for(int i = 0; i < LSMBLOOMHASHES; i++) {
+		int bit = bloomBit(key, i, bitCount);
+		if(!(run->bloom[bit / 8] & (1 << (bit % 8)))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::LsmIndex -- Constructor
+// -----------------------------------------------------------------------------
+
+LsmIndex::LsmIndex(const std::string & relationName,
+		std::string & outIndexName,
+		BufMgr *bufMgrIn,
+		const int attrByteOffset,
+		const Datatype attrType)
+{
+	if(attrType != INTEGER) {
+		throw BadIndexInfoException("LSM indexes take INTEGER attributes only");
+	}
+
+	std::ostringstream idxStr;
+	idxStr << relationName << '.' << attrByteOffset << ".lsm";
+	indexName = idxStr.str();
+
+	outIndexName = indexName;
+	this->bufMgr = bufMgrIn;
+	this->attrByteOffset = attrByteOffset;
+	this->scanExecuting = false;
+
+	if(File::exists(indexName)) {
+		this->file = new BlobFile(indexName, false);
+		this->headerPageNum = file->getFirstPageNo();
+		Page* metaPage;
+		bufMgr->readPage(file, headerPageNum, metaPage);
+		LsmMetaInfo* meta = (LsmMetaInfo*)metaPage;
+		if(meta->attrByteOffset != attrByteOffset || meta->attrType != attrType) {
+			bufMgr->unPinPage(file, headerPageNum, false);
+			delete file;
+			throw BadIndexInfoException("Index meta page does not match the requested attribute");
+		}
+		nextRunId = meta->nextRunId;
+		std::vector<int> runIds(meta->runIdArray, meta->runIdArray + meta->runCount);
+		std::vector<int> runLevels(meta->runLevelArray, meta->runLevelArray + meta->runCount);
+		bufMgr->unPinPage(file, headerPageNum, false);
+		for(size_t i = 0; i < runIds.size(); i++) {
+			runs.push_back(openRun(runIds[i], runLevels[i]));
+		}
+		return;
+	}
+
+	this->file = new BlobFile(indexName, true);
+	Page* metaPage;
+	bufMgr->allocPage(file, headerPageNum, metaPage);
+	LsmMetaInfo* meta = (LsmMetaInfo*)metaPage;
+	strcpy(meta->relationName, relationName.c_str());
+	meta->attrByteOffset = attrByteOffset;
+	meta->attrType = attrType;
+	bufMgr->unPinPage(file, headerPageNum, true);
+	nextRunId = 1;
+	writeMeta();
+
+	FileScan* scan = new FileScan(relationName, bufMgr);
+	try {
+		while(true) {
+			RecordId rid;
+			scan->scanNext(rid);
+			std::string recordString = scan->getRecord();
+			insertEntry(recordString.c_str() + attrByteOffset, rid);
+		}
+	}
+	catch(const EndOfFileException& e) {}
+	delete scan;
+	bufMgr->flushFile(file);
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::~LsmIndex -- destructor
+// -----------------------------------------------------------------------------
+
+LsmIndex::~LsmIndex()
+{
+	scanExecuting = false;
+	scanCursors.clear();
+	flushMemtable();
+	for(size_t i = 0; i < runs.size(); i++) {
+		bufMgr->flushFile(runs[i]->file);
+		delete runs[i]->file;
+		delete runs[i];
+	}
+	bufMgr->flushFile(file);
+	delete file;
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::insertEntry
+// -----------------------------------------------------------------------------
+
+const void LsmIndex::insertEntry(const void* key, const RecordId rid)
+{
+	addEntry(*(int*)key, rid, LSMINSERT);
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::deleteEntry
+// -----------------------------------------------------------------------------
+
+const void LsmIndex::deleteEntry(const void* key, const RecordId rid)
+{
+	addEntry(*(int*)key, rid, LSMDELETE);
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::remove
+// -----------------------------------------------------------------------------
+
+void LsmIndex::remove(const std::string& indexName)
+{
+	std::vector<int> runIds;
+	{
+		BlobFile indexFile(indexName, false);
+		Page metaPage = indexFile.readPage(indexFile.getFirstPageNo());
+		LsmMetaInfo* meta = (LsmMetaInfo*)&metaPage;
+		runIds.assign(meta->runIdArray, meta->runIdArray + meta->runCount);
+	}
+	for(size_t i = 0; i < runIds.size(); i++) {
+		std::ostringstream nameStr;
+		nameStr << indexName << '.' << runIds[i];
+		File::remove(nameStr.str());
+	}
+	File::remove(indexName);
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::getRunCount
+// -----------------------------------------------------------------------------
+
+int LsmIndex::getRunCount() const
+{
+	return runs.size();
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::addEntry
+// -----------------------------------------------------------------------------
+
+void LsmIndex::addEntry(const int key, const RecordId rid, const int type)
+{
+	memtable[std::make_pair(key, std::make_pair(rid.page_number, rid.slot_number))] = type;
+	if(!scanExecuting && (int)memtable.size() >= LSMMEMTABLESIZE) {
+		flushMemtable();
+	}
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::flushMemtable
+// -----------------------------------------------------------------------------
+
+void LsmIndex::flushMemtable()
+{
+	if(memtable.empty()) {
+		return;
+	}
+	std::vector<LsmCursor> cursors(1);
+	cursors[0].run = -1;
+	cursors[0].page = 0;
+	cursors[0].pos = 0;
+	for(std::map<std::pair<int, std::pair<PageId, SlotId> >, int>::iterator it = memtable.begin(); it != memtable.end(); ++it) {
+		LsmEntry entry;
+		entry.key = it->first.first;
+		entry.rid.page_number = it->first.second.first;
+		entry.rid.slot_number = it->first.second.second;
+		entry.type = it->second;
+		cursors[0].entries.push_back(entry);
+	}
+	LsmRun* run = writeRun(cursors, 0, runs.empty(), memtable.size());
+	memtable.clear();
+	if(run != NULL) {
+		runs.insert(runs.begin(), run);
+	}
+
+	// runs are kept newest first, so the runs of a level are next to each other
+	for(int level = 0; ; level++) {
+		size_t first = 0;
+		while(first < runs.size() && runs[first]->level < level) {
+			first++;
+		}
+		size_t last = first;
+		while(last < runs.size() && runs[last]->level == level) {
+			last++;
+		}
+		if(first == runs.size()) {
+			break;
+		}
+		if((int)(last - first) >= LSMLEVELRUNS) {
+			mergeRuns(first, last, level + 1);
+		}
+	}
+	writeMeta();
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::mergeRuns
+// -----------------------------------------------------------------------------
+
+void LsmIndex::mergeRuns(const size_t first, const size_t last, const int level)
+{
+	std::vector<LsmCursor> cursors(last - first);
+	int maxEntries = 0;
+	for(size_t i = first; i < last; i++) {
+		cursors[i-first].run = i;
+		seekRun(cursors[i-first], INT_MIN);
+		maxEntries += runs[i]->entryCount;
+	}
+
+	// with no older run left, a tombstone has nothing more to delete
+	LsmRun* run = writeRun(cursors, level, last == runs.size(), maxEntries);
+	for(size_t i = first; i < last; i++) {
+		removeRun(runs[i]);
+	}
+	runs.erase(runs.begin() + first, runs.begin() + last);
+	if(run != NULL) {
+		runs.insert(runs.begin() + first, run);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::writeRun
+// -----------------------------------------------------------------------------
+
+LsmRun* LsmIndex::writeRun(std::vector<LsmCursor>& cursors, const int level, const bool dropDeletes, const int maxEntries)
+{
+	LsmRun* run = new LsmRun;
+	run->runId = nextRunId++;
+	run->level = level;
+	run->entryCount = 0;
+	run->file = new BlobFile(runFileName(run->runId), true);
+	run->bloom.assign((std::max(maxEntries, 1) * LSMBLOOMBITSPERKEY + 7) / 8, 0);
+	int bitCount = run->bloom.size() * 8;
+
+	PageId headerPageNo;
+	Page* page;
+	bufMgr->allocPage(run->file, headerPageNo, page);
+	bufMgr->unPinPage(run->file, headerPageNo, false);
+
+	// data pages are filled one after the other, each one gets a fence
+	PageId dataPageNo = 0;
+	LsmDataPage* dataPage = NULL;
+	LsmEntry entry;
+	while(nextMerged(cursors, entry)) {
+		if(dropDeletes && entry.type == LSMDELETE) {
+			continue;
+		}
+		if(dataPage != NULL && dataPage->count == LSMPAGESIZE) {
+			bufMgr->unPinPage(run->file, dataPageNo, true);
+			dataPage = NULL;
+		}
+		if(dataPage == NULL) {
+			bufMgr->allocPage(run->file, dataPageNo, page);
+			dataPage = (LsmDataPage*)page;
+			dataPage->count = 0;
+			run->fenceKeys.push_back(entry.key);
+			run->fencePageNos.push_back(dataPageNo);
+		}
+		dataPage->entries[dataPage->count++] = entry;
+		run->entryCount++;
+		for(int i = 0; i < LSMBLOOMHASHES; i++) {
+			int bit = bloomBit(entry.key, i, bitCount);
+			run->bloom[bit / 8] |= 1 << (bit % 8);
+		}
+	}
+	if(dataPage != NULL) {
+		bufMgr->unPinPage(run->file, dataPageNo, true);
+	}
+	if(run->entryCount == 0) {
+		removeRun(run);
+		return NULL;
+	}
+
+	LsmRunHeader header;
+	header.entryCount = run->entryCount;
+	header.level = level;
+	header.dataPageCount = run->fenceKeys.size();
+	header.fencePageCount = 0;
+	for(size_t i = 0; i < run->fenceKeys.size(); i += LSMFENCEPAGESIZE) {
+		PageId pageNo;
+		bufMgr->allocPage(run->file, pageNo, page);
+		LsmFencePage* fencePage = (LsmFencePage*)page;
+		fencePage->count = std::min((size_t)LSMFENCEPAGESIZE, run->fenceKeys.size() - i);
+		std::copy(run->fenceKeys.begin() + i, run->fenceKeys.begin() + i + fencePage->count, fencePage->keyArray);
+		std::copy(run->fencePageNos.begin() + i, run->fencePageNos.begin() + i + fencePage->count, fencePage->pageNoArray);
+		bufMgr->unPinPage(run->file, pageNo, true);
+		if(header.fencePageCount++ == 0) {
+			header.fencePageNo = pageNo;
+		}
+	}
+	header.bloomPageCount = 0;
+	header.bloomBitCount = bitCount;
+	for(size_t i = 0; i < run->bloom.size(); i += Page::SIZE) {
+		PageId pageNo;
+		bufMgr->allocPage(run->file, pageNo, page);
+		size_t count = std::min((size_t)Page::SIZE, run->bloom.size() - i);
+		std::copy(run->bloom.begin() + i, run->bloom.begin() + i + count, (unsigned char*)page);
+		bufMgr->unPinPage(run->file, pageNo, true);
+		if(header.bloomPageCount++ == 0) {
+			header.bloomPageNo = pageNo;
+		}
+	}
+
+	bufMgr->readPage(run->file, headerPageNo, page);
+	*(LsmRunHeader*)page = header;
+	bufMgr->unPinPage(run->file, headerPageNo, true);
+	return run;
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::openRun
+// -----------------------------------------------------------------------------
+
+LsmRun* LsmIndex::openRun(const int runId, const int level)
+{
+	LsmRun* run = new LsmRun;
+	run->runId = runId;
+	run->level = level;
+	run->file = new BlobFile(runFileName(runId), false);
+
+	Page* page;
+	PageId headerPageNo = run->file->getFirstPageNo();
+	bufMgr->readPage(run->file, headerPageNo, page);
+	LsmRunHeader header = *(LsmRunHeader*)page;
+	bufMgr->unPinPage(run->file, headerPageNo, false);
+	run->entryCount = header.entryCount;
+
+	// fence and Bloom filter pages are allocated one after the other
+	for(int i = 0; i < header.fencePageCount; i++) {
+		bufMgr->readPage(run->file, header.fencePageNo + i, page);
+		LsmFencePage* fencePage = (LsmFencePage*)page;
+		run->fenceKeys.insert(run->fenceKeys.end(), fencePage->keyArray, fencePage->keyArray + fencePage->count);
+		run->fencePageNos.insert(run->fencePageNos.end(), fencePage->pageNoArray, fencePage->pageNoArray + fencePage->count);
+		bufMgr->unPinPage(run->file, header.fencePageNo + i, false);
+	}
+	run->bloom.resize(header.bloomBitCount / 8);
+	for(int i = 0; i < header.bloomPageCount; i++) {
+		bufMgr->readPage(run->file, header.bloomPageNo + i, page);
+		size_t count = std::min((size_t)Page::SIZE, run->bloom.size() - i * Page::SIZE);
+		std::copy((unsigned char*)page, (unsigned char*)page + count, run->bloom.begin() + i * Page::SIZE);
+		bufMgr->unPinPage(run->file, header.bloomPageNo + i, false);
+	}
+	return run;
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::removeRun
+// -----------------------------------------------------------------------------
+
+void LsmIndex::removeRun(LsmRun* run)
+{
+	// the pages of the run have to leave the buffer pool before the file goes
+	bufMgr->flushFile(run->file);
+	delete run->file;
+	File::remove(runFileName(run->runId));
+	delete run;
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::writeMeta
+// -----------------------------------------------------------------------------
+
+void LsmIndex::writeMeta()
+{
+	Page* metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	LsmMetaInfo* meta = (LsmMetaInfo*)metaPage;
+	meta->nextRunId = nextRunId;
+	meta->runCount = runs.size();
+	for(size_t i = 0; i < runs.size(); i++) {
+		meta->runIdArray[i] = runs[i]->runId;
+		meta->runLevelArray[i] = runs[i]->level;
+	}
+	bufMgr->unPinPage(file, headerPageNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::runFileName
+// -----------------------------------------------------------------------------
+
+std::string LsmIndex::runFileName(const int runId) const
+{
+	// LsmIndex::remove() names the files the same way
+	std::ostringstream nameStr;
+	nameStr << indexName << '.' << runId;
+	return nameStr.str();
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::seekRun
+// -----------------------------------------------------------------------------
+
+void LsmIndex::seekRun(LsmCursor& cursor, const int key)
+{
+	// the page before the first fence >= key may still end with key
+	const std::vector<int>& fences = runs[cursor.run]->fenceKeys;
+	int page = std::lower_bound(fences.begin(), fences.end(), key) - fences.begin();
+	cursor.page = std::max(page - 1, 0) - 1;
+	cursor.entries.clear();
+	cursor.pos = 0;
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::fillCursor
+// -----------------------------------------------------------------------------
+
+bool LsmIndex::fillCursor(LsmCursor& cursor)
+{
+	while(cursor.pos >= cursor.entries.size()) {
+		if(cursor.run < 0 || cursor.page + 1 >= (int)runs[cursor.run]->fencePageNos.size()) {
+			return false;
+		}
+		cursor.page++;
+		PageId pageNo = runs[cursor.run]->fencePageNos[cursor.page];
+		Page* page;
+		bufMgr->readPage(runs[cursor.run]->file, pageNo, page);
+		LsmDataPage* dataPage = (LsmDataPage*)page;
+		cursor.entries.assign(dataPage->entries, dataPage->entries + dataPage->count);
+		cursor.pos = 0;
+		bufMgr->unPinPage(runs[cursor.run]->file, pageNo, false);
+	}
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::nextMerged
+// -----------------------------------------------------------------------------
+
+bool LsmIndex::nextMerged(std::vector<LsmCursor>& cursors, LsmEntry& outEntry)
+{
+	// cursors are newest first, so on a tie the first one holds the latest entry
+	int best = -1;
+	for(size_t i = 0; i < cursors.size(); i++) {
+		if(fillCursor(cursors[i]) && (best < 0
+				|| entryLess(cursors[i].entries[cursors[i].pos], cursors[best].entries[cursors[best].pos]))) {
+			best = i;
+		}
+	}
+	if(best < 0) {
+		return false;
+	}
+	outEntry = cursors[best].entries[cursors[best].pos];
+	for(size_t i = 0; i < cursors.size(); i++) {
+		if(fillCursor(cursors[i]) && !entryLess(outEntry, cursors[i].entries[cursors[i].pos])) {
+			cursors[i].pos++;
+		}
+	}
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::startScan
+// -----------------------------------------------------------------------------
+
+const void LsmIndex::startScan(const void* lowValParm,
+				   const Operator lowOpParm,
+				   const void* highValParm,
+				   const Operator highOpParm)
+{
+	lowValInt = *(int *)lowValParm;
+	highValInt = *(int *)highValParm;
+	lowOp = lowOpParm;
+	highOp = highOpParm;
+	if(lowValInt > highValInt) {
+		throw BadScanrangeException();
+	}
+	if(lowOpParm != GTE && lowOpParm != GT) {
+		throw BadOpcodesException();
+	}
+	if(highOpParm != LTE && highOpParm != LT) {
+		throw BadOpcodesException();
+	}
+
+	// the memtable is copied, entries added during the scan are not returned
+	scanCursors.assign(1, LsmCursor());
+	scanCursors[0].run = -1;
+	scanCursors[0].page = 0;
+	scanCursors[0].pos = 0;
+	std::map<std::pair<int, std::pair<PageId, SlotId> >, int>::iterator it =
+		memtable.lower_bound(std::make_pair(lowValInt, std::make_pair((PageId)0, (SlotId)0)));
+	for(; it != memtable.end() && it->first.first <= highValInt; ++it) {
+		LsmEntry entry;
+		entry.key = it->first.first;
+		entry.rid.page_number = it->first.second.first;
+		entry.rid.slot_number = it->first.second.second;
+		entry.type = it->second;
+		scanCursors[0].entries.push_back(entry);
+	}
+
+	// only read runs whose fences overlap the range, and for a single key whose Bloom filter may have it
+	long long low = (long long)lowValInt + (lowOp == GT ? 1 : 0);
+	long long high = (long long)highValInt - (highOp == LT ? 1 : 0);
+	for(size_t i = 0; i < runs.size(); i++) {
+		if(runs[i]->fenceKeys.empty() || runs[i]->fenceKeys[0] > high) {
+			continue;
+		}
+		if(low == high && !bloomContains(runs[i], (int)low)) {
+			continue;
+		}
+		LsmCursor cursor;
+		cursor.run = i;
+		seekRun(cursor, lowValInt);
+		scanCursors.push_back(cursor);
+	}
+
+	scanExecuting = true;
+	scanCompleted = false;
+	if(!findNextEntry()) {
+		scanExecuting = false;
+		scanCursors.clear();
+		throw NoSuchKeyFoundException();
+	}
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::findNextEntry
+// -----------------------------------------------------------------------------
+
+bool LsmIndex::findNextEntry()
+{
+	while(nextMerged(scanCursors, nextEntry)) {
+		if(nextEntry.key < lowValInt || (lowOp == GT && nextEntry.key == lowValInt)) {
+			continue;
+		}
+		if((highOp == LT && nextEntry.key >= highValInt) || (highOp == LTE && nextEntry.key > highValInt)) {
+			return false;
+		}
+		if(nextEntry.type == LSMINSERT) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::scanNext
+// -----------------------------------------------------------------------------
+
+const void LsmIndex::scanNext(RecordId& outRid)
+{
+	if(!scanExecuting) {
+		throw ScanNotInitializedException();
+	}
+	if(scanCompleted) {
+		throw IndexScanCompletedException();
+	}
+	outRid = nextEntry.rid;
+	scanCompleted = !findNextEntry();
+}
+
+// -----------------------------------------------------------------------------
+// LsmIndex::endScan
+// -----------------------------------------------------------------------------
+
+const void LsmIndex::endScan()
+{
+	if(!scanExecuting) {
+		throw ScanNotInitializedException();
+	}
+	scanExecuting = false;
+	scanCursors.clear();
+	if((int)memtable.size() >= LSMMEMTABLESIZE) {
+		flushMemtable();
+	}
+}
+
+}
@@ -0,0 +1,386 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of entries the memtable takes before it is written out as a run.
+ */
+const  int LSMMEMTABLESIZE = 4096;
+
+/**
+ * @brief Number of runs a level takes before they are merged into one run of the next level.
+ */
+const  int LSMLEVELRUNS = 4;
+
+/**
+ * @brief Most runs an LSM index can have at a time.
+ */
+const  int LSMMAXRUNS = 64;
+
+/**
+ * @brief Bits of Bloom filter per run entry, and number of bits set per key.
+ */
+const  int LSMBLOOMBITSPERKEY = 10;
+const  int LSMBLOOMHASHES = 7;
+
+/**
+ * @brief Kinds of entry in the memtable and in runs. A delete is kept as a tombstone until it has been
+ * merged with every older run.
+ */
+enum LsmEntryType
+{
+	LSMINSERT = 0,
+	LSMDELETE = 1
+};
+
+/**
+ * @brief An entry of a run, in <key,rid> order.
+ */
+struct LsmEntry{
+	int key;
+	RecordId rid;
+	int type;
+};
+
+/**
+ * @brief Number of entries in a data page of a run.
+ */
+//                                          entry count
+const  int LSMPAGESIZE = ( Page::SIZE - sizeof( int ) ) / sizeof( LsmEntry );
+
+/**
+ * @brief Number of fence pointers in a fence page of a run.
+ */
+const  int LSMFENCEPAGESIZE = ( Page::SIZE - sizeof( int ) ) / ( sizeof( int ) + sizeof( PageId ) );
+
+/**
+ * @brief A data page of a run.
+ */
+struct LsmDataPage{
+	int count;
+	LsmEntry entries[ LSMPAGESIZE ];
+};
+
+/**
+ * @brief A page of fence pointers: the smallest key of every data page of a run.
+ */
+struct LsmFencePage{
+	int count;
+	int keyArray[ LSMFENCEPAGESIZE ];
+	PageId pageNoArray[ LSMFENCEPAGESIZE ];
+};
+
+/**
+ * @brief First page of a run file. Data pages come next, then the fence pages, then the Bloom filter pages.
+ */
+struct LsmRunHeader{
+	int entryCount;
+	int level;
+	int dataPageCount;
+	PageId fencePageNo;
+	int fencePageCount;
+	PageId bloomPageNo;
+	int bloomPageCount;
+	int bloomBitCount;
+};
+
+/**
+ * @brief A run while its file is open. Fences and the Bloom filter are kept in memory.
+ */
+struct LsmRun{
+	int runId;
+	int level;
+	int entryCount;
+	File* file;
+	std::vector<int> fenceKeys;
+	std::vector<PageId> fencePageNos;
+	std::vector<unsigned char> bloom;
+};
+
+/**
+ * @brief Position in the memtable snapshot or in a run during a scan or a merge.
+ */
+struct LsmCursor{
+  /**
+   * Index of the run in runs, -1 for the memtable snapshot.
+   */
+	int run;
+
+  /**
+   * Index of the data page of the run held in entries.
+   */
+	int page;
+
+  /**
+   * Entries of the current data page, or the memtable snapshot.
+   */
+	std::vector<LsmEntry> entries;
+
+  /**
+   * Index of the current entry in entries.
+   */
+	size_t pos;
+};
+
+/**
+ * @brief The meta page of an LSM index: the runs, newest first.
+ */
+struct LsmMetaInfo{
+	char relationName[20];
+	int attrByteOffset;
+	Datatype attrType;
+	int nextRunId;
+	int runCount;
+	int runIdArray[ LSMMAXRUNS ];
+	int runLevelArray[ LSMMAXRUNS ];
+};
+
+
+/**
+ * @brief Log structured merge index on an INTEGER attribute.
+ *
+ * Inserts and deletes go into an in-memory memtable. A full memtable is written out as a sorted run, an
+ * immutable file of data pages with fence pointers to the first key of each page and a Bloom filter over its
+ * keys. When a level has LSMLEVELRUNS runs they are merged into one run of the next level. Scans merge the
+ * memtable and every run, the newest entry for a <key,rid> wins.
+ *
+ * startScan(), scanNext() and endScan() are called like those of BTreeIndex. Compactions run inside the
+ * insertEntry() or deleteEntry() call that fills the memtable. While a scan is executing the memtable is not
+ * written out, it grows past LSMMEMTABLESIZE until endScan().
+*/
+class LsmIndex {
+
+ private:
+
+  /**
+   * File holding the meta page.
+   */
+	File		*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * Name of the index file, run files are named after it.
+   */
+	std::string indexName;
+
+  /**
+   * Byte offset of attribute in the record.
+   */
+	int			attrByteOffset;
+
+  /**
+   * Id for the next run file.
+   */
+	int			nextRunId;
+
+  /**
+   * Entries not yet written to a run, the latest insert or delete of each <key,rid>.
+   */
+	std::map<std::pair<int, std::pair<PageId, SlotId> >, int> memtable;
+
+  /**
+   * Open runs, newest first.
+   */
+	std::vector<LsmRun*> runs;
+
+	// MEMBERS SPECIFIC TO SCANNING
+
+  /**
+   * True if an index scan has been started.
+   */
+	bool		scanExecuting;
+
+  /**
+   * A cursor for the memtable and each run the scan reads.
+   */
+	std::vector<LsmCursor> scanCursors;
+
+  /**
+   * Next entry the scan returns, found ahead so that startScan() can tell if there is one.
+   */
+	LsmEntry	nextEntry;
+
+  /**
+   * True once nextEntry is past the end of the scan.
+   */
+	bool		scanCompleted;
+
+  /**
+   * Low INTEGER value for scan.
+   */
+	int			lowValInt;
+
+  /**
+   * High INTEGER value for scan.
+   */
+	int			highValInt;
+
+  /**
+   * Low Operator. Can only be GT(>) or GTE(>=).
+   */
+	Operator	lowOp;
+
+  /**
+   * High Operator. Can only be LT(<) or LTE(<=).
+   */
+	Operator	highOp;
+
+  /**
+	 * Add an entry to the memtable, writing the memtable out if it is full.
+	**/
+	void addEntry(const int key, const RecordId rid, const int type);
+
+  /**
+	 * Write the memtable out as a new level 0 run and compact the levels that are full.
+	**/
+	void flushMemtable();
+
+  /**
+	 * Merge the runs [first, last) of runs into one run of level. Tombstones are dropped if no older run is left.
+	**/
+	void mergeRuns(const size_t first, const size_t last, const int level);
+
+  /**
+	 * Write the entries a cursor set produces into a new run file.
+	 * @param dropDeletes	Leave tombstones out
+	 * @return the new run, or NULL if no entries were left
+	**/
+	LsmRun* writeRun(std::vector<LsmCursor>& cursors, const int level, const bool dropDeletes, const int maxEntries);
+
+  /**
+	 * Open the file of run runId and load its fences and Bloom filter.
+	**/
+	LsmRun* openRun(const int runId, const int level);
+
+  /**
+	 * Close and remove the file of a run.
+	**/
+	void removeRun(LsmRun* run);
+
+  /**
+	 * Write the run list to the meta page.
+	**/
+	void writeMeta();
+
+  /**
+	 * @return name of the file of run runId
+	**/
+	std::string runFileName(const int runId) const;
+
+  /**
+	 * Position a cursor on run at the first entry that may have a key >= key, using the fences.
+	**/
+	void seekRun(LsmCursor& cursor, const int key);
+
+  /**
+	 * Load the next data page into a cursor if it is past the end of its entries.
+	 * @return false if the cursor is exhausted
+	**/
+	bool fillCursor(LsmCursor& cursor);
+
+  /**
+	 * Take the smallest <key,rid> of a cursor set, skipping the older entries for it.
+	 * @return false if every cursor is exhausted
+	**/
+	bool nextMerged(std::vector<LsmCursor>& cursors, LsmEntry& outEntry);
+
+  /**
+	 * Move nextEntry on to the next live entry in the scan range.
+	 * @return false if there is none
+	**/
+	bool findNextEntry();
+
+ public:
+
+  /**
+	 * Open the LSM index on attrByteOffset of relationName, or create it and insert an entry for every record
+	 * if there is none yet.
+   * @param relationName	Name of file
+   * @param outIndexName	Return the name of index file
+   * @param bufMgrIn			Buffer Manager Instance
+   * @param attrByteOffset	Offset of attribute, over which index is to be built, in the record
+   * @param attrType			Datatype of attribute over which index is built, INTEGER only
+	 * @throws  BadIndexInfoException If an existing index file does not match attrByteOffset and attrType.
+	**/
+	LsmIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn, const int attrByteOffset, const Datatype attrType);
+
+  /**
+	 * Destructor. Writes out the memtable and closes the runs.
+	**/
+	~LsmIndex();
+
+  /**
+	 * Insert a new entry using the pair <value,rid>.
+   * @param key			Key to insert, pointer to integer
+   * @param rid			Record ID of a record whose entry is getting inserted into the index.
+	**/
+	const void insertEntry(const void* key, const RecordId rid);
+
+  /**
+	 * Delete the entry <key,rid> by adding a tombstone. Deleting an entry that is not in the index has no effect.
+	**/
+	const void deleteEntry(const void* key, const RecordId rid);
+
+  /**
+	 * Remove an LSM index file and the files of its runs. The index must not be open.
+	 * @param indexName	Name of the index file
+	**/
+	static void remove(const std::string& indexName);
+
+  /**
+	 * @return number of runs
+	**/
+	int getRunCount() const;
+
+  /**
+	 * Begin a filtered scan of the index, like BTreeIndex::startScan(). Runs whose fences lie outside the
+	 * range are not read, and for a range of a single key neither are runs whose Bloom filter rules it out.
+	 * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+	 * @throws  BadScanrangeException If lowVal > highval
+	 * @throws  NoSuchKeyFoundException If there is no key in the index that satisfies the scan criteria.
+	**/
+	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+  /**
+	 * Fetch the record id of the next index entry that matches the scan.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	**/
+	const void scanNext(RecordId& outRid);
+
+  /**
+	 * Terminate the current scan, and write out the memtable if it filled up during the scan.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	const void endScan();
+};
+
+}
@@ -6,7 +6,25 @@
  */
 
 #include <vector>
+#include <ctime>
+#include <cmath>
+#include <climits>
 #include "btree.h"
+#include "stringnode.h"
+#include "compositeindex.h"
+#include "betree.h"
+#include "lsmindex.h"
+#include "hashindex.h"
+#include "bitmapindex.h"
+#include "bitmapheapscan.h"
+#include "operators.h"
+#include "vectorized.h"
+#include "hashjoin.h"
+#include "externalsort.h"
+#include "hashaggregate.h"
+#include "hyperloglog.h"
+#include "morsel.h"
+#include "planner.h"
 #include "page.h"
 #include "filescan.h"
 #include "page_iterator.h"
@@ -19,6 +37,12 @@
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/invalid_record_exception.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/no_such_column_exception.h"
+#include "exceptions/unsupported_aggregate_exception.h"
+#include "exceptions/sql_syntax_exception.h"
+#include "exceptions/unsupported_query_exception.h"
 
 #define checkPassFail(a, b) 																				\
 {																																		\
@@ -43,7 +67,9 @@ int testNum = 1;
 const std::string relationName = "relA";
 //If the relation size is changed then the second parameter 2 chechPassFail may need to be changed to number of record that are expected to be found during the scan, else tests will erroneously be reported to have failed.
 const int	relationSize = 5000;
-std::string intIndexName, doubleIndexName, stringIndexName;
+// Number of tuples in the relation the current test created: relationSize, or a million for test 4.
+int relationTuples = relationSize;
+std::string intIndexName, doubleIndexName, stringIndexName, compositeIndexName, beIndexName, lsmIndexName, hashIndexName, bitmapIndexName;
 
 // This is the structure for tuples in the base relation
 
@@ -70,12 +96,39 @@ void createRelationRandom();
 void createRelationMassive();
 void intTests();
 int intScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+int intBatchScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+int intDescScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, int maxResults, int &firstKey);
+int intCount(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+int intDelete(BTreeIndex *index, int lowVal, int highVal, bool lazy, std::vector<RIDKeyPair<int> > &removed);
+void compositeTests();
+int compositePrefixScan(CompositeIndex *index, const std::string &prefix);
+void beTreeTests();
+void lsmTests();
+void hashTests();
+void bitmapTests();
+void heapScanTests();
+Schema tupleSchema();
+int countTuples(QueryOperator *op);
+void operatorTests();
+void vectorTests();
+void hashJoinTests();
+void externalSortTests();
+void hashAggregateTests();
+void distinctCountTests();
+void parallelAggregateTests();
+void sqlTests();
+void engineBenchmark();
+template <class Index> int engineRun(const std::string &engine, std::string &indexName);
+template <class Index> int engineInsertRun(const std::string &engine, std::string &indexName, const int inserts);
+template <class Index, class Key> int engineScan(Index *index, const Key &lowVal, Operator lowOp, const Key &highVal, Operator highOp);
+template <class Index, class Start> int countScan(Index *index, Start start);
 void indexTests();
 void test1();
 void test2();
 void test3();
 void test4();
 void errorTests();
+void stringNodeTests();
 void deleteRelation();
 
 int main(int argc, char **argv)
@@ -139,6 +192,7 @@ int main(int argc, char **argv)
 
 	File::remove(relationName);
 
+	stringNodeTests();
 	test1();
 	test2();
 	test3();
@@ -209,6 +263,7 @@ void createRelationForward()
 	}
 
   file1 = new PageFile(relationName, true);
+  relationTuples = relationSize;
 
   // initialize all of record1.s to keep purify happy
   memset(record1.s, ' ', sizeof(record1.s));
@@ -256,6 +311,7 @@ void createRelationBackward()
 	{
 	}
   file1 = new PageFile(relationName, true);
+  relationTuples = relationSize;
 
   // initialize all of record1.s to keep purify happy
   memset(record1.s, ' ', sizeof(record1.s));
@@ -304,6 +360,7 @@ void createRelationRandom()
 	{
 	}
   file1 = new PageFile(relationName, true);
+  relationTuples = relationSize;
 
   // initialize all of record1.s to keep purify happy
   memset(record1.s, ' ', sizeof(record1.s));
@@ -371,6 +428,7 @@ void createRelationMassive()
 	}
 
   file1 = new PageFile(relationName, true);
+  relationTuples = 1000000;
 
   // initialize all of record1.s to keep purify happy
   memset(record1.s, ' ', sizeof(record1.s));
@@ -378,7 +436,7 @@ void createRelationMassive()
   Page new_page = file1->allocatePage(new_page_number);
 
   // Insert One Million tuples into the relation.
-  for(int i = 0; i < 1000000; i++ )
+  for(int i = 0; i < relationTuples; i++ )
 	{
     sprintf(record1.s, "%05d string record", i);
     record1.i = i;
@@ -419,7 +477,22 @@ void indexTests()
   	catch(FileNotFoundException e)
   	{
   	}
+    compositeTests();
+    beTreeTests();
+    lsmTests();
+    hashTests();
+    bitmapTests();
+    heapScanTests();
+    operatorTests();
+    vectorTests();
+    hashJoinTests();
+    externalSortTests();
+    hashAggregateTests();
+    distinctCountTests();
+    parallelAggregateTests();
+    sqlTests();
   }
+  engineBenchmark();
 }
 
 // -----------------------------------------------------------------------------
@@ -439,6 +512,124 @@ void intTests()
 	checkPassFail(intScan(&index,0,GT,1,LT), 0)
 	checkPassFail(intScan(&index,300,GT,400,LT), 99)
 	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+
+	// same ranges through the batched interface
+	checkPassFail(intBatchScan(&index,25,GT,40,LT), 14)
+	checkPassFail(intBatchScan(&index,-3,GT,3,LT), 3)
+	checkPassFail(intBatchScan(&index,300,GT,400,LT), 99)
+	checkPassFail(intBatchScan(&index,3000,GTE,4000,LT), 1000)
+
+	// counts come from the non-leaves, without a scan
+	checkPassFail(intCount(&index,25,GT,40,LT), 14)
+	checkPassFail(intCount(&index,-3,GT,3,LT), 3)
+	checkPassFail(intCount(&index,0,GT,1,LT), 0)
+	checkPassFail(intCount(&index,3000,GTE,4000,LT), 1000)
+	checkPassFail(intCount(&index,0,GTE,relationTuples,LT), relationTuples)
+
+	// descending scans, stopping early answers top-N and "largest key below x"
+	int firstKey;
+	checkPassFail(intDescScan(&index,25,GT,40,LT,relationTuples,firstKey), 14)
+	checkPassFail(firstKey, 39)
+	checkPassFail(intDescScan(&index,-3,GT,3,LT,relationTuples,firstKey), 3)
+	checkPassFail(intDescScan(&index,0,GTE,1000,LT,1,firstKey), 1)
+	checkPassFail(firstKey, 999)
+	checkPassFail(intDescScan(&index,0,GTE,relationTuples,LT,5,firstKey), 5)
+	checkPassFail(firstKey, relationTuples-1)
+
+	// delete a range spanning several leaves, its neighbours have to stay
+	std::vector<RIDKeyPair<int> > removed;
+	checkPassFail(intDelete(&index,1000,2999,false,removed), 2000)
+	checkPassFail(intScan(&index,996,GT,3005,LT), 8)
+	checkPassFail(intDescScan(&index,0,GTE,2500,LTE,1,firstKey), 1)
+	checkPassFail(firstKey, 999)
+	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+
+	// lazily deleted entries are hidden from scans before and after they are reclaimed
+	checkPassFail(intDelete(&index,200,299,true,removed), 100)
+	checkPassFail(intScan(&index,150,GTE,350,LT), 100)
+	checkPassFail(intBatchScan(&index,150,GTE,350,LT), 100)
+	checkPassFail(intCount(&index,150,GTE,350,LT), 100)
+	checkPassFail(index.reclaimDeadEntries(), 100)
+	checkPassFail(index.reclaimDeadEntries(), 0)
+	checkPassFail(intScan(&index,150,GTE,350,LT), 100)
+
+	// empty the low end and fill it up again from the free page list
+	removed.clear();
+	checkPassFail(intDelete(&index,0,relationTuples-1,false,removed), relationTuples-2100)
+	checkPassFail(intScan(&index,0,GTE,relationTuples,LT), 0)
+	for(size_t i = 0; i < removed.size(); i++)
+	{
+		index.insertEntry(&removed[i].key, removed[i].rid);
+	}
+	checkPassFail(intScan(&index,25,GT,40,LT), 14)
+	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+
+	// delete a block and load it back as one batch, in reverse so it has to be sorted first
+	removed.clear();
+	checkPassFail(intDelete(&index,4000,4999,false,removed), 1000)
+	std::vector<int> batchKeys;
+	std::vector<RecordId> batchRids;
+	for(size_t i = removed.size(); i > 0; i--)
+	{
+		batchKeys.push_back(removed[i-1].key);
+		batchRids.push_back(removed[i-1].rid);
+	}
+	index.insertBatch(&batchKeys[0], &batchRids[0], batchKeys.size());
+	checkPassFail(intScan(&index,4000,GTE,5000,LT), 1000)
+	checkPassFail(intBatchScan(&index,3990,GTE,4010,LT), 20)
+	checkPassFail(intDescScan(&index,0,GTE,relationTuples,LT,relationTuples,firstKey), relationTuples-2100)
+	checkPassFail(intCount(&index,0,GTE,relationTuples,LT), relationTuples-2100)
+
+	// rank and select are inverse, 0-199 and 300-999 and 3000-3999 are below 4000
+	int key = 4000;
+	int selectedKey;
+	RecordId rid;
+	checkPassFail(index.rank(&key), 1900)
+	checkPassFail(index.select(1900, &selectedKey, rid), true)
+	checkPassFail(selectedKey, 4000)
+
+	// the last entry has the largest key, there is none past it
+	int entries = intCount(&index,INT_MIN,GTE,INT_MAX,LTE);
+	int lastKey;
+	checkPassFail(intDescScan(&index,INT_MIN,GTE,INT_MAX,LTE,1,lastKey), 1)
+	checkPassFail(index.select(entries-1, &selectedKey, rid), true)
+	checkPassFail(selectedKey, lastKey)
+	checkPassFail(index.select(entries, &selectedKey, rid), false)
+
+	// point lookups, a duplicate key has to be reported once per entry
+	key = 4321;
+	checkPassFail(index.lookup(&key, rid), true)
+	index.insertEntry(&key, rid);
+	int matches = 0;
+	checkPassFail(index.lookupAll(&key, [&](const RecordId& r) { if(r == rid) matches++; }), 2)
+	checkPassFail(matches, 2)
+	key = -1;
+	checkPassFail(index.lookup(&key, rid), false)
+	checkPassFail(index.lookupAll(&key, [](const RecordId&) {}), 0)
+	key = INT_MAX;
+	checkPassFail(index.lookup(&key, rid), false)
+
+	// a long run of one key is packed into a posting list, deletes take record ids out of it
+	key = -5;
+	for(size_t i = 0; i < removed.size(); i++)
+	{
+		index.insertEntry(&key, removed[i].rid);
+	}
+	checkPassFail(index.lookupAll(&key, [](const RecordId&) {}), 1000)
+	checkPassFail(intCount(&index,-10,GT,0,LT), 1000)
+	checkPassFail(intScan(&index,-10,GT,0,LT), 1000)
+	for(size_t i = 0; i < removed.size() - 1; i++)
+	{
+		if(i < 500)
+			index.deleteEntryLazy(&key, removed[i].rid);
+		else
+			index.deleteEntry(&key, removed[i].rid);
+	}
+	checkPassFail(intCount(&index,-10,GT,0,LT), 1)
+	index.deleteEntryLazy(&key, removed.back().rid);
+	checkPassFail(index.lookup(&key, rid), false)
+	checkPassFail(index.reclaimDeadEntries(), 1)
+	checkPassFail(intCount(&index,-10,GT,10,LT), 10)
 }
 
 int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
@@ -501,6 +692,1487 @@ int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operato
 	return numResults;
 }
 
+int intBatchScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+{
+	// smaller than a leaf so that a leaf takes more than one call
+	const size_t batchSize = 64;
+  RecordId scanRids[batchSize];
+	Page *curPage;
+
+  std::cout << "Batch scan for ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
+
+  int numResults = 0;
+
+	try
+	{
+  	index->startScan(&lowVal, lowOp, &highVal, highOp);
+	}
+	catch(const NoSuchKeyFoundException& e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	size_t got;
+	while((got = index->scanNextBatch(scanRids, batchSize)) > 0)
+	{
+		for(size_t i = 0; i < got; i++)
+		{
+			bufMgr->readPage(file1, scanRids[i].page_number, curPage);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRids[i]).data()));
+			bufMgr->unPinPage(file1, scanRids[i].page_number, false);
+
+			// every rid handed back has to be inside the range
+			if( (lowOp == GT && myRec.i <= lowVal) || (lowOp == GTE && myRec.i < lowVal) ||
+					(highOp == LT && myRec.i >= highVal) || (highOp == LTE && myRec.i > highVal) )
+			{
+				std::cout << "Out of range key:" << myRec.i << std::endl;
+				index->endScan();
+				return -1;
+			}
+			numResults++;
+		}
+	}
+
+  std::cout << "Number of results: " << numResults << std::endl;
+  index->endScan();
+  std::cout << std::endl;
+
+	return numResults;
+}
+int intDescScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp, int maxResults, int &firstKey)
+{
+  RecordId scanRid;
+	Page *curPage;
+
+  std::cout << "Descending scan for ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << " limit " << maxResults << std::endl;
+
+  int numResults = 0;
+	int prevKey = 0;
+
+	try
+	{
+  	index->startScan(&lowVal, lowOp, &highVal, highOp, true);
+	}
+	catch(const NoSuchKeyFoundException& e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	while(numResults < maxResults)
+	{
+		try
+		{
+			index->scanNext(scanRid);
+		}
+		catch(const IndexScanCompletedException& e)
+		{
+			break;
+		}
+		bufMgr->readPage(file1, scanRid.page_number, curPage);
+		RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+		bufMgr->unPinPage(file1, scanRid.page_number, false);
+
+		// keys have to come back in range and in descending order
+		if( (lowOp == GT && myRec.i <= lowVal) || (lowOp == GTE && myRec.i < lowVal) ||
+				(highOp == LT && myRec.i >= highVal) || (highOp == LTE && myRec.i > highVal) ||
+				(numResults > 0 && myRec.i > prevKey) )
+		{
+			std::cout << "Out of order key:" << myRec.i << std::endl;
+			index->endScan();
+			return -1;
+		}
+		if( numResults == 0 )
+		{
+			firstKey = myRec.i;
+		}
+		prevKey = myRec.i;
+		numResults++;
+	}
+
+  std::cout << "Number of results: " << numResults << std::endl;
+  index->endScan();
+  std::cout << std::endl;
+
+	return numResults;
+}
+
+int intCount(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+{
+  std::cout << "Count for ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
+
+	int numResults = index->countRange(&lowVal, lowOp, &highVal, highOp);
+  std::cout << "Number of results: " << numResults << std::endl << std::endl;
+	return numResults;
+}
+
+int intDelete(BTreeIndex * index, int lowVal, int highVal, bool lazy, std::vector<RIDKeyPair<int> > &removed)
+{
+  RecordId scanRid;
+	Page *curPage;
+
+  std::cout << (lazy ? "Lazy delete of " : "Delete of ") << "[" << lowVal << "," << highVal << "]" << std::endl;
+
+	// collect the entries first, deleting under an open scan would end it
+	std::vector<RIDKeyPair<int> > entries;
+	try
+	{
+  	index->startScan(&lowVal, GTE, &highVal, LTE);
+		while(1)
+		{
+			index->scanNext(scanRid);
+			bufMgr->readPage(file1, scanRid.page_number, curPage);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+			bufMgr->unPinPage(file1, scanRid.page_number, false);
+
+			RIDKeyPair<int> entry;
+			entry.set(scanRid, myRec.i);
+			entries.push_back(entry);
+		}
+	}
+	catch(const NoSuchKeyFoundException& e)
+	{
+		return 0;
+	}
+	catch(const IndexScanCompletedException& e)
+	{
+		index->endScan();
+	}
+
+	for(size_t i = 0; i < entries.size(); i++)
+	{
+		if(lazy)
+			index->deleteEntryLazy(&entries[i].key, entries[i].rid);
+		else
+			index->deleteEntry(&entries[i].key, entries[i].rid);
+		removed.push_back(entries[i]);
+	}
+
+  std::cout << "Number of entries deleted: " << entries.size() << std::endl;
+  std::cout << std::endl;
+
+	return (int)entries.size();
+}
+
+// -----------------------------------------------------------------------------
+// compositeTests
+// -----------------------------------------------------------------------------
+
+void compositeTests()
+{
+	// encodings compare like the values they encode
+	int i1 = -1, i2 = 0, i3 = 1;
+	double d1 = -2.5, d2 = -1.0, d3 = 0.0, d4 = 3.5;
+	checkPassFail((encodeKeyPart(&i1, INTEGER) < encodeKeyPart(&i2, INTEGER)), true)
+	checkPassFail((encodeKeyPart(&i2, INTEGER) < encodeKeyPart(&i3, INTEGER)), true)
+	checkPassFail((encodeKeyPart(&d1, DOUBLE) < encodeKeyPart(&d2, DOUBLE)), true)
+	checkPassFail((encodeKeyPart(&d2, DOUBLE) < encodeKeyPart(&d3, DOUBLE)), true)
+	checkPassFail((encodeKeyPart(&d3, DOUBLE) < encodeKeyPart(&d4, DOUBLE)), true)
+	checkPassFail((encodeKeyPart("ab", STRING) < encodeKeyPart("abc", STRING)), true)
+
+	{
+		std::cout << "Create a composite index on the integer and double fields" << std::endl;
+		std::vector<KeyPart> parts(2);
+		parts[0].attrByteOffset = offsetof(tuple,i);
+		parts[0].attrType = INTEGER;
+		parts[1].attrByteOffset = offsetof(tuple,d);
+		parts[1].attrType = DOUBLE;
+		CompositeIndex index(relationName, compositeIndexName, bufMgr, parts);
+
+		// a range on the leading attribute takes in every value of the next one
+		int low = 100, high = 199;
+		checkPassFail(engineScan(&index, encodeKeyPart(&low, INTEGER), GTE, prefixUpperBound(encodeKeyPart(&high, INTEGER)), LT), 100)
+		checkPassFail(compositePrefixScan(&index, encodeKeyPart(&high, INTEGER)), 1)
+		double d = 199.0;
+		checkPassFail(compositePrefixScan(&index, encodeKeyPart(&high, INTEGER) + encodeKeyPart(&d, DOUBLE)), 1)
+		d = 198.0;
+		checkPassFail(compositePrefixScan(&index, encodeKeyPart(&high, INTEGER) + encodeKeyPart(&d, DOUBLE)), 0)
+		checkPassFail(compositePrefixScan(&index, ""), relationTuples)
+
+		// take one entry out again
+		RecordId found;
+		std::string key = encodeKeyPart(&high, INTEGER) + encodeKeyPart(&(d = 199.0), DOUBLE);
+		index.startPrefixScan(key);
+		index.scanNext(found);
+		index.endScan();
+		index.deleteEntry(key, found);
+		checkPassFail(engineScan(&index, encodeKeyPart(&low, INTEGER), GTE, prefixUpperBound(encodeKeyPart(&high, INTEGER)), LT), 99)
+	}
+	File::remove(compositeIndexName);
+
+	{
+		std::cout << "Create a composite index on the string and integer fields" << std::endl;
+		std::vector<KeyPart> parts(2);
+		parts[0].attrByteOffset = offsetof(tuple,s);
+		parts[0].attrType = STRING;
+		parts[1].attrByteOffset = offsetof(tuple,i);
+		parts[1].attrType = INTEGER;
+		CompositeIndex index(relationName, compositeIndexName, bufMgr, parts);
+
+		// a prefix of the leading string matches every string starting with it
+		checkPassFail(compositePrefixScan(&index, "0004"), 10)
+		checkPassFail(compositePrefixScan(&index, encodeKeyPart("00042 string record", STRING)), 1)
+		int ones = 0;
+		char digits[16];
+		for(int i = 0; i < relationTuples; i++)
+		{
+			sprintf(digits, "%05d", i);
+			ones += (digits[0] == '1');
+		}
+		checkPassFail(compositePrefixScan(&index, "1"), ones)
+	}
+	File::remove(compositeIndexName);
+}
+
+int compositePrefixScan(CompositeIndex * index, const std::string &prefix)
+{
+	return countScan(index, [&]() { index->startPrefixScan(prefix); });
+}
+
+// -----------------------------------------------------------------------------
+// beTreeTests
+// -----------------------------------------------------------------------------
+
+void beTreeTests()
+{
+	{
+		std::cout << "Create a Bε-tree index on the integer field" << std::endl;
+		BeTreeIndex index(relationName, beIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+		// most entries are still in the buffers, scans merge them in
+		checkPassFail(engineScan(&index,25,GT,40,LT), 14)
+		checkPassFail(engineScan(&index,20,GTE,35,LTE), 16)
+		checkPassFail(engineScan(&index,-3,GT,3,LT), 3)
+		checkPassFail(engineScan(&index,0,GT,1,LT), 0)
+		checkPassFail(engineScan(&index,3000,GTE,4000,LT), 1000)
+		checkPassFail(engineScan(&index,0,GTE,relationTuples,LT), relationTuples)
+
+		// deletes are buffered too
+		FileScan scan(relationName, bufMgr);
+		try
+		{
+			while(1)
+			{
+				RecordId scanRid;
+				scan.scanNext(scanRid);
+				std::string recordStr = scan.getRecord();
+				int key = ((RECORD*)recordStr.c_str())->i;
+				if(key >= 100 && key < 200)
+				{
+					index.deleteEntry(&key, scanRid);
+				}
+			}
+		}
+		catch(const EndOfFileException& e)
+		{
+		}
+		checkPassFail(engineScan(&index,50,GTE,250,LT), 100)
+		index.flushMessages();
+		checkPassFail(engineScan(&index,50,GTE,250,LT), 100)
+		checkPassFail(engineScan(&index,0,GTE,relationTuples,LT), relationTuples - 100)
+	}
+
+	{
+		// pending messages are kept in the index file
+		BeTreeIndex index(relationName, beIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(engineScan(&index,0,GTE,relationTuples,LT), relationTuples - 100)
+	}
+	File::remove(beIndexName);
+}
+
+// -----------------------------------------------------------------------------
+// lsmTests
+// -----------------------------------------------------------------------------
+
+void lsmTests()
+{
+	{
+		std::cout << "Create an LSM index on the integer field" << std::endl;
+		LsmIndex index(relationName, lsmIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+		// entries are split between a run and the memtable
+		checkPassFail((index.getRunCount() > 0), true)
+		checkPassFail(engineScan(&index,25,GT,40,LT), 14)
+		checkPassFail(engineScan(&index,20,GTE,35,LTE), 16)
+		checkPassFail(engineScan(&index,-3,GT,3,LT), 3)
+		checkPassFail(engineScan(&index,0,GT,1,LT), 0)
+		checkPassFail(engineScan(&index,42,GTE,42,LTE), 1)
+		checkPassFail(engineScan(&index,3000,GTE,4000,LT), 1000)
+		checkPassFail(engineScan(&index,0,GTE,relationTuples,LT), relationTuples)
+
+		// tombstones hide the entries in the runs
+		FileScan scan(relationName, bufMgr);
+		try
+		{
+			while(1)
+			{
+				RecordId scanRid;
+				scan.scanNext(scanRid);
+				std::string recordStr = scan.getRecord();
+				int key = ((RECORD*)recordStr.c_str())->i;
+				if(key >= 100 && key < 200)
+				{
+					index.deleteEntry(&key, scanRid);
+				}
+			}
+		}
+		catch(const EndOfFileException& e)
+		{
+		}
+		checkPassFail(engineScan(&index,50,GTE,250,LT), 100)
+		checkPassFail(engineScan(&index,150,GTE,150,LTE), 0)
+	}
+
+	{
+		// the memtable was written out when the index was closed
+		LsmIndex index(relationName, lsmIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(engineScan(&index,0,GTE,relationTuples,LT), relationTuples - 100)
+	}
+	LsmIndex::remove(lsmIndexName);
+}
+
+// -----------------------------------------------------------------------------
+// hashTests
+// -----------------------------------------------------------------------------
+
+void hashTests()
+{
+	std::vector<RIDKeyPair<int> > removed;
+	{
+		std::cout << "Create a hash index on the integer field" << std::endl;
+		HashIndex index(relationName, hashIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail((index.getGlobalDepth() > 0), true)
+
+		int found = 0;
+		for(int key = 0; key < relationTuples; key++)
+		{
+			RecordId lookupRid;
+			if(index.lookup(&key, lookupRid))
+			{
+				found++;
+			}
+			if(key >= 100 && key < 200)
+			{
+				RIDKeyPair<int> entry;
+				entry.set(lookupRid, key);
+				removed.push_back(entry);
+			}
+		}
+		checkPassFail(found, relationTuples)
+		int key = -1;
+		checkPassFail(index.lookup(&key, rid), false)
+
+		// duplicates of one key end up in an overflow chain
+		key = -5;
+		for(int i = 0; i < 2000; i++)
+		{
+			index.insertEntry(&key, removed[i % removed.size()].rid);
+		}
+		checkPassFail(index.lookupAll(&key, [](const RecordId&) {}), 2000)
+
+		for(size_t i = 0; i < removed.size(); i++)
+		{
+			index.deleteEntry(&removed[i].key, removed[i].rid);
+		}
+		key = 150;
+		checkPassFail(index.lookup(&key, rid), false)
+		checkPassFail(index.lookupAll(&key, [](const RecordId&) {}), 0)
+	}
+
+	{
+		HashIndex index(relationName, hashIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		int key = -5;
+		checkPassFail(index.lookupAll(&key, [](const RecordId&) {}), 2000)
+		key = 250;
+		checkPassFail(index.lookupAll(&key, [](const RecordId&) {}), 1)
+	}
+	File::remove(hashIndexName);
+}
+
+// -----------------------------------------------------------------------------
+// bitmapTests
+// -----------------------------------------------------------------------------
+
+void bitmapTests()
+{
+	int valueCount;
+	{
+		// 0..9999 is a bitmap container, the even values an array container
+		RoaringBitmap all, evens;
+		for(std::uint32_t value = 0; value < 10000; value++)
+		{
+			all.add(value);
+			if(value % 2 == 0)
+			{
+				evens.add(value);
+			}
+		}
+		evens.add(1 << 20);
+		checkPassFail((int)all.andWith(evens).cardinality(), 5000)
+		checkPassFail((int)all.orWith(evens).cardinality(), 10001)
+		checkPassFail((int)all.andNotWith(evens).cardinality(), 5000)
+		checkPassFail(all.andNotWith(evens).contains(7), true)
+		checkPassFail(all.andNotWith(evens).contains(8), false)
+		for(std::uint32_t value = 0; value < 6000; value++)
+		{
+			all.remove(value);
+		}
+		checkPassFail((int)all.cardinality(), 4000)
+		checkPassFail((int)all.andWith(evens).cardinality(), 2000)
+	}
+
+	{
+		// a page number past the high 16 bits of a value must not alias a lower page
+		RecordId rid;
+		rid.page_number = 0x10000;
+		rid.slot_number = 1;
+		bool thrown = false;
+		try
+		{
+			RoaringBitmap::ridValue(rid);
+		}
+		catch(const InvalidRecordException& e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+	}
+
+	{
+		std::cout << "Create a bitmap index on the integer field" << std::endl;
+		BitmapIndex index(relationName, bitmapIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		int key = 42;
+		checkPassFail((int)index.getBitmap(&key).cardinality(), 1)
+		key = -1;
+		checkPassFail((int)index.getBitmap(&key).cardinality(), 0)
+
+		RoaringBitmap small;
+		for(key = 0; key < 100; key++)
+		{
+			small = small.orWith(index.getBitmap(&key));
+		}
+		checkPassFail((int)small.cardinality(), 100)
+		checkPassFail((int)index.complement(small).cardinality(), (int)index.complement(RoaringBitmap()).cardinality() - 100)
+
+		// fetch only the pages holding the qualifying records
+		std::vector<RecordId> rids;
+		small.toRids(rids);
+		FileScan scan(relationName, bufMgr);
+		scan.restrictTo(rids);
+		int found = 0;
+		try
+		{
+			while(true)
+			{
+				scan.scanNext(rid);
+				std::string recordString = scan.getRecord();
+				if(((tuple*)recordString.c_str())->i < 100)
+				{
+					found++;
+				}
+			}
+		}
+		catch(const EndOfFileException& e)
+		{
+		}
+		checkPassFail(found, 100)
+
+		key = 42;
+		rids.clear();
+		index.getBitmap(&key).toRids(rids);
+		index.deleteEntry(&key, rids[0]);
+		valueCount = index.getValueCount();
+	}
+
+	{
+		BitmapIndex index(relationName, bitmapIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(index.getValueCount(), valueCount)
+		int key = 42;
+		checkPassFail((int)index.getBitmap(&key).cardinality(), 0)
+	}
+	File::remove(bitmapIndexName);
+}
+
+// -----------------------------------------------------------------------------
+// heapScanTests
+// -----------------------------------------------------------------------------
+
+void heapScanTests()
+{
+	{
+		std::cout << "Fetch the records of two index scans in page order" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		BitmapHeapScan heapScan(relationName, bufMgr);
+		int lowVal = 0, highVal = 2000;
+		heapScan.addIndexScan(&index, &lowVal, GTE, &highVal, LT);
+		checkPassFail((int)heapScan.getRidCount(), 2000)
+		lowVal = 1000;
+		highVal = 3000;
+		heapScan.addIndexScan(&index, &lowVal, GTE, &highVal, LT);
+		checkPassFail((int)heapScan.getRidCount(), 1000)
+
+		// each page is read at most once and the pages come in order
+		bufMgr->clearBufStats();
+		heapScan.startFetch();
+		int found = 0, pages = 0;
+		bool ordered = true;
+		PageId lastPageNo = 0;
+		try
+		{
+			while(true)
+			{
+				std::string recordString;
+				heapScan.fetchNext(rid, recordString);
+				int key = ((tuple*)recordString.c_str())->i;
+				if(key >= 1000 && key < 3000)
+				{
+					found++;
+				}
+				if(pages == 0 || rid.page_number != lastPageNo)
+				{
+					ordered = ordered && (pages == 0 || rid.page_number > lastPageNo);
+					lastPageNo = rid.page_number;
+					pages++;
+				}
+			}
+		}
+		catch(const EndOfFileException& e)
+		{
+		}
+		heapScan.endFetch();
+		checkPassFail(found, 1000)
+		checkPassFail(ordered, true)
+		checkPassFail(((int)bufMgr->getBufStats().diskreads <= pages), true)
+
+		lowVal = 4000;
+		highVal = 4100;
+		heapScan.addIndexScan(&index, &lowVal, GTE, &highVal, LT);
+		checkPassFail((int)heapScan.getRidCount(), 0)
+	}
+	File::remove(intIndexName);
+}
+
+// -----------------------------------------------------------------------------
+// tupleSchema
+// -----------------------------------------------------------------------------
+
+Schema tupleSchema()
+{
+	Schema schema;
+	schema.addColumnAt("i", INTEGER, offsetof(tuple,i), sizeof(int));
+	schema.addColumnAt("d", DOUBLE, offsetof(tuple,d), sizeof(double));
+	schema.addColumnAt("s", STRING, offsetof(tuple,s), sizeof(record1.s));
+	return schema;
+}
+
+// -----------------------------------------------------------------------------
+// countTuples
+// -----------------------------------------------------------------------------
+
+int countTuples(QueryOperator *op)
+{
+	int count = 0;
+	TupleRef row;
+	op->open();
+	while(op->next(row))
+	{
+		count++;
+	}
+	op->close();
+	return count;
+}
+
+// -----------------------------------------------------------------------------
+// operatorTests
+// -----------------------------------------------------------------------------
+
+void operatorTests()
+{
+	Schema schema = tupleSchema();
+	TupleRef row;
+	TuplePredicate below100 = [schema](const char* t) { return schema.getInt(t, 0) < 100; };
+	{
+		std::cout << "Run query plans of operators" << std::endl;
+		ScanOperator scan(relationName, bufMgr, schema);
+		checkPassFail(countTuples(&scan), relationTuples)
+		FilterOperator filter(new ScanOperator(relationName, bufMgr, schema), below100);
+		checkPassFail(countTuples(&filter), 100)
+	}
+
+	{
+		// SELECT COUNT(*), SUM(2 * d), MAX(i) FROM relA WHERE i < 100
+		ProjectOperator* project = new ProjectOperator(new FilterOperator(new ScanOperator(relationName, bufMgr, schema), below100),
+				std::vector<std::string>(1, "i"));
+		project->addColumn("twice", DOUBLE, 0, [](const char* t, char* out) {
+			double value = 2 * ((tuple*)t)->d;
+			memcpy(out, &value, sizeof(double));
+		});
+		std::vector<AggregateSpec> aggregates(3);
+		aggregates[0].function = AGGCOUNT;
+		aggregates[0].name = "count";
+		aggregates[1].function = AGGSUM;
+		aggregates[1].column = "twice";
+		aggregates[1].name = "sum";
+		aggregates[2].function = AGGMAX;
+		aggregates[2].column = "i";
+		aggregates[2].name = "max";
+		AggregateOperator aggregate(project, std::vector<std::string>(), aggregates);
+		aggregate.open();
+		checkPassFail(aggregate.next(row), true)
+		checkPassFail(aggregate.getSchema().getInt(row.data, 0), 100)
+		checkPassFail(aggregate.getSchema().getDouble(row.data, 1), 9900.0)
+		checkPassFail(aggregate.getSchema().getDouble(row.data, 2), 99.0)
+		checkPassFail(aggregate.next(row), false)
+		aggregate.close();
+	}
+
+	{
+		// SELECT i % 10, COUNT(*) FROM relA GROUP BY i % 10
+		ProjectOperator* project = new ProjectOperator(new ScanOperator(relationName, bufMgr, schema), std::vector<std::string>());
+		project->addColumn("bucket", INTEGER, 0, [](const char* t, char* out) {
+			int value = ((tuple*)t)->i % 10;
+			memcpy(out, &value, sizeof(int));
+		});
+		std::vector<AggregateSpec> aggregates(1);
+		aggregates[0].function = AGGCOUNT;
+		aggregates[0].name = "count";
+		AggregateOperator aggregate(project, std::vector<std::string>(1, "bucket"), aggregates);
+		int groups = 0, total = 0;
+		aggregate.open();
+		while(aggregate.next(row))
+		{
+			groups++;
+			total += aggregate.getSchema().getInt(row.data, 1);
+		}
+		aggregate.close();
+		checkPassFail(groups, 10)
+		checkPassFail(total, relationTuples)
+	}
+
+	{
+		// SELECT * FROM relA A, relA B WHERE A.i = B.i AND A.i < 100 AND B.i < 20
+		TuplePredicate below20 = [schema](const char* t) { return schema.getInt(t, 0) < 20; };
+		JoinOperator join(new FilterOperator(new ScanOperator(relationName, bufMgr, schema), below100),
+				new FilterOperator(new ScanOperator(relationName, bufMgr, schema), below20), "i", "i");
+		checkPassFail(countTuples(&join), 20)
+		checkPassFail(join.getSchema().tupleLength, 2 * schema.tupleLength)
+
+		// SELECT i FROM relA ORDER BY i DESC LIMIT 3 OFFSET 1
+		std::vector<SortKey> keys(1);
+		keys[0].column = "i";
+		keys[0].descending = true;
+		LimitOperator limit(new SortOperator(new ScanOperator(relationName, bufMgr, schema), keys), 3, 1);
+		limit.open();
+		checkPassFail(limit.next(row), true)
+		checkPassFail(schema.getInt(row.data, 0), relationTuples - 2)
+		checkPassFail(countTuples(&limit), 3)
+
+		TopNOperator top(new ScanOperator(relationName, bufMgr, schema), keys, 3, 1);
+		top.open();
+		checkPassFail(top.next(row), true)
+		checkPassFail(schema.getInt(row.data, 0), relationTuples - 2)
+		checkPassFail(countTuples(&top), 3)
+	}
+
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		IndexScanOperator scan(relationName, bufMgr, schema, &index, 100, GTE, 200, LT);
+		int count = 0, lastKey = -1;
+		bool ordered = true;
+		scan.open();
+		while(scan.next(row))
+		{
+			ordered = ordered && schema.getInt(row.data, 0) > lastKey;
+			lastKey = schema.getInt(row.data, 0);
+			count++;
+		}
+		scan.close();
+		checkPassFail(count, 100)
+		checkPassFail(ordered, true)
+
+		// index nested loop joins, with a few left tuples and with the whole relation in several batches
+		TuplePredicate every3rd = [schema](const char* t) { return schema.getInt(t, 0) < 300 && schema.getInt(t, 0) % 3 == 0; };
+		IndexJoinOperator selective(new FilterOperator(new ScanOperator(relationName, bufMgr, schema), every3rd), "i",
+				relationName, bufMgr, schema, &index);
+		checkPassFail(countTuples(&selective), 100)
+		IndexJoinOperator join(new ScanOperator(relationName, bufMgr, schema), "i", relationName, bufMgr, schema, &index);
+		count = 0;
+		int matched = 0;
+		join.open();
+		while(join.next(row))
+		{
+			const Schema& joined = join.getSchema();
+			matched += joined.getInt(row.data, 0) == joined.getInt(row.data, 3) && joined.getDouble(row.data, 4) == joined.getDouble(row.data, 1);
+			count++;
+		}
+		join.close();
+		checkPassFail(count, relationTuples)
+		checkPassFail(matched, relationTuples)
+		bool thrown = false;
+		try
+		{
+			IndexJoinOperator onDouble(new ScanOperator(relationName, bufMgr, schema), "d", relationName, bufMgr, schema, &index);
+		}
+		catch(const BadIndexInfoException& e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+
+		// ORDER BY i DESC LIMIT 5 over a descending index scan reads about 5 records
+		std::vector<SortKey> keys(1);
+		keys[0].column = "i";
+		keys[0].descending = true;
+		int read = 0;
+		TuplePredicate counting = [&read](const char* t) { read++; return true; };
+		TopNOperator top(new FilterOperator(new IndexScanOperator(relationName, bufMgr, schema, &index, 0, GTE, relationTuples, LT, true),
+				counting), keys, 5);
+		top.open();
+		checkPassFail(top.next(row), true)
+		checkPassFail(schema.getInt(row.data, 0), relationTuples - 1)
+		top.close();
+		checkPassFail((read < 10), true)
+	}
+	File::remove(intIndexName);
+
+	bool thrown = false;
+	try
+	{
+		schema.find("x");
+	}
+	catch(const NoSuchColumnException& e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+}
+
+// -----------------------------------------------------------------------------
+// vectorTests
+// -----------------------------------------------------------------------------
+
+void vectorTests()
+{
+	Schema schema = tupleSchema();
+	std::vector<std::string> columns;
+	columns.push_back("i");
+	columns.push_back("d");
+	columns.push_back("s");
+	std::vector<AggregateSpec> aggregates(2);
+	aggregates[0].function = AGGCOUNT;
+	aggregates[0].name = "count";
+	aggregates[1].function = AGGSUM;
+	aggregates[1].column = "twice";
+	aggregates[1].name = "sum";
+	VectorBatch batch;
+	{
+		// SELECT COUNT(*), SUM(d * 2) FROM relA WHERE i < 100
+		std::cout << "Run vectorized query plans" << std::endl;
+		VectorComputeOperator* compute = new VectorComputeOperator(new VectorFilterOperator(
+				new VectorScanOperator(relationName, bufMgr, schema, columns), "i", CMPLT, 100));
+		compute->addColumn("twice", "d", ARITHMUL, 2);
+		VectorAggregateOperator aggregate(compute, std::vector<std::string>(), aggregates);
+		batch.init(aggregate.getSchema());
+		aggregate.open();
+		checkPassFail(aggregate.next(batch), true)
+		checkPassFail(batch.count, 1)
+		checkPassFail(batch.columns[0].ints[0], 100)
+		checkPassFail(batch.columns[1].doubles[0], 9900.0)
+		checkPassFail(aggregate.next(batch), false)
+		aggregate.close();
+	}
+
+	{
+		// SELECT i, COUNT(*) FROM relA WHERE i >= 10 AND i < 60 GROUP BY i
+		VectorComputeOperator* compute = new VectorComputeOperator(new VectorFilterOperator(new VectorFilterOperator(
+				new VectorScanOperator(relationName, bufMgr, schema, columns), "i", CMPGTE, 10), "i", CMPLT, 60));
+		compute->addColumn("twice", "d", ARITHADD, "d");
+		VectorAggregateOperator aggregate(compute, std::vector<std::string>(1, "i"), aggregates);
+		batch.init(aggregate.getSchema());
+		aggregate.open();
+		checkPassFail(aggregate.next(batch), true)
+		checkPassFail(batch.count, 50)
+		int total = 0;
+		for(int r = 0; r < batch.count; r++)
+		{
+			total += batch.columns[1].ints[r];
+		}
+		checkPassFail(total, 50)
+		aggregate.close();
+
+		// SELECT COUNT(*) FROM relA WHERE s = '00042 string record'
+		std::vector<AggregateSpec> count(1, aggregates[0]);
+		VectorAggregateOperator match(new VectorFilterOperator(new VectorScanOperator(relationName, bufMgr, schema, columns),
+				"s", CMPEQ, std::string("00042 string record")), std::vector<std::string>(), count);
+		batch.init(match.getSchema());
+		match.open();
+		match.next(batch);
+		checkPassFail(batch.columns[0].ints[0], 1)
+		match.close();
+	}
+
+	{
+		// the same aggregate one tuple at a time and one batch at a time
+		const int repeats = 20;
+		double tupleSum = 0, vectorSum = 0;
+		clock_t start = clock();
+		for(int r = 0; r < repeats; r++)
+		{
+			ProjectOperator* project = new ProjectOperator(new ScanOperator(relationName, bufMgr, schema), std::vector<std::string>());
+			project->addColumn("twice", DOUBLE, 0, [](const char* t, char* out) {
+				double value = 2 * ((tuple*)t)->d;
+				memcpy(out, &value, sizeof(double));
+			});
+			AggregateOperator aggregate(project, std::vector<std::string>(), aggregates);
+			TupleRef row;
+			aggregate.open();
+			aggregate.next(row);
+			tupleSum = aggregate.getSchema().getDouble(row.data, 1);
+			aggregate.close();
+		}
+		clock_t tupleDone = clock();
+		for(int r = 0; r < repeats; r++)
+		{
+			VectorComputeOperator* compute = new VectorComputeOperator(new VectorScanOperator(relationName, bufMgr, schema,
+					std::vector<std::string>(1, "d")));
+			compute->addColumn("twice", "d", ARITHMUL, 2);
+			VectorAggregateOperator aggregate(compute, std::vector<std::string>(), aggregates);
+			batch.init(aggregate.getSchema());
+			aggregate.open();
+			aggregate.next(batch);
+			vectorSum = batch.columns[1].doubles[0];
+			aggregate.close();
+		}
+		clock_t vectorDone = clock();
+		std::cout << "SUM(d * 2) tuple ms  vector ms" << std::endl;
+		std::cout << (tupleDone - start) * 1000 / CLOCKS_PER_SEC << "  " << (vectorDone - tupleDone) * 1000 / CLOCKS_PER_SEC << std::endl;
+		checkPassFail(vectorSum, tupleSum)
+	}
+}
+
+// -----------------------------------------------------------------------------
+// hashJoinTests
+// -----------------------------------------------------------------------------
+
+void hashJoinTests()
+{
+	Schema schema = tupleSchema();
+	TuplePredicate below1000 = [schema](const char* t) { return schema.getInt(t, 0) < 1000; };
+	{
+		// the build side, the right child, fits in memory whatever the size of the relation
+		std::cout << "Run hash joins" << std::endl;
+		HashJoinOperator join(new ScanOperator(relationName, bufMgr, schema),
+				new FilterOperator(new ScanOperator(relationName, bufMgr, schema), below1000), "i", "i", bufMgr, 1 << 20);
+		checkPassFail(countTuples(&join), 1000)
+		checkPassFail(join.getSpillCount(), 0)
+	}
+
+	{
+		// the build side spills, and its partitions are split again
+		HashJoinOperator join(new FilterOperator(new ScanOperator(relationName, bufMgr, schema), below1000),
+				new ScanOperator(relationName, bufMgr, schema), "i", "i", bufMgr, 20000);
+		const Schema& joined = join.getSchema();
+		int matched = 0, count = 0;
+		TupleRef row;
+		join.open();
+		while(join.next(row))
+		{
+			count++;
+			if(joined.getInt(row.data, 0) == joined.getInt(row.data, 3)
+				&& joined.getString(row.data, 2) == joined.getString(row.data, 5))
+			{
+				matched++;
+			}
+		}
+		join.close();
+		checkPassFail(count, 1000)
+		checkPassFail(matched, 1000)
+		checkPassFail((join.getSpillCount() > HASHJOINPARTITIONS), true)
+	}
+}
+
+// -----------------------------------------------------------------------------
+// externalSortTests
+// -----------------------------------------------------------------------------
+
+void externalSortTests()
+{
+	Schema schema = tupleSchema();
+	std::vector<SortKey> keys(1);
+	keys[0].column = "i";
+	keys[0].descending = true;
+	std::cout << "Run external sorts" << std::endl;
+	for(int frames = 3; frames <= 81; frames *= 27)
+	{
+		// 3 frames spill runs and merge them two at a time, 81 frames sort the smaller relations in memory
+		ExternalSortOperator sort(new ScanOperator(relationName, bufMgr, schema), keys, bufMgr, frames);
+		int count = 0, ordered = 0, previous = relationTuples;
+		TupleRef row;
+		sort.open();
+		while(sort.next(row))
+		{
+			int value = schema.getInt(row.data, 0);
+			if(value < previous)
+			{
+				ordered++;
+			}
+			previous = value;
+			count++;
+		}
+		sort.close();
+		checkPassFail(count, relationTuples)
+		checkPassFail(ordered, relationTuples)
+		checkPassFail((sort.getRunCount() > 0), (relationTuples > frames * (int)Page::SIZE / schema.tupleLength))
+	}
+}
+
+// -----------------------------------------------------------------------------
+// hashAggregateTests
+// -----------------------------------------------------------------------------
+
+void hashAggregateTests()
+{
+	Schema schema = tupleSchema();
+	std::vector<AggregateSpec> aggregates(2);
+	aggregates[0].function = AGGCOUNT;
+	aggregates[0].name = "count";
+	aggregates[1].function = AGGSUM;
+	aggregates[1].column = "d";
+	aggregates[1].name = "sum";
+	TupleFunction bucket = [](const char* t, char* out) {
+		int value = ((tuple*)t)->i % 500;
+		memcpy(out, &value, sizeof(int));
+	};
+
+	// SELECT i % 500, COUNT(*), SUM(d) FROM relA GROUP BY i % 500, in memory, then spilling and splitting partitions
+	std::cout << "Run hash aggregates" << std::endl;
+	const size_t budgets[2] = {1 << 20, 600};
+	for(int b = 0; b < 2; b++)
+	{
+		ProjectOperator* project = new ProjectOperator(new ScanOperator(relationName, bufMgr, schema), std::vector<std::string>(1, "d"));
+		project->addColumn("bucket", INTEGER, 0, bucket);
+		HashAggregateOperator aggregate(project, std::vector<std::string>(1, "bucket"), aggregates, bufMgr, budgets[b]);
+		int groups = 0, complete = 0;
+		double total = 0;
+		TupleRef row;
+		aggregate.open();
+		while(aggregate.next(row))
+		{
+			groups++;
+			complete += aggregate.getSchema().getInt(row.data, 1) == relationTuples / 500;
+			total += aggregate.getSchema().getDouble(row.data, 2);
+		}
+		aggregate.close();
+		checkPassFail(groups, 500)
+		checkPassFail(complete, 500)
+		checkPassFail(total, (double)relationTuples * (relationTuples - 1) / 2)
+		checkPassFail((aggregate.getSpillCount() > HASHAGGPARTITIONS), (b == 1))
+	}
+
+	// partial aggregates of two halves merged into one table
+	AggregateHashTable halves[2];
+	std::vector<AggregateFunction> functions(1, AGGMAX);
+	for(int h = 0; h < 2; h++)
+	{
+		halves[h].init(sizeof(int), functions);
+		for(int i = h * relationTuples / 2; i < (h + 1) * relationTuples / 2; i++)
+		{
+			int key = i % 7;
+			halves[h].update(halves[h].find((char*)&key, AggregateHashTable::hashKey((char*)&key, sizeof(int)), true), 0, i);
+		}
+	}
+	halves[0].mergeFrom(halves[1]);
+	checkPassFail((int)halves[0].getGroupCount(), 7)
+	double maximum;
+	int key = (relationTuples - 1) % 7;
+	halves[0].finish(halves[0].find((char*)&key, AggregateHashTable::hashKey((char*)&key, sizeof(int)), false), 0, (char*)&maximum);
+	checkPassFail(maximum, relationTuples - 1)
+}
+
+// -----------------------------------------------------------------------------
+// distinctCountTests
+// -----------------------------------------------------------------------------
+
+void distinctCountTests()
+{
+	Schema schema = tupleSchema();
+	std::vector<AggregateSpec> aggregates(2);
+	aggregates[0].function = AGGCOUNTDISTINCT;
+	aggregates[0].column = "bucket";
+	aggregates[0].name = "exact";
+	aggregates[1].function = AGGAPPROXCOUNTDISTINCT;
+	aggregates[1].column = "bucket";
+	aggregates[1].name = "approx";
+
+	// SELECT COUNT(DISTINCT i % 500) FROM relA, exactly and with a sketch
+	std::cout << "Run distinct counts" << std::endl;
+	ProjectOperator* project = new ProjectOperator(new ScanOperator(relationName, bufMgr, schema), std::vector<std::string>());
+	project->addColumn("bucket", INTEGER, 0, [](const char* t, char* out) {
+		int value = ((tuple*)t)->i % 500;
+		memcpy(out, &value, sizeof(int));
+	});
+	AggregateOperator aggregate(project, std::vector<std::string>(), aggregates);
+	TupleRef row;
+	aggregate.open();
+	checkPassFail(aggregate.next(row), true)
+	checkPassFail(aggregate.getSchema().getInt(row.data, 0), 500)
+	checkPassFail(aggregate.getSchema().getInt(row.data, 1), 500)
+	aggregate.close();
+
+	// dense sketches of two halves merge into the sketch of the whole
+	HyperLogLog whole, halves[2];
+	const int values = 200000;
+	for(int i = 0; i < values; i++)
+	{
+		std::uint64_t hash = HyperLogLog::hashValue((char*)&i, sizeof(int));
+		whole.add(hash);
+		halves[i % 2].add(hash);
+	}
+	halves[0].merge(halves[1]);
+	checkPassFail(whole.isSparse(), false)
+	checkPassFail(halves[0].estimate(), whole.estimate())
+	checkPassFail((std::fabs(whole.estimate() - values) < 0.03 * values), true)
+
+	bool thrown = false;
+	try
+	{
+		HashAggregateOperator hashed(new ScanOperator(relationName, bufMgr, schema), std::vector<std::string>(), aggregates, bufMgr, 1 << 20);
+	}
+	catch(const UnsupportedAggregateException& e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+}
+
+// -----------------------------------------------------------------------------
+// parallelAggregateTests
+// -----------------------------------------------------------------------------
+
+void parallelAggregateTests()
+{
+	Schema schema = tupleSchema();
+	std::vector<AggregateSpec> aggregates(2);
+	aggregates[0].function = AGGCOUNT;
+	aggregates[0].name = "count";
+	aggregates[1].function = AGGSUM;
+	aggregates[1].column = "d";
+	aggregates[1].name = "sum";
+	TupleRef row;
+
+	// SELECT COUNT(*), SUM(d) FROM relA on one and on several workers
+	std::cout << "Run parallel aggregates" << std::endl;
+	const int workers[2] = {1, 4};
+	for(int w = 0; w < 2; w++)
+	{
+		ParallelAggregateOperator aggregate(relationName, bufMgr, schema, TuplePredicate(), std::vector<std::string>(),
+				aggregates, workers[w]);
+		aggregate.open();
+		checkPassFail(aggregate.next(row), true)
+		checkPassFail(aggregate.getSchema().getInt(row.data, 0), relationTuples)
+		checkPassFail(aggregate.getSchema().getDouble(row.data, 1), (double)relationTuples * (relationTuples - 1) / 2)
+		checkPassFail(aggregate.next(row), false)
+		aggregate.close();
+	}
+
+	// SELECT i, COUNT(*) FROM relA WHERE i < 100 GROUP BY i
+	TuplePredicate below100 = [schema](const char* t) { return schema.getInt(t, 0) < 100; };
+	ParallelAggregateOperator grouped(relationName, bufMgr, schema, below100, std::vector<std::string>(1, "i"), aggregates, 4);
+	int groups = 0, single = 0;
+	grouped.open();
+	while(grouped.next(row))
+	{
+		groups++;
+		single += grouped.getSchema().getInt(row.data, 1) == 1;
+	}
+	grouped.close();
+	checkPassFail(groups, 100)
+	checkPassFail(single, 100)
+
+	// the same aggregate over the leaves of an index range
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		ParallelAggregateOperator ranged(relationName, bufMgr, schema, TuplePredicate(), &index, 1000, GTE, 2000, LT,
+				std::vector<std::string>(), aggregates, 3);
+		ranged.open();
+		checkPassFail(ranged.next(row), true)
+		checkPassFail(ranged.getSchema().getInt(row.data, 0), 1000)
+		checkPassFail(ranged.getSchema().getDouble(row.data, 1), 1000.0 * (1000 + 1999) / 2)
+		ranged.close();
+	}
+	File::remove(intIndexName);
+}
+
+// -----------------------------------------------------------------------------
+// sqlTests
+// -----------------------------------------------------------------------------
+
+void sqlTests()
+{
+	TupleRef row;
+	std::cout << "Run SQL queries" << std::endl;
+	{
+		// the planner opens the index file on i, which has to be written out first
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	}
+	{
+		QueryPlanner planner(bufMgr);
+		planner.addRelation(relationName, tupleSchema());
+
+		QueryOperator* query = planner.plan("SELECT COUNT(*), SUM(d) AS total FROM relA WHERE i < 100");
+		query->open();
+		checkPassFail(query->next(row), true)
+		checkPassFail(query->getSchema().getInt(row.data, 0), 100)
+		checkPassFail(query->getSchema().getDouble(row.data, query->getSchema().find("total")), 4950)
+		checkPassFail(query->next(row), false)
+		query->close();
+		delete query;
+		checkPassFail((int)planner.getIndexCount(), 1)
+
+		// read backwards from the index, the scan stops once the top 3 are found
+		query = planner.plan("select i, s from RELA where i >= 1000 and i < 1010 order by i desc limit 3;");
+		query->open();
+		for(int i = 1009; i > 1006; i--)
+		{
+			checkPassFail(query->next(row), true)
+			checkPassFail(query->getSchema().getInt(row.data, 0), i)
+		}
+		checkPassFail(query->getSchema().getString(row.data, 1), std::string("01007 string record"))
+		checkPassFail(query->next(row), false)
+		query->close();
+		delete query;
+
+		query = planner.plan("SELECT COUNT(*) FROM relA a, relA b WHERE a.i = b.i AND b.d < 20");
+		query->open();
+		checkPassFail(query->next(row), true)
+		checkPassFail(query->getSchema().getInt(row.data, 0), 20)
+		query->close();
+		delete query;
+
+		// the few rows of a probe the index on the bigger side
+		query = planner.plan("SELECT a.s FROM relA a JOIN relA b ON a.i = b.i WHERE a.i < 5");
+		checkPassFail(countTuples(query), 5)
+		delete query;
+		checkPassFail((int)planner.getIndexCount(), 4)
+
+		query = planner.plan("SELECT SUBSTR(s, 1, 4) AS prefix, COUNT(*) AS n FROM relA GROUP BY prefix HAVING n >= 10");
+		int groups = 0, first = 0;
+		query->open();
+		while(query->next(row))
+		{
+			groups++;
+			if(query->getSchema().getString(row.data, 0) == "0000")
+			{
+				first = query->getSchema().getInt(row.data, 1);
+			}
+		}
+		query->close();
+		delete query;
+		// the records are numbered with at least 5 digits, so their first 4 chars are digits
+		std::vector<int> prefixes(10000, 0);
+		char digits[16];
+		for(int i = 0; i < relationTuples; i++)
+		{
+			sprintf(digits, "%05d", i);
+			digits[4] = 0;
+			prefixes[atoi(digits)]++;
+		}
+		int expected = 0;
+		for(size_t p = 0; p < prefixes.size(); p++)
+		{
+			expected += prefixes[p] >= 10;
+		}
+		checkPassFail(groups, expected)
+		checkPassFail(first, 10)
+
+		query = planner.plan("SELECT i FROM relA WHERE i < 100 AND i NOT IN (SELECT i FROM relA WHERE d >= 50)");
+		checkPassFail(countTuples(query), 50)
+		delete query;
+
+		query = planner.plan("SELECT DISTINCT i FROM relA x WHERE i < 20 AND NOT EXISTS "
+				"(SELECT * FROM relA y WHERE y.d < 10 AND y.i = x.i)");
+		checkPassFail(countTuples(query), 10)
+		delete query;
+
+		bool thrown = false;
+		try
+		{
+			planner.plan("SELECT i FROM relA WHERE");
+		}
+		catch(const SqlSyntaxException& e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+
+		thrown = false;
+		try
+		{
+			planner.plan("CREATE TABLE T1 AS SELECT i FROM relA");
+		}
+		catch(const UnsupportedQueryException& e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+	}
+	File::remove(intIndexName);
+}
+
+// -----------------------------------------------------------------------------
+// engineBenchmark
+// -----------------------------------------------------------------------------
+
+void engineBenchmark()
+{
+	// build each engine over the relation of the current test, then run a full scan and point lookups
+	std::cout << "engine  build ms  scan ms  disk reads  disk writes" << std::endl;
+	std::string indexName;
+	checkPassFail(engineRun<BTreeIndex>("B+ tree", indexName), relationTuples + 100)
+	File::remove(indexName);
+	checkPassFail(engineRun<BeTreeIndex>("Be-tree", indexName), relationTuples + 100)
+	File::remove(indexName);
+	checkPassFail(engineRun<LsmIndex>("LSM", indexName), relationTuples + 100)
+	LsmIndex::remove(indexName);
+
+	// then insert a tenth more entries with keys in random order, which is what the Be-tree buffers are for
+	int inserts = relationTuples / 10;
+	std::cout << "engine  insert ms  disk reads  disk writes" << std::endl;
+	checkPassFail(engineInsertRun<BTreeIndex>("B+ tree", indexName, inserts), relationTuples + inserts)
+	File::remove(indexName);
+	checkPassFail(engineInsertRun<BeTreeIndex>("Be-tree", indexName, inserts), relationTuples + inserts)
+	File::remove(indexName);
+}
+
+template <class Index>
+int engineRun(const std::string &engine, std::string &indexName)
+{
+	int numResults = 0;
+	bufMgr->clearBufStats();
+	clock_t start = clock();
+	Index* index = new Index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER);
+	clock_t built = clock();
+	numResults += engineScan(index, 0, GTE, relationTuples, LT);
+	for(int i = 0; i < 100; i++)
+	{
+		int key = (i * 7919) % relationTuples;
+		numResults += engineScan(index, key, GTE, key, LTE);
+	}
+	clock_t scanned = clock();
+	delete index;
+
+	BufStats stats = bufMgr->getBufStats();
+	std::cout << engine << "  " << (built - start) * 1000 / CLOCKS_PER_SEC << "  " << (scanned - built) * 1000 / CLOCKS_PER_SEC;
+	std::cout << "  " << stats.diskreads << "  " << stats.diskwrites << std::endl;
+	return numResults;
+}
+
+template <class Index>
+int engineInsertRun(const std::string &engine, std::string &indexName, const int inserts)
+{
+	Index* index = new Index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER);
+	bufMgr->clearBufStats();
+	clock_t start = clock();
+	for(int i = 0; i < inserts; i++)
+	{
+		int key = random() % relationTuples;
+		RecordId rid;
+		rid.page_number = i + 1;
+		rid.slot_number = 1;
+		index->insertEntry(&key, rid);
+	}
+	clock_t inserted = clock();
+	BufStats stats = bufMgr->getBufStats();
+	int numResults = engineScan(index, 0, GTE, relationTuples, LT);
+	delete index;
+
+	std::cout << engine << "  " << (inserted - start) * 1000 / CLOCKS_PER_SEC;
+	std::cout << "  " << stats.diskreads << "  " << stats.diskwrites << std::endl;
+	return numResults;
+}
+
+// Keys as the startScan() of each index takes them: integers by address, encoded composite keys as they are
+const void* scanKey(const int &key)
+{
+	return &key;
+}
+
+const std::string& scanKey(const std::string &key)
+{
+	return key;
+}
+
+template <class Index, class Key>
+int engineScan(Index * index, const Key &lowVal, Operator lowOp, const Key &highVal, Operator highOp)
+{
+	return countScan(index, [&]() { index->startScan(scanKey(lowVal), lowOp, scanKey(highVal), highOp); });
+}
+
+// Run start, which begins a scan of index, and count the entries the scan returns
+template <class Index, class Start>
+int countScan(Index * index, Start start)
+{
+	RecordId scanRid;
+	int numResults = 0;
+
+	try
+	{
+		start();
+	}
+	catch(const NoSuchKeyFoundException& e)
+	{
+		return 0;
+	}
+	try
+	{
+		while(1)
+		{
+			index->scanNext(scanRid);
+			numResults++;
+		}
+	}
+	catch(const IndexScanCompletedException& e)
+	{
+	}
+	index->endScan();
+	return numResults;
+}
+
+// -----------------------------------------------------------------------------
+// stringNodeTests
+// -----------------------------------------------------------------------------
+
+void stringNodeTests()
+{
+	std::cout << "String node tests" << std::endl;
+	std::cout << "-----------------" << std::endl;
+
+	// only the bytes up to the first difference are promoted
+	const char* left = "00123 string record";
+	const char* right = "00124 string record";
+	checkPassFail(shortestSeparator(left, getStringKeyLength(left), right, getStringKeyLength(right)), 5)
+	checkPassFail(shortestSeparator(left, 3, left, getStringKeyLength(left)), 4)
+
+	// keys like the s attribute of the test relation, a full 64 byte key would fit about 113 times
+	const int plainFanout = Page::SIZE / (STRINGSIZE + sizeof(RecordId));
+	LeafNodeString* leaf = new LeafNodeString;
+	LeafNodeString* newLeaf = new LeafNodeString;
+	initStringLeaf(leaf);
+	initStringLeaf(newLeaf);
+	char key[STRINGSIZE];
+	RIDKeyPair<std::string> entry;
+	int inserted = 0;
+	for(int i = 999; ; i -= 3)
+	{
+		sprintf(key, "%05d string record", i);
+		rid.page_number = i + 1;
+		rid.slot_number = 1;
+		entry.set(rid, std::string(key, getStringKeyLength(key)));
+		if(!insertIntoStringLeaf(leaf, entry))
+			break;
+		inserted++;
+	}
+	checkPassFail((inserted > 2 * plainFanout), true)
+	checkPassFail((getStringLeafKey(leaf, 0) < getStringLeafKey(leaf, inserted - 1)), true)
+	checkPassFail(findStringLeafPos(leaf, getStringLeafKey(leaf, 10), false), 10)
+	checkPassFail(findStringLeafPos(leaf, getStringLeafKey(leaf, 10), true), 11)
+
+	// after a split the halves keep every entry and the one that did not fit, and the separator routes between them
+	std::string sep = splitStringLeaf(leaf, newLeaf, entry, false);
+	checkPassFail(leaf->keyCount + newLeaf->keyCount, inserted + 1)
+	checkPassFail((sep.size() <= 5), true)
+	checkPassFail((getStringLeafKey(leaf, leaf->keyCount - 1) < sep && sep <= getStringLeafKey(newLeaf, 0)), true)
+	checkPassFail((getStringLeafKey(leaf, 0) == entry.key), true)
+
+	// long keys sharing a long head prefix, and a key that shares none of it: the half taking that key loses
+	// the prefix, so the split has to go by bytes for both halves to fit
+	std::string longPrefix(STRINGSIZE - 6, 'a');
+	initStringLeaf(leaf);
+	initStringLeaf(newLeaf);
+	inserted = 0;
+	while(true)
+	{
+		sprintf(key, "%05d", inserted);
+		entry.set(rid, longPrefix + key);
+		if(!insertIntoStringLeaf(leaf, entry))
+			break;
+		inserted++;
+	}
+	entry.set(rid, std::string(STRINGSIZE - 1, 'b'));
+	sep = splitStringLeaf(leaf, newLeaf, entry, false);
+	checkPassFail(leaf->keyCount + newLeaf->keyCount, inserted + 1)
+	checkPassFail((getStringLeafKey(newLeaf, newLeaf->keyCount - 1) == entry.key), true)
+	checkPassFail((getStringLeafKey(leaf, leaf->keyCount - 1) < sep && sep <= getStringLeafKey(newLeaf, 0)), true)
+
+	// appending past the last key on the right edge keeps the leaf full and starts the new one with the entry
+	initStringLeaf(leaf);
+	initStringLeaf(newLeaf);
+	for(int i = 0; i < inserted; i++)
+	{
+		sprintf(key, "%05d", i);
+		entry.set(rid, longPrefix + key);
+		insertIntoStringLeaf(leaf, entry);
+	}
+	sprintf(key, "%05d", inserted);
+	entry.set(rid, longPrefix + key);
+	sep = splitStringLeaf(leaf, newLeaf, entry, true);
+	checkPassFail(leaf->keyCount, inserted)
+	checkPassFail(newLeaf->keyCount, 1)
+	checkPassFail((getStringLeafKey(leaf, leaf->keyCount - 1) < sep && sep <= entry.key), true)
+
+	// non-leaves hold the truncated separators, so they fan out much wider than full keys would allow
+	NonLeafNodeString* node = new NonLeafNodeString;
+	NonLeafNodeString* newNode = new NonLeafNodeString;
+	initStringNonLeaf(node, 1, 1);
+	int children = 1;
+	while(true)
+	{
+		sprintf(key, "%05d", children * 7);
+		if(!insertIntoStringNonLeaf(node, children - 1, std::string(key), children + 1))
+			break;
+		children++;
+	}
+	checkPassFail((children > 4 * plainFanout), true)
+	checkPassFail((int)getStringChild(node, findStringChildPos(node, "00700 string record", false)), 101)
+	sprintf(key, "%05d", children * 7);
+	sep = splitStringNonLeaf(node, newNode, children - 1, std::string(key), children + 1, false);
+	checkPassFail(node->keyCount + newNode->keyCount + 2, children + 1)
+	checkPassFail((int)getStringChild(newNode, newNode->keyCount), children + 1)
+	checkPassFail((getStringSeparator(node, node->keyCount - 1) < sep && sep < getStringSeparator(newNode, 0)), true)
+
+	// and on the right edge the new child goes into the new node alone
+	initStringNonLeaf(node, 1, 1);
+	for(int i = 1; i < children; i++)
+	{
+		sprintf(key, "%05d", i * 7);
+		insertIntoStringNonLeaf(node, i - 1, std::string(key), i + 1);
+	}
+	sprintf(key, "%05d", children * 7);
+	sep = splitStringNonLeaf(node, newNode, children - 1, std::string(key), children + 1, true);
+	checkPassFail(node->keyCount + 1, children)
+	checkPassFail(newNode->keyCount, 0)
+	checkPassFail((int)getStringChild(newNode, 0), children + 1)
+	checkPassFail((sep == std::string(key)), true)
+
+	delete leaf;
+	delete newLeaf;
+	delete node;
+	delete newNode;
+	std::cout << std::endl;
+}
 
 // -----------------------------------------------------------------------------
 // errorTests
@@ -0,0 +1,373 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include "morsel.h"
+#include "page_iterator.h"
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/unsupported_aggregate_exception.h"
+
+namespace badgerdb
+{
+
+// order record ids by page, so that the records of a page are read while it is pinned once
+static bool ridPageLess(const RecordId& r1, const RecordId& r2)
+{
+	if(r1.page_number != r2.page_number) {
+		return r1.page_number < r2.page_number;
+	}
+	return r1.slot_number < r2.slot_number;
+}
+
+// -----------------------------------------------------------------------------
+// MorselScheduler::MorselScheduler -- Constructor
+// -----------------------------------------------------------------------------
+
+MorselScheduler::MorselScheduler(const int workerCount)
+{
+	this->workerCount = workerCount > 0 ? workerCount : std::max((int)std::thread::hardware_concurrency(), 1);
+	this->queues = new WorkerQueue[this->workerCount];
+	this->steals.assign(this->workerCount, 0);
+	this->failed = false;
+}
+
+MorselScheduler::~MorselScheduler()
+{
+	delete [] queues;
+}
+
+// -----------------------------------------------------------------------------
+// MorselScheduler::takeMorsel
+// -----------------------------------------------------------------------------
+
+bool MorselScheduler::takeMorsel(const int worker, Morsel& morsel)
+{
+	if(failed) {
+		return false;
+	}
+	{
+		std::lock_guard<std::mutex> guard(queues[worker].lock);
+		if(!queues[worker].morsels.empty()) {
+			morsel = queues[worker].morsels.front();
+			queues[worker].morsels.pop_front();
+			return true;
+		}
+	}
+
+	// steal the morsel the owner would get to last, starting with the next worker so thieves spread out
+	for(int i = 1; i < workerCount; i++) {
+		WorkerQueue& victim = queues[(worker + i) % workerCount];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if(!victim.morsels.empty()) {
+			morsel = victim.morsels.back();
+			victim.morsels.pop_back();
+			steals[worker]++;
+			return true;
+		}
+	}
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// MorselScheduler::work
+// -----------------------------------------------------------------------------
+
+void MorselScheduler::work(const int worker, const std::function<void (const int worker, const Morsel& morsel)>& task,
+		std::exception_ptr& error)
+{
+	try
+	{
+		Morsel morsel;
+		while(takeMorsel(worker, morsel)) {
+			task(worker, morsel);
+		}
+	}
+	catch(...)
+	{
+		error = std::current_exception();
+		failed = true;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// MorselScheduler::run
+// -----------------------------------------------------------------------------
+
+void MorselScheduler::run(const size_t unitCount, const size_t morselSize,
+		const std::function<void (const int worker, const Morsel& morsel)>& task)
+{
+	// deal the morsels out in contiguous shares
+	size_t morselCount = (unitCount + morselSize - 1) / morselSize;
+	for(int w = 0; w < workerCount; w++) {
+		queues[w].morsels.clear();
+		for(size_t m = morselCount * w / workerCount; m < morselCount * (w + 1) / workerCount; m++) {
+			Morsel morsel = {m * morselSize, std::min((m + 1) * morselSize, unitCount)};
+			queues[w].morsels.push_back(morsel);
+		}
+	}
+	steals.assign(workerCount, 0);
+	failed = false;
+
+	std::vector<std::exception_ptr> errors(workerCount);
+	std::vector<std::thread> threads;
+	for(int w = 1; w < workerCount; w++) {
+		threads.push_back(std::thread(&MorselScheduler::work, this, w, std::cref(task), std::ref(errors[w])));
+	}
+	work(0, task, errors[0]);
+	for(size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+
+	for(int w = 0; w < workerCount; w++) {
+		queues[w].morsels.clear();
+		if(errors[w]) {
+			std::rethrow_exception(errors[w]);
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------
+// MorselScheduler::getStealCount
+// -----------------------------------------------------------------------------
+
+int MorselScheduler::getStealCount() const
+{
+	int total = 0;
+	for(size_t i = 0; i < steals.size(); i++) {
+		total += steals[i];
+	}
+	return total;
+}
+
+// -----------------------------------------------------------------------------
+// ParallelAggregateOperator::ParallelAggregateOperator -- Constructor
+// -----------------------------------------------------------------------------
+
+ParallelAggregateOperator::ParallelAggregateOperator(const std::string & relationName, BufMgr *bufMgrIn,
+		const Schema& schema, const TuplePredicate& predicate, const std::vector<std::string>& groupColumnNames,
+		const std::vector<AggregateSpec>& aggregates, const int workerCount)
+	: scheduler(workerCount)
+{
+	this->relationName = relationName;
+	this->bufMgr = bufMgrIn;
+	this->recordSchema = schema;
+	this->predicate = predicate;
+	this->index = NULL;
+	this->aggregates = aggregates;
+	init(groupColumnNames);
+}
+
+ParallelAggregateOperator::ParallelAggregateOperator(const std::string & relationName, BufMgr *bufMgrIn,
+		const Schema& schema, const TuplePredicate& predicate, BTreeIndex *index, int lowVal, const Operator lowOp,
+		int highVal, const Operator highOp, const std::vector<std::string>& groupColumnNames,
+		const std::vector<AggregateSpec>& aggregates, const int workerCount)
+	: scheduler(workerCount)
+{
+	this->relationName = relationName;
+	this->bufMgr = bufMgrIn;
+	this->recordSchema = schema;
+	this->predicate = predicate;
+	this->index = index;
+	this->lowVal = lowVal;
+	this->lowOp = lowOp;
+	this->highVal = highVal;
+	this->highOp = highOp;
+	this->aggregates = aggregates;
+	init(groupColumnNames);
+}
+
+ParallelAggregateOperator::~ParallelAggregateOperator()
+{
+	close();
+}
+
+// -----------------------------------------------------------------------------
+// ParallelAggregateOperator::init
+// -----------------------------------------------------------------------------
+
+void ParallelAggregateOperator::init(const std::vector<std::string>& groupColumnNames)
+{
+	for(size_t i = 0; i < groupColumnNames.size(); i++) {
+		int column = recordSchema.find(groupColumnNames[i]);
+		groupColumns.push_back(column);
+		schema.addColumn(recordSchema.columns[column].name, recordSchema.columns[column].type, recordSchema.columns[column].length);
+	}
+	keyLength = schema.tupleLength;
+	std::vector<AggregateFunction> functions;
+	for(size_t i = 0; i < aggregates.size(); i++) {
+		// the partial results of the workers are fixed width states, as in HashAggregateOperator
+		if(aggregates[i].function == AGGCOUNTDISTINCT || aggregates[i].function == AGGAPPROXCOUNTDISTINCT) {
+			throw UnsupportedAggregateException(aggregates[i].name);
+		}
+		aggregateColumns.push_back(aggregates[i].column.empty() ? -1 : recordSchema.find(aggregates[i].column));
+		schema.addColumn(aggregates[i].name, aggregates[i].function == AGGCOUNT ? INTEGER : DOUBLE);
+		functions.push_back(aggregates[i].function);
+	}
+	table.init(keyLength, functions);
+	nextGroup = 0;
+}
+
+// -----------------------------------------------------------------------------
+// ParallelAggregateOperator::aggregateRecord
+// -----------------------------------------------------------------------------
+
+void ParallelAggregateOperator::aggregateRecord(AggregateHashTable& table, const char* record, char* key) const
+{
+	if(predicate && !predicate(record)) {
+		return;
+	}
+	for(size_t i = 0; i < groupColumns.size(); i++) {
+		const Column& column = recordSchema.columns[groupColumns[i]];
+		memcpy(key + schema.columns[i].offset, record + column.offset, column.length);
+	}
+	char* row = table.find(key, AggregateHashTable::hashKey(key, keyLength), true);
+	for(size_t i = 0; i < aggregates.size(); i++) {
+		table.update(row, i, aggregateColumns[i] < 0 ? 0 : recordSchema.getNumber(record, aggregateColumns[i]));
+	}
+}
+
+// -----------------------------------------------------------------------------
+// ParallelAggregateOperator::aggregatePages
+// -----------------------------------------------------------------------------
+
+void ParallelAggregateOperator::aggregatePages(PageFile* file, const std::vector<PageId>& pageNos, const Morsel& morsel,
+		AggregateHashTable& table) const
+{
+	std::vector<char> key(keyLength, 0);
+	for(size_t i = morsel.begin; i < morsel.end; i++) {
+		Page* page;
+		try
+		{
+			bufMgr->readPage(file, pageNos[i], page);
+		}
+		catch(const InvalidPageException& e)
+		{
+			// a page that was deleted from the relation
+			continue;
+		}
+		for(PageIterator it = page->begin(); it != page->end(); ++it) {
+			std::size_t length;
+			aggregateRecord(table, page->getRecordData(it.getCurrentRecord(), &length), &key[0]);
+		}
+		bufMgr->unPinPage(file, pageNos[i], false);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// ParallelAggregateOperator::aggregateLeaves
+// -----------------------------------------------------------------------------
+
+void ParallelAggregateOperator::aggregateLeaves(PageFile* file, const std::vector<PageId>& leafPageNos,
+		const Morsel& morsel, AggregateHashTable& table) const
+{
+	std::vector<RecordId> rids;
+	for(size_t i = morsel.begin; i < morsel.end; i++) {
+		index->readLeafRange(leafPageNos[i], &lowVal, lowOp, &highVal, highOp, rids);
+	}
+
+	// the order of the records does not matter to the aggregates, so each heap page is pinned once
+	std::sort(rids.begin(), rids.end(), ridPageLess);
+	std::vector<char> key(keyLength, 0);
+	Page* page = NULL;
+	for(size_t i = 0; i < rids.size(); i++) {
+		if(page == NULL || rids[i].page_number != rids[i - 1].page_number) {
+			if(page != NULL) {
+				bufMgr->unPinPage(file, rids[i - 1].page_number, false);
+			}
+			bufMgr->readPage(file, rids[i].page_number, page);
+		}
+		std::size_t length;
+		aggregateRecord(table, page->getRecordData(rids[i], &length), &key[0]);
+	}
+	if(page != NULL) {
+		bufMgr->unPinPage(file, rids.back().page_number, false);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// ParallelAggregateOperator::open
+// -----------------------------------------------------------------------------
+
+void ParallelAggregateOperator::open()
+{
+	close();
+	buffer.assign(schema.tupleLength, 0);
+
+	// the units are the heap pages of the relation, or the leaves of the range
+	PageFile* file = new PageFile(relationName, false);
+	std::vector<PageId> units;
+	if(index == NULL) {
+		for(PageId pageNo = 1; pageNo < file->getNumPages(); pageNo++) {
+			units.push_back(pageNo);
+		}
+	} else {
+		index->getLeafPages(&lowVal, lowOp, &highVal, highOp, units);
+	}
+
+	std::vector<AggregateHashTable> tables(scheduler.getWorkerCount(), table);
+	try
+	{
+		scheduler.run(units.size(), index == NULL ? MORSELPAGES : MORSELLEAVES,
+			[&](const int worker, const Morsel& morsel) {
+				if(index == NULL) {
+					aggregatePages(file, units, morsel, tables[worker]);
+				} else {
+					aggregateLeaves(file, units, morsel, tables[worker]);
+				}
+			});
+	}
+	catch(...)
+	{
+		delete file;
+		throw;
+	}
+	bufMgr->flushFile(file);
+	delete file;
+
+	for(size_t w = 0; w < tables.size(); w++) {
+		table.mergeFrom(tables[w]);
+	}
+	if(groupColumns.empty() && table.getGroupCount() == 0) {
+		std::vector<char> key(keyLength, 0);
+		table.find(&key[0], AggregateHashTable::hashKey(&key[0], keyLength), true);
+	}
+	nextGroup = 0;
+}
+
+// -----------------------------------------------------------------------------
+// ParallelAggregateOperator::next
+// -----------------------------------------------------------------------------
+
+bool ParallelAggregateOperator::next(TupleRef& outTuple)
+{
+	if(nextGroup == table.getGroupCount()) {
+		return false;
+	}
+	const char* row = table.getRow(nextGroup++);
+	memcpy(&buffer[0], row, keyLength);
+	for(size_t i = 0; i < aggregates.size(); i++) {
+		table.finish(row, i, &buffer[schema.columns[groupColumns.size() + i].offset]);
+	}
+	outTuple.data = &buffer[0];
+	outTuple.rid.page_number = Page::INVALID_NUMBER;
+	outTuple.rid.slot_number = Page::INVALID_SLOT;
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// ParallelAggregateOperator::close
+// -----------------------------------------------------------------------------
+
+void ParallelAggregateOperator::close()
+{
+	table.clear();
+	nextGroup = 0;
+}
+
+}
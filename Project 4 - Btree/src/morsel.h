@@ -0,0 +1,215 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <functional>
+
+#include "buffer.h"
+#include "btree.h"
+#include "operators.h"
+#include "hashaggregate.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of heap pages of a relation in a morsel.
+ */
+const  int MORSELPAGES = 16;
+
+/**
+ * @brief Number of BTreeIndex leaves in a morsel. A leaf points to several heap pages of records.
+ */
+const  int MORSELLEAVES = 2;
+
+/**
+ * @brief A piece of work for a MorselScheduler: the units from begin up to end, e.g. pages of a relation.
+ */
+struct Morsel{
+	size_t begin;
+	size_t end;
+};
+
+/**
+ * @brief Runs a task over morsels of a list of units on several threads, stealing work between them.
+ *
+ * The units are cut into morsels, and each worker is dealt a contiguous share of them in its own queue so that
+ * neighbouring units are read by the same thread. A worker takes morsels from the front of its queue; once it
+ * is empty it steals from the back of the queue of another worker, so a worker whose morsels are slow, e.g.
+ * because their pages are not cached, does not hold up the others. The calling thread is worker 0.
+*/
+class MorselScheduler {
+
+ private:
+
+  /**
+   * Morsels dealt to a worker and not taken yet.
+   */
+	struct WorkerQueue{
+		std::mutex lock;
+		std::deque<Morsel> morsels;
+	};
+
+	int			workerCount;
+	WorkerQueue	*queues;
+
+  /**
+   * Morsels each worker took from another worker's queue during the last run.
+   */
+	std::vector<int>	steals;
+
+  /**
+   * Set once a task has thrown, the workers then stop taking morsels.
+   */
+	std::atomic<bool>	failed;
+
+  /**
+	 * Take the next morsel for worker, stealing one if its queue is empty.
+	 * @return false if there are no morsels left
+	**/
+	bool takeMorsel(const int worker, Morsel& morsel);
+
+  /**
+	 * Run task on morsels until there are none left, recording the exception it throws, if any, in error.
+	**/
+	void work(const int worker, const std::function<void (const int worker, const Morsel& morsel)>& task,
+						std::exception_ptr& error);
+
+ public:
+
+  /**
+   * @param workerCount		Number of threads, the number of cores if 0
+	**/
+	MorselScheduler(const int workerCount = 0);
+	~MorselScheduler();
+
+  /**
+	 * Call task for each morsel of morselSize units out of unitCount, on the workers, and wait for them all.
+	 * Calls on the same worker never overlap, so a task can keep per worker state by its worker number.
+	 * @throws the first exception a task threw, once every worker has stopped
+	**/
+	void run(const size_t unitCount, const size_t morselSize,
+			const std::function<void (const int worker, const Morsel& morsel)>& task);
+
+	int getWorkerCount() const { return workerCount; }
+
+  /**
+	 * @return number of morsels stolen during the last run
+	**/
+	int getStealCount() const;
+};
+
+/**
+ * @brief GROUP BY over the records of a relation, with the results of HashAggregateOperator, computed by the
+ * workers of a MorselScheduler.
+ *
+ * The relation is read in morsels of MORSELPAGES heap pages, or, given a BTreeIndex and a range, in morsels of
+ * MORSELLEAVES leaves of the range. Each worker filters the records of its morsels with the predicate and
+ * aggregates them into an AggregateHashTable of its own, so the workers share nothing but the buffer manager;
+ * the tables are merged when they are done. Each worker pins at most two pages at a time.
+ * The groups have to fit in memory, there is no spilling. The predicate is called from several threads at once.
+*/
+class ParallelAggregateOperator : public QueryOperator {
+
+ private:
+
+	std::string	relationName;
+	BufMgr	*bufMgr;
+	Schema	recordSchema;
+	TuplePredicate	predicate;
+
+  /**
+   * Index the range is read from, NULL to read every page of the relation.
+   */
+	BTreeIndex	*index;
+	int			lowVal;
+	Operator	lowOp;
+	int			highVal;
+	Operator	highOp;
+
+	MorselScheduler	scheduler;
+
+  /**
+   * Positions of the group columns and the aggregated columns in recordSchema, -1 for COUNT(*).
+   */
+	std::vector<int>	groupColumns;
+	std::vector<AggregateSpec>	aggregates;
+	std::vector<int>	aggregateColumns;
+
+  /**
+   * Bytes of the group columns at the start of a result tuple.
+   */
+	int			keyLength;
+
+  /**
+   * The merged groups, and the next one to return.
+   */
+	AggregateHashTable	table;
+	size_t	nextGroup;
+
+  /**
+   * The tuple last returned.
+   */
+	std::vector<char>	buffer;
+
+	void init(const std::vector<std::string>& groupColumnNames);
+
+  /**
+	 * Aggregate record into table if it satisfies the predicate, using key as space for its group key.
+	**/
+	void aggregateRecord(AggregateHashTable& table, const char* record, char* key) const;
+
+  /**
+	 * Aggregate the records of the heap pages of a morsel.
+	**/
+	void aggregatePages(PageFile* file, const std::vector<PageId>& pageNos, const Morsel& morsel,
+						AggregateHashTable& table) const;
+
+  /**
+	 * Aggregate the records of the index entries in the range in the leaves of a morsel.
+	**/
+	void aggregateLeaves(PageFile* file, const std::vector<PageId>& leafPageNos, const Morsel& morsel,
+						AggregateHashTable& table) const;
+
+ public:
+
+  /**
+   * @param schema			Layout of the records of relationName
+   * @param predicate		Condition on the records to aggregate, all of them if it is empty
+   * @param workerCount	Number of threads, the number of cores if 0
+	**/
+	ParallelAggregateOperator(const std::string & relationName, BufMgr *bufMgrIn, const Schema& schema,
+						const TuplePredicate& predicate, const std::vector<std::string>& groupColumnNames,
+						const std::vector<AggregateSpec>& aggregates, const int workerCount = 0);
+
+  /**
+   * @param index			Index on an INTEGER column of relationName, owned by the caller
+   * The range is given as for BTreeIndex::startScan().
+	**/
+	ParallelAggregateOperator(const std::string & relationName, BufMgr *bufMgrIn, const Schema& schema,
+						const TuplePredicate& predicate, BTreeIndex *index, int lowVal, const Operator lowOp,
+						int highVal, const Operator highOp, const std::vector<std::string>& groupColumnNames,
+						const std::vector<AggregateSpec>& aggregates, const int workerCount = 0);
+	~ParallelAggregateOperator();
+	void open();
+	bool next(TupleRef& outTuple);
+	void close();
+
+  /**
+	 * @return number of morsels workers stole from each other while the operator was last opened
+	**/
+	int getStealCount() const { return scheduler.getStealCount(); }
+};
+
+}
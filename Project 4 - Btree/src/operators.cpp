@@ -0,0 +1,1180 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cstring>
+#include <algorithm>
+#include "operators.h"
+#include "exceptions/no_such_column_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/end_of_file_exception.h"
+#include "exceptions/bad_index_info_exception.h"
+
+namespace badgerdb
+{
+
+static std::string stringValue(const char* data, const int length)
+{
+	return std::string(data, strnlen(data, length));
+}
+
+// -----------------------------------------------------------------------------
+// Schema::Schema -- Constructor
+// -----------------------------------------------------------------------------
+
+Schema::Schema()
+{
+	tupleLength = 0;
+}
+
+// -----------------------------------------------------------------------------
+// Schema::addColumn
+// -----------------------------------------------------------------------------
+
+void Schema::addColumn(const std::string& name, const Datatype type, const int length)
+{
+	int size = type == INTEGER ? sizeof(int) : type == DOUBLE ? sizeof(double) : length;
+	addColumnAt(name, type, tupleLength, size);
+}
+
+// -----------------------------------------------------------------------------
+// Schema::addColumnAt
+// -----------------------------------------------------------------------------
+
+void Schema::addColumnAt(const std::string& name, const Datatype type, const int offset, const int length)
+{
+	Column column;
+	column.name = name;
+	column.type = type;
+	column.offset = offset;
+	column.length = length;
+	columns.push_back(column);
+	tupleLength = std::max(tupleLength, offset + length);
+}
+
+// -----------------------------------------------------------------------------
+// Schema::append
+// -----------------------------------------------------------------------------
+
+void Schema::append(const Schema& other)
+{
+	int base = tupleLength;
+	for(size_t i = 0; i < other.columns.size(); i++) {
+		addColumnAt(other.columns[i].name, other.columns[i].type, base + other.columns[i].offset, other.columns[i].length);
+	}
+	tupleLength = base + other.tupleLength;
+}
+
+// -----------------------------------------------------------------------------
+// Schema::find
+// -----------------------------------------------------------------------------
+
+int Schema::find(const std::string& name) const
+{
+	for(size_t i = 0; i < columns.size(); i++) {
+		if(columns[i].name == name) {
+			return i;
+		}
+	}
+	throw NoSuchColumnException(name);
+}
+
+// -----------------------------------------------------------------------------
+// Schema::getInt
+// -----------------------------------------------------------------------------
+
+int Schema::getInt(const char* tuple, const int column) const
+{
+	int value;
+	memcpy(&value, tuple + columns[column].offset, sizeof(int));
+	return value;
+}
+
+// -----------------------------------------------------------------------------
+// Schema::getDouble
+// -----------------------------------------------------------------------------
+
+double Schema::getDouble(const char* tuple, const int column) const
+{
+	double value;
+	memcpy(&value, tuple + columns[column].offset, sizeof(double));
+	return value;
+}
+
+// -----------------------------------------------------------------------------
+// Schema::getNumber
+// -----------------------------------------------------------------------------
+
+double Schema::getNumber(const char* tuple, const int column) const
+{
+	return columns[column].type == INTEGER ? getInt(tuple, column) : getDouble(tuple, column);
+}
+
+// -----------------------------------------------------------------------------
+// Schema::getString
+// -----------------------------------------------------------------------------
+
+std::string Schema::getString(const char* tuple, const int column) const
+{
+	return stringValue(tuple + columns[column].offset, columns[column].length);
+}
+
+// -----------------------------------------------------------------------------
+// compareValues
+// -----------------------------------------------------------------------------
+
+int compareValues(const char* left, const Column& leftColumn, const char* right, const Column& rightColumn)
+{
+	if(leftColumn.type == STRING || rightColumn.type == STRING) {
+		return stringValue(left + leftColumn.offset, leftColumn.length).compare(stringValue(right + rightColumn.offset, rightColumn.length));
+	}
+	if(leftColumn.type == INTEGER && rightColumn.type == INTEGER) {
+		int l, r;
+		memcpy(&l, left + leftColumn.offset, sizeof(int));
+		memcpy(&r, right + rightColumn.offset, sizeof(int));
+		return l < r ? -1 : l > r ? 1 : 0;
+	}
+	double l, r;
+	if(leftColumn.type == INTEGER) {
+		int value;
+		memcpy(&value, left + leftColumn.offset, sizeof(int));
+		l = value;
+	} else {
+		memcpy(&l, left + leftColumn.offset, sizeof(double));
+	}
+	if(rightColumn.type == INTEGER) {
+		int value;
+		memcpy(&value, right + rightColumn.offset, sizeof(int));
+		r = value;
+	} else {
+		memcpy(&r, right + rightColumn.offset, sizeof(double));
+	}
+	return l < r ? -1 : l > r ? 1 : 0;
+}
+
+// -----------------------------------------------------------------------------
+// ScanOperator::ScanOperator -- Constructor
+// -----------------------------------------------------------------------------
+
+ScanOperator::ScanOperator(const std::string & relationName, BufMgr *bufMgrIn, const Schema& schema)
+{
+	this->relationName = relationName;
+	this->bufMgr = bufMgrIn;
+	this->schema = schema;
+	this->scan = NULL;
+}
+
+ScanOperator::~ScanOperator()
+{
+	close();
+}
+
+// -----------------------------------------------------------------------------
+// ScanOperator::open
+// -----------------------------------------------------------------------------
+
+void ScanOperator::open()
+{
+	close();
+	scan = new FileScan(relationName, bufMgr);
+}
+
+// -----------------------------------------------------------------------------
+// ScanOperator::next
+// -----------------------------------------------------------------------------
+
+bool ScanOperator::next(TupleRef& outTuple)
+{
+	try
+	{
+		scan->scanNext(outTuple.rid);
+	}
+	catch(const EndOfFileException& e)
+	{
+		return false;
+	}
+	std::size_t length;
+	outTuple.data = scan->getRecordData(length);
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// ScanOperator::close
+// -----------------------------------------------------------------------------
+
+void ScanOperator::close()
+{
+	if(scan != NULL) {
+		delete scan;
+		scan = NULL;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// IndexScanOperator::IndexScanOperator -- Constructor
+// -----------------------------------------------------------------------------
+
+IndexScanOperator::IndexScanOperator(const std::string & relationName, BufMgr *bufMgrIn, const Schema& schema,
+		BTreeIndex *index, int lowVal, const Operator lowOp, int highVal, const Operator highOp, const bool descending)
+{
+	this->relationName = relationName;
+	this->bufMgr = bufMgrIn;
+	this->schema = schema;
+	this->index = index;
+	this->lowVal = lowVal;
+	this->lowOp = lowOp;
+	this->highVal = highVal;
+	this->highOp = highOp;
+	this->file = NULL;
+	this->curPage = NULL;
+	this->scanning = false;
+	this->descending = descending;
+	this->keyColumn = -1;
+	for(size_t i = 0; i < schema.columns.size(); i++) {
+		if(schema.columns[i].type == INTEGER && schema.columns[i].offset == index->getAttrByteOffset()) {
+			this->keyColumn = i;
+		}
+	}
+	this->bounded = false;
+	this->bound = 0;
+}
+
+IndexScanOperator::~IndexScanOperator()
+{
+	close();
+}
+
+// -----------------------------------------------------------------------------
+// IndexScanOperator::open
+// -----------------------------------------------------------------------------
+
+void IndexScanOperator::open()
+{
+	close();
+	file = new PageFile(relationName, false);
+	bounded = false;
+	try
+	{
+		index->startScan(&lowVal, lowOp, &highVal, highOp, descending);
+		scanning = true;
+	}
+	catch(const NoSuchKeyFoundException& e)
+	{
+	}
+}
+
+// -----------------------------------------------------------------------------
+// IndexScanOperator::next
+// -----------------------------------------------------------------------------
+
+bool IndexScanOperator::next(TupleRef& outTuple)
+{
+	if(!scanning) {
+		return false;
+	}
+	try
+	{
+		index->scanNext(outTuple.rid);
+	}
+	catch(const IndexScanCompletedException& e)
+	{
+		index->endScan();
+		scanning = false;
+		return false;
+	}
+
+	// keep the heap page pinned while the records are on it
+	if(curPage == NULL || outTuple.rid.page_number != curPageNo) {
+		if(curPage != NULL) {
+			bufMgr->unPinPage(file, curPageNo, false);
+		}
+		curPageNo = outTuple.rid.page_number;
+		bufMgr->readPage(file, curPageNo, curPage);
+	}
+	std::size_t length;
+	outTuple.data = curPage->getRecordData(outTuple.rid, &length);
+
+	// keys come in order, so the first one past the bound ends the scan
+	if(bounded) {
+		int key = schema.getInt(outTuple.data, keyColumn);
+		if(descending ? key < bound : key > bound) {
+			index->endScan();
+			scanning = false;
+			return false;
+		}
+	}
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// IndexScanOperator::limitColumn
+// -----------------------------------------------------------------------------
+
+void IndexScanOperator::limitColumn(const std::string& column, const double bound, const bool descending)
+{
+	if(keyColumn >= 0 && descending == this->descending && schema.columns[keyColumn].name == column) {
+		this->bounded = true;
+		this->bound = bound;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// IndexScanOperator::close
+// -----------------------------------------------------------------------------
+
+void IndexScanOperator::close()
+{
+	if(scanning) {
+		index->endScan();
+		scanning = false;
+	}
+	if(curPage != NULL) {
+		bufMgr->unPinPage(file, curPageNo, false);
+		curPage = NULL;
+	}
+	if(file != NULL) {
+		bufMgr->flushFile(file);
+		delete file;
+		file = NULL;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// FilterOperator::FilterOperator -- Constructor
+// -----------------------------------------------------------------------------
+
+FilterOperator::FilterOperator(QueryOperator *child, const TuplePredicate& predicate)
+{
+	this->child = child;
+	this->predicate = predicate;
+	this->schema = child->getSchema();
+}
+
+FilterOperator::~FilterOperator()
+{
+	delete child;
+}
+
+void FilterOperator::open()
+{
+	child->open();
+}
+
+// -----------------------------------------------------------------------------
+// FilterOperator::next
+// -----------------------------------------------------------------------------
+
+bool FilterOperator::next(TupleRef& outTuple)
+{
+	while(child->next(outTuple)) {
+		if(predicate(outTuple.data)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void FilterOperator::close()
+{
+	child->close();
+}
+
+void FilterOperator::limitColumn(const std::string& column, const double bound, const bool descending)
+{
+	// a filter keeps the order and the columns of its child
+	child->limitColumn(column, bound, descending);
+}
+
+// -----------------------------------------------------------------------------
+// ProjectOperator::ProjectOperator -- Constructor
+// -----------------------------------------------------------------------------
+
+ProjectOperator::ProjectOperator(QueryOperator *child, const std::vector<std::string>& columnNames)
+{
+	this->child = child;
+	const Schema& childSchema = child->getSchema();
+	for(size_t i = 0; i < columnNames.size(); i++) {
+		const Column& column = childSchema.columns[childSchema.find(columnNames[i])];
+		int offset = column.offset;
+		int length = column.length;
+		addColumn(column.name, column.type, column.length, [offset, length](const char* tuple, char* out) {
+			memcpy(out, tuple + offset, length);
+		});
+	}
+}
+
+ProjectOperator::~ProjectOperator()
+{
+	delete child;
+}
+
+// -----------------------------------------------------------------------------
+// ProjectOperator::addColumn
+// -----------------------------------------------------------------------------
+
+void ProjectOperator::addColumn(const std::string& name, const Datatype type, const int length, const TupleFunction& function)
+{
+	schema.addColumn(name, type, length);
+	functions.push_back(function);
+}
+
+void ProjectOperator::open()
+{
+	buffer.assign(schema.tupleLength, 0);
+	child->open();
+}
+
+// -----------------------------------------------------------------------------
+// ProjectOperator::next
+// -----------------------------------------------------------------------------
+
+bool ProjectOperator::next(TupleRef& outTuple)
+{
+	if(!child->next(outTuple)) {
+		return false;
+	}
+	for(size_t i = 0; i < functions.size(); i++) {
+		functions[i](outTuple.data, &buffer[schema.columns[i].offset]);
+	}
+	outTuple.data = &buffer[0];
+	return true;
+}
+
+void ProjectOperator::close()
+{
+	child->close();
+}
+
+// -----------------------------------------------------------------------------
+// JoinOperator::JoinOperator -- Constructor
+// -----------------------------------------------------------------------------
+
+JoinOperator::JoinOperator(QueryOperator *left, QueryOperator *right, const JoinPredicate& predicate)
+{
+	this->left = left;
+	this->right = right;
+	this->predicate = predicate;
+	this->schema = left->getSchema();
+	this->schema.append(right->getSchema());
+	this->rightCount = 0;
+	this->haveLeft = false;
+}
+
+JoinOperator::JoinOperator(QueryOperator *left, QueryOperator *right, const std::string& leftColumn, const std::string& rightColumn)
+{
+	this->left = left;
+	this->right = right;
+	Column l = left->getSchema().columns[left->getSchema().find(leftColumn)];
+	Column r = right->getSchema().columns[right->getSchema().find(rightColumn)];
+	this->predicate = [l, r](const char* leftTuple, const char* rightTuple) {
+		return compareValues(leftTuple, l, rightTuple, r) == 0;
+	};
+	this->schema = left->getSchema();
+	this->schema.append(right->getSchema());
+	this->rightCount = 0;
+	this->haveLeft = false;
+}
+
+JoinOperator::~JoinOperator()
+{
+	delete left;
+	delete right;
+}
+
+// -----------------------------------------------------------------------------
+// JoinOperator::open
+// -----------------------------------------------------------------------------
+
+void JoinOperator::open()
+{
+	int rightLength = right->getSchema().tupleLength;
+	rightTuples.clear();
+	rightCount = 0;
+	right->open();
+	TupleRef tuple;
+	while(right->next(tuple)) {
+		rightTuples.insert(rightTuples.end(), tuple.data, tuple.data + rightLength);
+		rightCount++;
+	}
+	right->close();
+
+	buffer.assign(schema.tupleLength, 0);
+	haveLeft = false;
+	left->open();
+}
+
+// -----------------------------------------------------------------------------
+// JoinOperator::next
+// -----------------------------------------------------------------------------
+
+bool JoinOperator::next(TupleRef& outTuple)
+{
+	int leftLength = left->getSchema().tupleLength;
+	int rightLength = right->getSchema().tupleLength;
+	while(true) {
+		if(!haveLeft) {
+			TupleRef tuple;
+			if(rightCount == 0 || !left->next(tuple)) {
+				return false;
+			}
+			memcpy(&buffer[0], tuple.data, leftLength);
+			outTuple.rid = tuple.rid;
+			haveLeft = true;
+			nextRight = 0;
+		}
+		while(nextRight < rightCount) {
+			const char* rightTuple = &rightTuples[nextRight++ * rightLength];
+			if(predicate(&buffer[0], rightTuple)) {
+				memcpy(&buffer[leftLength], rightTuple, rightLength);
+				outTuple.data = &buffer[0];
+				return true;
+			}
+		}
+		haveLeft = false;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// JoinOperator::close
+// -----------------------------------------------------------------------------
+
+void JoinOperator::close()
+{
+	left->close();
+	std::vector<char>().swap(rightTuples);
+	rightCount = 0;
+}
+
+// -----------------------------------------------------------------------------
+// IndexJoinOperator::IndexJoinOperator -- Constructor
+// -----------------------------------------------------------------------------
+
+IndexJoinOperator::IndexJoinOperator(QueryOperator *left, const std::string& leftColumn, const std::string & relationName,
+		BufMgr *bufMgrIn, const Schema& schema, BTreeIndex *index)
+{
+	this->left = left;
+	this->relationName = relationName;
+	this->bufMgr = bufMgrIn;
+	this->index = index;
+	this->leftKey = left->getSchema().columns[left->getSchema().find(leftColumn)];
+	// the probes read the key as an int, any other column would be reinterpreted
+	if(leftKey.type != INTEGER)
+	{
+		delete left;
+		throw BadIndexInfoException("Index join column " + leftColumn + " is not an INTEGER");
+	}
+	this->schema = left->getSchema();
+	this->schema.append(schema);
+	this->file = NULL;
+	this->curPage = NULL;
+	this->nextLeft = 0;
+	this->haveMatches = false;
+	this->nextMatch = 0;
+	this->leftDone = true;
+}
+
+IndexJoinOperator::~IndexJoinOperator()
+{
+	close();
+	delete left;
+}
+
+// -----------------------------------------------------------------------------
+// IndexJoinOperator::open
+// -----------------------------------------------------------------------------
+
+void IndexJoinOperator::open()
+{
+	close();
+	file = new PageFile(relationName, false);
+	buffer.assign(schema.tupleLength, 0);
+	left->open();
+	leftDone = false;
+}
+
+// -----------------------------------------------------------------------------
+// IndexJoinOperator::readBatch
+// -----------------------------------------------------------------------------
+
+bool IndexJoinOperator::readBatch()
+{
+	int leftLength = left->getSchema().tupleLength;
+	batch.clear();
+	batchRids.clear();
+	batchKeys.clear();
+	TupleRef tuple;
+	while(!leftDone && batchKeys.size() < (size_t)INDEXJOINBATCHSIZE) {
+		if(!left->next(tuple)) {
+			leftDone = true;
+			break;
+		}
+		int key;
+		memcpy(&key, tuple.data + leftKey.offset, sizeof(int));
+		batch.insert(batch.end(), tuple.data, tuple.data + leftLength);
+		batchRids.push_back(tuple.rid);
+		batchKeys.push_back(key);
+	}
+
+	order.resize(batchKeys.size());
+	for(size_t i = 0; i < order.size(); i++) {
+		order[i] = i;
+	}
+	const std::vector<int>& keys = batchKeys;
+	std::stable_sort(order.begin(), order.end(), [&keys](const size_t a, const size_t b) { return keys[a] < keys[b]; });
+	nextLeft = 0;
+	return !order.empty();
+}
+
+// -----------------------------------------------------------------------------
+// IndexJoinOperator::next
+// -----------------------------------------------------------------------------
+
+bool IndexJoinOperator::next(TupleRef& outTuple)
+{
+	int leftLength = left->getSchema().tupleLength;
+	int rightLength = schema.tupleLength - leftLength;
+	while(true) {
+		if(nextMatch < matches.size()) {
+			RecordId rid = matches[nextMatch++];
+
+			// keep the heap page pinned while the records are on it
+			if(curPage == NULL || rid.page_number != curPageNo) {
+				if(curPage != NULL) {
+					bufMgr->unPinPage(file, curPageNo, false);
+				}
+				curPageNo = rid.page_number;
+				bufMgr->readPage(file, curPageNo, curPage);
+			}
+			std::size_t length;
+			memcpy(&buffer[leftLength], curPage->getRecordData(rid, &length), rightLength);
+			outTuple.data = &buffer[0];
+			outTuple.rid = batchRids[order[nextLeft - 1]];
+			return true;
+		}
+
+		if(nextLeft == order.size() && !readBatch()) {
+			return false;
+		}
+		size_t position = order[nextLeft++];
+		memcpy(&buffer[0], &batch[position * leftLength], leftLength);
+
+		// left tuples with the same key share one probe, even across batches
+		int key = batchKeys[position];
+		if(!haveMatches || key != matchKey) {
+			matches.clear();
+			index->probeSorted(&key, [this](const RecordId& rid) { matches.push_back(rid); });
+			matchKey = key;
+			haveMatches = true;
+		}
+		nextMatch = 0;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// IndexJoinOperator::close
+// -----------------------------------------------------------------------------
+
+void IndexJoinOperator::close()
+{
+	if(file != NULL) {
+		left->close();
+		index->endProbes();
+	}
+	if(curPage != NULL) {
+		bufMgr->unPinPage(file, curPageNo, false);
+		curPage = NULL;
+	}
+	if(file != NULL) {
+		bufMgr->flushFile(file);
+		delete file;
+		file = NULL;
+	}
+	batch.clear();
+	batchRids.clear();
+	batchKeys.clear();
+	order.clear();
+	matches.clear();
+	nextLeft = 0;
+	nextMatch = 0;
+	haveMatches = false;
+	leftDone = true;
+}
+
+// -----------------------------------------------------------------------------
+// SemiJoinOperator::SemiJoinOperator -- Constructor
+// -----------------------------------------------------------------------------
+
+SemiJoinOperator::SemiJoinOperator(QueryOperator *left, QueryOperator *right, const std::string& leftColumn,
+		const std::string& rightColumn, const bool anti)
+{
+	this->left = left;
+	this->right = right;
+	this->leftKey = left->getSchema().columns[left->getSchema().find(leftColumn)];
+	this->rightKey = right->getSchema().columns[right->getSchema().find(rightColumn)];
+	this->anti = anti;
+	this->schema = left->getSchema();
+}
+
+SemiJoinOperator::~SemiJoinOperator()
+{
+	close();
+	delete left;
+	delete right;
+}
+
+// -----------------------------------------------------------------------------
+// SemiJoinOperator::keyOf
+// -----------------------------------------------------------------------------
+
+std::string SemiJoinOperator::keyOf(const char* tuple, const Column& column)
+{
+	if(column.type == STRING) {
+		return stringValue(tuple + column.offset, column.length);
+	}
+	double number;
+	if(column.type == INTEGER) {
+		int value;
+		memcpy(&value, tuple + column.offset, sizeof(int));
+		number = value;
+	} else {
+		memcpy(&number, tuple + column.offset, sizeof(double));
+	}
+	number = number == 0 ? 0 : number;
+	return std::string((const char*)&number, sizeof(double));
+}
+
+// -----------------------------------------------------------------------------
+// SemiJoinOperator::open
+// -----------------------------------------------------------------------------
+
+void SemiJoinOperator::open()
+{
+	keys.clear();
+	right->open();
+	TupleRef tuple;
+	while(right->next(tuple)) {
+		keys.insert(keyOf(tuple.data, rightKey));
+	}
+	right->close();
+	left->open();
+}
+
+// -----------------------------------------------------------------------------
+// SemiJoinOperator::next
+// -----------------------------------------------------------------------------
+
+bool SemiJoinOperator::next(TupleRef& outTuple)
+{
+	while(left->next(outTuple)) {
+		if((keys.count(keyOf(outTuple.data, leftKey)) != 0) != anti) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void SemiJoinOperator::close()
+{
+	left->close();
+	keys.clear();
+}
+
+void SemiJoinOperator::limitColumn(const std::string& column, const double bound, const bool descending)
+{
+	// like a filter, the join keeps the order and the columns of its left child
+	left->limitColumn(column, bound, descending);
+}
+
+// -----------------------------------------------------------------------------
+// AggregateOperator::AggregateOperator -- Constructor
+// -----------------------------------------------------------------------------
+
+AggregateOperator::AggregateOperator(QueryOperator *child, const std::vector<std::string>& groupColumnNames,
+		const std::vector<AggregateSpec>& aggregates)
+{
+	this->child = child;
+	this->aggregates = aggregates;
+	const Schema& childSchema = child->getSchema();
+	for(size_t i = 0; i < groupColumnNames.size(); i++) {
+		int column = childSchema.find(groupColumnNames[i]);
+		groupColumns.push_back(column);
+		schema.addColumn(childSchema.columns[column].name, childSchema.columns[column].type, childSchema.columns[column].length);
+	}
+	for(size_t i = 0; i < aggregates.size(); i++) {
+		aggregateColumns.push_back(aggregates[i].column.empty() ? -1 : childSchema.find(aggregates[i].column));
+		schema.addColumn(aggregates[i].name, isCountAggregate(aggregates[i].function) ? INTEGER : DOUBLE);
+	}
+}
+
+AggregateOperator::~AggregateOperator()
+{
+	delete child;
+}
+
+// -----------------------------------------------------------------------------
+// AggregateOperator::open
+// -----------------------------------------------------------------------------
+
+void AggregateOperator::open()
+{
+	const Schema& childSchema = child->getSchema();
+	int groupLength = groupColumns.empty() ? 0 : schema.columns[groupColumns.size() - 1].offset + schema.columns[groupColumns.size() - 1].length;
+	std::string groupKey(groupLength, 0);
+	groups.clear();
+	distinctValues.clear();
+	sketches.clear();
+	if(groupColumns.empty()) {
+		groups[groupKey].assign(2 * aggregates.size(), 0);
+	}
+
+	child->open();
+	TupleRef tuple;
+	while(child->next(tuple)) {
+		for(size_t i = 0; i < groupColumns.size(); i++) {
+			const Column& column = childSchema.columns[groupColumns[i]];
+			memcpy(&groupKey[schema.columns[i].offset], tuple.data + column.offset, column.length);
+		}
+		std::vector<double>& state = groups[groupKey];
+		if(state.empty()) {
+			state.assign(2 * aggregates.size(), 0);
+		}
+
+		// each aggregate keeps a value and the number of values it has seen
+		for(size_t i = 0; i < aggregates.size(); i++) {
+			if(aggregates[i].function == AGGCOUNTDISTINCT || aggregates[i].function == AGGAPPROXCOUNTDISTINCT) {
+				// numbers are kept as doubles, so that 1 and 1.0 are the same value
+				std::string value;
+				const Column& column = childSchema.columns[aggregateColumns[i]];
+				if(column.type == STRING) {
+					value = childSchema.getString(tuple.data, aggregateColumns[i]);
+				} else {
+					double number = childSchema.getNumber(tuple.data, aggregateColumns[i]);
+					number = number == 0 ? 0 : number;
+					value.assign((const char*)&number, sizeof(double));
+				}
+				if(aggregates[i].function == AGGCOUNTDISTINCT) {
+					std::vector<std::set<std::string> >& values = distinctValues[groupKey];
+					values.resize(aggregates.size());
+					values[i].insert(value);
+				} else {
+					std::vector<HyperLogLog>& sketch = sketches[groupKey];
+					sketch.resize(aggregates.size());
+					sketch[i].add(HyperLogLog::hashValue(value.data(), value.size()));
+				}
+				continue;
+			}
+			double value = aggregateColumns[i] < 0 ? 0 : childSchema.getNumber(tuple.data, aggregateColumns[i]);
+			double& current = state[2 * i];
+			if(aggregates[i].function == AGGSUM || aggregates[i].function == AGGAVG) {
+				current += value;
+			} else if(aggregates[i].function == AGGMIN) {
+				current = state[2 * i + 1] == 0 ? value : std::min(current, value);
+			} else if(aggregates[i].function == AGGMAX) {
+				current = state[2 * i + 1] == 0 ? value : std::max(current, value);
+			}
+			state[2 * i + 1]++;
+		}
+	}
+	child->close();
+
+	buffer.assign(schema.tupleLength, 0);
+	nextGroup = groups.begin();
+}
+
+// -----------------------------------------------------------------------------
+// AggregateOperator::next
+// -----------------------------------------------------------------------------
+
+bool AggregateOperator::next(TupleRef& outTuple)
+{
+	if(nextGroup == groups.end()) {
+		return false;
+	}
+	memcpy(&buffer[0], nextGroup->first.data(), nextGroup->first.size());
+	const std::vector<double>& state = nextGroup->second;
+	for(size_t i = 0; i < aggregates.size(); i++) {
+		const Column& column = schema.columns[groupColumns.size() + i];
+		if(aggregates[i].function == AGGCOUNT) {
+			int count = state[2 * i + 1];
+			memcpy(&buffer[column.offset], &count, sizeof(int));
+		} else if(aggregates[i].function == AGGCOUNTDISTINCT) {
+			std::map<std::string, std::vector<std::set<std::string> > >::const_iterator values = distinctValues.find(nextGroup->first);
+			int count = values == distinctValues.end() ? 0 : values->second[i].size();
+			memcpy(&buffer[column.offset], &count, sizeof(int));
+		} else if(aggregates[i].function == AGGAPPROXCOUNTDISTINCT) {
+			std::map<std::string, std::vector<HyperLogLog> >::iterator sketch = sketches.find(nextGroup->first);
+			int count = sketch == sketches.end() ? 0 : (int)(sketch->second[i].estimate() + 0.5);
+			memcpy(&buffer[column.offset], &count, sizeof(int));
+		} else {
+			double value = state[2 * i];
+			if(aggregates[i].function == AGGAVG) {
+				value = state[2 * i + 1] == 0 ? 0 : value / state[2 * i + 1];
+			}
+			memcpy(&buffer[column.offset], &value, sizeof(double));
+		}
+	}
+	++nextGroup;
+	outTuple.data = &buffer[0];
+	outTuple.rid.page_number = Page::INVALID_NUMBER;
+	outTuple.rid.slot_number = Page::INVALID_SLOT;
+	return true;
+}
+
+void AggregateOperator::close()
+{
+	groups.clear();
+	distinctValues.clear();
+	sketches.clear();
+}
+
+// -----------------------------------------------------------------------------
+// SortOperator::SortOperator -- Constructor
+// -----------------------------------------------------------------------------
+
+SortOperator::SortOperator(QueryOperator *child, const std::vector<SortKey>& keys)
+{
+	this->child = child;
+	this->keys = keys;
+	this->schema = child->getSchema();
+	for(size_t i = 0; i < keys.size(); i++) {
+		keyColumns.push_back(schema.find(keys[i].column));
+	}
+}
+
+SortOperator::~SortOperator()
+{
+	delete child;
+}
+
+/**
+ * Orders tuple numbers by the sort keys of the tuples.
+ */
+struct TupleOrder {
+	const char* tuples;
+	int tupleLength;
+	const Schema* schema;
+	const std::vector<int>* keyColumns;
+	const std::vector<SortKey>* keys;
+
+	bool operator()(const size_t a, const size_t b) const
+	{
+		const char* left = tuples + a * tupleLength;
+		const char* right = tuples + b * tupleLength;
+		for(size_t i = 0; i < keyColumns->size(); i++) {
+			const Column& column = schema->columns[(*keyColumns)[i]];
+			int result = compareValues(left, column, right, column);
+			if(result != 0) {
+				return (*keys)[i].descending ? result > 0 : result < 0;
+			}
+		}
+		return false;
+	}
+};
+
+// -----------------------------------------------------------------------------
+// SortOperator::open
+// -----------------------------------------------------------------------------
+
+void SortOperator::open()
+{
+	tuples.clear();
+	child->open();
+	TupleRef tuple;
+	while(child->next(tuple)) {
+		tuples.insert(tuples.end(), tuple.data, tuple.data + schema.tupleLength);
+	}
+	child->close();
+
+	size_t count = schema.tupleLength == 0 ? 0 : tuples.size() / schema.tupleLength;
+	order.resize(count);
+	for(size_t i = 0; i < count; i++) {
+		order[i] = i;
+	}
+	TupleOrder less = {tuples.empty() ? NULL : &tuples[0], schema.tupleLength, &schema, &keyColumns, &keys};
+	std::stable_sort(order.begin(), order.end(), less);
+	nextTuple = 0;
+}
+
+// -----------------------------------------------------------------------------
+// SortOperator::next
+// -----------------------------------------------------------------------------
+
+bool SortOperator::next(TupleRef& outTuple)
+{
+	if(nextTuple == order.size()) {
+		return false;
+	}
+	outTuple.data = &tuples[order[nextTuple++] * schema.tupleLength];
+	outTuple.rid.page_number = Page::INVALID_NUMBER;
+	outTuple.rid.slot_number = Page::INVALID_SLOT;
+	return true;
+}
+
+void SortOperator::close()
+{
+	std::vector<char>().swap(tuples);
+	order.clear();
+}
+
+// -----------------------------------------------------------------------------
+// TopNOperator::TopNOperator -- Constructor
+// -----------------------------------------------------------------------------
+
+TopNOperator::TopNOperator(QueryOperator *child, const std::vector<SortKey>& keys, const size_t limit, const size_t offset)
+{
+	this->child = child;
+	this->keys = keys;
+	this->limit = limit;
+	this->offset = offset;
+	this->schema = child->getSchema();
+	for(size_t i = 0; i < keys.size(); i++) {
+		keyColumns.push_back(schema.find(keys[i].column));
+	}
+	this->nextTuple = 0;
+}
+
+TopNOperator::~TopNOperator()
+{
+	delete child;
+}
+
+// -----------------------------------------------------------------------------
+// TopNOperator::compareKeys
+// -----------------------------------------------------------------------------
+
+int TopNOperator::compareKeys(const char* a, const char* b) const
+{
+	for(size_t i = 0; i < keyColumns.size(); i++) {
+		const Column& column = schema.columns[keyColumns[i]];
+		int result = compareValues(a, column, b, column);
+		if(result != 0) {
+			return keys[i].descending ? -result : result;
+		}
+	}
+	return 0;
+}
+
+// -----------------------------------------------------------------------------
+// TopNOperator::open
+// -----------------------------------------------------------------------------
+
+void TopNOperator::open()
+{
+	close();
+	size_t capacity = limit + offset;
+	if(capacity == 0) {
+		return;
+	}
+
+	// the heap keeps the worst tuple on top, equal tuples ranking by their position in the child
+	int tupleLength = schema.tupleLength;
+	auto less = [this, tupleLength](const HeapEntry& a, const HeapEntry& b) {
+		int result = compareKeys(&tuples[a.slot * tupleLength], &tuples[b.slot * tupleLength]);
+		return result != 0 ? result < 0 : a.seq < b.seq;
+	};
+	bool bounding = !keys.empty() && schema.columns[keyColumns[0]].type != STRING;
+
+	child->open();
+	TupleRef tuple;
+	size_t seq = 0;
+	while(child->next(tuple)) {
+		if(heap.size() < capacity) {
+			tuples.insert(tuples.end(), tuple.data, tuple.data + tupleLength);
+			HeapEntry entry = {seq++, heap.size()};
+			heap.push_back(entry);
+			std::push_heap(heap.begin(), heap.end(), less);
+		} else if(compareKeys(tuple.data, &tuples[heap[0].slot * tupleLength]) < 0) {
+			// the tuple beats the worst one, which gives it its slot
+			std::pop_heap(heap.begin(), heap.end(), less);
+			HeapEntry& entry = heap.back();
+			memcpy(&tuples[entry.slot * tupleLength], tuple.data, tupleLength);
+			entry.seq = seq++;
+			std::push_heap(heap.begin(), heap.end(), less);
+		} else {
+			seq++;
+			continue;
+		}
+		if(bounding && heap.size() == capacity) {
+			child->limitColumn(keys[0].column, schema.getNumber(&tuples[heap[0].slot * tupleLength], keyColumns[0]), keys[0].descending);
+		}
+	}
+	child->close();
+	std::sort_heap(heap.begin(), heap.end(), less);
+	nextTuple = offset;
+}
+
+// -----------------------------------------------------------------------------
+// TopNOperator::next
+// -----------------------------------------------------------------------------
+
+bool TopNOperator::next(TupleRef& outTuple)
+{
+	if(nextTuple >= heap.size()) {
+		return false;
+	}
+	outTuple.data = &tuples[heap[nextTuple++].slot * schema.tupleLength];
+	outTuple.rid.page_number = Page::INVALID_NUMBER;
+	outTuple.rid.slot_number = Page::INVALID_SLOT;
+	return true;
+}
+
+void TopNOperator::close()
+{
+	std::vector<char>().swap(tuples);
+	heap.clear();
+	nextTuple = 0;
+}
+
+// -----------------------------------------------------------------------------
+// LimitOperator::LimitOperator -- Constructor
+// -----------------------------------------------------------------------------
+
+LimitOperator::LimitOperator(QueryOperator *child, const size_t limit, const size_t offset)
+{
+	this->child = child;
+	this->limit = limit;
+	this->offset = offset;
+	this->count = 0;
+	this->schema = child->getSchema();
+}
+
+LimitOperator::~LimitOperator()
+{
+	delete child;
+}
+
+void LimitOperator::open()
+{
+	count = 0;
+	child->open();
+}
+
+// -----------------------------------------------------------------------------
+// LimitOperator::next
+// -----------------------------------------------------------------------------
+
+bool LimitOperator::next(TupleRef& outTuple)
+{
+	while(count < offset) {
+		if(!child->next(outTuple)) {
+			return false;
+		}
+		count++;
+	}
+	if(count >= offset + limit || !child->next(outTuple)) {
+		return false;
+	}
+	count++;
+	return true;
+}
+
+void LimitOperator::close()
+{
+	child->close();
+}
+
+}
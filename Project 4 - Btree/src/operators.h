@@ -0,0 +1,766 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <functional>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+#include "filescan.h"
+#include "hyperloglog.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief A column of a tuple. Tuples are fixed length, an INTEGER is stored as an int, a DOUBLE as a double
+ * and a STRING as length chars padded with NULs.
+ */
+struct Column{
+  /**
+   * Name of the column.
+   */
+	std::string name;
+
+  /**
+   * Type of the column.
+   */
+	Datatype type;
+
+  /**
+   * Offset of the column in the tuple.
+   */
+	int offset;
+
+  /**
+   * Number of bytes of the column.
+   */
+	int length;
+};
+
+/**
+ * @brief The columns of the tuples an operator returns.
+*/
+class Schema {
+
+ public:
+
+  /**
+   * Columns in the order they were added.
+   */
+	std::vector<Column> columns;
+
+  /**
+   * Number of bytes of a tuple.
+   */
+	int tupleLength;
+
+	Schema();
+
+  /**
+	 * Append a column after the end of the tuple.
+   * @param length		Number of chars of a STRING column, ignored for INTEGER and DOUBLE
+	**/
+	void addColumn(const std::string& name, const Datatype type, const int length = 0);
+
+  /**
+	 * Add a column at offset, to describe records laid out by a struct, e.g. addColumnAt("d", DOUBLE,
+	 * offsetof(tuple,d), sizeof(double)). The tuple grows to the end of the column if it is not that long yet.
+	**/
+	void addColumnAt(const std::string& name, const Datatype type, const int offset, const int length);
+
+  /**
+	 * Append the columns of other after the end of the tuple, as a join lays out its result.
+	**/
+	void append(const Schema& other);
+
+  /**
+	 * @return position of the first column called name in columns
+	 * @throws NoSuchColumnException If there is no such column.
+	**/
+	int find(const std::string& name) const;
+
+  /**
+	 * @return value of INTEGER column of tuple
+	**/
+	int getInt(const char* tuple, const int column) const;
+
+  /**
+	 * @return value of DOUBLE column of tuple
+	**/
+	double getDouble(const char* tuple, const int column) const;
+
+  /**
+	 * @return value of INTEGER or DOUBLE column of tuple as a double
+	**/
+	double getNumber(const char* tuple, const int column) const;
+
+  /**
+	 * @return value of STRING column of tuple, without the padding
+	**/
+	std::string getString(const char* tuple, const int column) const;
+};
+
+/**
+ * @return negative, zero or positive as value leftColumn of left is less than, equal to or greater than value
+ * rightColumn of right. Numbers compare as numbers and strings byte by byte.
+**/
+int compareValues(const char* left, const Column& leftColumn, const char* right, const Column& rightColumn);
+
+/**
+ * @brief A tuple handed from an operator to its parent.
+ * data points into a page the operator keeps pinned or into a buffer it owns. Either way it stays valid until
+ * the next call of next() or close() on that operator, a parent that needs a tuple for longer copies it.
+*/
+struct TupleRef{
+  /**
+   * First byte of the tuple, laid out as the schema of the operator says.
+   */
+	const char* data;
+
+  /**
+   * Record id of the record, for tuples that are records of a relation.
+   */
+	RecordId rid;
+};
+
+/**
+ * @brief Condition on a tuple.
+ */
+typedef std::function<bool (const char* tuple)> TuplePredicate;
+
+/**
+ * @brief Condition on a pair of tuples, the left one first.
+ */
+typedef std::function<bool (const char* left, const char* right)> JoinPredicate;
+
+/**
+ * @brief Computes a value from a tuple and writes it to out, as a column of the type it is declared with.
+ */
+typedef std::function<void (const char* tuple, char* out)> TupleFunction;
+
+/**
+ * @brief An operator of a query plan, Volcano style.
+ *
+ * A parent calls open(), then next() until it returns false, then close(). Operators own their children and
+ * delete them when they are deleted. A closed operator may be opened again, which restarts it.
+*/
+class QueryOperator {
+
+ protected:
+
+  /**
+   * Columns of the tuples next() returns.
+   */
+	Schema	schema;
+
+ public:
+
+	virtual ~QueryOperator() {}
+
+  /**
+	 * Prepare to return tuples, opening the children.
+	**/
+	virtual void open() = 0;
+
+  /**
+	 * Return the next tuple.
+	 * @return false if there are no more tuples
+	**/
+	virtual bool next(TupleRef& outTuple) = 0;
+
+  /**
+	 * Release the pages and memory held, closing the children.
+	**/
+	virtual void close() = 0;
+
+  /**
+	 * Tell the operator that only tuples whose column is at most bound (at least bound if descending) are still
+	 * wanted, e.g. by a TopNOperator above it. An operator that returns tuples in that order may stop early, the
+	 * others ignore it or pass it on to their child.
+	**/
+	virtual void limitColumn(const std::string& column, const double bound, const bool descending) {}
+
+  /**
+	 * @return columns of the tuples next() returns
+	**/
+	const Schema& getSchema() const { return schema; }
+};
+
+/**
+ * @brief Returns the records of a relation in file order, pointing into the pinned pages of a FileScan.
+*/
+class ScanOperator : public QueryOperator {
+
+ private:
+
+	std::string	relationName;
+	BufMgr	*bufMgr;
+
+  /**
+   * Scan of the relation, NULL unless the operator is open.
+   */
+	FileScan	*scan;
+
+ public:
+
+  /**
+   * @param schema		Layout of the records of relationName
+	**/
+	ScanOperator(const std::string & relationName, BufMgr *bufMgrIn, const Schema& schema);
+	~ScanOperator();
+	void open();
+	bool next(TupleRef& outTuple);
+	void close();
+};
+
+/**
+ * @brief Returns the records of a relation found by a range scan of a BTreeIndex, in key order.
+ * The heap page of a record stays pinned while the following records are on the same page.
+*/
+class IndexScanOperator : public QueryOperator {
+
+ private:
+
+	std::string	relationName;
+	BufMgr	*bufMgr;
+	BTreeIndex	*index;
+	int			lowVal;
+	Operator	lowOp;
+	int			highVal;
+	Operator	highOp;
+
+  /**
+   * The relation, NULL unless the operator is open.
+   */
+	PageFile	*file;
+
+  /**
+   * Heap page of the last record returned, NULL if none is pinned.
+   */
+	Page		*curPage;
+	PageId	curPageNo;
+
+  /**
+   * True while the index scan has entries left.
+   */
+	bool		scanning;
+
+  /**
+   * True if the scan returns the records from the highest key down.
+   */
+	bool		descending;
+
+  /**
+   * Position of the indexed column in the schema, -1 if it is not there.
+   */
+	int			keyColumn;
+
+  /**
+   * True once limitColumn() has given a bound for the indexed column: the scan ends at the first key past it.
+   */
+	bool		bounded;
+	double	bound;
+
+ public:
+
+  /**
+   * @param index			Index on an INTEGER column of relationName, owned by the caller
+   * @param schema		Layout of the records of relationName
+   * The range and descending are given as for BTreeIndex::startScan().
+	**/
+	IndexScanOperator(const std::string & relationName, BufMgr *bufMgrIn, const Schema& schema, BTreeIndex *index,
+						int lowVal, const Operator lowOp, int highVal, const Operator highOp, const bool descending = false);
+	~IndexScanOperator();
+	void open();
+	bool next(TupleRef& outTuple);
+	void close();
+	void limitColumn(const std::string& column, const double bound, const bool descending);
+};
+
+/**
+ * @brief Returns the tuples of its child that satisfy a predicate.
+*/
+class FilterOperator : public QueryOperator {
+
+ private:
+
+	QueryOperator	*child;
+	TuplePredicate	predicate;
+
+ public:
+
+	FilterOperator(QueryOperator *child, const TuplePredicate& predicate);
+	~FilterOperator();
+	void open();
+	bool next(TupleRef& outTuple);
+	void close();
+	void limitColumn(const std::string& column, const double bound, const bool descending);
+};
+
+/**
+ * @brief Returns chosen and computed columns of the tuples of its child, packed into a new tuple.
+*/
+class ProjectOperator : public QueryOperator {
+
+ private:
+
+	QueryOperator	*child;
+
+  /**
+   * Computes each column of the result from a tuple of the child.
+   */
+	std::vector<TupleFunction>	functions;
+
+  /**
+   * The tuple last returned.
+   */
+	std::vector<char>	buffer;
+
+ public:
+
+  /**
+   * @param columnNames		Columns of the child to keep, more can be added with addColumn()
+	**/
+	ProjectOperator(QueryOperator *child, const std::vector<std::string>& columnNames);
+	~ProjectOperator();
+
+  /**
+	 * Append a column computed by function, e.g. WeeklySales/Size. Call before open().
+	**/
+	void addColumn(const std::string& name, const Datatype type, const int length, const TupleFunction& function);
+
+	void open();
+	bool next(TupleRef& outTuple);
+	void close();
+};
+
+/**
+ * @brief Nested loop join, returning each pair of tuples that satisfies a predicate as the left tuple followed
+ * by the right tuple.
+ * The right child is read into memory when the join is opened and the left child is read once.
+*/
+class JoinOperator : public QueryOperator {
+
+ private:
+
+	QueryOperator	*left;
+	QueryOperator	*right;
+	JoinPredicate	predicate;
+
+  /**
+   * Tuples of the right child, one after another.
+   */
+	std::vector<char>	rightTuples;
+
+  /**
+   * Number of tuples in rightTuples.
+   */
+	size_t	rightCount;
+
+  /**
+   * Position in rightTuples of the next right tuple to try with the current left tuple.
+   */
+	size_t	nextRight;
+
+  /**
+   * Current left tuple followed by the right tuple last returned.
+   */
+	std::vector<char>	buffer;
+
+  /**
+   * True while buffer holds a left tuple.
+   */
+	bool		haveLeft;
+
+ public:
+
+	JoinOperator(QueryOperator *left, QueryOperator *right, const JoinPredicate& predicate);
+
+  /**
+	 * Equi-join on leftColumn of left and rightColumn of right, NATURAL JOIN style.
+	**/
+	JoinOperator(QueryOperator *left, QueryOperator *right, const std::string& leftColumn, const std::string& rightColumn);
+	~JoinOperator();
+	void open();
+	bool next(TupleRef& outTuple);
+	void close();
+};
+
+/**
+ * @brief Number of left tuples an IndexJoinOperator reads and sorts before probing the index with them.
+ */
+const  int INDEXJOINBATCHSIZE = 1024;
+
+/**
+ * @brief Index nested loop equi-join, with the result tuples of JoinOperator, for a small left input and a large
+ * relation with a BTreeIndex on the join column.
+ * The left tuples are read in batches of INDEXJOINBATCHSIZE and sorted by key, then the index is probed once per
+ * distinct key with BTreeIndex::probeSorted(), which walks the leaves left to right instead of descending from
+ * the root for every key. The results of a batch come out in key order.
+*/
+class IndexJoinOperator : public QueryOperator {
+
+ private:
+
+	QueryOperator	*left;
+	std::string	relationName;
+	BufMgr	*bufMgr;
+	BTreeIndex	*index;
+
+  /**
+   * INTEGER key column of the left tuples.
+   */
+	Column	leftKey;
+
+  /**
+   * The relation, NULL unless the operator is open.
+   */
+	PageFile	*file;
+
+  /**
+   * Heap page of the last record returned, NULL if none is pinned.
+   */
+	Page		*curPage;
+	PageId	curPageNo;
+
+  /**
+   * Left tuples of the batch one after another, their record ids and keys, and their positions in key order.
+   */
+	std::vector<char>	batch;
+	std::vector<RecordId>	batchRids;
+	std::vector<int>	batchKeys;
+	std::vector<size_t>	order;
+
+  /**
+   * Position in order of the next left tuple to join.
+   */
+	size_t	nextLeft;
+
+  /**
+   * Record ids of the right records with key matchKey, and the next one to return.
+   */
+	std::vector<RecordId>	matches;
+	int			matchKey;
+	bool		haveMatches;
+	size_t	nextMatch;
+
+  /**
+   * True once the left child has no tuples left.
+   */
+	bool		leftDone;
+
+  /**
+   * Current left tuple followed by the right tuple last returned.
+   */
+	std::vector<char>	buffer;
+
+  /**
+	 * Read and sort the next batch of left tuples.
+	 * @return false if there are none
+	**/
+	bool readBatch();
+
+ public:
+
+  /**
+   * @param leftColumn	INTEGER key column of left
+   * @param index				Index on the join column of relationName, owned by the caller
+   * @param schema			Layout of the records of relationName
+	 * @throws  BadIndexInfoException If leftColumn is not an INTEGER column.
+	**/
+	IndexJoinOperator(QueryOperator *left, const std::string& leftColumn, const std::string & relationName,
+						BufMgr *bufMgrIn, const Schema& schema, BTreeIndex *index);
+	~IndexJoinOperator();
+	void open();
+	bool next(TupleRef& outTuple);
+	void close();
+};
+
+/**
+ * @brief Semi-join, IN (subquery) and EXISTS: returns the tuples of its left child whose key is among the keys
+ * of its right child, or with anti set, NOT IN and NOT EXISTS, those whose key is not.
+ * The keys of the right child are read into a set when the operator is opened, the left tuples keep their
+ * columns and their order.
+*/
+class SemiJoinOperator : public QueryOperator {
+
+ private:
+
+	QueryOperator	*left;
+	QueryOperator	*right;
+	Column	leftKey;
+	Column	rightKey;
+	bool		anti;
+
+  /**
+   * Keys of the right child, numbers as doubles so that 1 and 1.0 are the same key.
+   */
+	std::set<std::string>	keys;
+
+  /**
+	 * @return key column of tuple as it is kept in keys
+	**/
+	static std::string keyOf(const char* tuple, const Column& column);
+
+ public:
+
+  /**
+   * @param leftColumn		Key column of left
+   * @param rightColumn		Key column of right, both numbers or both STRING
+	**/
+	SemiJoinOperator(QueryOperator *left, QueryOperator *right, const std::string& leftColumn,
+						const std::string& rightColumn, const bool anti);
+	~SemiJoinOperator();
+	void open();
+	bool next(TupleRef& outTuple);
+	void close();
+	void limitColumn(const std::string& column, const double bound, const bool descending);
+};
+
+/**
+ * @brief Aggregate functions.
+ */
+enum AggregateFunction
+{
+	AGGCOUNT,
+	AGGSUM,
+	AGGMIN,
+	AGGMAX,
+	AGGAVG,
+	AGGCOUNTDISTINCT,
+	AGGAPPROXCOUNTDISTINCT
+};
+
+/**
+ * @brief An aggregate computed for each group.
+ */
+struct AggregateSpec{
+  /**
+   * The function.
+   */
+	AggregateFunction function;
+
+  /**
+   * INTEGER or DOUBLE column it is computed over, empty for COUNT(*).
+   */
+	std::string column;
+
+  /**
+   * Name of the result column. The counts give an INTEGER column, the others a DOUBLE column.
+   */
+	std::string name;
+};
+
+/**
+ * @return true if function gives an INTEGER count rather than a DOUBLE
+ */
+inline bool isCountAggregate(const AggregateFunction function)
+{
+	return function == AGGCOUNT || function == AGGCOUNTDISTINCT || function == AGGAPPROXCOUNTDISTINCT;
+}
+
+/**
+ * @brief GROUP BY: returns one tuple per group of its child, the group columns followed by the aggregates.
+ * With no aggregates this is DISTINCT on the group columns, with no group columns there is a single group,
+ * which returns a tuple even if the child is empty. The child is read completely when the operator is opened
+ * and the groups come out in no particular order.
+ * AGGCOUNTDISTINCT keeps every distinct value of each group, AGGAPPROXCOUNTDISTINCT a HyperLogLog sketch of
+ * them, which takes at most 16 KB however many values there are.
+*/
+class AggregateOperator : public QueryOperator {
+
+ private:
+
+	QueryOperator	*child;
+
+  /**
+   * Positions of the group columns in the schema of the child.
+   */
+	std::vector<int>	groupColumns;
+
+	std::vector<AggregateSpec>	aggregates;
+
+  /**
+   * Positions of the aggregated columns in the schema of the child, -1 for COUNT(*).
+   */
+	std::vector<int>	aggregateColumns;
+
+  /**
+   * Value and count of each aggregate, by the group columns of each group as they appear in the result.
+   */
+	std::map<std::string, std::vector<double> >	groups;
+
+  /**
+   * Distinct values and sketches of the distinct count aggregates, by group and aggregate.
+   */
+	std::map<std::string, std::vector<std::set<std::string> > >	distinctValues;
+	std::map<std::string, std::vector<HyperLogLog> >	sketches;
+
+  /**
+   * Next group to return.
+   */
+	std::map<std::string, std::vector<double> >::const_iterator	nextGroup;
+
+  /**
+   * The tuple last returned.
+   */
+	std::vector<char>	buffer;
+
+ public:
+
+	AggregateOperator(QueryOperator *child, const std::vector<std::string>& groupColumnNames,
+						const std::vector<AggregateSpec>& aggregates);
+	~AggregateOperator();
+	void open();
+	bool next(TupleRef& outTuple);
+	void close();
+};
+
+/**
+ * @brief A column to sort by.
+ */
+struct SortKey{
+  /**
+   * Name of the column.
+   */
+	std::string column;
+
+  /**
+   * True for descending order.
+   */
+	bool descending;
+};
+
+/**
+ * @brief ORDER BY: returns the tuples of its child sorted by the keys, equal tuples in the order of the child.
+ * The child is read into memory when the operator is opened.
+*/
+class SortOperator : public QueryOperator {
+
+ private:
+
+	QueryOperator	*child;
+	std::vector<SortKey>	keys;
+
+  /**
+   * Positions of the key columns in the schema.
+   */
+	std::vector<int>	keyColumns;
+
+  /**
+   * Tuples of the child, one after another.
+   */
+	std::vector<char>	tuples;
+
+  /**
+   * Numbers of the tuples in sorted order.
+   */
+	std::vector<size_t>	order;
+
+  /**
+   * Position in order of the next tuple to return.
+   */
+	size_t	nextTuple;
+
+ public:
+
+	SortOperator(QueryOperator *child, const std::vector<SortKey>& keys);
+	~SortOperator();
+	void open();
+	bool next(TupleRef& outTuple);
+	void close();
+};
+
+/**
+ * @brief ORDER BY ... LIMIT: returns the tuples SortOperator followed by LimitOperator would, keeping only the
+ * offset + limit best tuples of its child in a heap instead of sorting it all.
+ * Once the heap is full, the first sort key of its worst tuple is passed to the child with limitColumn(), so
+ * that an index scan in the order of that key stops at the first tuple that cannot make it into the result.
+*/
+class TopNOperator : public QueryOperator {
+
+ private:
+
+  /**
+   * A tuple in the heap: its slot in tuples and its position in the child, which orders equal tuples.
+   */
+	struct HeapEntry{
+		size_t seq;
+		size_t slot;
+	};
+
+	QueryOperator	*child;
+	std::vector<SortKey>	keys;
+	size_t	limit;
+	size_t	offset;
+
+  /**
+   * Positions of the key columns in the schema.
+   */
+	std::vector<int>	keyColumns;
+
+  /**
+   * The kept tuples one after another, and the heap over them with the worst on top. Once the child is read,
+   * the heap is sorted best first.
+   */
+	std::vector<char>	tuples;
+	std::vector<HeapEntry>	heap;
+
+  /**
+   * Position in heap of the next tuple to return.
+   */
+	size_t	nextTuple;
+
+  /**
+	 * @return negative, zero or positive as tuple a sorts before, with or after tuple b
+	**/
+	int compareKeys(const char* a, const char* b) const;
+
+ public:
+
+	TopNOperator(QueryOperator *child, const std::vector<SortKey>& keys, const size_t limit, const size_t offset = 0);
+	~TopNOperator();
+	void open();
+	bool next(TupleRef& outTuple);
+	void close();
+};
+
+/**
+ * @brief LIMIT: returns the first limit tuples of its child after skipping offset tuples.
+*/
+class LimitOperator : public QueryOperator {
+
+ private:
+
+	QueryOperator	*child;
+	size_t	limit;
+	size_t	offset;
+
+  /**
+   * Number of tuples read from the child so far.
+   */
+	size_t	count;
+
+ public:
+
+	LimitOperator(QueryOperator *child, const size_t limit, const size_t offset = 0);
+	~LimitOperator();
+	void open();
+	bool next(TupleRef& outTuple);
+	void close();
+};
+
+}
@@ -151,6 +151,18 @@ class Page {
    */
   std::string getRecord(const RecordId& record_id) const;
 
+  /**
+   * Returns a pointer to the record with the given ID without copying it.
+   * The pointer stays valid until the page is changed or, for a page in the
+   * buffer pool, until it is unpinned.
+   *
+   * @param record_id  ID of the record to return.
+   * @param length     Set to the length of the record in bytes.
+   * @return  Pointer to the first byte of the record.
+   */
+  const char* getRecordData(const RecordId& record_id,
+                            std::size_t* length) const;
+
   /**
    * Updates the record with the given ID, replacing its data with a new
    * version.  This is equivalent to deleting the old record and inserting a
@@ -0,0 +1,1251 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+#include "planner.h"
+#include "file.h"
+#include "exceptions/no_such_column_exception.h"
+#include "exceptions/no_such_relation_exception.h"
+#include "exceptions/unsupported_query_exception.h"
+
+namespace badgerdb
+{
+
+static std::string lowerCase(const std::string& text)
+{
+	std::string lower(text);
+	for(size_t i = 0; i < lower.size(); i++) {
+		lower[i] = tolower(lower[i]);
+	}
+	return lower;
+}
+
+// true for column = column
+static bool isColumnEquality(const SqlExpr& expr)
+{
+	return expr.type == SQLOPERATOR && expr.name == "=" && expr.args[0].type == SQLCOLUMN && expr.args[1].type == SQLCOLUMN;
+}
+
+static bool isComparison(const std::string& name)
+{
+	return name == "=" || name == "<>" || name == "<" || name == "<=" || name == ">" || name == ">=";
+}
+
+// the columns expr refers to, not looking into subqueries
+static void collectColumns(const SqlExpr& expr, std::vector<const SqlExpr*>& columns)
+{
+	if(expr.type == SQLCOLUMN) {
+		columns.push_back(&expr);
+	}
+	for(size_t i = 0; i < expr.args.size(); i++) {
+		collectColumns(expr.args[i], columns);
+	}
+}
+
+// the aggregates in expr, each once
+static void collectAggregates(const SqlExpr& expr, std::vector<SqlExpr>& aggregates)
+{
+	if(expr.type == SQLFUNCTION && isAggregateName(expr.name)) {
+		std::string text = expr.toString();
+		for(size_t i = 0; i < aggregates.size(); i++) {
+			if(aggregates[i].toString() == text) {
+				return;
+			}
+		}
+		aggregates.push_back(expr);
+		return;
+	}
+	for(size_t i = 0; i < expr.args.size(); i++) {
+		collectAggregates(expr.args[i], aggregates);
+	}
+}
+
+// the names FROM item ref can be qualified with
+static void collectTableNames(const SqlTableRef& ref, std::set<std::string>& names)
+{
+	if(!ref.alias.empty()) {
+		names.insert(lowerCase(ref.alias));
+	} else if(!ref.relation.empty()) {
+		names.insert(lowerCase(ref.relation));
+	}
+	for(size_t i = 0; i < ref.joined.size(); i++) {
+		collectTableNames(ref.joined[i], names);
+	}
+}
+
+// true if column is qualified with a name that is not in names, i.e. refers to an outer query
+static bool isOuterColumn(const SqlExpr& column, const std::set<std::string>& names)
+{
+	return !column.table.empty() && names.count(lowerCase(column.table)) == 0;
+}
+
+// LIKE, case insensitive: % matches any chars and _ a single char
+static bool likeMatch(const std::string& text, const std::string& pattern)
+{
+	size_t t = 0, p = 0, starPattern = std::string::npos, starText = 0;
+	while(t < text.size()) {
+		if(p < pattern.size() && pattern[p] == '%') {
+			starPattern = p++;
+			starText = t;
+		} else if(p < pattern.size() && (pattern[p] == '_' || tolower(pattern[p]) == tolower(text[t]))) {
+			t++;
+			p++;
+		} else if(starPattern != std::string::npos) {
+			p = starPattern + 1;
+			t = ++starText;
+		} else {
+			return false;
+		}
+	}
+	while(p < pattern.size() && pattern[p] == '%') {
+		p++;
+	}
+	return p == pattern.size();
+}
+
+static bool comparisonHolds(const std::string& name, const int result)
+{
+	if(name == "=") {
+		return result == 0;
+	} else if(name == "<>") {
+		return result != 0;
+	} else if(name == "<") {
+		return result < 0;
+	} else if(name == "<=") {
+		return result <= 0;
+	} else if(name == ">") {
+		return result > 0;
+	}
+	return result >= 0;
+}
+
+// -----------------------------------------------------------------------------
+// QueryPlanner::QueryPlanner -- Constructor
+// -----------------------------------------------------------------------------
+
+QueryPlanner::QueryPlanner(BufMgr *bufMgrIn)
+{
+	this->bufMgr = bufMgrIn;
+	this->columnCount = 0;
+}
+
+QueryPlanner::~QueryPlanner()
+{
+	for(size_t i = 0; i < indexes.size(); i++) {
+		delete indexes[i];
+	}
+}
+
+// -----------------------------------------------------------------------------
+// QueryPlanner::addRelation
+// -----------------------------------------------------------------------------
+
+void QueryPlanner::addRelation(const std::string& relationName, const Schema& schema)
+{
+	relations[lowerCase(relationName)] = schema;
+	relationNames[lowerCase(relationName)] = relationName;
+}
+
+// -----------------------------------------------------------------------------
+// QueryPlanner::plan
+// -----------------------------------------------------------------------------
+
+QueryOperator* QueryPlanner::plan(const std::string& sql)
+{
+	SqlParser parser(sql);
+	SqlSelect select = parser.parseStatement();
+	if(!parser.atEnd()) {
+		throw UnsupportedQueryException("more than one statement");
+	}
+	return plan(select);
+}
+
+QueryOperator* QueryPlanner::plan(const SqlSelect& select)
+{
+	return planSelect(select, true).op;
+}
+
+// -----------------------------------------------------------------------------
+// QueryPlanner::newColumnName
+// -----------------------------------------------------------------------------
+
+std::string QueryPlanner::newColumnName(const std::string& name)
+{
+	std::ostringstream unique;
+	unique << lowerCase(name) << '#' << ++columnCount;
+	return unique.str();
+}
+
+// -----------------------------------------------------------------------------
+// QueryPlanner::findColumn
+// -----------------------------------------------------------------------------
+
+int QueryPlanner::findColumn(const Plan& plan, const SqlExpr& expr) const
+{
+	std::string table = lowerCase(expr.table);
+	std::string name = expr.type == SQLCOLUMN ? lowerCase(expr.name) : expr.toString();
+	for(size_t i = 0; i < plan.bindings.size(); i++) {
+		const Binding& binding = plan.bindings[i];
+		if(binding.name.empty() || binding.name != name) {
+			continue;
+		}
+		if(expr.type == SQLCOLUMN ? table.empty() || binding.table == table : binding.table.empty()) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+// -----------------------------------------------------------------------------
+// QueryPlanner::compile
+// -----------------------------------------------------------------------------
+
+QueryPlanner::CompiledExpr QueryPlanner::compile(const SqlExpr& expr, const Plan& plan) const
+{
+	CompiledExpr compiled;
+	compiled.length = 0;
+
+	// a column, or an expression computed below, e.g. SUM(x) after GROUP BY
+	if(expr.type != SQLNUMBER && expr.type != SQLSTRING) {
+		int position = findColumn(plan, expr);
+		if(position >= 0) {
+			const Column& column = plan.schema.columns[position];
+			int offset = column.offset;
+			int length = column.length;
+			compiled.type = column.type;
+			compiled.length = length;
+			if(column.type == INTEGER) {
+				compiled.number = [offset](const char* tuple) {
+					int value;
+					memcpy(&value, tuple + offset, sizeof(int));
+					return (double)value;
+				};
+			} else if(column.type == DOUBLE) {
+				compiled.number = [offset](const char* tuple) {
+					double value;
+					memcpy(&value, tuple + offset, sizeof(double));
+					return value;
+				};
+			} else {
+				compiled.text = [offset, length](const char* tuple) {
+					return std::string(tuple + offset, strnlen(tuple + offset, length));
+				};
+			}
+			return compiled;
+		}
+		if(expr.type == SQLCOLUMN) {
+			throw NoSuchColumnException(expr.toString());
+		}
+	}
+
+	switch(expr.type) {
+		case SQLNUMBER: {
+			double number = expr.number;
+			compiled.type = number == floor(number) && fabs(number) <= INT_MAX ? INTEGER : DOUBLE;
+			compiled.number = [number](const char* tuple) { return number; };
+			return compiled;
+		}
+		case SQLSTRING: {
+			std::string text = expr.name;
+			compiled.type = STRING;
+			compiled.length = text.size();
+			compiled.text = [text](const char* tuple) { return text; };
+			return compiled;
+		}
+		case SQLOPERATOR:
+			return compileOperator(expr, plan);
+		case SQLFUNCTION:
+			return compileFunction(expr, plan);
+		case SQLIN:
+			if(!expr.query) {
+				break;
+			}
+			throw UnsupportedQueryException("IN subqueries other than conditions ANDed together in WHERE");
+		case SQLEXISTS:
+			throw UnsupportedQueryException("EXISTS other than in conditions ANDed together in WHERE");
+		default:
+			throw UnsupportedQueryException("* other than in a SELECT list or COUNT(*)");
+	}
+
+	// IN list
+	CompiledExpr value = compile(expr.args[0], plan);
+	std::vector<CompiledExpr> list;
+	for(size_t i = 1; i < expr.args.size(); i++) {
+		list.push_back(compile(expr.args[i], plan));
+		if((list.back().type == STRING) != (value.type == STRING)) {
+			throw UnsupportedQueryException("comparison of a number with a string");
+		}
+	}
+	bool negated = expr.negated;
+	compiled.type = INTEGER;
+	if(value.type == STRING) {
+		compiled.number = [value, list, negated](const char* tuple) {
+			std::string text = value.text(tuple);
+			for(size_t i = 0; i < list.size(); i++) {
+				if(list[i].text(tuple) == text) {
+					return negated ? 0.0 : 1.0;
+				}
+			}
+			return negated ? 1.0 : 0.0;
+		};
+	} else {
+		compiled.number = [value, list, negated](const char* tuple) {
+			double number = value.number(tuple);
+			for(size_t i = 0; i < list.size(); i++) {
+				if(list[i].number(tuple) == number) {
+					return negated ? 0.0 : 1.0;
+				}
+			}
+			return negated ? 1.0 : 0.0;
+		};
+	}
+	return compiled;
+}
+
+// -----------------------------------------------------------------------------
+// QueryPlanner::compileOperator
+// -----------------------------------------------------------------------------
+
+QueryPlanner::CompiledExpr QueryPlanner::compileOperator(const SqlExpr& expr, const Plan& plan) const
+{
+	CompiledExpr compiled;
+	compiled.length = 0;
+	CompiledExpr left = compile(expr.args[0], plan);
+	const std::string& name = expr.name;
+
+	if(expr.args.size() == 1) {
+		if(left.type == STRING) {
+			throw UnsupportedQueryException(name == "NOT" ? "a string as a condition" : "arithmetic on strings");
+		}
+		if(name == "NOT") {
+			compiled.type = INTEGER;
+			compiled.number = [left](const char* tuple) { return left.number(tuple) == 0 ? 1.0 : 0.0; };
+		} else {
+			compiled.type = left.type;
+			compiled.number = [left](const char* tuple) { return -left.number(tuple); };
+		}
+		return compiled;
+	}
+
+	CompiledExpr right = compile(expr.args[1], plan);
+	compiled.type = INTEGER;
+	if(name == "LIKE") {
+		if(left.type != STRING || right.type != STRING) {
+			throw UnsupportedQueryException("LIKE on numbers");
+		}
+		bool negated = expr.negated;
+		compiled.number = [left, right, negated](const char* tuple) {
+			return likeMatch(left.text(tuple), right.text(tuple)) != negated ? 1.0 : 0.0;
+		};
+		return compiled;
+	}
+	if(isComparison(name)) {
+		if((left.type == STRING) != (right.type == STRING)) {
+			throw UnsupportedQueryException("comparison of a number with a string");
+		}
+		if(left.type == STRING) {
+			compiled.number = [left, right, name](const char* tuple) {
+				return comparisonHolds(name, left.text(tuple).compare(right.text(tuple))) ? 1.0 : 0.0;
+			};
+		} else {
+			compiled.number = [left, right, name](const char* tuple) {
+				double l = left.number(tuple);
+				double r = right.number(tuple);
+				return comparisonHolds(name, l < r ? -1 : l > r ? 1 : 0) ? 1.0 : 0.0;
+			};
+		}
+		return compiled;
+	}
+
+	if(left.type == STRING || right.type == STRING) {
+		throw UnsupportedQueryException(name == "AND" || name == "OR" ? "a string as a condition" : "arithmetic on strings");
+	}
+	if(name == "AND") {
+		compiled.number = [left, right](const char* tuple) {
+			return left.number(tuple) != 0 && right.number(tuple) != 0 ? 1.0 : 0.0;
+		};
+	} else if(name == "OR") {
+		compiled.number = [left, right](const char* tuple) {
+			return left.number(tuple) != 0 || right.number(tuple) != 0 ? 1.0 : 0.0;
+		};
+	} else {
+		// INTEGER arithmetic stays INTEGER, dividing truncates; dividing by zero gives 0
+		compiled.type = left.type == INTEGER && right.type == INTEGER ? INTEGER : DOUBLE;
+		bool integer = compiled.type == INTEGER;
+		char op = name[0];
+		compiled.number = [left, right, op, integer](const char* tuple) {
+			double l = left.number(tuple);
+			double r = right.number(tuple);
+			switch(op) {
+				case '+':
+					return l + r;
+				case '-':
+					return l - r;
+				case '*':
+					return l * r;
+			}
+			if(r == 0) {
+				return 0.0;
+			}
+			return integer ? trunc(l / r) : l / r;
+		};
+	}
+	return compiled;
+}
+
+// -----------------------------------------------------------------------------
+// QueryPlanner::compileFunction
+// -----------------------------------------------------------------------------
+
+QueryPlanner::CompiledExpr QueryPlanner::compileFunction(const SqlExpr& expr, const Plan& plan) const
+{
+	if(isAggregateName(expr.name)) {
+		throw UnsupportedQueryException("aggregates other than in the SELECT list, HAVING and ORDER BY");
+	}
+	if(expr.name != "SUBSTR" && expr.name != "SUBSTRING") {
+		throw UnsupportedQueryException("function " + expr.name);
+	}
+	if(expr.args.size() != 2 && expr.args.size() != 3) {
+		throw UnsupportedQueryException("SUBSTR with " + std::string(expr.args.size() < 2 ? "less than 2" : "more than 3") + " arguments");
+	}
+
+	// SUBSTR(text, start, count), start counts from 1, or from the end if negative
+	CompiledExpr text = compile(expr.args[0], plan);
+	CompiledExpr start = compile(expr.args[1], plan);
+	if(text.type != STRING || start.type == STRING) {
+		throw UnsupportedQueryException("SUBSTR of a number");
+	}
+	CompiledExpr count;
+	bool counted = expr.args.size() == 3;
+	CompiledExpr compiled;
+	compiled.type = STRING;
+	compiled.length = text.length;
+	if(counted) {
+		count = compile(expr.args[2], plan);
+		if(count.type == STRING) {
+			throw UnsupportedQueryException("SUBSTR with a string count");
+		}
+		if(expr.args[2].type == SQLNUMBER && expr.args[2].number >= 0) {
+			compiled.length = std::min(text.length, (int)expr.args[2].number);
+		}
+	}
+	compiled.text = [text, start, count, counted](const char* tuple) {
+		std::string value = text.text(tuple);
+		long long first = (long long)start.number(tuple);
+		long long size = value.size();
+		first = first > 0 ? first - 1 : first < 0 ? std::max(0LL, size + first) : 0;
+		if(first >= size) {
+			return std::string();
+		}
+		long long length = counted ? std::max(0LL, (long long)count.number(tuple)) : size;
+		return value.substr(first, std::min(length, size - first));
+	};
+	return compiled;
+}
+
+// -----------------------------------------------------------------------------
+// QueryPlanner::compileCondition
+// -----------------------------------------------------------------------------
+
+TuplePredicate QueryPlanner::compileCondition(const SqlExpr& expr, const Plan& plan) const
+{
+	CompiledExpr condition = compile(expr, plan);
+	if(condition.type == STRING) {
+		throw UnsupportedQueryException("a string as a condition");
+	}
+	std::function<double (const char* tuple)> number = condition.number;
+	return [number](const char* tuple) { return number(tuple) != 0; };
+}
+
+// -----------------------------------------------------------------------------
+// QueryPlanner::addComputedColumn
+// -----------------------------------------------------------------------------
+
+void QueryPlanner::addComputedColumn(ProjectOperator* project, const std::string& name, const CompiledExpr& expr) const
+{
+	std::function<double (const char* tuple)> number = expr.number;
+	if(expr.type == INTEGER) {
+		project->addColumn(name, INTEGER, 0, [number](const char* tuple, char* out) {
+			int value = (int)number(tuple);
+			memcpy(out, &value, sizeof(int));
+		});
+	} else if(expr.type == DOUBLE) {
+		project->addColumn(name, DOUBLE, 0, [number](const char* tuple, char* out) {
+			double value = number(tuple);
+			memcpy(out, &value, sizeof(double));
+		});
+	} else {
+		std::function<std::string (const char* tuple)> text = expr.text;
+		int length = std::max(expr.length, 1);
+		project->addColumn(name, STRING, length, [text, length](const char* tuple, char* out) {
+			std::string value = text(tuple);
+			memset(out, 0, length);
+			memcpy(out, value.data(), std::min((int)value.size(), length));
+		});
+	}
+}
+
+// -----------------------------------------------------------------------------
+// QueryPlanner::openIndex
+// -----------------------------------------------------------------------------
+
+BTreeIndex* QueryPlanner::openIndex(const std::string& relation, const Column& column)
+{
+	if(column.type != INTEGER) {
+		return NULL;
+	}
+	std::ostringstream indexName;
+	indexName << relation << '.' << column.offset;
+	if(!File::exists(indexName.str())) {
+		return NULL;
+	}
+
+	// a BTreeIndex runs one scan at a time, so each operator gets an index of its own
+	std::string outIndexName;
+	BTreeIndex* index = new BTreeIndex(relation, outIndexName, bufMgr, column.offset, INTEGER);
+	indexes.push_back(index);
+	return index;
+}
+
+// -----------------------------------------------------------------------------
+// QueryPlanner::planTableRef
+// -----------------------------------------------------------------------------
+
+QueryPlanner::Plan QueryPlanner::planTableRef(const SqlTableRef& ref)
+{
+	Plan plan;
+	plan.op = NULL;
+	if(!ref.relation.empty()) {
+		std::map<std::string, Schema>::const_iterator relation = relations.find(lowerCase(ref.relation));
+		if(relation == relations.end()) {
+			throw NoSuchRelationException(ref.relation);
+		}
+		plan.relation = relationNames[relation->first];
+		plan.schema = relation->second;
+		std::string table = lowerCase(ref.alias.empty() ? ref.relation : ref.alias);
+		for(size_t i = 0; i < plan.schema.columns.size(); i++) {
+			Binding binding = {table, lowerCase(plan.schema.columns[i].name)};
+			plan.bindings.push_back(binding);
+			plan.schema.columns[i].name = newColumnName(binding.name);
+		}
+		PageFile file = PageFile::open(plan.relation);
+		plan.pages = file.getNumPages();
+		return plan;
+	}
+
+	if(ref.query) {
+		plan = planSelect(*ref.query, false);
+	} else {
+		// (A NATURAL JOIN B ...) joins on the columns of the same name
+		plan = planTableRef(ref.joined[0]);
+		for(size_t k = 1; k < ref.joined.size(); k++) {
+			Plan right = planTableRef(ref.joined[k]);
+			std::vector<int> leftColumns, rightColumns;
+			std::set<std::string> shared;
+			for(size_t i = 0; i < plan.bindings.size(); i++) {
+				const std::string& name = plan.bindings[i].name;
+				if(name.empty() || shared.count(name) != 0) {
+					continue;
+				}
+				for(size_t j = 0; j < right.bindings.size(); j++) {
+					if(right.bindings[j].name == name) {
+						shared.insert(name);
+						leftColumns.push_back(i);
+						rightColumns.push_back(j);
+						break;
+					}
+				}
+			}
+			std::vector<SqlExpr> none;
+			plan = planJoin(plan, right, none, leftColumns, rightColumns, true);
+		}
+	}
+	if(!ref.alias.empty()) {
+		for(size_t i = 0; i < plan.bindings.size(); i++) {
+			plan.bindings[i].table = lowerCase(ref.alias);
+		}
+	}
+	return plan;
+}
+
+// -----------------------------------------------------------------------------
+// QueryPlanner::planAccess
+// -----------------------------------------------------------------------------
+
+void QueryPlanner::planAccess(Plan& plan, std::vector<SqlExpr>& conditions, const std::string& orderColumn, const bool descending)
+{
+	if(plan.op != NULL) {
+		planFilter(plan, conditions);
+		conditions.clear();
+		return;
+	}
+
+	// ranges of INTEGER columns compared with numbers, by column, and the conditions giving them
+	std::map<int, std::pair<long long, long long> > ranges;
+	std::map<int, std::vector<size_t> > rangeConditions;
+	std::vector<int> rangeOrder;
+	for(size_t i = 0; i < conditions.size(); i++) {
+		const SqlExpr& condition = conditions[i];
+		if(condition.type != SQLOPERATOR || !isComparison(condition.name) || condition.name == "<>") {
+			continue;
+		}
+		bool flipped = condition.args[0].type == SQLNUMBER;
+		const SqlExpr& column = condition.args[flipped ? 1 : 0];
+		const SqlExpr& value = condition.args[flipped ? 0 : 1];
+		int position = column.type == SQLCOLUMN && value.type == SQLNUMBER ? findColumn(plan, column) : -1;
+		if(position < 0 || plan.schema.columns[position].type != INTEGER) {
+			continue;
+		}
+
+		std::string name = condition.name;
+		if(flipped && name != "=") {
+			name = name[0] == '<' ? ">" + name.substr(1) : "<" + name.substr(1);
+		}
+		double number = value.number;
+		if(name == "=" && number != floor(number)) {
+			continue;
+		}
+		if(ranges.count(position) == 0) {
+			ranges[position] = std::make_pair((long long)INT_MIN, (long long)INT_MAX);
+			rangeOrder.push_back(position);
+		}
+		std::pair<long long, long long>& range = ranges[position];
+		if(name == "=" || name == ">=") {
+			range.first = std::max(range.first, (long long)ceil(std::max(number, -1e18)));
+		} else if(name == ">") {
+			range.first = std::max(range.first, (long long)floor(std::max(number, -1e18)) + 1);
+		}
+		if(name == "=" || name == "<=") {
+			range.second = std::min(range.second, (long long)floor(std::min(number, 1e18)));
+		} else if(name == "<") {
+			range.second = std::min(range.second, (long long)ceil(std::min(number, 1e18)) - 1);
+		}
+		rangeConditions[position].push_back(i);
+	}
+
+	// the first column with a range and an index, else the ORDER BY column if it has an index
+	BTreeIndex* index = NULL;
+	int keyColumn = -1;
+	for(size_t i = 0; i < rangeOrder.size() && index == NULL; i++) {
+		const std::pair<long long, long long>& range = ranges[rangeOrder[i]];
+		if(range.first <= range.second && range.first <= INT_MAX && range.second >= INT_MIN) {
+			keyColumn = rangeOrder[i];
+			index = openIndex(plan.relation, plan.schema.columns[keyColumn]);
+		}
+	}
+	long long low = INT_MIN, high = INT_MAX;
+	if(index != NULL) {
+		low = std::max(ranges[keyColumn].first, (long long)INT_MIN);
+		high = std::min(ranges[keyColumn].second, (long long)INT_MAX);
+		std::vector<size_t>& used = rangeConditions[keyColumn];
+		for(size_t i = used.size(); i > 0; i--) {
+			conditions.erase(conditions.begin() + used[i - 1]);
+		}
+		plan.pages = low == high ? 1 : std::max(plan.pages / 2, (PageId)1);
+	} else if(!orderColumn.empty()) {
+		keyColumn = plan.schema.find(orderColumn);
+		index = openIndex(plan.relation, plan.schema.columns[keyColumn]);
+	}
+
+	if(index != NULL) {
+		bool inOrder = plan.schema.columns[keyColumn].name == orderColumn && descending;
+		plan.op = new IndexScanOperator(plan.relation, bufMgr, plan.schema, index, low, GTE, high, LTE, inOrder);
+	} else {
+		plan.op = new ScanOperator(plan.relation, bufMgr, plan.schema);
+	}
+	plan.relation.clear();
+	planFilter(plan, conditions);
+	conditions.clear();
+}
+
+// -----------------------------------------------------------------------------
+// QueryPlanner::planFilter
+// -----------------------------------------------------------------------------
+
+void QueryPlanner::planFilter(Plan& plan, const std::vector<SqlExpr>& conditions)
+{
+	if(plan.op == NULL) {
+		std::vector<SqlExpr> local(conditions);
+		planAccess(plan, local, "", false);
+		return;
+	}
+	if(conditions.empty()) {
+		return;
+	}
+
+	std::vector<TuplePredicate> predicates;
+	for(size_t i = 0; i < conditions.size(); i++) {
+		predicates.push_back(compileCondition(conditions[i], plan));
+	}
+	plan.op = new FilterOperator(plan.op, [predicates](const char* tuple) {
+		for(size_t i = 0; i < predicates.size(); i++) {
+			if(!predicates[i](tuple)) {
+				return false;
+			}
+		}
+		return true;
+	});
+
+	// guess that each condition keeps half of the tuples
+	plan.pages = std::max(plan.pages >> std::min(conditions.size(), (size_t)16), (PageId)1);
+}
+
+// -----------------------------------------------------------------------------
+// QueryPlanner::planJoin
+// -----------------------------------------------------------------------------
+
+QueryPlanner::Plan QueryPlanner::planJoin(Plan& left, Plan& right, std::vector<SqlExpr>& rightConditions,
+		const std::vector<int>& leftColumns, const std::vector<int>& rightColumns, const bool natural)
+{
+	std::vector<SqlExpr> none;
+	if(left.op == NULL) {
+		planAccess(left, none, "", false);
+	}
+
+	// the internal names of the equal columns, which are kept by the join
+	std::vector<std::pair<std::string, std::string> > equalities;
+	for(size_t i = 0; i < leftColumns.size(); i++) {
+		const Column& leftColumn = left.schema.columns[leftColumns[i]];
+		const Column& rightColumn = right.schema.columns[rightColumns[i]];
+		if((leftColumn.type == STRING) != (rightColumn.type == STRING)) {
+			throw UnsupportedQueryException("join of a number with a string");
+		}
+		equalities.push_back(std::make_pair(leftColumn.name, rightColumn.name));
+	}
+
+	Plan result;
+	result.relation.clear();
+	bool leftFirst = true;
+	if(equalities.empty()) {
+		planAccess(right, rightConditions, "", false);
+		result.op = new JoinOperator(left.op, right.op, [](const char* l, const char* r) { return true; });
+		result.pages = (PageId)std::min((unsigned long long)left.pages * right.pages, (unsigned long long)1 << 30);
+	} else {
+		const Column& leftKey = left.schema.columns[leftColumns[0]];
+		const Column& rightKey = right.schema.columns[rightColumns[0]];
+		BTreeIndex* index = NULL;
+		if(right.op == NULL && leftKey.type == INTEGER && rightKey.type == INTEGER && right.pages > left.pages) {
+			index = openIndex(right.relation, rightKey);
+		}
+		if(index != NULL) {
+			result.op = new IndexJoinOperator(left.op, leftKey.name, right.relation, bufMgr, right.schema, index);
+			result.pages = left.pages;
+		} else {
+			planAccess(right, rightConditions, "", false);
+			leftFirst = right.pages <= left.pages;
+			if(leftFirst) {
+				result.op = new HashJoinOperator(left.op, right.op, leftKey.name, rightKey.name, bufMgr, SQLJOINBUDGET);
+			} else {
+				result.op = new HashJoinOperator(right.op, left.op, rightKey.name, leftKey.name, bufMgr, SQLJOINBUDGET);
+			}
+			result.pages = std::max(left.pages, right.pages);
+		}
+	}
+	result.schema = result.op->getSchema();
+	result.bindings = leftFirst ? left.bindings : right.bindings;
+	const std::vector<Binding>& second = leftFirst ? right.bindings : left.bindings;
+	result.bindings.insert(result.bindings.end(), second.begin(), second.end());
+
+	// what the index join left to check: conditions on right and the other equalities
+	planFilter(result, rightConditions);
+	rightConditions.clear();
+	if(equalities.size() > 1) {
+		std::vector<std::pair<Column, Column> > columns;
+		for(size_t i = 1; i < equalities.size(); i++) {
+			columns.push_back(std::make_pair(result.schema.columns[result.schema.find(equalities[i].first)],
+					result.schema.columns[result.schema.find(equalities[i].second)]));
+		}
+		result.op = new FilterOperator(result.op, [columns](const char* tuple) {
+			for(size_t i = 0; i < columns.size(); i++) {
+				if(compareValues(tuple, columns[i].first, tuple, columns[i].second) != 0) {
+					return false;
+				}
+			}
+			return true;
+		});
+	}
+
+	if(natural) {
+		for(size_t i = 0; i < equalities.size(); i++) {
+			result.bindings[result.schema.find(equalities[i].second)].name.clear();
+		}
+	}
+	return result;
+}
+
+// -----------------------------------------------------------------------------
+// QueryPlanner::planSubqueryCondition
+// -----------------------------------------------------------------------------
+
+void QueryPlanner::planSubqueryCondition(Plan& plan, const SqlExpr& condition)
+{
+	SqlSelect query = *condition.query;
+	SqlExpr outer = condition.args.empty() ? SqlExpr() : condition.args[0];
+	if(condition.type == SQLIN) {
+		if(outer.type != SQLCOLUMN) {
+			throw UnsupportedQueryException("IN subqueries tested with an expression other than a column");
+		}
+	} else {
+		// EXISTS: take the equality with the outer query out of the subquery, which then selects the inner column
+		std::set<std::string> names;
+		for(size_t i = 0; i < query.from.size(); i++) {
+			collectTableNames(query.from[i], names);
+		}
+		int correlation = -1;
+		for(size_t i = 0; i < query.where.size(); i++) {
+			std::vector<const SqlExpr*> columns;
+			collectColumns(query.where[i], columns);
+			for(size_t j = 0; j < columns.size(); j++) {
+				if(isOuterColumn(*columns[j], names)) {
+					if(correlation >= 0 && correlation != (int)i) {
+						throw UnsupportedQueryException("EXISTS subqueries correlated by more than one condition");
+					}
+					correlation = i;
+				}
+			}
+		}
+		if(correlation < 0) {
+			throw UnsupportedQueryException("EXISTS subqueries that are not correlated");
+		}
+		const SqlExpr& equality = query.where[correlation];
+		if(!isColumnEquality(equality) || isOuterColumn(equality.args[0], names) == isOuterColumn(equality.args[1], names)) {
+			throw UnsupportedQueryException("EXISTS subqueries correlated by a condition other than inner = outer");
+		}
+		bool hasAggregate = !query.groupBy.empty() || !query.having.empty();
+		for(size_t i = 0; i < query.items.size(); i++) {
+			hasAggregate = hasAggregate || query.items[i].expr.hasAggregate();
+		}
+		if(hasAggregate) {
+			throw UnsupportedQueryException("EXISTS subqueries with GROUP BY or aggregates");
+		}
+
+		bool outerFirst = isOuterColumn(equality.args[0], names);
+		outer = equality.args[outerFirst ? 0 : 1];
+		SqlSelectItem item;
+		item.expr = equality.args[outerFirst ? 1 : 0];
+		query.items.assign(1, item);
+		query.where.erase(query.where.begin() + correlation);
+		query.distinct = false;
+		query.orderBy.clear();
+		query.limit = -1;
+		query.offset = 0;
+	}
+
+	int position = findColumn(plan, outer);
+	if(position < 0) {
+		throw NoSuchColumnException(outer.toString());
+	}
+	Plan inner = planSelect(query, false);
+	if(inner.schema.columns.size() != 1) {
+		delete inner.op;
+		throw UnsupportedQueryException("IN subqueries of more than one column");
+	}
+	if((inner.schema.columns[0].type == STRING) != (plan.schema.columns[position].type == STRING)) {
+		delete inner.op;
+		throw UnsupportedQueryException("comparison of a number with a string");
+	}
+	plan.op = new SemiJoinOperator(plan.op, inner.op, plan.schema.columns[position].name, inner.schema.columns[0].name,
+			condition.negated);
+}
+
+// -----------------------------------------------------------------------------
+// QueryPlanner::planSelect
+// -----------------------------------------------------------------------------
+
+QueryPlanner::Plan QueryPlanner::planSelect(const SqlSelect& select, const bool topLevel)
+{
+	if(select.from.empty()) {
+		throw UnsupportedQueryException("SELECT without FROM");
+	}
+	std::vector<Plan> items;
+	for(size_t i = 0; i < select.from.size(); i++) {
+		items.push_back(planTableRef(select.from[i]));
+	}
+
+	// sort WHERE into conditions on one item, on several, and subqueries; a column belongs to the first item it is in
+	std::vector<std::vector<SqlExpr> > local(items.size());
+	std::vector<std::pair<SqlExpr, std::set<size_t> > > pending;
+	std::vector<SqlExpr> subqueries;
+	for(size_t i = 0; i < select.where.size(); i++) {
+		const SqlExpr& condition = select.where[i];
+		if(condition.query) {
+			subqueries.push_back(condition);
+			continue;
+		}
+		std::vector<const SqlExpr*> columns;
+		collectColumns(condition, columns);
+		std::set<size_t> owners;
+		for(size_t j = 0; j < columns.size(); j++) {
+			size_t owner = 0;
+			while(owner < items.size() && findColumn(items[owner], *columns[j]) < 0) {
+				owner++;
+			}
+			if(owner == items.size()) {
+				throw NoSuchColumnException(columns[j]->toString());
+			}
+			owners.insert(owner);
+		}
+		if(owners.size() == 1) {
+			local[*owners.begin()].push_back(condition);
+		} else {
+			pending.push_back(std::make_pair(condition, owners));
+		}
+	}
+
+	bool aggregated = !select.groupBy.empty();
+	for(size_t i = 0; i < select.items.size(); i++) {
+		aggregated = aggregated || select.items[i].expr.hasAggregate();
+	}
+	for(size_t i = 0; i < select.having.size(); i++) {
+		aggregated = aggregated || select.having[i].hasAggregate();
+	}
+	if(!aggregated && !select.having.empty()) {
+		throw UnsupportedQueryException("HAVING without GROUP BY or aggregates");
+	}
+
+	// ORDER BY items as expressions, aliases and positions replaced by what they select
+	std::vector<SqlExpr> orderExprs;
+	std::vector<int> orderItems;
+	for(size_t i = 0; i < select.orderBy.size(); i++) {
+		const SqlExpr& expr = select.orderBy[i].expr;
+		int item = -1;
+		if(expr.type == SQLNUMBER && expr.number == floor(expr.number) && expr.number >= 1 && expr.number <= select.items.size()) {
+			item = (int)expr.number - 1;
+		}
+		for(size_t j = 0; j < select.items.size() && item < 0; j++) {
+			if(expr.type == SQLCOLUMN && expr.table.empty() && lowerCase(select.items[j].alias) == lowerCase(expr.name)) {
+				item = j;
+			}
+		}
+		for(size_t j = 0; j < select.items.size() && item < 0; j++) {
+			if(select.items[j].expr.toString() == expr.toString()) {
+				item = j;
+			}
+		}
+		if(item >= 0 && select.items[item].expr.type == SQLSTAR) {
+			throw UnsupportedQueryException("ORDER BY of *");
+		}
+		orderExprs.push_back(item >= 0 ? select.items[item].expr : expr);
+		orderItems.push_back(item);
+	}
+
+	// a query over one relation with ORDER BY ... LIMIT may read it in order from an index
+	std::string orderColumn;
+	if(items.size() == 1 && items[0].op == NULL && select.limit >= 0 && !orderExprs.empty() && !aggregated &&
+			!select.distinct && orderExprs[0].type == SQLCOLUMN) {
+		int position = findColumn(items[0], orderExprs[0]);
+		if(position >= 0) {
+			orderColumn = items[0].schema.columns[position].name;
+		}
+	}
+
+	// join: each time the first item an equality connects to the joined items, or else the next one
+	std::vector<bool> joined(items.size(), false);
+	Plan current = items[0];
+	joined[0] = true;
+	planAccess(current, local[0], orderColumn, !select.orderBy.empty() && select.orderBy[0].descending);
+	for(size_t step = 1; step <= items.size(); step++) {
+		std::vector<SqlExpr> ready;
+		for(size_t i = pending.size(); i > 0; i--) {
+			bool allJoined = true;
+			for(std::set<size_t>::const_iterator owner = pending[i - 1].second.begin(); owner != pending[i - 1].second.end(); ++owner) {
+				allJoined = allJoined && joined[*owner];
+			}
+			if(allJoined) {
+				ready.insert(ready.begin(), pending[i - 1].first);
+				pending.erase(pending.begin() + (i - 1));
+			}
+		}
+		planFilter(current, ready);
+		if(step == items.size()) {
+			break;
+		}
+
+		size_t next = items.size();
+		for(size_t i = 0; i < pending.size() && next == items.size(); i++) {
+			const std::set<size_t>& owners = pending[i].second;
+			if(isColumnEquality(pending[i].first) && owners.size() == 2 && joined[*owners.begin()] != joined[*owners.rbegin()]) {
+				next = joined[*owners.begin()] ? *owners.rbegin() : *owners.begin();
+			}
+		}
+		for(size_t i = 0; i < items.size() && next == items.size(); i++) {
+			if(!joined[i]) {
+				next = i;
+			}
+		}
+
+		// the equalities of next with joined items become join columns
+		std::vector<int> leftColumns, rightColumns;
+		for(size_t i = pending.size(); i > 0; i--) {
+			const SqlExpr& condition = pending[i - 1].first;
+			const std::set<size_t>& owners = pending[i - 1].second;
+			if(!isColumnEquality(condition) || owners.size() != 2 || owners.count(next) == 0 ||
+					!joined[*owners.begin() == next ? *owners.rbegin() : *owners.begin()]) {
+				continue;
+			}
+			size_t owner = 0;
+			while(findColumn(items[owner], condition.args[0]) < 0) {
+				owner++;
+			}
+			int rightColumn = findColumn(items[next], condition.args[owner == next ? 0 : 1]);
+			int leftColumn = findColumn(current, condition.args[owner == next ? 1 : 0]);
+			if((items[next].schema.columns[rightColumn].type == STRING) != (current.schema.columns[leftColumn].type == STRING)) {
+				throw UnsupportedQueryException("comparison of a number with a string");
+			}
+			leftColumns.insert(leftColumns.begin(), leftColumn);
+			rightColumns.insert(rightColumns.begin(), rightColumn);
+			pending.erase(pending.begin() + (i - 1));
+		}
+		current = planJoin(current, items[next], local[next], leftColumns, rightColumns, false);
+		joined[next] = true;
+	}
+
+	for(size_t i = 0; i < subqueries.size(); i++) {
+		planSubqueryCondition(current, subqueries[i]);
+	}
+
+	if(aggregated) {
+		// GROUP BY may name what the SELECT list computes by its alias
+		std::vector<SqlExpr> keys;
+		for(size_t i = 0; i < select.groupBy.size(); i++) {
+			SqlExpr key = select.groupBy[i];
+			for(size_t j = 0; j < select.items.size(); j++) {
+				if(key.type == SQLCOLUMN && key.table.empty() && findColumn(current, key) < 0 &&
+						lowerCase(select.items[j].alias) == lowerCase(key.name)) {
+					key = select.items[j].expr;
+				}
+			}
+			keys.push_back(key);
+		}
+
+		// columns selected along with GROUP BY, e.g. the name of a GROUP BY id, are taken as group columns too
+		for(size_t i = 0; i < select.items.size() && !select.groupBy.empty(); i++) {
+			const SqlExpr& expr = select.items[i].expr;
+			if(expr.type == SQLSTAR) {
+				throw UnsupportedQueryException("SELECT * with GROUP BY");
+			}
+			int position = expr.type == SQLCOLUMN ? findColumn(current, expr) : -1;
+			bool grouped = position < 0;
+			for(size_t j = 0; j < keys.size() && !grouped; j++) {
+				grouped = findColumn(current, keys[j]) == position;
+			}
+			if(!grouped) {
+				keys.push_back(expr);
+			}
+		}
+
+		std::vector<SqlExpr> aggregateExprs;
+		for(size_t i = 0; i < select.items.size(); i++) {
+			collectAggregates(select.items[i].expr, aggregateExprs);
+		}
+		for(size_t i = 0; i < select.having.size(); i++) {
+			collectAggregates(select.having[i], aggregateExprs);
+		}
+		for(size_t i = 0; i < orderExprs.size(); i++) {
+			collectAggregates(orderExprs[i], aggregateExprs);
+		}
+
+		// compute the group columns and aggregated values first, then group
+		std::vector<std::pair<std::string, CompiledExpr> > computed;
+		std::vector<std::string> groupNames;
+		std::vector<AggregateSpec> aggregates;
+		Plan grouped;
+		for(size_t i = 0; i < keys.size(); i++) {
+			std::string name = newColumnName(keys[i].type == SQLCOLUMN ? keys[i].name : "group");
+			computed.push_back(std::make_pair(name, compile(keys[i], current)));
+			groupNames.push_back(name);
+			int position = keys[i].type == SQLCOLUMN ? findColumn(current, keys[i]) : -1;
+			Binding binding = {"", keys[i].toString()};
+			grouped.bindings.push_back(position >= 0 ? current.bindings[position] : binding);
+		}
+		for(size_t i = 0; i < aggregateExprs.size(); i++) {
+			const SqlExpr& expr = aggregateExprs[i];
+			if(expr.args.size() != 1) {
+				throw UnsupportedQueryException(expr.name + " of other than one argument");
+			}
+			AggregateSpec spec;
+			spec.name = newColumnName(expr.name);
+			bool star = expr.args[0].type == SQLSTAR;
+			if(expr.name == "COUNT") {
+				// there are no NULLs, so COUNT(x) is COUNT(*)
+				spec.function = expr.distinct ? AGGCOUNTDISTINCT : AGGCOUNT;
+				star = star || !expr.distinct;
+			} else if(star || expr.distinct) {
+				throw UnsupportedQueryException(expr.name + (star ? "(*)" : " of DISTINCT values"));
+			} else {
+				spec.function = expr.name == "SUM" ? AGGSUM : expr.name == "AVG" ? AGGAVG : expr.name == "MIN" ? AGGMIN : AGGMAX;
+			}
+			if(!star) {
+				CompiledExpr argument = compile(expr.args[0], current);
+				if(argument.type == STRING && spec.function != AGGCOUNTDISTINCT) {
+					throw UnsupportedQueryException(expr.name + " of strings");
+				}
+				spec.column = newColumnName("argument");
+				computed.push_back(std::make_pair(spec.column, argument));
+			}
+			aggregates.push_back(spec);
+			Binding binding = {"", expr.toString()};
+			grouped.bindings.push_back(binding);
+		}
+
+		QueryOperator* input = current.op;
+		if(!computed.empty()) {
+			ProjectOperator* project = new ProjectOperator(current.op, std::vector<std::string>());
+			for(size_t i = 0; i < computed.size(); i++) {
+				addComputedColumn(project, computed[i].first, computed[i].second);
+			}
+			input = project;
+		}
+		grouped.op = new AggregateOperator(input, groupNames, aggregates);
+		grouped.schema = grouped.op->getSchema();
+		grouped.pages = keys.empty() ? 1 : std::max(current.pages / 2, (PageId)1);
+		current = grouped;
+
+		std::vector<SqlExpr> having;
+		for(size_t i = 0; i < select.having.size(); i++) {
+			SqlExpr condition = select.having[i];
+			if(condition.type == SQLOPERATOR && condition.args.size() == 2) {
+				for(size_t side = 0; side < 2; side++) {
+					SqlExpr& operand = condition.args[side];
+					for(size_t j = 0; j < select.items.size(); j++) {
+						if(operand.type == SQLCOLUMN && operand.table.empty() && findColumn(current, operand) < 0 &&
+								lowerCase(select.items[j].alias) == lowerCase(operand.name)) {
+							operand = select.items[j].expr;
+						}
+					}
+				}
+			}
+			having.push_back(condition);
+		}
+		planFilter(current, having);
+	}
+
+	// ORDER BY before the SELECT list is computed, unless DISTINCT needs the list first
+	std::vector<SortKey> sortKeys;
+	if(!select.distinct && !orderExprs.empty()) {
+		std::vector<std::pair<std::string, CompiledExpr> > computed;
+		for(size_t i = 0; i < orderExprs.size(); i++) {
+			SortKey key;
+			key.descending = select.orderBy[i].descending;
+			int position = findColumn(current, orderExprs[i]);
+			if(position >= 0) {
+				key.column = current.schema.columns[position].name;
+			} else {
+				key.column = newColumnName("order");
+				computed.push_back(std::make_pair(key.column, compile(orderExprs[i], current)));
+			}
+			sortKeys.push_back(key);
+		}
+		if(!computed.empty()) {
+			std::vector<std::string> names;
+			for(size_t i = 0; i < current.schema.columns.size(); i++) {
+				names.push_back(current.schema.columns[i].name);
+			}
+			ProjectOperator* project = new ProjectOperator(current.op, names);
+			for(size_t i = 0; i < computed.size(); i++) {
+				addComputedColumn(project, computed[i].first, computed[i].second);
+				Binding hidden = {"", ""};
+				current.bindings.push_back(hidden);
+			}
+			current.op = project;
+			current.schema = project->getSchema();
+		}
+		if(select.limit >= 0) {
+			current.op = new TopNOperator(current.op, sortKeys, select.limit, select.offset);
+		} else {
+			current.op = new SortOperator(current.op, sortKeys);
+		}
+	}
+	if(!select.distinct && (select.orderBy.empty() || select.limit < 0) && (select.limit >= 0 || select.offset > 0)) {
+		current.op = new LimitOperator(current.op, select.limit >= 0 ? select.limit : (size_t)-1, select.offset);
+	}
+
+	// the SELECT list, named for the caller at the top, and uniquely in a subquery
+	Plan result;
+	std::vector<std::pair<std::string, CompiledExpr> > computed;
+	std::set<std::string> used;
+	std::vector<int> itemColumns;
+	for(size_t i = 0; i < select.items.size(); i++) {
+		const SqlExpr& expr = select.items[i].expr;
+		itemColumns.push_back(computed.size());
+		std::vector<std::pair<std::string, SqlExpr> > columns;
+		if(expr.type == SQLSTAR) {
+			for(size_t j = 0; j < current.bindings.size(); j++) {
+				const Binding& binding = current.bindings[j];
+				if(!binding.name.empty() && (expr.table.empty() || binding.table == lowerCase(expr.table))) {
+					SqlExpr column;
+					column.type = SQLCOLUMN;
+					column.table = binding.table;
+					column.name = binding.name;
+					columns.push_back(std::make_pair(binding.name, column));
+				}
+			}
+			if(columns.empty()) {
+				throw NoSuchColumnException(expr.toString());
+			}
+		} else {
+			std::string name = !select.items[i].alias.empty() ? select.items[i].alias :
+					expr.type == SQLCOLUMN ? expr.name : expr.toString();
+			columns.push_back(std::make_pair(name, expr));
+		}
+
+		for(size_t j = 0; j < columns.size(); j++) {
+			std::string name = columns[j].first;
+			if(topLevel) {
+				for(int k = 2; used.count(name) != 0; k++) {
+					std::ostringstream numbered;
+					numbered << columns[j].first << '#' << k;
+					name = numbered.str();
+				}
+				used.insert(name);
+			} else {
+				name = newColumnName(name);
+			}
+			computed.push_back(std::make_pair(name, compile(columns[j].second, current)));
+			Binding binding = {"", lowerCase(columns[j].first)};
+			result.bindings.push_back(binding);
+		}
+	}
+	ProjectOperator* project = new ProjectOperator(current.op, std::vector<std::string>());
+	for(size_t i = 0; i < computed.size(); i++) {
+		addComputedColumn(project, computed[i].first, computed[i].second);
+	}
+	result.op = project;
+	result.schema = project->getSchema();
+	result.pages = current.pages;
+
+	if(select.distinct) {
+		std::vector<std::string> names;
+		for(size_t i = 0; i < result.schema.columns.size(); i++) {
+			names.push_back(result.schema.columns[i].name);
+		}
+		result.op = new AggregateOperator(result.op, names, std::vector<AggregateSpec>());
+		for(size_t i = 0; i < orderExprs.size(); i++) {
+			if(orderItems[i] < 0) {
+				throw UnsupportedQueryException("ORDER BY of what DISTINCT does not select");
+			}
+			SortKey key = {result.schema.columns[itemColumns[orderItems[i]]].name, select.orderBy[i].descending};
+			sortKeys.push_back(key);
+		}
+		if(!sortKeys.empty() && select.limit >= 0) {
+			result.op = new TopNOperator(result.op, sortKeys, select.limit, select.offset);
+		} else if(!sortKeys.empty()) {
+			result.op = new SortOperator(result.op, sortKeys);
+		}
+		if((sortKeys.empty() || select.limit < 0) && (select.limit >= 0 || select.offset > 0)) {
+			result.op = new LimitOperator(result.op, select.limit >= 0 ? select.limit : (size_t)-1, select.offset);
+		}
+	}
+	return result;
+}
+
+}
@@ -0,0 +1,193 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <functional>
+
+#include "buffer.h"
+#include "btree.h"
+#include "operators.h"
+#include "hashjoin.h"
+#include "sqlparser.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Bytes a hash join of a planned query may take before it spills.
+ */
+const  size_t SQLJOINBUDGET = 1 << 24;
+
+/**
+ * @brief Compiles the SELECT statements SqlParser reads into trees of QueryOperators over the relations of a
+ * catalog.
+ *
+ * Conditions on a single relation are applied right above its scan. The relation is read with an
+ * IndexScanOperator instead of a ScanOperator when a condition compares an INTEGER column with a number and
+ * the BTreeIndex file of that column, relationName.attrByteOffset, exists; the same holds for the first
+ * ORDER BY column of a query over one relation with a LIMIT, so that the scan stops early. The FROM items
+ * are joined in FROM order, starting each time with an item an equality connects to those joined so far:
+ * with an IndexJoinOperator when the item is a relation, bigger than what it is joined with, with an index on
+ * an INTEGER join column, and with a HashJoinOperator building on the smaller side otherwise. Items no
+ * equality connects are joined as a cross product. IN and EXISTS subqueries become SemiJoinOperators, an
+ * EXISTS subquery has to be correlated with its outer query by a single equality.
+ *
+ * Names are case insensitive. An unqualified column name refers to the first column of that name in the FROM
+ * list, which for (A NATURAL JOIN B) is the column they share.
+*/
+class QueryPlanner {
+
+ private:
+
+  /**
+   * A SQL name of a column of a plan: the relation or alias it is qualified with, empty for a computed column,
+   * and its name, empty for a column that cannot be referred to, e.g. the second copy of a NATURAL JOIN
+   * column. Computed columns, such as aggregates after GROUP BY, are named by SqlExpr::toString().
+   */
+	struct Binding{
+		std::string table;
+		std::string name;
+	};
+
+  /**
+   * A planned FROM item or query: the operator, and the binding of each column of its schema. A relation
+   * whose access path has not been chosen yet has no operator; its columns are laid out as its records.
+   */
+	struct Plan{
+		QueryOperator* op;
+		Schema schema;
+		std::vector<Binding> bindings;
+
+	  /**
+	   * Name of the relation of a plan without operator, empty otherwise.
+	   */
+		std::string relation;
+
+	  /**
+	   * Estimated size in pages, to choose join methods.
+	   */
+		PageId pages;
+	};
+
+  /**
+   * An expression compiled against the schema of a plan. A condition is an INTEGER, 1 if it holds.
+   */
+	struct CompiledExpr{
+		Datatype type;
+
+	  /**
+	   * Number of chars of a STRING.
+	   */
+		int length;
+		std::function<double (const char* tuple)> number;
+		std::function<std::string (const char* tuple)> text;
+	};
+
+	BufMgr	*bufMgr;
+
+  /**
+   * Schemas of the relations, by name in lower case, and the names they were added with.
+   */
+	std::map<std::string, Schema>	relations;
+	std::map<std::string, std::string>	relationNames;
+
+  /**
+   * Indexes opened for the plans, each used by a single operator.
+   */
+	std::vector<BTreeIndex*>	indexes;
+
+  /**
+   * Number of columns named so far, to give every column of a plan a unique name.
+   */
+	int			columnCount;
+
+	std::string newColumnName(const std::string& name);
+
+  /**
+	 * @return position in plan of the column expr refers to, -1 if there is none
+	**/
+	int findColumn(const Plan& plan, const SqlExpr& expr) const;
+
+	CompiledExpr compile(const SqlExpr& expr, const Plan& plan) const;
+	CompiledExpr compileOperator(const SqlExpr& expr, const Plan& plan) const;
+	CompiledExpr compileFunction(const SqlExpr& expr, const Plan& plan) const;
+	TuplePredicate compileCondition(const SqlExpr& expr, const Plan& plan) const;
+
+  /**
+	 * Add a column to project computing expr.
+	**/
+	void addComputedColumn(ProjectOperator* project, const std::string& name, const CompiledExpr& expr) const;
+
+  /**
+	 * @return the index on column of relation if its file exists, NULL otherwise
+	**/
+	BTreeIndex* openIndex(const std::string& relation, const Column& column);
+
+	Plan planSelect(const SqlSelect& select, const bool topLevel);
+	Plan planTableRef(const SqlTableRef& ref);
+
+  /**
+	 * Give a relation planned without operator its access path, applying conditions, and scanning in the order
+	 * of orderColumn if it is not empty and indexed.
+	**/
+	void planAccess(Plan& plan, std::vector<SqlExpr>& conditions, const std::string& orderColumn, const bool descending);
+
+  /**
+	 * Join right to left on the equalities of the columns leftColumns of left and rightColumns of right, a cross
+	 * product if there are none. The right columns of the equalities are hidden if natural is set.
+	**/
+	Plan planJoin(Plan& left, Plan& right, std::vector<SqlExpr>& rightConditions, const std::vector<int>& leftColumns,
+						const std::vector<int>& rightColumns, const bool natural);
+
+  /**
+	 * Apply conditions to plan as a filter.
+	**/
+	void planFilter(Plan& plan, const std::vector<SqlExpr>& conditions);
+
+  /**
+	 * Apply an IN or EXISTS condition to plan as a semi-join.
+	**/
+	void planSubqueryCondition(Plan& plan, const SqlExpr& condition);
+
+ public:
+
+	QueryPlanner(BufMgr *bufMgrIn);
+
+  /**
+	 * Deletes the indexes opened for the plans, which have to be deleted first.
+	**/
+	~QueryPlanner();
+
+  /**
+	 * Add a relation to the catalog.
+   * @param schema		Layout of the records of the relation, e.g. built with Schema::addColumnAt()
+	**/
+	void addRelation(const std::string& relationName, const Schema& schema);
+
+  /**
+	 * Plan a SELECT statement. The result columns are named by their aliases, column names, or expressions.
+	 * @return the plan, owned by the caller, to be deleted before the planner
+	 * @throws SqlSyntaxException If sql is not valid SQL of the subset SqlParser reads.
+	 * @throws UnsupportedQueryException If sql is not a SELECT, or does what the planner cannot.
+	 * @throws NoSuchRelationException If a relation is not in the catalog.
+	 * @throws NoSuchColumnException If a column is not in the FROM items.
+	**/
+	QueryOperator* plan(const std::string& sql);
+	QueryOperator* plan(const SqlSelect& select);
+
+  /**
+	 * @return number of indexes opened for the plans so far
+	**/
+	size_t getIndexCount() const { return indexes.size(); }
+};
+
+}
@@ -0,0 +1,151 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cstring>
+#include <sstream>
+#include "spillfile.h"
+
+namespace badgerdb
+{
+
+/**
+ * Number of the next spill file, which names it.
+ */
+static int spillFileNumber = 0;
+
+// -----------------------------------------------------------------------------
+// SpillFile::SpillFile -- Constructor
+// -----------------------------------------------------------------------------
+
+SpillFile::SpillFile(BufMgr *bufMgrIn, const int tupleLength)
+{
+	do {
+		std::ostringstream name;
+		name << "spill." << spillFileNumber++;
+		fileName = name.str();
+	} while(File::exists(fileName));
+
+	this->bufMgr = bufMgrIn;
+	this->file = new BlobFile(fileName, true);
+	this->tupleLength = tupleLength;
+	this->tuplesPerPage = sizeof(SpillPage::data) / tupleLength;
+	this->firstPageNo = 0;
+	this->pageCount = 0;
+	this->tupleCount = 0;
+	this->writePage = NULL;
+	this->readPage = NULL;
+	this->readPageIndex = 0;
+	this->readSlot = 0;
+	this->prefetch = false;
+	this->aheadPage = NULL;
+}
+
+// -----------------------------------------------------------------------------
+// SpillFile::~SpillFile -- destructor
+// -----------------------------------------------------------------------------
+
+SpillFile::~SpillFile()
+{
+	finishWrite();
+	if(readPage != NULL) {
+		bufMgr->unPinPage(file, readPageNo, false);
+	}
+	if(aheadPage != NULL) {
+		bufMgr->unPinPage(file, aheadPageNo, false);
+	}
+	bufMgr->flushFile(file);
+	delete file;
+	File::remove(fileName);
+}
+
+// -----------------------------------------------------------------------------
+// SpillFile::append
+// -----------------------------------------------------------------------------
+
+void SpillFile::append(const char* tuple)
+{
+	if(writePage == NULL || writePage->count == tuplesPerPage) {
+		finishWrite();
+		Page* page;
+		bufMgr->allocPage(file, writePageNo, page);
+		if(pageCount++ == 0) {
+			firstPageNo = writePageNo;
+		}
+		writePage = (SpillPage*)page;
+		writePage->count = 0;
+	}
+	memcpy(writePage->data + writePage->count * tupleLength, tuple, tupleLength);
+	writePage->count++;
+	tupleCount++;
+}
+
+// -----------------------------------------------------------------------------
+// SpillFile::finishWrite
+// -----------------------------------------------------------------------------
+
+void SpillFile::finishWrite()
+{
+	if(writePage != NULL) {
+		bufMgr->unPinPage(file, writePageNo, true);
+		writePage = NULL;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// SpillFile::startRead
+// -----------------------------------------------------------------------------
+
+void SpillFile::startRead(const bool prefetch)
+{
+	finishWrite();
+	if(readPage != NULL) {
+		bufMgr->unPinPage(file, readPageNo, false);
+		readPage = NULL;
+	}
+	if(aheadPage != NULL) {
+		bufMgr->unPinPage(file, aheadPageNo, false);
+		aheadPage = NULL;
+	}
+	this->prefetch = prefetch;
+	readPageIndex = 0;
+	readSlot = 0;
+}
+
+// -----------------------------------------------------------------------------
+// SpillFile::readNext
+// -----------------------------------------------------------------------------
+
+const char* SpillFile::readNext()
+{
+	while(readPage == NULL || readSlot == readPage->count) {
+		if(readPage != NULL) {
+			bufMgr->unPinPage(file, readPageNo, false);
+			readPage = NULL;
+		}
+		if(readPageIndex == pageCount) {
+			return NULL;
+		}
+		Page* page;
+		readPageNo = firstPageNo + readPageIndex++;
+		if(aheadPage != NULL) {
+			readPage = aheadPage;
+			aheadPage = NULL;
+		} else {
+			bufMgr->readPage(file, readPageNo, page);
+			readPage = (SpillPage*)page;
+		}
+		readSlot = 0;
+		if(prefetch && readPageIndex < pageCount) {
+			aheadPageNo = firstPageNo + readPageIndex;
+			bufMgr->readPage(file, aheadPageNo, page);
+			aheadPage = (SpillPage*)page;
+		}
+	}
+	return readPage->data + readSlot++ * tupleLength;
+}
+
+}
@@ -0,0 +1,132 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief A page of a spill file, tuples packed one after another.
+ */
+struct SpillPage{
+  /**
+   * Number of tuples on the page.
+   */
+	int count;
+
+  /**
+   * The tuples.
+   */
+	char data[ Page::SIZE - sizeof( int ) ];
+};
+
+/**
+ * @brief Temporary file of fixed length tuples that an operator writes once and reads back in order, through
+ * the buffer pool, when its input does not fit in memory.
+ *
+ * Pages are allocated consecutively, so a spill file is read by page number without a page directory. The
+ * file is removed when the SpillFile is deleted.
+*/
+class SpillFile {
+
+ private:
+
+	BufMgr	*bufMgr;
+
+  /**
+   * The temporary file.
+   */
+	File		*file;
+	std::string	fileName;
+
+  /**
+   * Bytes of a tuple and number of tuples on a page.
+   */
+	int			tupleLength;
+	int			tuplesPerPage;
+
+  /**
+   * Page number of the first page, the others follow it.
+   */
+	PageId	firstPageNo;
+	int			pageCount;
+	size_t	tupleCount;
+
+  /**
+   * Page being filled, NULL if none is pinned.
+   */
+	SpillPage	*writePage;
+	PageId	writePageNo;
+
+  /**
+   * Page being read, NULL if none is pinned, and the position in the file and on the page of the next tuple.
+   */
+	SpillPage	*readPage;
+	PageId	readPageNo;
+	int			readPageIndex;
+	int			readSlot;
+
+  /**
+   * Page after the one being read, pinned ahead of time when reading with prefetch, NULL otherwise.
+   */
+	bool		prefetch;
+	SpillPage	*aheadPage;
+	PageId	aheadPageNo;
+
+ public:
+
+  /**
+	 * Create an empty spill file for tuples of tupleLength bytes.
+	**/
+	SpillFile(BufMgr *bufMgrIn, const int tupleLength);
+
+  /**
+	 * Destructor. Unpins the pages held and removes the file.
+	**/
+	~SpillFile();
+
+  /**
+	 * Append a copy of tuple.
+	**/
+	void append(const char* tuple);
+
+  /**
+	 * Unpin the page being filled. Appending later starts a new page.
+	**/
+	void finishWrite();
+
+  /**
+	 * Start reading the tuples from the first one, ending the writing.
+	 * @param prefetch		Read each page one page ahead and keep it pinned until it is reached
+	**/
+	void startRead(const bool prefetch = false);
+
+  /**
+	 * @return the next tuple, valid until the next call, or NULL once every tuple has been read
+	**/
+	const char* readNext();
+
+  /**
+	 * @return number of tuples appended
+	**/
+	size_t getTupleCount() const { return tupleCount; }
+
+  /**
+	 * @return number of pages written
+	**/
+	int getPageCount() const { return pageCount; }
+};
+
+}
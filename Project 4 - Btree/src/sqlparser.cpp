@@ -0,0 +1,748 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include "sqlparser.h"
+#include "exceptions/sql_syntax_exception.h"
+#include "exceptions/unsupported_query_exception.h"
+
+namespace badgerdb
+{
+
+/**
+ * Words that cannot be used as aliases, since they may follow a FROM item or a SELECT expression.
+ */
+static const char* reservedWords[] = {"SELECT", "DISTINCT", "ALL", "FROM", "WHERE", "GROUP", "BY", "HAVING", "ORDER",
+		"ASC", "DESC", "LIMIT", "OFFSET", "AS", "AND", "OR", "NOT", "IN", "EXISTS", "LIKE", "NATURAL", "JOIN", "INNER",
+		"ON", "UNION", "CASE", "WHEN", "THEN", "ELSE", "END", NULL};
+
+static std::string upperCase(const std::string& text)
+{
+	std::string upper(text);
+	for(size_t i = 0; i < upper.size(); i++) {
+		upper[i] = toupper(upper[i]);
+	}
+	return upper;
+}
+
+static std::string lowerCase(const std::string& text)
+{
+	std::string lower(text);
+	for(size_t i = 0; i < lower.size(); i++) {
+		lower[i] = tolower(lower[i]);
+	}
+	return lower;
+}
+
+// -----------------------------------------------------------------------------
+// SqlExpr::SqlExpr -- Constructor
+// -----------------------------------------------------------------------------
+
+SqlExpr::SqlExpr()
+{
+	this->type = SQLNUMBER;
+	this->number = 0;
+	this->distinct = false;
+	this->negated = false;
+}
+
+// -----------------------------------------------------------------------------
+// SqlExpr::toString
+// -----------------------------------------------------------------------------
+
+std::string SqlExpr::toString() const
+{
+	std::ostringstream text;
+	switch(type) {
+		case SQLCOLUMN:
+			if(!table.empty()) {
+				text << lowerCase(table) << '.';
+			}
+			text << lowerCase(name);
+			break;
+		case SQLNUMBER:
+			text << std::setprecision(15) << number;
+			break;
+		case SQLSTRING:
+			text << '\'' << name << '\'';
+			break;
+		case SQLOPERATOR:
+			if(args.size() == 1) {
+				text << (name == "NEG" ? "-" : "not") << '(' << args[0].toString() << ')';
+			} else {
+				text << '(' << args[0].toString() << ' ' << lowerCase(name) << ' ' << args[1].toString() << ')';
+			}
+			break;
+		case SQLFUNCTION:
+			text << lowerCase(name) << '(' << (distinct ? "distinct " : "");
+			for(size_t i = 0; i < args.size(); i++) {
+				text << (i > 0 ? "," : "") << args[i].toString();
+			}
+			text << ')';
+			break;
+		case SQLIN:
+			text << '(' << args[0].toString() << (negated ? " not in (" : " in (");
+			if(query) {
+				text << "select";
+			}
+			for(size_t i = 1; i < args.size(); i++) {
+				text << (i > 1 ? "," : "") << args[i].toString();
+			}
+			text << "))";
+			break;
+		case SQLEXISTS:
+			text << (negated ? "not exists(select)" : "exists(select)");
+			break;
+		case SQLSTAR:
+			if(!table.empty()) {
+				text << lowerCase(table) << '.';
+			}
+			text << '*';
+			break;
+	}
+	return text.str();
+}
+
+// -----------------------------------------------------------------------------
+// SqlExpr::hasAggregate
+// -----------------------------------------------------------------------------
+
+bool SqlExpr::hasAggregate() const
+{
+	if(type == SQLFUNCTION && isAggregateName(name)) {
+		return true;
+	}
+	for(size_t i = 0; i < args.size(); i++) {
+		if(args[i].hasAggregate()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// isAggregateName
+// -----------------------------------------------------------------------------
+
+bool isAggregateName(const std::string& name)
+{
+	return name == "COUNT" || name == "SUM" || name == "AVG" || name == "MIN" || name == "MAX";
+}
+
+// -----------------------------------------------------------------------------
+// SqlSelect::SqlSelect -- Constructor
+// -----------------------------------------------------------------------------
+
+SqlSelect::SqlSelect()
+{
+	this->distinct = false;
+	this->limit = -1;
+	this->offset = 0;
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::SqlParser -- Constructor
+// -----------------------------------------------------------------------------
+
+SqlParser::SqlParser(const std::string& text)
+{
+	tokenize(text);
+	this->next = 0;
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::tokenize
+// -----------------------------------------------------------------------------
+
+void SqlParser::tokenize(const std::string& text)
+{
+	static const char* symbols[] = {"<=", ">=", "<>", "!=", "==", "=", "<", ">", "+", "-", "*", "/", "(", ")",
+			",", ".", ";", NULL};
+	size_t i = 0;
+	while(i < text.size()) {
+		char c = text[i];
+		if(isspace((unsigned char)c)) {
+			i++;
+			continue;
+		}
+		if(c == '-' && i + 1 < text.size() && text[i + 1] == '-') {
+			while(i < text.size() && text[i] != '\n') {
+				i++;
+			}
+			continue;
+		}
+
+		Token token;
+		token.position = i;
+		token.number = 0;
+		if(isalpha((unsigned char)c) || c == '_') {
+			size_t end = i;
+			while(end < text.size() && (isalnum((unsigned char)text[end]) || text[end] == '_')) {
+				end++;
+			}
+			token.type = TOKIDENTIFIER;
+			token.text = text.substr(i, end - i);
+			i = end;
+		} else if(isdigit((unsigned char)c)) {
+			size_t end = i;
+			while(end < text.size() && (isdigit((unsigned char)text[end]) || text[end] == '.')) {
+				end++;
+			}
+			token.type = TOKNUMBER;
+			token.text = text.substr(i, end - i);
+			token.number = strtod(token.text.c_str(), NULL);
+			i = end;
+		} else if(c == '\'' || c == '"') {
+			// a doubled quote stands for itself
+			size_t end = i + 1;
+			while(true) {
+				if(end >= text.size()) {
+					throw SqlSyntaxException("unterminated string", i);
+				}
+				if(text[end] == c) {
+					if(end + 1 < text.size() && text[end + 1] == c) {
+						token.text += c;
+						end += 2;
+						continue;
+					}
+					break;
+				}
+				token.text += text[end++];
+			}
+			token.type = TOKSTRING;
+			i = end + 1;
+		} else {
+			int s = 0;
+			while(symbols[s] != NULL && text.compare(i, strlen(symbols[s]), symbols[s]) != 0) {
+				s++;
+			}
+			if(symbols[s] == NULL) {
+				throw SqlSyntaxException(std::string("unexpected character '") + c + "'", i);
+			}
+			token.type = TOKSYMBOL;
+			token.text = symbols[s];
+			i += token.text.size();
+		}
+		tokens.push_back(token);
+	}
+
+	Token end;
+	end.type = TOKEND;
+	end.number = 0;
+	end.position = text.size();
+	tokens.push_back(end);
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::atKeyword
+// -----------------------------------------------------------------------------
+
+bool SqlParser::atKeyword(const char* word) const
+{
+	return tokens[next].type == TOKIDENTIFIER && upperCase(tokens[next].text) == word;
+}
+
+bool SqlParser::acceptKeyword(const char* word)
+{
+	if(atKeyword(word)) {
+		next++;
+		return true;
+	}
+	return false;
+}
+
+void SqlParser::expectKeyword(const char* word)
+{
+	if(!acceptKeyword(word)) {
+		fail(word);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::atSymbol
+// -----------------------------------------------------------------------------
+
+bool SqlParser::atSymbol(const char* symbol) const
+{
+	return tokens[next].type == TOKSYMBOL && tokens[next].text == symbol;
+}
+
+bool SqlParser::acceptSymbol(const char* symbol)
+{
+	if(atSymbol(symbol)) {
+		next++;
+		return true;
+	}
+	return false;
+}
+
+void SqlParser::expectSymbol(const char* symbol)
+{
+	if(!acceptSymbol(symbol)) {
+		fail(std::string("'") + symbol + "'");
+	}
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::expectIdentifier
+// -----------------------------------------------------------------------------
+
+std::string SqlParser::expectIdentifier()
+{
+	if(tokens[next].type != TOKIDENTIFIER) {
+		fail("a name");
+	}
+	return tokens[next++].text;
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::atAlias
+// -----------------------------------------------------------------------------
+
+bool SqlParser::atAlias() const
+{
+	if(tokens[next].type != TOKIDENTIFIER) {
+		return false;
+	}
+	std::string word = upperCase(tokens[next].text);
+	for(int i = 0; reservedWords[i] != NULL; i++) {
+		if(word == reservedWords[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::fail
+// -----------------------------------------------------------------------------
+
+void SqlParser::fail(const std::string& expected) const
+{
+	const Token& token = tokens[next];
+	std::string found = token.type == TOKEND ? "end of text" : "'" + token.text + "'";
+	throw SqlSyntaxException("expected " + expected + " but found " + found, token.position);
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::atEnd
+// -----------------------------------------------------------------------------
+
+bool SqlParser::atEnd()
+{
+	while(acceptSymbol(";")) {
+	}
+	return tokens[next].type == TOKEND;
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::parseStatement
+// -----------------------------------------------------------------------------
+
+SqlSelect SqlParser::parseStatement()
+{
+	while(acceptSymbol(";")) {
+	}
+	if(!atKeyword("SELECT")) {
+		if(tokens[next].type == TOKIDENTIFIER) {
+			throw UnsupportedQueryException(upperCase(tokens[next].text) + " statements");
+		}
+		fail("SELECT");
+	}
+	SqlSelect select = parseSelect();
+	if(!acceptSymbol(";") && tokens[next].type != TOKEND) {
+		fail("end of statement");
+	}
+	return select;
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::parseSelect
+// -----------------------------------------------------------------------------
+
+SqlSelect SqlParser::parseSelect()
+{
+	SqlSelect select;
+	expectKeyword("SELECT");
+	select.distinct = acceptKeyword("DISTINCT");
+	if(!select.distinct) {
+		acceptKeyword("ALL");
+	}
+	do {
+		SqlSelectItem item;
+		item.expr = parseOr();
+		if(acceptKeyword("AS")) {
+			item.alias = tokens[next].type == TOKSTRING ? tokens[next++].text : expectIdentifier();
+		} else if(atAlias()) {
+			item.alias = tokens[next++].text;
+		}
+		select.items.push_back(item);
+	} while(acceptSymbol(","));
+
+	if(acceptKeyword("FROM")) {
+		select.from.push_back(parseTableRef(select));
+		while(true) {
+			if(acceptSymbol(",")) {
+				select.from.push_back(parseTableRef(select));
+			} else if(atKeyword("JOIN") || atKeyword("INNER")) {
+				acceptKeyword("INNER");
+				expectKeyword("JOIN");
+				select.from.push_back(parseTableRef(select));
+				expectKeyword("ON");
+				addConditions(parseOr(), select.where);
+			} else if(acceptKeyword("NATURAL")) {
+				// A NATURAL JOIN B without parentheses joins B to the item before it
+				expectKeyword("JOIN");
+				SqlTableRef& last = select.from.back();
+				if(last.joined.empty() || !last.alias.empty()) {
+					SqlTableRef group;
+					group.joined.push_back(last);
+					last = group;
+				}
+				last.joined.push_back(parseTableRef(select));
+			} else {
+				break;
+			}
+		}
+	}
+
+	if(acceptKeyword("WHERE")) {
+		addConditions(parseOr(), select.where);
+	}
+	if(acceptKeyword("GROUP")) {
+		expectKeyword("BY");
+		do {
+			select.groupBy.push_back(parseOr());
+		} while(acceptSymbol(","));
+	}
+	if(acceptKeyword("HAVING")) {
+		addConditions(parseOr(), select.having);
+	}
+	if(acceptKeyword("ORDER")) {
+		expectKeyword("BY");
+		do {
+			SqlOrderItem item;
+			item.expr = parseOr();
+			item.descending = acceptKeyword("DESC");
+			if(!item.descending) {
+				acceptKeyword("ASC");
+			}
+			select.orderBy.push_back(item);
+		} while(acceptSymbol(","));
+	}
+	if(acceptKeyword("LIMIT")) {
+		if(tokens[next].type != TOKNUMBER) {
+			fail("a number");
+		}
+		select.limit = (long long)tokens[next++].number;
+		if(acceptSymbol(",")) {
+			// LIMIT offset, count
+			if(tokens[next].type != TOKNUMBER) {
+				fail("a number");
+			}
+			select.offset = select.limit;
+			select.limit = (long long)tokens[next++].number;
+		} else if(acceptKeyword("OFFSET")) {
+			if(tokens[next].type != TOKNUMBER) {
+				fail("a number");
+			}
+			select.offset = (long long)tokens[next++].number;
+		}
+	}
+	if(atKeyword("UNION")) {
+		throw UnsupportedQueryException("UNION");
+	}
+	return select;
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::parseTableRef
+// -----------------------------------------------------------------------------
+
+SqlTableRef SqlParser::parseTableRef(SqlSelect& select)
+{
+	SqlTableRef ref;
+	if(acceptSymbol("(")) {
+		if(atKeyword("SELECT")) {
+			ref.query = std::make_shared<SqlSelect>(parseSelect());
+		} else {
+			ref.joined.push_back(parseTableRef(select));
+			while(acceptKeyword("NATURAL")) {
+				expectKeyword("JOIN");
+				ref.joined.push_back(parseTableRef(select));
+			}
+			if(ref.joined.size() == 1) {
+				SqlTableRef single = ref.joined[0];
+				ref = single;
+			}
+		}
+		expectSymbol(")");
+	} else {
+		ref.relation = expectIdentifier();
+	}
+
+	if(acceptKeyword("AS")) {
+		ref.alias = expectIdentifier();
+	} else if(atAlias()) {
+		ref.alias = tokens[next++].text;
+	}
+	return ref;
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::addConditions
+// -----------------------------------------------------------------------------
+
+void SqlParser::addConditions(const SqlExpr& expr, std::vector<SqlExpr>& conditions)
+{
+	if(expr.type == SQLOPERATOR && expr.name == "AND") {
+		addConditions(expr.args[0], conditions);
+		addConditions(expr.args[1], conditions);
+	} else {
+		conditions.push_back(expr);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::parseOr
+// -----------------------------------------------------------------------------
+
+// the operator name applied to left and right
+static SqlExpr binary(const std::string& name, const SqlExpr& left, const SqlExpr& right)
+{
+	SqlExpr expr;
+	expr.type = SQLOPERATOR;
+	expr.name = name;
+	expr.args.push_back(left);
+	expr.args.push_back(right);
+	return expr;
+}
+
+SqlExpr SqlParser::parseOr()
+{
+	SqlExpr expr = parseAnd();
+	while(acceptKeyword("OR")) {
+		expr = binary("OR", expr, parseAnd());
+	}
+	return expr;
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::parseAnd
+// -----------------------------------------------------------------------------
+
+SqlExpr SqlParser::parseAnd()
+{
+	SqlExpr expr = parseNot();
+	while(acceptKeyword("AND")) {
+		expr = binary("AND", expr, parseNot());
+	}
+	return expr;
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::parseNot
+// -----------------------------------------------------------------------------
+
+SqlExpr SqlParser::parseNot()
+{
+	if(!acceptKeyword("NOT")) {
+		return parsePredicate();
+	}
+	SqlExpr operand = parseNot();
+	if(operand.type == SQLEXISTS) {
+		operand.negated = !operand.negated;
+		return operand;
+	}
+	SqlExpr expr;
+	expr.type = SQLOPERATOR;
+	expr.name = "NOT";
+	expr.args.push_back(operand);
+	return expr;
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::parsePredicate
+// -----------------------------------------------------------------------------
+
+SqlExpr SqlParser::parsePredicate()
+{
+	static const char* comparisons[] = {"=", "==", "<>", "!=", "<", "<=", ">", ">=", NULL};
+	SqlExpr left = parseAdditive();
+	for(int i = 0; comparisons[i] != NULL; i++) {
+		if(acceptSymbol(comparisons[i])) {
+			std::string name = comparisons[i];
+			name = name == "==" ? "=" : name == "!=" ? "<>" : name;
+			return binary(name, left, parseAdditive());
+		}
+	}
+
+	bool negated = acceptKeyword("NOT");
+	if(acceptKeyword("LIKE")) {
+		SqlExpr expr = binary("LIKE", left, parseAdditive());
+		expr.negated = negated;
+		return expr;
+	}
+	if(acceptKeyword("IN")) {
+		SqlExpr expr;
+		expr.type = SQLIN;
+		expr.negated = negated;
+		expr.args.push_back(left);
+		expectSymbol("(");
+		if(atKeyword("SELECT")) {
+			expr.query = std::make_shared<SqlSelect>(parseSelect());
+		} else {
+			do {
+				expr.args.push_back(parseOr());
+			} while(acceptSymbol(","));
+		}
+		expectSymbol(")");
+		return expr;
+	}
+	if(negated) {
+		fail("IN or LIKE");
+	}
+	return left;
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::parseAdditive
+// -----------------------------------------------------------------------------
+
+SqlExpr SqlParser::parseAdditive()
+{
+	SqlExpr expr = parseMultiplicative();
+	while(atSymbol("+") || atSymbol("-")) {
+		std::string name = tokens[next++].text;
+		expr = binary(name, expr, parseMultiplicative());
+	}
+	return expr;
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::parseMultiplicative
+// -----------------------------------------------------------------------------
+
+SqlExpr SqlParser::parseMultiplicative()
+{
+	SqlExpr expr = parseUnary();
+	while(atSymbol("*") || atSymbol("/")) {
+		std::string name = tokens[next++].text;
+		expr = binary(name, expr, parseUnary());
+	}
+	return expr;
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::parseUnary
+// -----------------------------------------------------------------------------
+
+SqlExpr SqlParser::parseUnary()
+{
+	if(acceptSymbol("+")) {
+		return parseUnary();
+	}
+	if(!acceptSymbol("-")) {
+		return parsePrimary();
+	}
+	SqlExpr operand = parseUnary();
+	if(operand.type == SQLNUMBER) {
+		operand.number = -operand.number;
+		return operand;
+	}
+	SqlExpr expr;
+	expr.type = SQLOPERATOR;
+	expr.name = "NEG";
+	expr.args.push_back(operand);
+	return expr;
+}
+
+// -----------------------------------------------------------------------------
+// SqlParser::parsePrimary
+// -----------------------------------------------------------------------------
+
+SqlExpr SqlParser::parsePrimary()
+{
+	SqlExpr expr;
+	const Token& token = tokens[next];
+	if(token.type == TOKNUMBER) {
+		expr.type = SQLNUMBER;
+		expr.number = token.number;
+		next++;
+		return expr;
+	}
+	if(token.type == TOKSTRING) {
+		expr.type = SQLSTRING;
+		expr.name = token.text;
+		next++;
+		return expr;
+	}
+	if(acceptSymbol("*")) {
+		expr.type = SQLSTAR;
+		return expr;
+	}
+	if(acceptSymbol("(")) {
+		if(atKeyword("SELECT")) {
+			throw UnsupportedQueryException("scalar subqueries");
+		}
+		expr = parseOr();
+		expectSymbol(")");
+		return expr;
+	}
+	if(acceptKeyword("EXISTS")) {
+		expr.type = SQLEXISTS;
+		expectSymbol("(");
+		expr.query = std::make_shared<SqlSelect>(parseSelect());
+		expectSymbol(")");
+		return expr;
+	}
+	if(atKeyword("CASE")) {
+		throw UnsupportedQueryException("CASE expressions");
+	}
+	if(!atAlias()) {
+		fail("an expression");
+	}
+
+	std::string name = tokens[next++].text;
+	if(acceptSymbol("(")) {
+		expr.type = SQLFUNCTION;
+		expr.name = upperCase(name);
+		if(acceptSymbol("*")) {
+			SqlExpr star;
+			star.type = SQLSTAR;
+			expr.args.push_back(star);
+		} else {
+			expr.distinct = acceptKeyword("DISTINCT");
+			if(!atSymbol(")")) {
+				do {
+					expr.args.push_back(parseOr());
+				} while(acceptSymbol(","));
+			}
+		}
+		expectSymbol(")");
+		return expr;
+	}
+	if(acceptSymbol(".")) {
+		expr.table = name;
+		if(acceptSymbol("*")) {
+			expr.type = SQLSTAR;
+			return expr;
+		}
+		expr.type = SQLCOLUMN;
+		expr.name = expectIdentifier();
+		return expr;
+	}
+	expr.type = SQLCOLUMN;
+	expr.name = name;
+	return expr;
+}
+
+}
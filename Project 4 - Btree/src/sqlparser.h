@@ -0,0 +1,254 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace badgerdb
+{
+
+/**
+ * @brief Kinds of SQL expressions.
+ */
+enum SqlExprType
+{
+	SQLCOLUMN,
+	SQLNUMBER,
+	SQLSTRING,
+	SQLOPERATOR,
+	SQLFUNCTION,
+	SQLIN,
+	SQLEXISTS,
+	SQLSTAR
+};
+
+struct SqlSelect;
+
+/**
+ * @brief A parsed SQL expression.
+ */
+struct SqlExpr{
+	SqlExprType type;
+
+  /**
+   * Name of a column, value of a string, upper case name of a function, or operator: + - * / = <> < <= > >=,
+   * AND, OR, NOT, LIKE, or NEG for unary minus.
+   */
+	std::string name;
+
+  /**
+   * Table or alias a column, or a *, is qualified with, empty if none.
+   */
+	std::string table;
+
+  /**
+   * Value of a number.
+   */
+	double number;
+
+  /**
+   * True for an aggregate over DISTINCT values, e.g. COUNT(DISTINCT mid).
+   */
+	bool distinct;
+
+  /**
+   * True for NOT IN, NOT EXISTS and NOT LIKE.
+   */
+	bool negated;
+
+  /**
+   * Operands of an operator, arguments of a function, or for IN the expression tested followed by the list.
+   */
+	std::vector<SqlExpr> args;
+
+  /**
+   * Subquery of IN and EXISTS, NULL for an IN list.
+   */
+	std::shared_ptr<SqlSelect> query;
+
+	SqlExpr();
+
+  /**
+	 * @return the expression in a canonical form, identifiers in lower case, which is equal for expressions
+	 * written the same way up to case and spacing, e.g. to match ORDER BY SUM(x) with the SUM(x) selected
+	**/
+	std::string toString() const;
+
+  /**
+	 * @return true if the expression contains COUNT, SUM, AVG, MIN or MAX
+	**/
+	bool hasAggregate() const;
+};
+
+/**
+ * @return true if name, in upper case, is an aggregate function
+**/
+bool isAggregateName(const std::string& name);
+
+/**
+ * @brief An item of a FROM list: a relation, a subquery, or relations joined with NATURAL JOIN.
+ */
+struct SqlTableRef{
+  /**
+   * Name of the relation, empty for a subquery or a join.
+   */
+	std::string relation;
+
+  /**
+   * The subquery, NULL otherwise.
+   */
+	std::shared_ptr<SqlSelect> query;
+
+  /**
+   * Items of (A NATURAL JOIN B ...), in order, empty otherwise.
+   */
+	std::vector<SqlTableRef> joined;
+
+  /**
+   * Alias the item is referred to by, empty if none.
+   */
+	std::string alias;
+};
+
+/**
+ * @brief An expression of a SELECT list with its alias. A * or T.* is an SQLSTAR expression.
+ */
+struct SqlSelectItem{
+	SqlExpr expr;
+	std::string alias;
+};
+
+/**
+ * @brief An expression of an ORDER BY list.
+ */
+struct SqlOrderItem{
+	SqlExpr expr;
+	bool descending;
+};
+
+/**
+ * @brief A parsed SELECT statement. WHERE and HAVING are split into the conditions ANDed together, and the
+ * conditions of JOIN ... ON are added to WHERE.
+ */
+struct SqlSelect{
+	bool distinct;
+	std::vector<SqlSelectItem> items;
+	std::vector<SqlTableRef> from;
+	std::vector<SqlExpr> where;
+	std::vector<SqlExpr> groupBy;
+	std::vector<SqlExpr> having;
+	std::vector<SqlOrderItem> orderBy;
+
+  /**
+   * LIMIT and OFFSET, limit is -1 if there is no LIMIT.
+   */
+	long long limit;
+	long long offset;
+
+	SqlSelect();
+};
+
+/**
+ * @brief Recursive descent parser for the SELECT statements of our report queries.
+ *
+ * It takes SELECT [DISTINCT] with expressions and aliases; FROM lists of relations, subqueries,
+ * (A NATURAL JOIN B) and A [INNER] JOIN B ON condition; WHERE with AND, OR, NOT, comparisons, arithmetic,
+ * LIKE, IN and NOT IN lists or subqueries, EXISTS and NOT EXISTS; GROUP BY; HAVING; ORDER BY with ASC and DESC;
+ * LIMIT and OFFSET; the aggregates COUNT, SUM, AVG, MIN and MAX with DISTINCT; and SUBSTR. Keywords and
+ * identifiers are case insensitive, strings are quoted with ' or ". Statements are separated by semicolons.
+*/
+class SqlParser {
+
+ private:
+
+	enum TokenType
+	{
+		TOKIDENTIFIER,
+		TOKNUMBER,
+		TOKSTRING,
+		TOKSYMBOL,
+		TOKEND
+	};
+
+	struct Token{
+		TokenType type;
+		std::string text;
+		double number;
+		size_t position;
+	};
+
+	std::vector<Token>	tokens;
+
+  /**
+   * Position in tokens of the next token to parse.
+   */
+	size_t	next;
+
+	void tokenize(const std::string& text);
+
+  /**
+	 * @return true if the next token is the keyword word, given in upper case
+	**/
+	bool atKeyword(const char* word) const;
+	bool acceptKeyword(const char* word);
+	void expectKeyword(const char* word);
+	bool atSymbol(const char* symbol) const;
+	bool acceptSymbol(const char* symbol);
+	void expectSymbol(const char* symbol);
+	std::string expectIdentifier();
+
+  /**
+	 * @return true if the next token is an identifier that is not a reserved word, i.e. can be an alias
+	**/
+	bool atAlias() const;
+
+  /**
+	 * @throws SqlSyntaxException saying that expected was expected at the next token
+	**/
+	void fail(const std::string& expected) const;
+
+	SqlSelect parseSelect();
+	SqlTableRef parseTableRef(SqlSelect& select);
+	SqlExpr parseOr();
+	SqlExpr parseAnd();
+	SqlExpr parseNot();
+	SqlExpr parsePredicate();
+	SqlExpr parseAdditive();
+	SqlExpr parseMultiplicative();
+	SqlExpr parseUnary();
+	SqlExpr parsePrimary();
+
+  /**
+	 * Append the conditions expr ANDs together to conditions.
+	**/
+	static void addConditions(const SqlExpr& expr, std::vector<SqlExpr>& conditions);
+
+ public:
+
+  /**
+   * @param text		One or more statements
+   * @throws SqlSyntaxException If text has a character no token starts with, or an unterminated string.
+	**/
+	SqlParser(const std::string& text);
+
+  /**
+	 * @return true if there are no statements left
+	**/
+	bool atEnd();
+
+  /**
+	 * Parse the next statement.
+	 * @throws SqlSyntaxException If it is not valid SQL of the subset.
+	 * @throws UnsupportedQueryException If it is a statement other than SELECT, or uses CASE or scalar subqueries.
+	**/
+	SqlSelect parseStatement();
+};
+
+}
@@ -0,0 +1,508 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cassert>
+#include <algorithm>
+#include "stringnode.h"
+
+namespace badgerdb
+{
+
+static StringLeafSlot* leafSlots(LeafNodeString* node)
+{
+	return (StringLeafSlot*)node->data;
+}
+
+static const StringLeafSlot* leafSlots(const LeafNodeString* node)
+{
+	return (const StringLeafSlot*)node->data;
+}
+
+static StringNonLeafSlot* nonLeafSlots(NonLeafNodeString* node)
+{
+	return (StringNonLeafSlot*)node->data;
+}
+
+static const StringNonLeafSlot* nonLeafSlots(const NonLeafNodeString* node)
+{
+	return (const StringNonLeafSlot*)node->data;
+}
+
+// -----------------------------------------------------------------------------
+// compareStringKeys
+// -----------------------------------------------------------------------------
+
+int compareStringKeys(const char* key1, const int length1, const char* key2, const int length2)
+{
+	int cmp = memcmp(key1, key2, std::min(length1, length2));
+	if(cmp != 0) {
+		return cmp;
+	}
+	return length1 - length2;
+}
+
+// -----------------------------------------------------------------------------
+// getStringKeyLength
+// -----------------------------------------------------------------------------
+
+int getStringKeyLength(const char* key)
+{
+	int length = 0;
+	while(length < STRINGSIZE && key[length] != '\0') {
+		length++;
+	}
+	return length;
+}
+
+// -----------------------------------------------------------------------------
+// shortestSeparator
+// -----------------------------------------------------------------------------
+
+int shortestSeparator(const char* left, const int leftLength, const char* right, const int rightLength)
+{
+	// one byte past the first difference is enough, if right is the larger key
+	int i = 0;
+	while(i < leftLength && i < rightLength && left[i] == right[i]) {
+		i++;
+	}
+	if(i < rightLength && (i == leftLength || (unsigned char)left[i] < (unsigned char)right[i])) {
+		return i + 1;
+	}
+	return rightLength;
+}
+
+// -----------------------------------------------------------------------------
+// initStringLeaf
+// -----------------------------------------------------------------------------
+
+void initStringLeaf(LeafNodeString* node)
+{
+	node->rightSibPageNo = 0;
+	node->leftSibPageNo = 0;
+	node->keyCount = 0;
+	node->prefixLength = 0;
+	node->heapOffset = STRINGLEAFDATASIZE;
+	memset(node->prefix, 0, MAXSTRINGKEYSIZE);
+}
+
+// -----------------------------------------------------------------------------
+// buildStringLeaf
+// -----------------------------------------------------------------------------
+
+bool buildStringLeaf(LeafNodeString* node, const std::vector<RIDKeyPair<std::string> >& entries)
+{
+	// keys are sorted, so the prefix of the first and last key is shared by all of them
+	int prefixLength = 0;
+	if(!entries.empty()) {
+		const std::string& first = entries.front().key;
+		const std::string& last = entries.back().key;
+		while(prefixLength < (int)first.size() && prefixLength < (int)last.size()
+				&& first[prefixLength] == last[prefixLength]) {
+			prefixLength++;
+		}
+	}
+
+	int bytes = entries.size() * sizeof(StringLeafSlot);
+	for(size_t i = 0; i < entries.size(); i++) {
+		bytes += entries[i].key.size() - prefixLength;
+	}
+	if(bytes > STRINGLEAFDATASIZE) {
+		return false;
+	}
+
+	node->keyCount = entries.size();
+	node->prefixLength = prefixLength;
+	memset(node->prefix, 0, MAXSTRINGKEYSIZE);
+	if(prefixLength > 0) {
+		memcpy(node->prefix, entries.front().key.data(), prefixLength);
+	}
+	node->heapOffset = STRINGLEAFDATASIZE;
+	StringLeafSlot* slots = leafSlots(node);
+	for(size_t i = 0; i < entries.size(); i++) {
+		int length = entries[i].key.size() - prefixLength;
+		node->heapOffset -= length;
+		memcpy(node->data + node->heapOffset, entries[i].key.data() + prefixLength, length);
+		slots[i].rid = entries[i].rid;
+		slots[i].offset = node->heapOffset;
+		slots[i].length = length;
+	}
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// readStringLeaf
+// -----------------------------------------------------------------------------
+
+void readStringLeaf(const LeafNodeString* node, std::vector<RIDKeyPair<std::string> >& entries)
+{
+	for(int i = 0; i < node->keyCount; i++) {
+		RIDKeyPair<std::string> entry;
+		entry.set(leafSlots(node)[i].rid, getStringLeafKey(node, i));
+		entries.push_back(entry);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// getStringLeafKey
+// -----------------------------------------------------------------------------
+
+std::string getStringLeafKey(const LeafNodeString* node, const int pos)
+{
+	const StringLeafSlot& slot = leafSlots(node)[pos];
+	std::string key(node->prefix, node->prefixLength);
+	key.append((const char*)node->data + slot.offset, slot.length);
+	return key;
+}
+
+// -----------------------------------------------------------------------------
+// findStringLeafPos
+// -----------------------------------------------------------------------------
+
+int findStringLeafPos(const LeafNodeString* node, const std::string& key, const bool afterKey)
+{
+	// a key that does not start with the head prefix sorts before or after the whole leaf
+	int keyLength = key.size();
+	int cmp = memcmp(key.data(), node->prefix, std::min(keyLength, node->prefixLength));
+	if(cmp < 0 || (cmp == 0 && keyLength < node->prefixLength)) {
+		return 0;
+	}
+	if(cmp > 0) {
+		return node->keyCount;
+	}
+
+	const char* suffix = key.data() + node->prefixLength;
+	int suffixLength = keyLength - node->prefixLength;
+	const StringLeafSlot* slots = leafSlots(node);
+	int low = 0;
+	int high = node->keyCount;
+	while(low < high) {
+		int mid = (low + high) / 2;
+		cmp = compareStringKeys((const char*)node->data + slots[mid].offset, slots[mid].length, suffix, suffixLength);
+		if(cmp < 0 || (afterKey && cmp == 0)) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+// -----------------------------------------------------------------------------
+// insertIntoStringLeaf
+// -----------------------------------------------------------------------------
+
+bool insertIntoStringLeaf(LeafNodeString* node, const RIDKeyPair<std::string>& entry)
+{
+	int pos = findStringLeafPos(node, entry.key, true);
+	int keyLength = entry.key.size();
+	int length = keyLength - node->prefixLength;
+	int freeBytes = node->heapOffset - (int)((node->keyCount + 1) * sizeof(StringLeafSlot));
+
+	// the common case only adds a slot and a suffix
+	if(node->keyCount > 0 && keyLength >= node->prefixLength
+			&& memcmp(entry.key.data(), node->prefix, node->prefixLength) == 0 && freeBytes >= length) {
+		StringLeafSlot* slots = leafSlots(node);
+		for(int i = node->keyCount; i > pos; i--) {
+			slots[i] = slots[i-1];
+		}
+		node->heapOffset -= length;
+		memcpy(node->data + node->heapOffset, entry.key.data() + node->prefixLength, length);
+		slots[pos].rid = entry.rid;
+		slots[pos].offset = node->heapOffset;
+		slots[pos].length = length;
+		node->keyCount++;
+		return true;
+	}
+
+	// otherwise the head prefix has to shrink or the suffixes need compacting
+	std::vector<RIDKeyPair<std::string> > entries;
+	readStringLeaf(node, entries);
+	entries.insert(entries.begin() + pos, entry);
+	return buildStringLeaf(node, entries);
+}
+
+// -----------------------------------------------------------------------------
+// removeFromStringLeaf
+// -----------------------------------------------------------------------------
+
+void removeFromStringLeaf(LeafNodeString* node, const int pos)
+{
+	StringLeafSlot* slots = leafSlots(node);
+	for(int i = pos; i < node->keyCount - 1; i++) {
+		slots[i] = slots[i+1];
+	}
+	node->keyCount--;
+	if(node->keyCount == 0) {
+		node->prefixLength = 0;
+		node->heapOffset = STRINGLEAFDATASIZE;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// stringLeafBytes
+// -----------------------------------------------------------------------------
+
+/**
+ * @return bytes of data the sorted entries [begin, end) take in a leaf of their own
+**/
+static int stringLeafBytes(const std::vector<RIDKeyPair<std::string> >& entries, const std::vector<int>& keyBytes,
+		const int begin, const int end)
+{
+	const std::string& first = entries[begin].key;
+	const std::string& last = entries[end-1].key;
+	int prefixLength = 0;
+	while(prefixLength < (int)first.size() && prefixLength < (int)last.size()
+			&& first[prefixLength] == last[prefixLength]) {
+		prefixLength++;
+	}
+	return (end - begin) * ((int)sizeof(StringLeafSlot) - prefixLength) + keyBytes[end] - keyBytes[begin];
+}
+
+// -----------------------------------------------------------------------------
+// splitStringLeaf
+// -----------------------------------------------------------------------------
+
+std::string splitStringLeaf(LeafNodeString* node, LeafNodeString* newNode, const RIDKeyPair<std::string>& entry,
+		const bool rightEdge)
+{
+	std::vector<RIDKeyPair<std::string> > entries;
+	readStringLeaf(node, entries);
+	entries.insert(entries.begin() + findStringLeafPos(node, entry.key, true), entry);
+	int count = entries.size();
+
+	// keyBytes[i] is the length of the first i keys together
+	std::vector<int> keyBytes(count + 1, 0);
+	for(int i = 0; i < count; i++) {
+		keyBytes[i+1] = keyBytes[i] + entries[i].key.size();
+	}
+
+	// a half can lose the head prefix the full leaf had when the new key shares less of it, so the split
+	// evens out the bytes of the halves and skips the points where one of them would not fit
+	std::vector<int> leftBytes(count, 0);
+	std::vector<int> rightBytes(count, 0);
+	int mid = 0;
+	for(int i = 1; i < count; i++) {
+		leftBytes[i] = stringLeafBytes(entries, keyBytes, 0, i);
+		rightBytes[i] = stringLeafBytes(entries, keyBytes, i, count);
+		if(leftBytes[i] <= STRINGLEAFDATASIZE && rightBytes[i] <= STRINGLEAFDATASIZE
+				&& (mid == 0 || std::abs(leftBytes[i] - rightBytes[i]) < std::abs(leftBytes[mid] - rightBytes[mid]))) {
+			mid = i;
+		}
+	}
+
+	// a new key between two others shares their prefix and one at either end fits in a half of its own,
+	// so some split point always fits
+	assert(mid > 0);
+
+	// appending past the last key keeps the full leaf full, the entry starts the new leaf on its own
+	int window = STRINGSPLITWINDOW;
+	if(rightEdge && leftBytes[count-1] <= STRINGLEAFDATASIZE) {
+		mid = count - 1;
+		window = 0;
+	}
+
+	// a split point a little off the middle is worth it for a shorter separator
+	int split = mid;
+	int sepLength = MAXSTRINGKEYSIZE + 1;
+	for(int i = std::max(1, mid - window); i <= std::min(count - 1, mid + window); i++) {
+		if(leftBytes[i] > STRINGLEAFDATASIZE || rightBytes[i] > STRINGLEAFDATASIZE) {
+			continue;
+		}
+		const std::string& left = entries[i-1].key;
+		const std::string& right = entries[i].key;
+		int length = shortestSeparator(left.data(), left.size(), right.data(), right.size());
+		if(length < sepLength || (length == sepLength && std::abs(i - mid) < std::abs(split - mid))) {
+			sepLength = length;
+			split = i;
+		}
+	}
+
+	std::vector<RIDKeyPair<std::string> > right(entries.begin() + split, entries.end());
+	entries.resize(split);
+	PageId rightSibPageNo = newNode->rightSibPageNo;
+	PageId leftSibPageNo = newNode->leftSibPageNo;
+	initStringLeaf(newNode);
+	newNode->rightSibPageNo = rightSibPageNo;
+	newNode->leftSibPageNo = leftSibPageNo;
+
+	buildStringLeaf(node, entries);
+	buildStringLeaf(newNode, right);
+	return right.front().key.substr(0, sepLength);
+}
+
+// -----------------------------------------------------------------------------
+// initStringNonLeaf
+// -----------------------------------------------------------------------------
+
+void initStringNonLeaf(NonLeafNodeString* node, const int level, const PageId pageNo)
+{
+	node->level = level;
+	node->keyCount = 0;
+	node->heapOffset = STRINGNONLEAFDATASIZE;
+	StringNonLeafSlot* slots = nonLeafSlots(node);
+	slots[0].pageNo = pageNo;
+	slots[0].offset = 0;
+	slots[0].length = 0;
+}
+
+// -----------------------------------------------------------------------------
+// getStringSeparator
+// -----------------------------------------------------------------------------
+
+std::string getStringSeparator(const NonLeafNodeString* node, const int pos)
+{
+	const StringNonLeafSlot& slot = nonLeafSlots(node)[pos];
+	return std::string((const char*)node->data + slot.offset, slot.length);
+}
+
+// -----------------------------------------------------------------------------
+// getStringChild
+// -----------------------------------------------------------------------------
+
+PageId getStringChild(const NonLeafNodeString* node, const int pos)
+{
+	return nonLeafSlots(node)[pos].pageNo;
+}
+
+// -----------------------------------------------------------------------------
+// findStringChildPos
+// -----------------------------------------------------------------------------
+
+int findStringChildPos(const NonLeafNodeString* node, const std::string& key, const bool afterKey)
+{
+	// keys in child i lie between separator i-1 and separator i, either end included
+	const StringNonLeafSlot* slots = nonLeafSlots(node);
+	int low = 0;
+	int high = node->keyCount;
+	while(low < high) {
+		int mid = (low + high) / 2;
+		int cmp = compareStringKeys((const char*)node->data + slots[mid].offset, slots[mid].length, key.data(), key.size());
+		if(cmp < 0 || (afterKey && cmp == 0)) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+// -----------------------------------------------------------------------------
+// insertIntoStringNonLeaf
+// -----------------------------------------------------------------------------
+
+bool insertIntoStringNonLeaf(NonLeafNodeString* node, const int pos, const std::string& sep, const PageId pageNo)
+{
+	int freeBytes = node->heapOffset - (int)((node->keyCount + 2) * sizeof(StringNonLeafSlot));
+	if(freeBytes < (int)sep.size()) {
+		return false;
+	}
+
+	// the new child takes over the separator to the right of child pos, sep goes between the two
+	StringNonLeafSlot* slots = nonLeafSlots(node);
+	for(int i = node->keyCount + 1; i > pos + 1; i--) {
+		slots[i] = slots[i-1];
+	}
+	slots[pos+1].pageNo = pageNo;
+	slots[pos+1].offset = slots[pos].offset;
+	slots[pos+1].length = slots[pos].length;
+	node->heapOffset -= sep.size();
+	memcpy(node->data + node->heapOffset, sep.data(), sep.size());
+	slots[pos].offset = node->heapOffset;
+	slots[pos].length = sep.size();
+	node->keyCount++;
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// buildStringNonLeaf
+// -----------------------------------------------------------------------------
+
+static void buildStringNonLeaf(NonLeafNodeString* node, const std::vector<PageId>& pageNos,
+		const std::vector<std::string>& seps)
+{
+	initStringNonLeaf(node, node->level, pageNos[0]);
+	for(size_t i = 1; i < pageNos.size(); i++) {
+		insertIntoStringNonLeaf(node, i - 1, seps[i-1], pageNos[i]);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// splitStringNonLeaf
+// -----------------------------------------------------------------------------
+
+std::string splitStringNonLeaf(NonLeafNodeString* node, NonLeafNodeString* newNode, const int pos,
+		const std::string& sep, const PageId pageNo, const bool rightEdge)
+{
+	std::vector<PageId> pageNos;
+	std::vector<std::string> seps;
+	for(int i = 0; i <= node->keyCount; i++) {
+		pageNos.push_back(getStringChild(node, i));
+		if(i < node->keyCount) {
+			seps.push_back(getStringSeparator(node, i));
+		}
+	}
+	pageNos.insert(pageNos.begin() + pos + 1, pageNo);
+	seps.insert(seps.begin() + pos, sep);
+	int total = pageNos.size();
+
+	// sepBytes[i] is the length of the first i separators together
+	std::vector<int> sepBytes(total, 0);
+	for(int i = 0; i < total - 1; i++) {
+		sepBytes[i+1] = sepBytes[i] + seps[i].size();
+	}
+
+	// the middle is where the bytes of the halves even out, separators can differ a lot in length; the
+	// separator pushed up between the halves is kept in neither
+	std::vector<int> leftBytes(total, 0);
+	std::vector<int> rightBytes(total, 0);
+	int mid = 0;
+	for(int i = 1; i < total; i++) {
+		leftBytes[i] = i * (int)sizeof(StringNonLeafSlot) + sepBytes[i-1];
+		rightBytes[i] = (total - i) * (int)sizeof(StringNonLeafSlot) + sepBytes[total-1] - sepBytes[i];
+		if(leftBytes[i] <= STRINGNONLEAFDATASIZE && rightBytes[i] <= STRINGNONLEAFDATASIZE
+				&& (mid == 0 || std::abs(leftBytes[i] - rightBytes[i]) < std::abs(leftBytes[mid] - rightBytes[mid]))) {
+			mid = i;
+		}
+	}
+
+	// the halves share the bytes of a node that fit and of one more separator, so even halves always fit
+	assert(mid > 0);
+
+	// a right edge split leaves only the new child in the new node, the node keeps what it had
+	int window = STRINGSPLITWINDOW;
+	if(rightEdge && pos == total - 2) {
+		mid = total - 1;
+		window = 0;
+	}
+
+	// push up the shortest separator near the middle
+	int leftCount = mid;
+	for(int i = std::max(1, mid - window); i <= std::min(total - 1, mid + window); i++) {
+		if(leftBytes[i] > STRINGNONLEAFDATASIZE || rightBytes[i] > STRINGNONLEAFDATASIZE) {
+			continue;
+		}
+		if(seps[i-1].size() < seps[leftCount-1].size()
+				|| (seps[i-1].size() == seps[leftCount-1].size() && std::abs(i - mid) < std::abs(leftCount - mid))) {
+			leftCount = i;
+		}
+	}
+
+	std::string upKey = seps[leftCount-1];
+	newNode->level = node->level;
+	buildStringNonLeaf(newNode, std::vector<PageId>(pageNos.begin() + leftCount, pageNos.end()),
+			std::vector<std::string>(seps.begin() + leftCount, seps.end()));
+	pageNos.resize(leftCount);
+	seps.resize(leftCount - 1);
+	buildStringNonLeaf(node, pageNos, seps);
+	return upKey;
+}
+
+}
@@ -0,0 +1,244 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "page.h"
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Width of a STRING key, keys shorter than this are padded with NUL bytes.
+ */
+const  int STRINGSIZE = 64;
+
+/**
+ * @brief Longest key the string nodes take, which leaves room for keys made of several attributes.
+ */
+const  int MAXSTRINGKEYSIZE = 256;
+
+/**
+ * @brief Slot of a string leaf: the record id and where the key suffix is kept in the node.
+ */
+struct StringLeafSlot{
+	RecordId rid;
+	unsigned short offset;
+	unsigned short length;
+};
+
+/**
+ * @brief Slot of a string non-leaf: a child and the separator to its right, empty for the last child.
+ */
+struct StringNonLeafSlot{
+	PageId pageNo;
+	unsigned short offset;
+	unsigned short length;
+};
+
+/**
+ * @brief Number of bytes for slots and key bytes in a string leaf.
+ */
+//                                                    sibling ptrs         counts              head prefix
+const  int STRINGLEAFDATASIZE = Page::SIZE - 2 * sizeof( PageId ) - 3 * sizeof( int ) - MAXSTRINGKEYSIZE;
+
+/**
+ * @brief Number of bytes for slots and key bytes in a string non-leaf.
+ */
+//                                                       level and counts
+const  int STRINGNONLEAFDATASIZE = Page::SIZE - 3 * sizeof( int );
+
+/**
+ * @brief Number of candidate split points on either side of the middle of a string leaf that are tried
+ * for the shortest separator.
+ */
+const  int STRINGSPLITWINDOW = 8;
+
+
+/**
+ * @brief Structure for all leaf nodes when the key is of STRING type.
+ * The prefix shared by every key in the node is stored once, each entry only keeps the rest of its key.
+ * Slots are sorted by key and grow from the front of data, key suffixes are stored from the back.
+*/
+struct LeafNodeString{
+  /**
+   * Page number of the leaf on the right side.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side.
+   */
+	PageId leftSibPageNo;
+
+  /**
+   * Number of entries.
+   */
+	int keyCount;
+
+  /**
+   * Length of the head prefix.
+   */
+	int prefixLength;
+
+  /**
+   * Start of the key suffix bytes, which run to the end of data.
+   */
+	int heapOffset;
+
+  /**
+   * Prefix common to every key in the leaf.
+   */
+	char prefix[ MAXSTRINGKEYSIZE ];
+
+  /**
+   * StringLeafSlots followed by free space and key suffixes.
+   */
+	unsigned char data[ STRINGLEAFDATASIZE ];
+};
+
+
+/**
+ * @brief Structure for all non-leaf nodes when the key is of STRING type.
+ * Separators are truncated to the shortest prefix that still tells the two children apart, so the fanout
+ * depends on how much the keys differ rather than on STRINGSIZE.
+*/
+struct NonLeafNodeString{
+  /**
+   * Level of the node in the tree, 1 right above the leaves.
+   */
+	int level;
+
+  /**
+   * Number of separators, the node has one child more.
+   */
+	int keyCount;
+
+  /**
+   * Start of the separator bytes, which run to the end of data.
+   */
+	int heapOffset;
+
+  /**
+   * StringNonLeafSlots followed by free space and separators.
+   */
+	unsigned char data[ STRINGNONLEAFDATASIZE ];
+};
+
+
+/**
+ * Compare two keys byte by byte, a key that is a prefix of the other sorts first.
+ * @return less than, equal to or greater than 0 like strcmp
+**/
+int compareStringKeys(const char* key1, const int length1, const char* key2, const int length2);
+
+/**
+ * @return length of a STRINGSIZE key, up to its first NUL byte
+**/
+int getStringKeyLength(const char* key);
+
+/**
+ * Find the shortest prefix sep of right with left < sep <= right, which is what a split promotes.
+ * If left and right are equal, the whole key is returned.
+ * @return length of the separator, which is the first that many bytes of right
+**/
+int shortestSeparator(const char* left, const int leftLength, const char* right, const int rightLength);
+
+/**
+ * Empty a string leaf.
+**/
+void initStringLeaf(LeafNodeString* node);
+
+/**
+ * Rewrite a string leaf from entries sorted by key, with the longest head prefix they share.
+ * @return false if the entries do not fit, the node is then left unchanged
+**/
+bool buildStringLeaf(LeafNodeString* node, const std::vector<RIDKeyPair<std::string> >& entries);
+
+/**
+ * Copy the entries of a string leaf out, with their keys expanded.
+**/
+void readStringLeaf(const LeafNodeString* node, std::vector<RIDKeyPair<std::string> >& entries);
+
+/**
+ * @return the full key of entry pos
+**/
+std::string getStringLeafKey(const LeafNodeString* node, const int pos);
+
+/**
+ * Binary search a string leaf for the first entry with a key >= key, or > key if afterKey is set.
+ * The head prefix is compared once, only the suffixes are compared in the search.
+ * @return index of the entry, keyCount if there is none
+**/
+int findStringLeafPos(const LeafNodeString* node, const std::string& key, const bool afterKey);
+
+/**
+ * Insert an entry after any entries with the same key. The head prefix is shortened if the key does not
+ * start with it, and the node is compacted if deleted suffixes left holes.
+ * @return false if the entry does not fit and the leaf has to be split
+**/
+bool insertIntoStringLeaf(LeafNodeString* node, const RIDKeyPair<std::string>& entry);
+
+/**
+ * Remove entry pos. Its suffix bytes are reclaimed the next time the leaf is compacted.
+**/
+void removeFromStringLeaf(LeafNodeString* node, const int pos);
+
+/**
+ * Split a string leaf entry does not fit in, moving the upper part of its entries and entry into newNode,
+ * which is rebuilt and gets its own head prefix. The halves are balanced by bytes rather than entries, and
+ * of the split points near the middle the one with the shortest separator is taken. With rightEdge set, for
+ * an entry appended past the last key, node keeps all its entries and newNode gets entry alone.
+ * Sibling pointers are left to the caller.
+ * @return the separator to insert into the parent for newNode
+**/
+std::string splitStringLeaf(LeafNodeString* node, LeafNodeString* newNode, const RIDKeyPair<std::string>& entry,
+		const bool rightEdge);
+
+/**
+ * Make a string non-leaf with the single child pageNo.
+**/
+void initStringNonLeaf(NonLeafNodeString* node, const int level, const PageId pageNo);
+
+/**
+ * @return separator pos, between child pos and child pos+1
+**/
+std::string getStringSeparator(const NonLeafNodeString* node, const int pos);
+
+/**
+ * @return page number of child pos
+**/
+PageId getStringChild(const NonLeafNodeString* node, const int pos);
+
+/**
+ * Find the child to descend to for key: the leftmost child that may contain it, or the rightmost one if
+ * afterKey is set.
+ * @return index of the child
+**/
+int findStringChildPos(const NonLeafNodeString* node, const std::string& key, const bool afterKey);
+
+/**
+ * Insert separator sep and the child pageNo right of it after child pos.
+ * @return false if the node is full and has to be split
+**/
+bool insertIntoStringNonLeaf(NonLeafNodeString* node, const int pos, const std::string& sep, const PageId pageNo);
+
+/**
+ * Split a string non-leaf that separator sep and child pageNo do not fit in, inserting them after child pos
+ * and moving the upper half by bytes into newNode. The middle separator is pushed up and kept in neither
+ * node. With rightEdge set, for a child added after the last one, newNode gets pageNo alone and sep is pushed up.
+ * @return the separator to insert into the parent for newNode
+**/
+std::string splitStringNonLeaf(NonLeafNodeString* node, NonLeafNodeString* newNode, const int pos,
+		const std::string& sep, const PageId pageNo, const bool rightEdge);
+
+}
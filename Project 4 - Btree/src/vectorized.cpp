@@ -0,0 +1,589 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include "vectorized.h"
+#include "exceptions/unsupported_aggregate_exception.h"
+
+namespace badgerdb
+{
+
+// -----------------------------------------------------------------------------
+// VectorBatch::init
+// -----------------------------------------------------------------------------
+
+void VectorBatch::init(const Schema& schema)
+{
+	count = 0;
+	selective = false;
+	selectedCount = 0;
+	selection.resize(VECTORSIZE);
+	columns.resize(schema.columns.size());
+	for(size_t i = 0; i < schema.columns.size(); i++) {
+		ColumnVector& column = columns[i];
+		column.type = schema.columns[i].type;
+		column.length = schema.columns[i].length;
+		if(column.type == INTEGER) {
+			column.ints.resize(VECTORSIZE);
+		} else if(column.type == DOUBLE) {
+			column.doubles.resize(VECTORSIZE);
+		} else {
+			column.chars.resize(VECTORSIZE * column.length);
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------
+// VectorScanOperator::VectorScanOperator -- Constructor
+// -----------------------------------------------------------------------------
+
+VectorScanOperator::VectorScanOperator(const std::string & relationName, BufMgr *bufMgrIn, const Schema& recordSchema,
+		const std::vector<std::string>& columnNames)
+{
+	this->relationName = relationName;
+	this->bufMgr = bufMgrIn;
+	this->file = NULL;
+	this->curPage = NULL;
+	for(size_t i = 0; i < columnNames.size(); i++) {
+		const Column& column = recordSchema.columns[recordSchema.find(columnNames[i])];
+		recordColumns.push_back(column);
+		schema.addColumn(column.name, column.type, column.length);
+	}
+}
+
+VectorScanOperator::~VectorScanOperator()
+{
+	close();
+}
+
+// -----------------------------------------------------------------------------
+// VectorScanOperator::open
+// -----------------------------------------------------------------------------
+
+void VectorScanOperator::open()
+{
+	close();
+	file = new PageFile(relationName, false);
+	curPageNo = file->getFirstPageNo();
+	if(curPageNo != Page::INVALID_NUMBER) {
+		bufMgr->readPage(file, curPageNo, curPage);
+		recordIter = curPage->begin();
+	}
+}
+
+// -----------------------------------------------------------------------------
+// VectorScanOperator::next
+// -----------------------------------------------------------------------------
+
+bool VectorScanOperator::next(VectorBatch& batch)
+{
+	const char* records[VECTORSIZE];
+	batch.count = 0;
+	batch.selective = false;
+	while(curPage != NULL && batch.count < VECTORSIZE) {
+		// the records of one page are decoded together, while it is pinned
+		int start = batch.count;
+		int n = 0;
+		PageIterator end = curPage->end();
+		while(recordIter != end && start + n < VECTORSIZE) {
+			std::size_t length;
+			records[n++] = curPage->getRecordData(recordIter.getCurrentRecord(), &length);
+			++recordIter;
+		}
+		for(size_t c = 0; c < recordColumns.size(); c++) {
+			const int offset = recordColumns[c].offset;
+			ColumnVector& column = batch.columns[c];
+			if(column.type == INTEGER) {
+				int* out = &column.ints[start];
+				for(int i = 0; i < n; i++) {
+					memcpy(&out[i], records[i] + offset, sizeof(int));
+				}
+			} else if(column.type == DOUBLE) {
+				double* out = &column.doubles[start];
+				for(int i = 0; i < n; i++) {
+					memcpy(&out[i], records[i] + offset, sizeof(double));
+				}
+			} else {
+				char* out = &column.chars[start * column.length];
+				for(int i = 0; i < n; i++) {
+					memcpy(out + i * column.length, records[i] + offset, column.length);
+				}
+			}
+		}
+		batch.count += n;
+
+		if(recordIter == end) {
+			PageId nextPageNo = curPage->next_page_number();
+			bufMgr->unPinPage(file, curPageNo, false);
+			curPage = NULL;
+			if(nextPageNo != Page::INVALID_NUMBER) {
+				curPageNo = nextPageNo;
+				bufMgr->readPage(file, curPageNo, curPage);
+				recordIter = curPage->begin();
+			}
+		}
+	}
+	return batch.count > 0;
+}
+
+// -----------------------------------------------------------------------------
+// VectorScanOperator::close
+// -----------------------------------------------------------------------------
+
+void VectorScanOperator::close()
+{
+	if(curPage != NULL) {
+		bufMgr->unPinPage(file, curPageNo, false);
+		curPage = NULL;
+	}
+	if(file != NULL) {
+		bufMgr->flushFile(file);
+		delete file;
+		file = NULL;
+	}
+}
+
+// select the rows of batch whose value passes compare against constant, without branching on the result
+template <class T, class Compare>
+static int selectRows(const T* values, const double constant, const VectorBatch& batch, int* out)
+{
+	Compare compare;
+	int n = 0;
+	if(!batch.selective) {
+		for(int i = 0; i < batch.count; i++) {
+			out[n] = i;
+			n += compare(values[i], constant);
+		}
+	} else {
+		for(int k = 0; k < batch.selectedCount; k++) {
+			int i = batch.selection[k];
+			out[n] = i;
+			n += compare(values[i], constant);
+		}
+	}
+	return n;
+}
+
+template <class T>
+static int selectRows(const T* values, const Comparison comparison, const double constant, const VectorBatch& batch, int* out)
+{
+	switch(comparison) {
+		case CMPLT:
+			return selectRows<T, std::less<double> >(values, constant, batch, out);
+		case CMPLTE:
+			return selectRows<T, std::less_equal<double> >(values, constant, batch, out);
+		case CMPEQ:
+			return selectRows<T, std::equal_to<double> >(values, constant, batch, out);
+		case CMPNE:
+			return selectRows<T, std::not_equal_to<double> >(values, constant, batch, out);
+		case CMPGTE:
+			return selectRows<T, std::greater_equal<double> >(values, constant, batch, out);
+		default:
+			return selectRows<T, std::greater<double> >(values, constant, batch, out);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// VectorFilterOperator::VectorFilterOperator -- Constructor
+// -----------------------------------------------------------------------------
+
+VectorFilterOperator::VectorFilterOperator(VectorOperator *child, const std::string& columnName, const Comparison comparison, const double number)
+{
+	this->child = child;
+	this->schema = child->getSchema();
+	this->column = schema.find(columnName);
+	this->comparison = comparison;
+	this->number = number;
+}
+
+VectorFilterOperator::VectorFilterOperator(VectorOperator *child, const std::string& columnName, const Comparison comparison, const std::string& text)
+{
+	this->child = child;
+	this->schema = child->getSchema();
+	this->column = schema.find(columnName);
+	this->comparison = comparison;
+	this->number = 0;
+	this->text = text;
+}
+
+VectorFilterOperator::~VectorFilterOperator()
+{
+	delete child;
+}
+
+void VectorFilterOperator::open()
+{
+	child->open();
+}
+
+// -----------------------------------------------------------------------------
+// VectorFilterOperator::next
+// -----------------------------------------------------------------------------
+
+bool VectorFilterOperator::next(VectorBatch& batch)
+{
+	std::vector<int> order;
+	while(child->next(batch)) {
+		const ColumnVector& values = batch.columns[column];
+		int n;
+		if(values.type == INTEGER) {
+			n = selectRows(&values.ints[0], comparison, number, batch, &batch.selection[0]);
+		} else if(values.type == DOUBLE) {
+			n = selectRows(&values.doubles[0], comparison, number, batch, &batch.selection[0]);
+		} else {
+			// strings are compared once per row, the result is then selected on like a number
+			order.resize(batch.count);
+			for(int i = 0; i < batch.count; i++) {
+				order[i] = strncmp(&values.chars[i * values.length], text.c_str(), values.length);
+			}
+			n = selectRows(&order[0], comparison, 0, batch, &batch.selection[0]);
+		}
+		batch.selective = true;
+		batch.selectedCount = n;
+		if(n > 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void VectorFilterOperator::close()
+{
+	child->close();
+}
+
+// -----------------------------------------------------------------------------
+// VectorComputeOperator::VectorComputeOperator -- Constructor
+// -----------------------------------------------------------------------------
+
+VectorComputeOperator::VectorComputeOperator(VectorOperator *child)
+{
+	this->child = child;
+	this->schema = child->getSchema();
+}
+
+VectorComputeOperator::~VectorComputeOperator()
+{
+	delete child;
+}
+
+// -----------------------------------------------------------------------------
+// VectorComputeOperator::addColumn
+// -----------------------------------------------------------------------------
+
+void VectorComputeOperator::addColumn(const std::string& name, const std::string& leftColumn, const Arithmetic operation, const std::string& rightColumn)
+{
+	operations.push_back(operation);
+	leftColumns.push_back(schema.find(leftColumn));
+	rightColumns.push_back(schema.find(rightColumn));
+	constants.push_back(0);
+	schema.addColumn(name, DOUBLE);
+}
+
+void VectorComputeOperator::addColumn(const std::string& name, const std::string& leftColumn, const Arithmetic operation, const double constant)
+{
+	operations.push_back(operation);
+	leftColumns.push_back(schema.find(leftColumn));
+	rightColumns.push_back(-1);
+	constants.push_back(constant);
+	schema.addColumn(name, DOUBLE);
+}
+
+void VectorComputeOperator::open()
+{
+	leftValues.resize(VECTORSIZE);
+	rightValues.resize(VECTORSIZE);
+	child->open();
+}
+
+// copy a column of a batch into doubles
+static void loadDoubles(const ColumnVector& column, const int count, double* out)
+{
+	if(column.type == INTEGER) {
+		const int* values = &column.ints[0];
+		for(int i = 0; i < count; i++) {
+			out[i] = values[i];
+		}
+	} else {
+		memcpy(out, &column.doubles[0], count * sizeof(double));
+	}
+}
+
+// -----------------------------------------------------------------------------
+// VectorComputeOperator::next
+// -----------------------------------------------------------------------------
+
+bool VectorComputeOperator::next(VectorBatch& batch)
+{
+	if(!child->next(batch)) {
+		return false;
+	}
+	int first = child->getSchema().columns.size();
+	const int count = batch.count;
+	for(size_t j = 0; j < operations.size(); j++) {
+		double* left = &leftValues[0];
+		double* right = &rightValues[0];
+		double* out = &batch.columns[first + j].doubles[0];
+		loadDoubles(batch.columns[leftColumns[j]], count, left);
+		if(rightColumns[j] >= 0) {
+			loadDoubles(batch.columns[rightColumns[j]], count, right);
+		} else {
+			std::fill(right, right + count, constants[j]);
+		}
+		switch(operations[j]) {
+			case ARITHADD:
+				for(int i = 0; i < count; i++) out[i] = left[i] + right[i];
+				break;
+			case ARITHSUB:
+				for(int i = 0; i < count; i++) out[i] = left[i] - right[i];
+				break;
+			case ARITHMUL:
+				for(int i = 0; i < count; i++) out[i] = left[i] * right[i];
+				break;
+			case ARITHDIV:
+				for(int i = 0; i < count; i++) out[i] = left[i] / right[i];
+				break;
+		}
+	}
+	return true;
+}
+
+void VectorComputeOperator::close()
+{
+	child->close();
+}
+
+// -----------------------------------------------------------------------------
+// VectorAggregateOperator::VectorAggregateOperator -- Constructor
+// -----------------------------------------------------------------------------
+
+VectorAggregateOperator::VectorAggregateOperator(VectorOperator *child, const std::vector<std::string>& groupColumnNames,
+		const std::vector<AggregateSpec>& aggregates)
+{
+	this->child = child;
+	this->aggregates = aggregates;
+	const Schema& childSchema = child->getSchema();
+	for(size_t i = 0; i < groupColumnNames.size(); i++) {
+		int column = childSchema.find(groupColumnNames[i]);
+		groupColumns.push_back(column);
+		schema.addColumn(childSchema.columns[column].name, childSchema.columns[column].type, childSchema.columns[column].length);
+	}
+	for(size_t i = 0; i < aggregates.size(); i++) {
+		if(aggregates[i].function == AGGCOUNTDISTINCT || aggregates[i].function == AGGAPPROXCOUNTDISTINCT) {
+			delete child;
+			throw UnsupportedAggregateException(aggregates[i].name);
+		}
+		aggregateColumns.push_back(aggregates[i].column.empty() ? -1 : childSchema.find(aggregates[i].column));
+		schema.addColumn(aggregates[i].name, aggregates[i].function == AGGCOUNT ? INTEGER : DOUBLE);
+	}
+}
+
+VectorAggregateOperator::~VectorAggregateOperator()
+{
+	delete child;
+}
+
+// start a group with the values of the group columns in key
+static int addGroup(const char* key, const int keyLength, const std::vector<AggregateSpec>& aggregates,
+		std::vector<char>& groupKeys, std::vector<double>& counts, std::vector<double>& states)
+{
+	groupKeys.insert(groupKeys.end(), key, key + keyLength);
+	counts.push_back(0);
+	for(size_t i = 0; i < aggregates.size(); i++) {
+		if(aggregates[i].function == AGGMIN) {
+			states.push_back(std::numeric_limits<double>::infinity());
+		} else if(aggregates[i].function == AGGMAX) {
+			states.push_back(-std::numeric_limits<double>::infinity());
+		} else {
+			states.push_back(0);
+		}
+	}
+	return counts.size() - 1;
+}
+
+// -----------------------------------------------------------------------------
+// VectorAggregateOperator::mapGroups
+// -----------------------------------------------------------------------------
+
+void VectorAggregateOperator::mapGroups()
+{
+	const int rows = childBatch.rowCount();
+	const int* selection = &childBatch.selection[0];
+	const bool selective = childBatch.selective;
+	if(groupColumns.empty()) {
+		std::fill(rowGroups.begin(), rowGroups.begin() + childBatch.count, 0);
+		return;
+	}
+
+	if(groupColumns.size() == 1 && schema.columns[0].type == INTEGER) {
+		const int* values = &childBatch.columns[groupColumns[0]].ints[0];
+		for(int k = 0; k < rows; k++) {
+			int i = selective ? selection[k] : k;
+			std::unordered_map<int, int>::iterator it = intGroups.find(values[i]);
+			if(it == intGroups.end()) {
+				int group = addGroup((const char*)&values[i], sizeof(int), aggregates, groupKeys, counts, states);
+				it = intGroups.insert(std::make_pair(values[i], group)).first;
+			}
+			rowGroups[i] = it->second;
+		}
+		return;
+	}
+
+	const Column& last = schema.columns[groupColumns.size() - 1];
+	std::string key(last.offset + last.length, 0);
+	for(int k = 0; k < rows; k++) {
+		int i = selective ? selection[k] : k;
+		for(size_t c = 0; c < groupColumns.size(); c++) {
+			const ColumnVector& column = childBatch.columns[groupColumns[c]];
+			char* out = &key[schema.columns[c].offset];
+			if(column.type == INTEGER) {
+				memcpy(out, &column.ints[i], sizeof(int));
+			} else if(column.type == DOUBLE) {
+				memcpy(out, &column.doubles[i], sizeof(double));
+			} else {
+				memcpy(out, &column.chars[i * column.length], column.length);
+			}
+		}
+		std::unordered_map<std::string, int>::iterator it = keyGroups.find(key);
+		if(it == keyGroups.end()) {
+			int group = addGroup(key.data(), key.size(), aggregates, groupKeys, counts, states);
+			it = keyGroups.insert(std::make_pair(key, group)).first;
+		}
+		rowGroups[i] = it->second;
+	}
+}
+
+// fold the values of the rows of batch into the states of their groups
+template <class T>
+static void accumulate(const T* values, const int* groups, const VectorBatch& batch, const AggregateFunction function,
+		double* states, const int stride)
+{
+	const int rows = batch.rowCount();
+	const int* selection = &batch.selection[0];
+	if(function == AGGSUM || function == AGGAVG) {
+		if(!batch.selective) {
+			for(int i = 0; i < rows; i++) states[groups[i] * stride] += values[i];
+		} else {
+			for(int k = 0; k < rows; k++) states[groups[selection[k]] * stride] += values[selection[k]];
+		}
+	} else if(function == AGGMIN) {
+		for(int k = 0; k < rows; k++) {
+			int i = batch.selective ? selection[k] : k;
+			double& state = states[groups[i] * stride];
+			state = std::min(state, (double)values[i]);
+		}
+	} else if(function == AGGMAX) {
+		for(int k = 0; k < rows; k++) {
+			int i = batch.selective ? selection[k] : k;
+			double& state = states[groups[i] * stride];
+			state = std::max(state, (double)values[i]);
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------
+// VectorAggregateOperator::open
+// -----------------------------------------------------------------------------
+
+void VectorAggregateOperator::open()
+{
+	intGroups.clear();
+	keyGroups.clear();
+	groupKeys.clear();
+	counts.clear();
+	states.clear();
+	rowGroups.resize(VECTORSIZE);
+	if(groupColumns.empty()) {
+		addGroup(NULL, 0, aggregates, groupKeys, counts, states);
+	}
+
+	childBatch.init(child->getSchema());
+	child->open();
+	const int stride = aggregates.size();
+	while(child->next(childBatch)) {
+		mapGroups();
+		const int rows = childBatch.rowCount();
+		for(int k = 0; k < rows; k++) {
+			counts[rowGroups[childBatch.selective ? childBatch.selection[k] : k]]++;
+		}
+		for(size_t a = 0; a < aggregates.size(); a++) {
+			if(aggregateColumns[a] < 0 || aggregates[a].function == AGGCOUNT) {
+				continue;
+			}
+			const ColumnVector& column = childBatch.columns[aggregateColumns[a]];
+			if(column.type == INTEGER) {
+				accumulate(&column.ints[0], &rowGroups[0], childBatch, aggregates[a].function, &states[a], stride);
+			} else {
+				accumulate(&column.doubles[0], &rowGroups[0], childBatch, aggregates[a].function, &states[a], stride);
+			}
+		}
+	}
+	child->close();
+	nextGroup = 0;
+}
+
+// -----------------------------------------------------------------------------
+// VectorAggregateOperator::next
+// -----------------------------------------------------------------------------
+
+bool VectorAggregateOperator::next(VectorBatch& batch)
+{
+	int groupCount = counts.size();
+	if(nextGroup == groupCount) {
+		return false;
+	}
+	batch.count = std::min(VECTORSIZE, groupCount - nextGroup);
+	batch.selective = false;
+	int keyLength = groupColumns.empty() ? 0 : schema.columns[groupColumns.size() - 1].offset + schema.columns[groupColumns.size() - 1].length;
+	for(int r = 0; r < batch.count; r++) {
+		int group = nextGroup + r;
+		const char* key = groupKeys.empty() ? NULL : &groupKeys[group * keyLength];
+		for(size_t c = 0; c < groupColumns.size(); c++) {
+			ColumnVector& column = batch.columns[c];
+			if(column.type == INTEGER) {
+				memcpy(&column.ints[r], key + schema.columns[c].offset, sizeof(int));
+			} else if(column.type == DOUBLE) {
+				memcpy(&column.doubles[r], key + schema.columns[c].offset, sizeof(double));
+			} else {
+				memcpy(&column.chars[r * column.length], key + schema.columns[c].offset, column.length);
+			}
+		}
+		for(size_t a = 0; a < aggregates.size(); a++) {
+			ColumnVector& column = batch.columns[groupColumns.size() + a];
+			double state = states[group * aggregates.size() + a];
+			if(aggregates[a].function == AGGCOUNT) {
+				column.ints[r] = counts[group];
+			} else if(counts[group] == 0) {
+				column.doubles[r] = 0;
+			} else if(aggregates[a].function == AGGAVG) {
+				column.doubles[r] = state / counts[group];
+			} else {
+				column.doubles[r] = state;
+			}
+		}
+	}
+	nextGroup += batch.count;
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// VectorAggregateOperator::close
+// -----------------------------------------------------------------------------
+
+void VectorAggregateOperator::close()
+{
+	intGroups.clear();
+	keyGroups.clear();
+	std::vector<char>().swap(groupKeys);
+	std::vector<double>().swap(counts);
+	std::vector<double>().swap(states);
+}
+
+}
@@ -0,0 +1,365 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "page_iterator.h"
+#include "operators.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Most rows in a VectorBatch.
+ */
+const  int VECTORSIZE = 1024;
+
+/**
+ * @brief The values of one column of a VectorBatch, in the array for its type.
+ */
+struct ColumnVector{
+  /**
+   * Type of the column.
+   */
+	Datatype type;
+
+  /**
+   * Number of chars of each value of a STRING column.
+   */
+	int length;
+
+  /**
+   * Values of an INTEGER column.
+   */
+	std::vector<int> ints;
+
+  /**
+   * Values of a DOUBLE column.
+   */
+	std::vector<double> doubles;
+
+  /**
+   * Values of a STRING column, length chars each.
+   */
+	std::vector<char> chars;
+};
+
+/**
+ * @brief Up to VECTORSIZE rows, stored column by column.
+ * Filters do not move rows, they narrow the selection, so operators loop over the values of a column either
+ * for all count rows or for the rows in selection.
+*/
+struct VectorBatch{
+  /**
+   * Number of rows.
+   */
+	int count;
+
+  /**
+   * Columns in the order of the schema the batch was made for.
+   */
+	std::vector<ColumnVector> columns;
+
+  /**
+   * True if only the rows in selection are part of the result.
+   */
+	bool selective;
+
+  /**
+   * Positions of the selected rows, in increasing order.
+   */
+	std::vector<int> selection;
+
+  /**
+   * Number of entries of selection.
+   */
+	int selectedCount;
+
+  /**
+	 * Make room for VECTORSIZE rows of schema.
+	**/
+	void init(const Schema& schema);
+
+  /**
+	 * @return number of rows that are part of the result
+	**/
+	int rowCount() const { return selective ? selectedCount : count; }
+};
+
+/**
+ * @brief Comparisons of a column with a constant.
+ */
+enum Comparison
+{
+	CMPLT,
+	CMPLTE,
+	CMPEQ,
+	CMPNE,
+	CMPGTE,
+	CMPGT
+};
+
+/**
+ * @brief Arithmetic on two columns, or a column and a constant.
+ */
+enum Arithmetic
+{
+	ARITHADD,
+	ARITHSUB,
+	ARITHMUL,
+	ARITHDIV
+};
+
+/**
+ * @brief An operator of a vectorized query plan, which hands batches of rows to its parent instead of single
+ * tuples.
+ *
+ * The parent makes a batch with VectorBatch::init() for the schema of the operator, or for a schema that
+ * extends it with more columns, and passes the same batch to each call of next(). An operator fills the
+ * first getSchema().columns.size() columns, so an operator that only adds or filters columns passes the batch
+ * on to its child. As with QueryOperator, operators own their children.
+*/
+class VectorOperator {
+
+ protected:
+
+  /**
+   * Columns of the rows next() returns.
+   */
+	Schema	schema;
+
+ public:
+
+	virtual ~VectorOperator() {}
+
+  /**
+	 * Prepare to return rows, opening the children.
+	**/
+	virtual void open() = 0;
+
+  /**
+	 * Fill batch with the next rows, at least one of them selected.
+	 * @return false if there are no more rows
+	**/
+	virtual bool next(VectorBatch& batch) = 0;
+
+  /**
+	 * Release the pages and memory held, closing the children.
+	**/
+	virtual void close() = 0;
+
+  /**
+	 * @return columns of the rows next() returns
+	**/
+	const Schema& getSchema() const { return schema; }
+};
+
+/**
+ * @brief Decodes chosen columns of the records of a relation into batches, straight from the pinned pages.
+ * Pages are followed through their next page numbers, so each page is read once through the buffer pool.
+*/
+class VectorScanOperator : public VectorOperator {
+
+ private:
+
+	std::string	relationName;
+	BufMgr	*bufMgr;
+
+  /**
+   * Columns of the records that are decoded.
+   */
+	std::vector<Column>	recordColumns;
+
+  /**
+   * The relation, NULL unless the operator is open.
+   */
+	PageFile	*file;
+
+  /**
+   * Page being decoded, NULL once every page has been.
+   */
+	Page		*curPage;
+	PageId	curPageNo;
+
+  /**
+   * Next record of curPage to decode.
+   */
+	PageIterator	recordIter;
+
+ public:
+
+  /**
+   * @param recordSchema		Layout of the records of relationName
+   * @param columnNames		Columns to decode
+	**/
+	VectorScanOperator(const std::string & relationName, BufMgr *bufMgrIn, const Schema& recordSchema,
+						const std::vector<std::string>& columnNames);
+	~VectorScanOperator();
+	void open();
+	bool next(VectorBatch& batch);
+	void close();
+};
+
+/**
+ * @brief Narrows the selection of the batches of its child to the rows where a column compares with a
+ * constant as asked, e.g. IsHoliday = 'TRUE'. Batches left without rows are skipped.
+*/
+class VectorFilterOperator : public VectorOperator {
+
+ private:
+
+	VectorOperator	*child;
+	int			column;
+	Comparison	comparison;
+	double	number;
+	std::string	text;
+
+ public:
+
+  /**
+   * Compare an INTEGER or DOUBLE column with number.
+	**/
+	VectorFilterOperator(VectorOperator *child, const std::string& columnName, const Comparison comparison, const double number);
+
+  /**
+   * Compare a STRING column with text.
+	**/
+	VectorFilterOperator(VectorOperator *child, const std::string& columnName, const Comparison comparison, const std::string& text);
+	~VectorFilterOperator();
+	void open();
+	bool next(VectorBatch& batch);
+	void close();
+};
+
+/**
+ * @brief Appends DOUBLE columns computed from the columns of its child, e.g. WeeklySales/Size.
+ * Values are computed for every row of a batch, selected or not, in loops the compiler can vectorize.
+*/
+class VectorComputeOperator : public VectorOperator {
+
+ private:
+
+	VectorOperator	*child;
+
+  /**
+   * Per computed column: operation, position of the left operand, position of the right operand or -1 if it
+   * is a constant, and the constant.
+   */
+	std::vector<Arithmetic>	operations;
+	std::vector<int>	leftColumns;
+	std::vector<int>	rightColumns;
+	std::vector<double>	constants;
+
+  /**
+   * Operands as doubles.
+   */
+	std::vector<double>	leftValues;
+	std::vector<double>	rightValues;
+
+ public:
+
+	VectorComputeOperator(VectorOperator *child);
+	~VectorComputeOperator();
+
+  /**
+	 * Append column name = leftColumn operation rightColumn. Call before open().
+	**/
+	void addColumn(const std::string& name, const std::string& leftColumn, const Arithmetic operation, const std::string& rightColumn);
+
+  /**
+	 * Append column name = leftColumn operation constant. Call before open().
+	**/
+	void addColumn(const std::string& name, const std::string& leftColumn, const Arithmetic operation, const double constant);
+
+	void open();
+	bool next(VectorBatch& batch);
+	void close();
+};
+
+/**
+ * @brief GROUP BY over batches, with the result columns of AggregateOperator.
+ * Each batch is first mapped to group numbers, then each aggregate runs as one loop over the batch that
+ * updates an array of states indexed by group number. Groups come out in the order they were first seen.
+*/
+class VectorAggregateOperator : public VectorOperator {
+
+ private:
+
+	VectorOperator	*child;
+
+  /**
+   * Batch the child fills.
+   */
+	VectorBatch	childBatch;
+
+  /**
+   * Positions of the group columns in the schema of the child.
+   */
+	std::vector<int>	groupColumns;
+
+	std::vector<AggregateSpec>	aggregates;
+
+  /**
+   * Positions of the aggregated columns in the schema of the child, -1 for COUNT(*).
+   */
+	std::vector<int>	aggregateColumns;
+
+  /**
+   * Group numbers by the value of a single INTEGER group column.
+   */
+	std::unordered_map<int, int>	intGroups;
+
+  /**
+   * Group numbers by the bytes of the group columns, when they are not a single INTEGER column.
+   */
+	std::unordered_map<std::string, int>	keyGroups;
+
+  /**
+   * Values of the group columns of each group, as laid out in the result.
+   */
+	std::vector<char>	groupKeys;
+
+  /**
+   * Number of rows and value of each aggregate, by group.
+   */
+	std::vector<double>	counts;
+	std::vector<double>	states;
+
+  /**
+   * Group number of each row of the current batch.
+   */
+	std::vector<int>	rowGroups;
+
+  /**
+   * Next group to return.
+   */
+	int			nextGroup;
+
+  /**
+	 * Set rowGroups for the rows of childBatch, adding groups that are new.
+	**/
+	void mapGroups();
+
+ public:
+
+	VectorAggregateOperator(VectorOperator *child, const std::vector<std::string>& groupColumnNames,
+							const std::vector<AggregateSpec>& aggregates);
+	~VectorAggregateOperator();
+	void open();
+	bool next(VectorBatch& batch);
+	void close();
+};
+
+}